@@ -29,6 +29,17 @@ class MMapFunction(SystemFunction):
 			yield '<sys/types.h>'
 		yield '<sys/mman.h>'
 
+class InotifyFunction(SystemFunction):
+	name = 'inotify_init1'
+
+	@classmethod
+	def getMakeName(cls):
+		return 'INOTIFY'
+
+	@classmethod
+	def iterHeaders(cls, targetPlatform):
+		yield '<sys/inotify.h>'
+
 # Build a list of system functions using introspection.
 systemFunctions = [
 	obj
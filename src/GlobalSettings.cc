@@ -2,6 +2,7 @@
 
 #include "GlobalCommandController.hh"
 #include "SettingsConfig.hh"
+#include "TraceEvents.hh"
 
 namespace openmsx {
 
@@ -28,14 +29,21 @@ GlobalSettings::GlobalSettings(GlobalCommandController& commandController_)
 		EnumSetting<ResampledSoundDevice::ResampleType>::Map{
 			{"hq",   ResampledSoundDevice::ResampleType::HQ},
 			{"blip", ResampledSoundDevice::ResampleType::BLIP}})
+	, traceMemoryLimitSetting(commandController, "trace_memory_limit",
+		"Memory (in MB) used to store the values of probe and user traces, "
+		"when more is needed older values are moved to a temporary file",
+		1024, 16, 1024 * 1024)
 	, speedManager(commandController)
 	, throttleManager(commandController)
 {
 	getPowerSetting().attach(*this);
+	traceMemoryLimitSetting.attach(*this);
+	update(traceMemoryLimitSetting);
 }
 
 GlobalSettings::~GlobalSettings()
 {
+	traceMemoryLimitSetting.detach(*this);
 	getPowerSetting().detach(*this);
 	commandController.getSettingsConfig().setSaveSettings(
 		autoSaveSetting.getBoolean());
@@ -54,6 +62,9 @@ void GlobalSettings::update(const Setting& setting) noexcept
 			// Ignore. E.g. can trigger when a Tcl trace on the
 			// pause setting triggers errors in the Tcl script.
 		}
+	} else if (&setting == &traceMemoryLimitSetting) {
+		TraceStorage::instance().setMemoryLimit(
+			size_t(traceMemoryLimitSetting.getInt()) * 1024 * 1024);
 	}
 }
 
@@ -70,6 +70,7 @@ private:
 	StringSetting  invalidPsgDirectionsSetting;
 	StringSetting  invalidPpiModeSetting;
 	EnumSetting<ResampledSoundDevice::ResampleType> resampleSetting;
+	IntegerSetting traceMemoryLimitSetting;
 	SpeedManager speedManager;
 	ThrottleManager throttleManager;
 };
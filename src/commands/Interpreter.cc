@@ -450,6 +450,57 @@ char* Interpreter::traceProc(ClientData clientData, Tcl_Interp* interp,
 	return nullptr;
 }
 
+void Interpreter::registerLazyArray(zstring_view name, LazyArray& array)
+{
+	unregisterLazyArray(name, array);
+	// create an empty array (so that the trace is on an array variable)
+	setVariable(TclObject(name), TclObject("dummy"), TclObject());
+	Tcl_UnsetVar2(interp, name.c_str(), "dummy", TCL_GLOBAL_ONLY);
+	Tcl_TraceVar(interp, name.c_str(), TCL_TRACE_READS | TCL_TRACE_ARRAY,
+	             lazyArrayTraceProc, &array);
+}
+
+void Interpreter::unregisterLazyArray(zstring_view name, LazyArray& array)
+{
+	Tcl_UntraceVar(interp, name.c_str(), TCL_TRACE_READS | TCL_TRACE_ARRAY,
+	               lazyArrayTraceProc, &array);
+	unsetVariable(name.c_str());
+}
+
+char* Interpreter::lazyArrayTraceProc(ClientData clientData, Tcl_Interp* interp,
+                                      const char* part1, const char* part2, int flags)
+{
+	// Note: while this callback runs, Tcl doesn't trigger traces on this
+	// variable, so the getVar/setVar calls below don't recurse.
+	try {
+		auto& array = *static_cast<LazyArray*>(clientData);
+		// 'part1' is the name as used in the access (e.g. via 'upvar')
+		auto scope = flags & (TCL_GLOBAL_ONLY | TCL_NAMESPACE_ONLY);
+		auto setElement = [&](const char* index, const TclObject& value) {
+			// don't overwrite elements that were already resolved or
+			// that were explicitly set (e.g. via 'set sym(foo) 123')
+			if (Tcl_GetVar2Ex(interp, part1, index, scope)) return;
+			Tcl_SetVar2Ex(interp, part1, index, value.getTclObjectNonConst(), scope);
+		};
+		if ((flags & TCL_TRACE_READS) && part2) {
+			if (auto value = array.getElement(part2)) {
+				setElement(part2, *value);
+			}
+		}
+		if (flags & TCL_TRACE_ARRAY) {
+			auto all = array.getAllElements();
+			auto n = all.size();
+			for (size_t i = 0; i + 1 < n; i += 2) {
+				auto index = std::string(all.getListIndexUnchecked(i).getString());
+				setElement(index.c_str(), all.getListIndexUnchecked(i + 1));
+			}
+		}
+	} catch (...) {
+		UNREACHABLE; // we cannot let exceptions pass through Tcl
+	}
+	return nullptr;
+}
+
 void Interpreter::createNamespace(const std::string& name)
 {
 	execute(tmpStrCat("namespace eval ", name, " {}"));
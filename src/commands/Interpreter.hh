@@ -8,6 +8,7 @@
 
 #include "tcl.hh"
 
+#include <optional>
 #include <span>
 #include <string>
 #include <string_view>
@@ -42,6 +43,26 @@ public:
 	void setVariable(const TclObject& name, const TclObject& value);
 	void setVariable(const TclObject& arrayName, const TclObject& arrayIndex, const TclObject& value);
 	void unsetVariable(const char* name);
+
+	/** Provides the elements of a global Tcl array on demand, so that the
+	  * (possibly many) elements don't all have to be created upfront.
+	  */
+	class LazyArray {
+	public:
+		/** Value of the given element, nullopt if it doesn't exist. */
+		[[nodiscard]] virtual std::optional<TclObject> getElement(std::string_view index) = 0;
+		/** All elements, as a flat list of index/value pairs. Only
+		  * needed for the 'array' subcommands, e.g. 'array names'. */
+		[[nodiscard]] virtual TclObject getAllElements() = 0;
+	protected:
+		~LazyArray() = default;
+	};
+	/** (Re)create the global array with the given name, the existing
+	  * elements are removed. An element is only created (via 'array')
+	  * when it's read for the first time.
+	  */
+	void registerLazyArray(zstring_view name, LazyArray& array);
+	void unregisterLazyArray(zstring_view name, LazyArray& array);
 	void registerSetting(BaseSetting& variable);
 	void unregisterSetting(BaseSetting& variable);
 
@@ -71,6 +92,8 @@ private:
 	                       int objc, Tcl_Obj* const* objv);
 	static char* traceProc(ClientData clientData, Tcl_Interp* interp,
 	                       const char* part1, const char* part2, int flags);
+	static char* lazyArrayTraceProc(ClientData clientData, Tcl_Interp* interp,
+	                                const char* part1, const char* part2, int flags);
 
 	static Tcl_ChannelType channelType;
 	Tcl_Interp* interp;
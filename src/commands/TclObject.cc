@@ -182,6 +182,12 @@ std::span<const uint8_t> TclObject::getBinary(Interpreter& interp_) const
 	return {buf, size_t(length)};
 }
 
+bool TclObject::isByteArray() const
+{
+	static const Tcl_ObjType* byteArrayType = Tcl_GetObjType("bytearray");
+	return obj->typePtr && (obj->typePtr == byteArrayType);
+}
+
 size_t TclObject::getListLength(Interpreter& interp_) const
 {
 	auto* interp = interp_.interp;
@@ -164,6 +164,9 @@ public:
 	[[nodiscard]] float  getFloat (Interpreter& interp) const;
 	[[nodiscard]] double getDouble(Interpreter& interp) const;
 	[[nodiscard]] std::span<const uint8_t> getBinary(Interpreter& interp) const;
+	/** Is the internal representation a byte array (e.g. the result of
+	  * 'debug read_block')? Then getBinary() doesn't need a conversion. */
+	[[nodiscard]] bool isByteArray() const;
 	[[nodiscard]] size_t getListLength(Interpreter& interp) const;
 	[[nodiscard]] TclObject getListIndex(Interpreter& interp, size_t index) const;
 	[[nodiscard]] TclObject getListIndexUnchecked(size_t index) const;
@@ -165,8 +165,11 @@
 #include "R800.hh"
 #include "Z80.hh"
 
+#include "Debugger.hh"
+#include "InstructionTracer.hh"
 #include "MSXCliComm.hh"
 #include "MSXMotherBoard.hh"
+#include "Profiler.hh"
 #include "Scheduler.hh"
 #include "TclCallback.hh"
 #include "Thread.hh"
@@ -292,6 +295,8 @@ template<typename T> CPUCore<T>::CPUCore(
 	, T(time, motherboard_.getScheduler())
 	, motherboard(motherboard_)
 	, scheduler(motherboard.getScheduler())
+	, profiler(motherboard.getDebugger().getProfiler())
+	, instructionTracer(motherboard.getDebugger().getInstructionTracer())
 	, diHaltCallback(diHaltCallback_)
 	, IRQStatus(motherboard.getDebugger(), name + ".pendingIRQ",
 	            "Non-zero if there are pending IRQs (thus CPU would enter "
@@ -545,7 +550,7 @@ NEVER_INLINE uint8_t CPUCore<T>::RDMEMslow(unsigned address, unsigned cc)
 	interface->tick(CacheLineCounters::NonCachedRead);
 	// not cached
 	unsigned high = address >> CacheLine::BITS;
-        if (readCacheLine[high] == nullptr) {
+	if (readCacheLine[high] == nullptr) {
 		// try to cache now (not a valid entry, and not yet tried)
 		auto addrBase = narrow_cast<uint16_t>(address & CacheLine::HIGH);
 		if (const uint8_t* line = interface->getReadCacheLine(addrBase)) {
@@ -562,6 +567,9 @@ NEVER_INLINE uint8_t CPUCore<T>::RDMEMslow(unsigned address, unsigned cc)
 	EmuTime time = T::getTimeFast(cc);
 	scheduler.schedule(time);
 	uint8_t result = interface->readMem(narrow_cast<uint16_t>(address), time);
+	if (instructionTracer.isRecordingMemory()) [[unlikely]] {
+		instructionTracer.memoryAccess(narrow_cast<uint16_t>(address), result, false);
+	}
 	T::template POST_MEM<POST_PB>(address);
 	return result;
 }
@@ -667,6 +675,9 @@ NEVER_INLINE void CPUCore<T>::WRMEMslow(unsigned address, uint8_t value, unsigne
 	EmuTime time = T::getTimeFast(cc);
 	scheduler.schedule(time);
 	interface->writeMem(narrow_cast<uint16_t>(address), value, time);
+	if (instructionTracer.isRecordingMemory()) [[unlikely]] {
+		instructionTracer.memoryAccess(narrow_cast<uint16_t>(address), value, true);
+	}
 	T::template POST_MEM<POST_PB>(address);
 }
 template<typename T> template<bool PRE_PB, bool POST_PB>
@@ -848,16 +859,17 @@ void CPUCore<T>::executeInstructions()
 	};
 
 // Check T::limitReached(). If it's OK to continue,
-// fetch and execute next instruction.
+// fetch and execute next instruction. (Though stop before an instruction on
+// a breakpoint address, the first instruction is always executed).
 #define NEXT \
 	setPC(getPC() + ii.length); \
 	T::add(ii.cycles); \
 	T::R800Refresh(*this); \
 	if (!T::limitReached()) [[likely]] { \
-		incR(1); \
 		unsigned address = getPC(); \
 		const uint8_t* line = readCacheLine[address >> CacheLine::BITS]; \
 		if (uintptr_t(line) > 1) [[likely]] { \
+			incR(1); \
 			T::template PRE_MEM<false, false>(address); \
 			T::template POST_MEM<      false>(address); \
 			uint8_t op = line[address]; \
@@ -893,6 +905,10 @@ void CPUCore<T>::executeInstructions()
 	T::add(ii.cycles); \
 	T::R800Refresh(*this); \
 	if (!T::limitReached()) [[likely]] { \
+		if ((uintptr_t(readCacheLine[getPC() >> CacheLine::BITS]) <= 1) && \
+		    interface->hasBreakPoint(getPC())) [[unlikely]] { \
+			return; /* stop before an instruction with a breakpoint */ \
+		} \
 		goto start; \
 	} \
 	return;
@@ -926,6 +942,12 @@ start:
 
 fetchSlow: {
 	unsigned address = getPC();
+	if (interface->hasBreakPoint(address)) [[unlikely]] {
+		// Stop before this instruction (only possible for non-cached
+		// cache lines). See MSXCPUInterface::hasBreakPoint().
+		return;
+	}
+	incR(1);
 	uint8_t opcodeSlow = RDMEMslow<false, false>(address, T::CC_MAIN);
 	goto *(opcodeTable[opcodeSlow]);
 }
@@ -2503,6 +2525,25 @@ template<typename T> void CPUCore<T>::execute(bool fastForward)
 	interface->setFastForward(false);
 }
 
+template<typename T> NEVER_INLINE void CPUCore<T>::beginTraceInstruction()
+{
+	auto pc = getPC();
+	auto time = T::getTimeFast();
+	std::array<uint8_t, 4> bytes;
+	for (auto i : xrange(4)) {
+		auto addr = narrow_cast<uint16_t>(pc + i);
+		const uint8_t* line = readCacheLine[addr >> CacheLine::BITS];
+		bytes[i] = (uintptr_t(line) > 1) ? line[addr] : interface->peekMem(addr, time);
+	}
+	int page = pc >> 14;
+	auto ps = interface->getPrimarySlot(page);
+	auto slot = uint8_t(ps);
+	if (interface->isExpanded(ps)) {
+		slot |= uint8_t(0x10 | (interface->getSecondarySlot(page) << 2));
+	}
+	instructionTracer.beginInstruction(time, pc, slot, bytes);
+}
+
 template<typename T> void CPUCore<T>::execute2(bool fastForward)
 {
 	// note: Don't use getTimeFast() here, because 'once in a while' we
@@ -2511,11 +2552,15 @@ template<typename T> void CPUCore<T>::execute2(bool fastForward)
 	//       once in this method is enough.
 	scheduler.schedule(T::getTime());
 	setSlowInstructions();
+	interface->updateBreakPointSet();
 
 	// Note: we call scheduler _after_ executing the instruction and before
 	// deciding between executeFast() and executeSlow() (because a
 	// SyncPoint could set an IRQ and then we must choose executeSlow())
-	if (fastForward || !interface->anyBreakPoints()) {
+	bool profiling = !fastForward && profiler.isCounting();
+	bool tracing = !fastForward && instructionTracer.isRecording();
+	bool perInstruction = profiling || tracing;
+	if (fastForward || (!interface->anyBreakPoints() && !perInstruction)) {
 		// fast path, no breakpoints, no tracing
 		do {
 			if (slowInstructions) {
@@ -2537,8 +2582,50 @@ template<typename T> void CPUCore<T>::execute2(bool fastForward)
 				}
 			}
 		} while (!needExitCPULoop());
+	} else if (!interface->anyConditions() && !perInstruction) {
+		// Only breakpoints: still execute multiple instructions at once,
+		// executeInstructions() stops right before an instruction on a
+		// breakpoint address. Check the breakpoints at the same moments
+		// as the loop below (see comment there).
+		do {
+			bool executed = true;
+			if (slowInstructions) {
+				--slowInstructions;
+				executeSlow(getExecIRQ());
+			} else {
+				T::enableLimit(); // does CPUClock::sync()
+				if (!T::limitReached()) [[likely]] {
+					executeInstructions();
+					endInstruction();
+				} else {
+					executed = false;
+				}
+			}
+			scheduler.schedule(T::getTimeFast());
+
+			if (executed && (getExecIRQ() == ExecIRQ::NONE) &&
+			    interface->hasBreakPoint(getPC())) {
+				if (interface->checkBreakPoints(getPC())) {
+					assert(interface->isBreaked());
+					break;
+				}
+				// A breakpoint command created a condition,
+				// continue in the loop below on the next call.
+				if (interface->anyConditions()) break;
+			}
+		} while (!needExitCPULoop());
 	} else {
 		do {
+			// For exact profiling: remember the location (incl. slot
+			// and segment) of this instruction, and measure its
+			// duration (incl. a possible IRQ acceptance).
+			uint64_t profileKey = 0;
+			auto profileStart = EmuTime::zero();
+			if (profiling) {
+				profileKey = profiler.locate(getPC());
+				profileStart = T::getTimeFast();
+			}
+			if (tracing) beginTraceInstruction();
 			if (slowInstructions == 0) {
 				assert(T::limitReached()); // only one instruction
 				executeInstructions();
@@ -2547,6 +2634,10 @@ template<typename T> void CPUCore<T>::execute2(bool fastForward)
 				--slowInstructions;
 				executeSlow(getExecIRQ());
 			}
+			if (profiling) {
+				profiler.add(profileKey, T::getTimeFast() - profileStart);
+			}
+			if (tracing) instructionTracer.endInstruction(*this);
 			// Don't use getTimeFast() here, we need a call to
 			// CPUClock::sync() 'once in a while'. (During a
 			// reverse fast-forward this wasn't always the case).
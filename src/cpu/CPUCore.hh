@@ -18,9 +18,11 @@
 
 namespace openmsx {
 
+class InstructionTracer;
 class MSXCPUInterface;
 class Scheduler;
 class MSXMotherBoard;
+class Profiler;
 class TclCallback;
 enum Reg8  : uint8_t;
 enum Reg16 : uint8_t;
@@ -126,6 +128,7 @@ public:
 
 private:
 	void execute2(bool fastForward);
+	void beginTraceInstruction();
 	[[nodiscard]] bool needExitCPULoop();
 	void setSlowInstructions();
 	void doSetFreq();
@@ -141,6 +144,8 @@ private:
 	MSXMotherBoard& motherboard;
 	Scheduler& scheduler;
 	MSXCPUInterface* interface = nullptr;
+	Profiler& profiler;
+	InstructionTracer& instructionTracer;
 
 	TclCallback& diHaltCallback;
 
@@ -0,0 +1,632 @@
+#include "CompiledCondition.hh"
+
+#include "CPURegs.hh"
+
+#include "StringOp.hh"
+#include "one_of.hh"
+#include "unreachable.hh"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <span>
+#include <utility>
+
+namespace openmsx {
+
+// All (intermediate) values are kept within this range, so that the
+// arithmetic below can't overflow. Bigger values are left to Tcl.
+static constexpr int64_t LIMIT = int64_t(1) << 31;
+
+static constexpr size_t MAX_NODES = 256;
+static constexpr unsigned MAX_DEPTH = 64;
+
+namespace {
+
+// Thrown by the parser for anything outside the supported subset.
+struct Unsupported {};
+
+struct RegInfo {
+	std::string_view name;
+	bool word;
+	uint8_t index; // as in the "CPU regs" debuggable (for words: high byte)
+};
+constexpr auto regInfos = std::to_array<RegInfo>({
+	{"A",    false,  0}, {"F",    false,  1}, {"B",    false,  2}, {"C",    false,  3},
+	{"D",    false,  4}, {"E",    false,  5}, {"H",    false,  6}, {"L",    false,  7},
+	{"A2",   false,  8}, {"F2",   false,  9}, {"B2",   false, 10}, {"C2",   false, 11},
+	{"D2",   false, 12}, {"E2",   false, 13}, {"H2",   false, 14}, {"L2",   false, 15},
+	{"IXH",  false, 16}, {"IXL",  false, 17}, {"IYH",  false, 18}, {"IYL",  false, 19},
+	{"PCH",  false, 20}, {"PCL",  false, 21}, {"SPH",  false, 22}, {"SPL",  false, 23},
+	{"I",    false, 24}, {"R",    false, 25}, {"IM",   false, 26}, {"IFF",  false, 27},
+	{"AF",   true,   0}, {"BC",   true,   2}, {"DE",   true,   4}, {"HL",   true,   6},
+	{"AF2",  true,   8}, {"BC2",  true,  10}, {"DE2",  true,  12}, {"HL2",  true,  14},
+	{"IX",   true,  16}, {"IY",   true,  18}, {"PC",   true,  20}, {"SP",   true,  22},
+});
+constexpr uint8_t PC_INDEX = 20;
+
+} // namespace
+
+[[nodiscard]] static bool isSpace(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r') || (c == '\v') || (c == '\f');
+}
+
+[[nodiscard]] static bool isNameChar(char c)
+{
+	return (('a' <= c) && (c <= 'z')) || (('A' <= c) && (c <= 'Z')) ||
+	       (('0' <= c) && (c <= '9')) || (c == '_');
+}
+
+[[nodiscard]] static int digitValue(char c)
+{
+	if (('0' <= c) && (c <= '9')) return c - '0';
+	if (('a' <= c) && (c <= 'z')) return c - 'a' + 10;
+	if (('A' <= c) && (c <= 'Z')) return c - 'A' + 10;
+	return -1;
+}
+
+// Parses an integer literal at the start of 's' (and removes it from 's').
+static int64_t parseNumber(std::string_view& s)
+{
+	int base = 10;
+	if ((s.size() >= 2) && (s[0] == '0')) {
+		switch (s[1]) {
+		case 'x': case 'X': base = 16; break;
+		case 'o': case 'O': base = 8; break;
+		case 'b': case 'B': base = 2; break;
+		default:
+			// octal in Tcl 8, but decimal in Tcl 9
+			if (digitValue(s[1]) != -1) throw Unsupported{};
+		}
+		if (base != 10) s.remove_prefix(2);
+	}
+	int64_t result = 0;
+	size_t n = 0;
+	for (; n < s.size(); ++n) {
+		int d = digitValue(s[n]);
+		if ((d < 0) || (d >= base)) break;
+		result = result * base + d;
+		if (result >= LIMIT) throw Unsupported{};
+	}
+	if (n == 0) throw Unsupported{};
+	s.remove_prefix(n);
+	// floating point, or digits that don't match the base
+	if (!s.empty() && (isNameChar(s.front()) || (s.front() == '.'))) {
+		throw Unsupported{};
+	}
+	return result;
+}
+
+class CompiledCondition::Parser
+{
+public:
+	explicit Parser(std::string_view str) : s(str) {}
+
+	std::vector<Node> parse() {
+		parseSelect();
+		skipSpace();
+		if (!s.empty()) throw Unsupported{};
+		return std::move(nodes);
+	}
+
+private:
+	struct Nested {
+		explicit Nested(Parser& p_) : p(p_) {
+			if (++p.depth > MAX_DEPTH) throw Unsupported{};
+		}
+		Nested(const Nested&) = delete;
+		Nested& operator=(const Nested&) = delete;
+		~Nested() { --p.depth; }
+		Parser& p;
+	};
+
+	// An argument of a Tcl command: either a bare word or a substitution.
+	struct Word {
+		std::string_view bare;
+		uint16_t node = 0;
+	};
+
+	uint16_t add(const Node& node) {
+		if (nodes.size() >= MAX_NODES) throw Unsupported{};
+		nodes.push_back(node);
+		return uint16_t(nodes.size() - 1);
+	}
+
+	uint16_t numeric(uint16_t idx) const {
+		if (isBooleanOnly(nodes, idx)) throw Unsupported{};
+		return idx;
+	}
+
+	void skipSpace() {
+		while (!s.empty() && isSpace(s.front())) s.remove_prefix(1);
+	}
+	bool match(std::string_view token, std::string_view notFollowedBy = {}) {
+		skipSpace();
+		if (!s.starts_with(token)) return false;
+		if ((s.size() > token.size()) &&
+		    (notFollowedBy.find(s[token.size()]) != std::string_view::npos)) {
+			return false;
+		}
+		s.remove_prefix(token.size());
+		return true;
+	}
+
+	uint16_t parseSelect() {
+		Nested nested(*this);
+		auto cond = parseOr();
+		if (!match("?")) return cond;
+		auto t = parseSelect();
+		if (!match(":")) throw Unsupported{};
+		auto f = parseSelect();
+		return add({.op = Op::SELECT, .a = cond, .b = t, .c = f});
+	}
+	uint16_t parseOr() {
+		auto r = parseAnd();
+		while (match("||")) r = add({.op = Op::OR, .a = r, .b = parseAnd()});
+		return r;
+	}
+	uint16_t parseAnd() {
+		auto r = parseBitOr();
+		while (match("&&")) r = add({.op = Op::AND, .a = r, .b = parseBitOr()});
+		return r;
+	}
+	uint16_t parseBitOr() {
+		auto r = parseBitXor();
+		while (match("|", "|")) r = binary(Op::BIT_OR, r, parseBitXor());
+		return r;
+	}
+	uint16_t parseBitXor() {
+		auto r = parseBitAnd();
+		while (match("^")) r = binary(Op::BIT_XOR, r, parseBitAnd());
+		return r;
+	}
+	uint16_t parseBitAnd() {
+		auto r = parseEquality();
+		while (match("&", "&")) r = binary(Op::BIT_AND, r, parseEquality());
+		return r;
+	}
+	uint16_t parseEquality() {
+		auto r = parseRelational();
+		while (true) {
+			if      (match("==")) r = binary(Op::EQ, r, parseRelational());
+			else if (match("!=")) r = binary(Op::NE, r, parseRelational());
+			else return r;
+		}
+	}
+	uint16_t parseRelational() {
+		auto r = parseShift();
+		while (true) {
+			if      (match("<="))       r = binary(Op::LE, r, parseShift());
+			else if (match(">="))       r = binary(Op::GE, r, parseShift());
+			else if (match("<", "<"))   r = binary(Op::LT, r, parseShift());
+			else if (match(">", ">"))   r = binary(Op::GT, r, parseShift());
+			else return r;
+		}
+	}
+	uint16_t parseShift() {
+		auto r = parseAdditive();
+		while (true) {
+			if      (match("<<")) r = binary(Op::SHL, r, parseAdditive());
+			else if (match(">>")) r = binary(Op::SHR, r, parseAdditive());
+			else return r;
+		}
+	}
+	uint16_t parseAdditive() {
+		auto r = parseMultiplicative();
+		while (true) {
+			if      (match("+")) r = binary(Op::ADD, r, parseMultiplicative());
+			else if (match("-")) r = binary(Op::SUB, r, parseMultiplicative());
+			else return r;
+		}
+	}
+	uint16_t parseMultiplicative() {
+		auto r = parseUnary();
+		while (true) {
+			if      (match("*", "*")) r = binary(Op::MUL, r, parseUnary());
+			else if (match("/"))      r = binary(Op::DIV, r, parseUnary());
+			else if (match("%"))      r = binary(Op::MOD, r, parseUnary());
+			else return r;
+		}
+	}
+	uint16_t parseUnary() {
+		Nested nested(*this);
+		if (match("-")) return add({.op = Op::NEG, .a = numeric(parseUnary())});
+		if (match("+")) return numeric(parseUnary());
+		if (match("~")) return add({.op = Op::BIT_NOT, .a = numeric(parseUnary())});
+		if (match("!")) return add({.op = Op::NOT, .a = parseUnary()});
+		return parsePrimary();
+	}
+	uint16_t parsePrimary() {
+		if (match("(")) {
+			auto r = parseSelect();
+			if (!match(")")) throw Unsupported{};
+			return r;
+		}
+		if (match("[")) return parseCommand();
+		if (!s.empty() && (s.front() == '$')) return parseVariable();
+		return add({.op = Op::NUMBER, .value = parseNumber(s)});
+	}
+
+	uint16_t binary(Op op, uint16_t a, uint16_t b) {
+		return add({.op = op, .a = numeric(a), .b = numeric(b)});
+	}
+
+	uint16_t parseVariable() {
+		s.remove_prefix(1); // '$'
+		if (s.starts_with("::")) s.remove_prefix(2);
+		auto n = std::ranges::find_if_not(s, isNameChar) - s.begin();
+		auto name = s.substr(0, n);
+		s.remove_prefix(n);
+		if (!s.empty() && ((s.front() == ':') || (s.front() == '('))) {
+			throw Unsupported{}; // namespace or array
+		}
+		if (name == "wp_last_address") return add({.op = Op::WP_ADDRESS});
+		if (name == "wp_last_value")   return add({.op = Op::WP_VALUE});
+		throw Unsupported{};
+	}
+
+	// Parses a command substitution, the opening '[' is already consumed.
+	uint16_t parseCommand() {
+		Nested nested(*this);
+		std::vector<Word> words;
+		while (true) {
+			// (a newline or ';' would start a new command)
+			while (!s.empty() && ((s.front() == ' ') || (s.front() == '\t'))) s.remove_prefix(1);
+			if (s.empty()) throw Unsupported{};
+			if (s.front() == ']') {
+				s.remove_prefix(1);
+				break;
+			}
+			auto& w = words.emplace_back();
+			if (s.front() == '[') {
+				s.remove_prefix(1);
+				w.node = parseCommand();
+			} else if (s.front() == '$') {
+				w.node = parseVariable();
+			} else {
+				auto n = std::ranges::find_if_not(s, isNameChar) - s.begin();
+				if (n == 0) throw Unsupported{}; // e.g. quotes, braces
+				w.bare = s.substr(0, n);
+				s.remove_prefix(n);
+			}
+			if (!s.empty() && (s.front() != ' ') && (s.front() != '\t') && (s.front() != ']')) {
+				throw Unsupported{};
+			}
+		}
+		if (words.empty()) throw Unsupported{};
+		return interpretCommand(words);
+	}
+
+	uint16_t argument(const Word& w) {
+		if (w.bare.empty()) return numeric(w.node);
+		auto str = w.bare;
+		return add({.op = Op::NUMBER, .value = parseNumber(str)});
+	}
+	static int64_t slotArgument(const Word& w) {
+		if (w.bare == "X") return -1;
+		if (w.bare.empty()) throw Unsupported{};
+		auto str = w.bare;
+		auto slot = parseNumber(str);
+		if (slot > 3) throw Unsupported{};
+		return slot;
+	}
+
+	uint16_t interpretCommand(std::span<const Word> words) {
+		auto cmd = words[0].bare;
+		auto numArgs = words.size() - 1;
+		if (cmd == "reg") {
+			// with a 2nd argument 'reg' writes the register
+			if ((numArgs != 1) || words[1].bare.empty()) throw Unsupported{};
+			auto it = std::ranges::find_if(regInfos, [&](const auto& info) {
+				return StringOp::casecmp()(info.name, words[1].bare);
+			});
+			if (it == regInfos.end()) throw Unsupported{};
+			return add({.op = it->word ? Op::REG16 : Op::REG8, .value = it->index});
+		}
+		if (cmd == "debug") {
+			if ((numArgs != 3) || (words[1].bare != "read") || (words[2].bare != "memory")) {
+				throw Unsupported{};
+			}
+			return add({.op = Op::PEEK_U8, .a = argument(words[3])});
+		}
+		if (cmd == one_of("pc_in_slot", "watch_in_slot")) {
+			if ((numArgs < 1) || (numArgs > 3)) throw Unsupported{};
+			if ((numArgs == 3) && (words[3].bare != "X")) throw Unsupported{}; // mapper
+			auto ps = slotArgument(words[1]);
+			auto ss = (numArgs >= 2) ? slotArgument(words[2]) : -1;
+			auto addr = (cmd == "pc_in_slot")
+			          ? add({.op = Op::REG16, .value = PC_INDEX})
+			          : add({.op = Op::WP_ADDRESS});
+			return add({.op = Op::IN_SLOT, .value = 4 * (ps + 1) + (ss + 1), .a = addr});
+		}
+
+		static constexpr auto peeks = std::to_array<std::pair<std::string_view, Op>>({
+			{"peek",        Op::PEEK_U8},
+			{"peek8",       Op::PEEK_U8},
+			{"peek_u8",     Op::PEEK_U8},
+			{"peek_s8",     Op::PEEK_S8},
+			{"peek16",      Op::PEEK_U16_LE},
+			{"peek16_LE",   Op::PEEK_U16_LE},
+			{"peek16_BE",   Op::PEEK_U16_BE},
+			{"peek_u16",    Op::PEEK_U16_LE},
+			{"peek_u16LE",  Op::PEEK_U16_LE},
+			{"peek_u16BE",  Op::PEEK_U16_BE},
+			{"peek_s16",    Op::PEEK_S16_LE},
+			{"peek_s16LE",  Op::PEEK_S16_LE},
+			{"peek_s16BE",  Op::PEEK_S16_BE},
+		});
+		auto it = std::ranges::find(peeks, cmd, &std::pair<std::string_view, Op>::first);
+		if (it == peeks.end()) throw Unsupported{};
+		if ((numArgs < 1) || (numArgs > 2)) throw Unsupported{};
+		if ((numArgs == 2) && (words[2].bare != "memory")) throw Unsupported{};
+		return add({.op = it->second, .a = argument(words[1])});
+	}
+
+private:
+	std::string_view s; // remaining input
+	std::vector<Node> nodes;
+	unsigned depth = 0;
+};
+
+std::shared_ptr<const CompiledCondition> CompiledCondition::compile(std::string_view expr)
+{
+	try {
+		auto result = std::make_shared<CompiledCondition>();
+		result->nodes = Parser(expr).parse();
+		result->collectInputs();
+		return result;
+	} catch (Unsupported&) {
+		return nullptr;
+	}
+}
+
+std::optional<bool> CompiledCondition::evaluate(const Context& context) const
+{
+	assert(!nodes.empty());
+	auto r = eval(uint16_t(nodes.size() - 1), context);
+	if (!r) return {};
+	return *r != 0;
+}
+
+std::optional<int64_t> CompiledCondition::evaluateValue(const Context& context) const
+{
+	assert(!nodes.empty());
+	auto root = unsigned(nodes.size() - 1);
+	if (isBooleanOnly(nodes, root)) return {};
+	return eval(root, context);
+}
+
+// 'pc_in_slot' returns "true" (not 1), only use it as a boolean
+bool CompiledCondition::isBooleanOnly(std::span<const Node> nodes, unsigned idx)
+{
+	const auto& n = nodes[idx];
+	return (n.op == Op::IN_SLOT) ||
+	       ((n.op == Op::SELECT) && (isBooleanOnly(nodes, n.b) || isBooleanOnly(nodes, n.c)));
+}
+
+void CompiledCondition::collectInputs()
+{
+	auto peekAt = [&](const Node& n, unsigned size) {
+		// only track peeks at a constant address
+		const auto& addr = nodes[n.a];
+		if ((addr.op != Op::NUMBER) || (addr.value < 0) || (addr.value > 0xffff)) {
+			inputs.dynamic = true;
+			return;
+		}
+		for (unsigned i = 0; i < size; ++i) {
+			if (addr.value + i > 0xffff) break; // evaluation declines
+			inputs.addresses.push_back(uint16_t(addr.value + i));
+		}
+	};
+	for (const auto& n : nodes) {
+		switch (n.op) {
+		case Op::REG8:
+			inputs.regs |= 1u << n.value;
+			break;
+		case Op::REG16:
+			inputs.regs |= 3u << n.value;
+			break;
+		case Op::PEEK_U8:
+		case Op::PEEK_S8:
+			peekAt(n, 1);
+			break;
+		case Op::PEEK_U16_LE:
+		case Op::PEEK_U16_BE:
+		case Op::PEEK_S16_LE:
+		case Op::PEEK_S16_BE:
+			peekAt(n, 2);
+			break;
+		case Op::WP_ADDRESS:
+		case Op::WP_VALUE:
+		case Op::IN_SLOT:
+			inputs.dynamic = true;
+			break;
+		default:
+			break;
+		}
+	}
+	std::ranges::sort(inputs.addresses);
+	auto [first, last] = std::ranges::unique(inputs.addresses);
+	inputs.addresses.erase(first, last);
+}
+
+[[nodiscard]] static uint8_t readReg(const CPURegs& regs, int64_t index)
+{
+	switch (index) {
+	case  0: return regs.getA();
+	case  1: return regs.getF();
+	case  2: return regs.getB();
+	case  3: return regs.getC();
+	case  4: return regs.getD();
+	case  5: return regs.getE();
+	case  6: return regs.getH();
+	case  7: return regs.getL();
+	case  8: return regs.getA2();
+	case  9: return regs.getF2();
+	case 10: return regs.getB2();
+	case 11: return regs.getC2();
+	case 12: return regs.getD2();
+	case 13: return regs.getE2();
+	case 14: return regs.getH2();
+	case 15: return regs.getL2();
+	case 16: return regs.getIXh();
+	case 17: return regs.getIXl();
+	case 18: return regs.getIYh();
+	case 19: return regs.getIYl();
+	case 20: return regs.getPCh();
+	case 21: return regs.getPCl();
+	case 22: return regs.getSPh();
+	case 23: return regs.getSPl();
+	case 24: return regs.getI();
+	case 25: return regs.getR();
+	case 26: return regs.getIM();
+	case 27: return uint8_t(1 *  regs.getIFF1() +
+	                        2 *  regs.getIFF2() +
+	                        4 * (regs.getIFF1() && !regs.prevWasEI()));
+	default: UNREACHABLE;
+	}
+}
+
+std::optional<int64_t> CompiledCondition::eval(unsigned idx, const Context& context) const
+{
+	const auto& n = nodes[idx];
+	auto peek = [&](int64_t addr) -> std::optional<int64_t> {
+		if ((addr < 0) || (addr > 0xffff)) return {}; // error in Tcl
+		return context.machine.peekMem(uint16_t(addr), context.time);
+	};
+	auto peek16 = [&](int64_t addr, bool bigEndian) -> std::optional<int64_t> {
+		auto b0 = peek(addr);
+		auto b1 = peek(addr + 1);
+		if (!b0 || !b1) return {};
+		return bigEndian ? (256 * *b0 + *b1) : (*b0 + 256 * *b1);
+	};
+	auto checked = [](int64_t v) -> std::optional<int64_t> {
+		if ((v <= -LIMIT) || (v >= LIMIT)) return {};
+		return v;
+	};
+
+	switch (n.op) {
+	case Op::NUMBER:
+		return n.value;
+	case Op::REG8:
+		return readReg(context.regs, n.value);
+	case Op::REG16:
+		return 256 * readReg(context.regs, n.value) + readReg(context.regs, n.value + 1);
+	case Op::WP_ADDRESS:
+		if (!context.wpLastAddress) return {};
+		return *context.wpLastAddress;
+	case Op::WP_VALUE:
+		if (!context.wpLastValue) return {};
+		return *context.wpLastValue;
+	default:
+		break;
+	}
+
+	auto a = eval(n.a, context);
+	if (!a) return {};
+	switch (n.op) {
+	case Op::PEEK_U8:
+		return peek(*a);
+	case Op::PEEK_S8: {
+		auto v = peek(*a);
+		if (!v) return {};
+		return (*v < 128) ? *v : (*v - 256);
+	}
+	case Op::PEEK_U16_LE:
+		return peek16(*a, false);
+	case Op::PEEK_U16_BE:
+		return peek16(*a, true);
+	case Op::PEEK_S16_LE:
+	case Op::PEEK_S16_BE: {
+		auto v = peek16(*a, n.op == Op::PEEK_S16_BE);
+		if (!v) return {};
+		return (*v < 32768) ? *v : (*v - 65536);
+	}
+	case Op::IN_SLOT: {
+		// see 'address_in_slot' in _slot.tcl
+		if ((*a < 0) || (*a > 0xffff)) return {};
+		auto page = int(*a >> 14);
+		auto ps = int(n.value / 4) - 1;
+		auto ss = int(n.value % 4) - 1;
+		const auto& machine = context.machine;
+		auto curPs = machine.getPrimarySlot(page);
+		if ((ps != -1) && (curPs != ps)) return 0;
+		if ((ss != -1) && machine.isExpanded(curPs) &&
+		    (machine.getSecondarySlot(page) != ss)) return 0;
+		return 1;
+	}
+	case Op::NEG:
+		return -*a;
+	case Op::NOT:
+		return *a == 0;
+	case Op::BIT_NOT:
+		return checked(~*a);
+	case Op::AND: {
+		if (*a == 0) return 0;
+		auto b = eval(n.b, context);
+		if (!b) return {};
+		return *b != 0;
+	}
+	case Op::OR: {
+		if (*a != 0) return 1;
+		auto b = eval(n.b, context);
+		if (!b) return {};
+		return *b != 0;
+	}
+	case Op::SELECT:
+		return eval((*a != 0) ? n.b : n.c, context);
+	default:
+		break;
+	}
+
+	auto b = eval(n.b, context);
+	if (!b) return {};
+	switch (n.op) {
+	case Op::MUL: return checked(*a * *b);
+	case Op::DIV: {
+		if (*b == 0) return {};
+		// Tcl rounds towards negative infinity
+		auto q = *a / *b;
+		if (((*a % *b) != 0) && ((*a < 0) != (*b < 0))) --q;
+		return q;
+	}
+	case Op::MOD: {
+		if (*b == 0) return {};
+		// the result has the sign of the divisor
+		auto r = *a % *b;
+		if ((r != 0) && ((r < 0) != (*b < 0))) r += *b;
+		return r;
+	}
+	case Op::ADD: return checked(*a + *b);
+	case Op::SUB: return checked(*a - *b);
+	case Op::SHL:
+		if ((*b < 0) || (*b >= 32)) return {};
+		return checked(*a << *b);
+	case Op::SHR:
+		if (*b < 0) return {};
+		return *a >> std::min<int64_t>(*b, 63);
+	case Op::LT: return *a <  *b;
+	case Op::GT: return *a >  *b;
+	case Op::LE: return *a <= *b;
+	case Op::GE: return *a >= *b;
+	case Op::EQ: return *a == *b;
+	case Op::NE: return *a != *b;
+	case Op::BIT_AND: return checked(*a & *b);
+	case Op::BIT_XOR: return checked(*a ^ *b);
+	case Op::BIT_OR:  return checked(*a | *b);
+	default: UNREACHABLE;
+	}
+}
+
+void CompiledCondition::readInputs(const Context& context, std::vector<uint8_t>& result) const
+{
+	for (auto addr : inputs.addresses) {
+		result.push_back(context.machine.peekMem(addr, context.time));
+	}
+	for (unsigned i = 0; i < 32; ++i) {
+		if (inputs.regs & (1u << i)) result.push_back(readReg(context.regs, i));
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,112 @@
+#ifndef COMPILEDCONDITION_HH
+#define COMPILEDCONDITION_HH
+
+#include "EmuTime.hh"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace openmsx {
+
+class CPURegs;
+
+/** Native evaluation of (the common subset of) breakpoint, watchpoint and
+  * debug condition expressions. Evaluating such a condition via Tcl after
+  * every instruction dominates the run time of e.g. 'debug set_condition'.
+  *
+  * Supported are integer literals, the arithmetic, bitwise, comparison and
+  * logical operators, '?:', '$wp_last_address', '$wp_last_value' and the
+  * commands 'reg', the 'peek' family, 'pc_in_slot' and 'watch_in_slot'
+  * (without the mapper argument). This assumes these commands have their
+  * standard implementation (from the openMSX scripts).
+  *
+  * Anything else makes compile() fail, and then the caller should use Tcl.
+  * Also evaluate() may decline (e.g. on a division by zero or an
+  * out-of-range address), in that case too Tcl must be used, so that the
+  * outcome (including the error message) is exactly the same.
+  */
+class CompiledCondition
+{
+public:
+	/** The machine state, besides the CPU registers, that a condition can
+	  * look at. Implemented by MSXCPUInterface.
+	  */
+	class Machine {
+	public:
+		[[nodiscard]] virtual uint8_t peekMem(uint16_t address, EmuTime time) const = 0;
+		[[nodiscard]] virtual int getPrimarySlot(int page) const = 0;
+		[[nodiscard]] virtual int getSecondarySlot(int page) const = 0;
+		[[nodiscard]] virtual bool isExpanded(int ps) const = 0;
+	protected:
+		~Machine() = default;
+	};
+
+	struct Context {
+		const CPURegs& regs;
+		const Machine& machine;
+		EmuTime time;
+		std::optional<unsigned> wpLastAddress = {};
+		std::optional<unsigned> wpLastValue = {};
+	};
+
+	/** Returns nullptr when the expression is not supported. */
+	[[nodiscard]] static std::shared_ptr<const CompiledCondition> compile(std::string_view expr);
+
+	/** Returns nullopt when the expression must be evaluated by Tcl. */
+	[[nodiscard]] std::optional<bool> evaluate(const Context& context) const;
+
+	/** Like evaluate(), but returns the value of the expression (the same
+	  * value Tcl's 'expr' would return). Also returns nullopt when that
+	  * value isn't an integer (e.g. the "true" from 'pc_in_slot').
+	  */
+	[[nodiscard]] std::optional<int64_t> evaluateValue(const Context& context) const;
+
+	/** The (memory and register) inputs of the expression. When the current
+	  * values of these inputs are the same as before, the result of the
+	  * expression didn't change either. Except when 'dynamic' is set, then
+	  * the result (also) depends on something else, e.g. on a peek at a
+	  * computed address or on the slot selection.
+	  */
+	struct Inputs {
+		std::vector<uint16_t> addresses;
+		uint32_t regs = 0; // bitmask, indices as in the "CPU regs" debuggable
+		bool dynamic = false;
+	};
+	[[nodiscard]] const Inputs& getInputs() const { return inputs; }
+
+	/** Append the current values of all inputs to 'result'. */
+	void readInputs(const Context& context, std::vector<uint8_t>& result) const;
+
+private:
+	enum class Op : uint8_t {
+		NUMBER, REG8, REG16, WP_ADDRESS, WP_VALUE,
+		PEEK_U8, PEEK_S8, PEEK_U16_LE, PEEK_U16_BE, PEEK_S16_LE, PEEK_S16_BE,
+		IN_SLOT,
+		NEG, NOT, BIT_NOT,
+		MUL, DIV, MOD, ADD, SUB, SHL, SHR,
+		LT, GT, LE, GE, EQ, NE,
+		BIT_AND, BIT_XOR, BIT_OR, AND, OR, SELECT,
+	};
+	struct Node {
+		Op op;
+		int64_t value = 0; // number, register number or slot numbers
+		uint16_t a = 0, b = 0, c = 0; // operands (index in 'nodes')
+	};
+	class Parser;
+
+	[[nodiscard]] static bool isBooleanOnly(std::span<const Node> nodes, unsigned idx);
+	[[nodiscard]] std::optional<int64_t> eval(unsigned idx, const Context& context) const;
+	void collectInputs();
+
+private:
+	std::vector<Node> nodes; // the root is the last node
+	Inputs inputs;
+};
+
+} // namespace openmsx
+
+#endif
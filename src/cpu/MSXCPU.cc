@@ -316,6 +316,11 @@ bool MSXCPU::isM1Cycle(unsigned address) const
 	                 : r800->isM1Cycle(address);
 }
 
+unsigned MSXCPU::getFreq() const
+{
+	return z80Active ? z80->getFreq() : r800->getFreq();
+}
+
 void MSXCPU::setZ80Freq(unsigned freq)
 {
 	z80->setFreq(freq);
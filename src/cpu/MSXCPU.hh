@@ -132,6 +132,9 @@ public:
 	/** Is the R800 currently active? */
 	[[nodiscard]] bool isR800Active() const { return !z80Active; }
 
+	/** Frequency of the currently active CPU. */
+	[[nodiscard]] unsigned getFreq() const;
+
 	/** Switch the Z80 clock freq. */
 	void setZ80Freq(unsigned freq);
 
@@ -3,6 +3,7 @@
 #include "BooleanSetting.hh"
 #include "CartridgeSlotManager.hh"
 #include "CommandException.hh"
+#include "Debugger.hh"
 #include "DeviceFactory.hh"
 #include "DummyDevice.hh"
 #include "Event.hh"
@@ -16,6 +17,7 @@
 #include "MSXMotherBoard.hh"
 #include "MSXMultiIODevice.hh"
 #include "MSXMultiMemDevice.hh"
+#include "Profiler.hh"
 #include "Reactor.hh"
 #include "ReadOnlySetting.hh"
 #include "RealTime.hh"
@@ -26,6 +28,8 @@
 #include "WatchPoint.hh"
 #include "serialize.hh"
 
+#include "enumerate.hh"
+#include "function_ref.hh"
 #include "narrow.hh"
 #include "outer.hh"
 #include "stl.hh"
@@ -49,6 +53,8 @@ static unsigned breakedSettingCount = 0;
 static constexpr uint8_t SECONDARY_SLOT_BIT = 0x01;
 static constexpr uint8_t MEMORY_WATCH_BIT   = 0x02;
 static constexpr uint8_t GLOBAL_RW_BIT      = 0x04;
+static constexpr uint8_t BREAKPOINT_BIT     = 0x08;
+static constexpr uint8_t MEMORY_TRACE_BIT   = 0x10;
 
 std::ostream& operator<<(std::ostream& os, EnumTypeName<CacheLineCounters>)
 {
@@ -88,6 +94,7 @@ MSXCPUInterface::MSXCPUInterface(MSXMotherBoard& motherBoard_)
 	, dummyDevice(DeviceFactory::createDummyDevice(
 		*motherBoard_.getMachineConfig()))
 	, msxcpu(motherBoard_.getCPU())
+	, profiler(motherBoard_.getDebugger().getProfiler())
 	, cliComm(motherBoard_.getMSXCliComm())
 	, motherBoard(motherBoard_)
 	, pauseSetting(motherBoard.getReactor().getGlobalSettings().getPauseSetting())
@@ -190,8 +197,8 @@ void MSXCPUInterface::removeAllWatchPoints()
 uint8_t MSXCPUInterface::readMemSlow(uint16_t address, EmuTime time)
 {
 	tick(CacheLineCounters::DisallowCacheRead);
-	// something special in this region?
-	if (disallowReadCache[address >> CacheLine::BITS]) [[unlikely]] {
+	// something special in this region? (other than just being traced)
+	if (disallowReadCache[address >> CacheLine::BITS] & ~MEMORY_TRACE_BIT) [[unlikely]] {
 		// slot-select-ignore reads (e.g. used in 'Carnivore2')
 		for (auto& g : globalReads) {
 			// very primitive address selection mechanism,
@@ -224,8 +231,8 @@ void MSXCPUInterface::writeMemSlow(uint16_t address, uint8_t value, EmuTime time
 	} else {
 		visibleDevices[address>>14]->writeMem(address, value, time);
 	}
-	// something special in this region?
-	if (disallowWriteCache[address >> CacheLine::BITS]) [[unlikely]] {
+	// something special in this region? (other than just being traced)
+	if (disallowWriteCache[address >> CacheLine::BITS] & ~MEMORY_TRACE_BIT) [[unlikely]] {
 		// slot-select-ignore writes (Super Lode Runner)
 		for (auto& g : globalWrites) {
 			// very primitive address selection mechanism,
@@ -655,6 +662,7 @@ ALWAYS_INLINE void MSXCPUInterface::updateVisible(uint8_t page, uint8_t ps, uint
 	if (visibleDevices[page] != newDevice) {
 		visibleDevices[page] = newDevice;
 		msxcpu.updateVisiblePage(page, ps, ss);
+		profiler.visibleDeviceChanged(page);
 	}
 }
 void MSXCPUInterface::updateVisible(uint8_t page)
@@ -773,34 +781,26 @@ uint8_t MSXCPUInterface::peekMem(uint16_t address, EmuTime time) const
 	}
 }
 
-// Similar to peekSlottedMem(), but can read a whole block at once
-void MSXCPUInterface::peekSlottedMemBlock(unsigned address, std::span<uint8_t> output, EmuTime time) const
+// Read a block of memory: per cache line either copy the whole line at once,
+// or (if the device doesn't provide a read cache line) read byte per byte.
+static void peekBlockHelper(
+	unsigned address, std::span<uint8_t> output,
+	function_ref<const uint8_t*(unsigned)> getCacheLine,
+	function_ref<uint8_t(unsigned)> peek)
 {
-	auto getCacheLine = [&]() -> const uint8_t* {
-		uint8_t primSlot = (address & 0xC0000) >> 18;
-		bool exp = isExpanded(primSlot);
-		uint16_t offset = (address & (0xFFFF & CacheLine::HIGH)); // includes page
-		if ((offset == (0xFFFF & CacheLine::HIGH)) && exp) {
-			return nullptr;
-		} else {
-			uint8_t subSlot = exp ? ((address & 0x30000) >> 16) : 0;
-			uint8_t page = (address & 0x0C000) >> 14;
-			return slotLayout[primSlot][subSlot][page]->getReadCacheLine(offset);
-		}
-	};
 	auto processChunk = [&](size_t start, size_t n) {
 		assert(start < CacheLine::SIZE);
 		assert((start + n) <= CacheLine::SIZE);
 
-		if (const auto* line = getCacheLine()) {
+		if (const auto* line = getCacheLine(address)) {
 			copy_to_range(std::span{line + start, n}, output);
 		} else {
 			for (auto i : xrange(n)) {
-				output[i] = peekSlottedMem(narrow<unsigned>(address + i), time);
+				output[i] = peek(narrow<unsigned>(address + i));
 			}
 		}
 		output = output.subspan(n);
-		address += n;
+		address += narrow<unsigned>(n);
 	};
 
 	if (auto l = address & CacheLine::LOW) { // start not aligned on cacheline boundary
@@ -816,6 +816,40 @@ void MSXCPUInterface::peekSlottedMemBlock(unsigned address, std::span<uint8_t> o
 	assert(output.empty()); // fully processed
 }
 
+// Similar to peekMem(), but can read a whole block at once
+void MSXCPUInterface::peekMemBlock(uint16_t address, std::span<uint8_t> output, EmuTime time) const
+{
+	assert((address + output.size()) <= 0x10000);
+	peekBlockHelper(address, output,
+		[&](unsigned addr) -> const uint8_t* {
+			uint16_t offset = addr & (0xFFFF & CacheLine::HIGH); // includes page
+			if ((offset == (0xFFFF & CacheLine::HIGH)) && isExpanded(primarySlotState[3])) {
+				return nullptr;
+			}
+			return visibleDevices[offset >> 14]->getReadCacheLine(offset);
+		},
+		[&](unsigned addr) { return peekMem(narrow<uint16_t>(addr), time); });
+}
+
+// Similar to peekSlottedMem(), but can read a whole block at once
+void MSXCPUInterface::peekSlottedMemBlock(unsigned address, std::span<uint8_t> output, EmuTime time) const
+{
+	peekBlockHelper(address, output,
+		[&](unsigned addr) -> const uint8_t* {
+			uint8_t primSlot = (addr & 0xC0000) >> 18;
+			bool exp = isExpanded(primSlot);
+			uint16_t offset = (addr & (0xFFFF & CacheLine::HIGH)); // includes page
+			if ((offset == (0xFFFF & CacheLine::HIGH)) && exp) {
+				return nullptr;
+			} else {
+				uint8_t subSlot = exp ? ((addr & 0x30000) >> 16) : 0;
+				uint8_t page = (addr & 0x0C000) >> 14;
+				return slotLayout[primSlot][subSlot][page]->getReadCacheLine(offset);
+			}
+		},
+		[&](unsigned addr) { return peekSlottedMem(addr, time); });
+}
+
 uint8_t MSXCPUInterface::peekSlottedMem(unsigned address, EmuTime time) const
 {
 	uint8_t primSlot = (address & 0xC0000) >> 18;
@@ -889,34 +923,87 @@ void MSXCPUInterface::removeBreakPoint(unsigned id)
 
 bool MSXCPUInterface::checkBreakPoints(unsigned pc)
 {
-	// create copy for the case that breakpoint/condition removes itself
-	//  - avoids iterating over a changing collection
-	std::vector<BreakPoint> bpCopy;
-	for (const auto& bp : breakPoints) {
-		if (bp.isEnabled() && bp.getAddress() == pc) bpCopy.push_back(bp);
+	if (!hasBreakPoint(pc) && conditions.empty()) return false;
+
+	// Executing a breakpoint or condition can add or remove (other)
+	// breakpoints and conditions. So first collect the ids, and (below)
+	// look each one up again right before executing it.
+	checkIds.clear();
+	if (hasBreakPoint(pc)) {
+		for (const auto& bp : breakPoints) {
+			if (bp.isEnabled() && bp.getAddress() == pc) checkIds.push_back(bp.getId());
+		}
 	}
-	std::vector<DebugCondition> condCopy;
+	auto numBreakPoints = checkIds.size();
 	for (const auto& cond : conditions) {
-		if (cond.isEnabled()) condCopy.push_back(cond);
+		if (cond.isEnabled()) checkIds.push_back(cond.getId());
 	}
-	if (bpCopy.empty() && condCopy.empty()) return false;
+	if (checkIds.empty()) return false;
 
 	auto& globalCliComm = motherBoard.getReactor().getGlobalCliComm();
 	auto& interp        = motherBoard.getReactor().getInterpreter();
+	auto context = getConditionContext();
 	auto scopedBlock = motherBoard.getStateChangeDistributor().tempBlockNewEventsDuringReplay();
-	for (auto& p : bpCopy) {
-		bool remove = p.checkAndExecute(globalCliComm, interp);
-		if (remove) {
-			removeBreakPoint(p.getId());
+	for (auto [i, id] : enumerate(checkIds)) {
+		if (i < numBreakPoints) {
+			auto it = std::ranges::find(breakPoints, id, &BreakPoint::getId);
+			if (it == breakPoints.end()) continue; // already removed
+			// execute on a copy, it may remove itself
+			auto p = *it;
+			if (p.checkAndExecute(globalCliComm, interp, &context)) {
+				removeBreakPoint(id);
+			}
+		} else {
+			auto it = std::ranges::find(conditions, id, &DebugCondition::getId);
+			if (it == conditions.end()) continue; // already removed
+			auto c = *it;
+			if (c.checkAndExecute(globalCliComm, interp, &context)) {
+				removeCondition(id);
+			}
 		}
 	}
-	for (auto& c : condCopy) {
-		bool remove = c.checkAndExecute(globalCliComm, interp);
-		if (remove) {
-			removeCondition(c.getId());
+	updateBreakPointSet();
+	return isBreaked();
+}
+
+void MSXCPUInterface::updateBreakPointSet()
+{
+	if (breakPoints.empty() && !anyBreakPointSet) return; // fast path
+
+	std::array<std::bitset<CacheLine::SIZE>, CacheLine::NUM> newSet = {};
+	for (const auto& bp : breakPoints) {
+		if (!bp.isEnabled()) continue;
+		if (auto addr = bp.getAddress()) {
+			newSet[*addr >> CacheLine::BITS].set(*addr & CacheLine::LOW);
 		}
 	}
-	return isBreaked();
+	if (newSet == breakPointSet) return;
+
+	breakPointSet = newSet;
+	anyBreakPointSet = false;
+	for (auto i : xrange(CacheLine::NUM)) {
+		if (breakPointSet[i].any()) {
+			disallowReadCache[i] |=  BREAKPOINT_BIT;
+			anyBreakPointSet = true;
+		} else {
+			disallowReadCache[i] &= ~BREAKPOINT_BIT;
+		}
+	}
+	msxcpu.invalidateAllSlotsRWCache(0x0000, 0x10000);
+}
+
+void MSXCPUInterface::setMemoryTracing(bool enabled)
+{
+	for (auto i : xrange(CacheLine::NUM)) {
+		if (enabled) {
+			disallowReadCache [i] |=  MEMORY_TRACE_BIT;
+			disallowWriteCache[i] |=  MEMORY_TRACE_BIT;
+		} else {
+			disallowReadCache [i] &= ~MEMORY_TRACE_BIT;
+			disallowWriteCache[i] &= ~MEMORY_TRACE_BIT;
+		}
+	}
+	msxcpu.invalidateAllSlotsRWCache(0x0000, 0x10000);
 }
 
 void MSXCPUInterface::registerWatchPoint(WatchPoint& wp)
@@ -1045,6 +1132,35 @@ void MSXCPUInterface::updateMemWatch(WatchPoint::Type type)
 	msxcpu.invalidateAllSlotsRWCache(0x0000, 0x10000);
 }
 
+CompiledCondition::Context MSXCPUInterface::getConditionContext()
+{
+	return {msxcpu.getRegisters(), conditionMachine, motherBoard.getCurrentTime()};
+}
+
+uint8_t MSXCPUInterface::ConditionMachine::peekMem(uint16_t address, EmuTime time) const
+{
+	const auto& interface = OUTER(MSXCPUInterface, conditionMachine);
+	return interface.peekMem(address, time);
+}
+
+int MSXCPUInterface::ConditionMachine::getPrimarySlot(int page) const
+{
+	const auto& interface = OUTER(MSXCPUInterface, conditionMachine);
+	return interface.getPrimarySlot(page);
+}
+
+int MSXCPUInterface::ConditionMachine::getSecondarySlot(int page) const
+{
+	const auto& interface = OUTER(MSXCPUInterface, conditionMachine);
+	return interface.getSecondarySlot(page);
+}
+
+bool MSXCPUInterface::ConditionMachine::isExpanded(int ps) const
+{
+	const auto& interface = OUTER(MSXCPUInterface, conditionMachine);
+	return interface.isExpanded(ps);
+}
+
 void MSXCPUInterface::executeMemWatch(WatchPoint::Type type,
                                       unsigned address, unsigned value)
 {
@@ -1053,9 +1169,12 @@ void MSXCPUInterface::executeMemWatch(WatchPoint::Type type,
 
 	auto& globalCliComm = motherBoard.getReactor().getGlobalCliComm();
 	auto& interp        = motherBoard.getReactor().getInterpreter();
+	auto context = getConditionContext();
+	context.wpLastAddress = address;
 	interp.setVariable(TclObject("wp_last_address"),
 	                   TclObject(int(address)));
 	if (value != ~0u) {
+		context.wpLastValue = value;
 		interp.setVariable(TclObject("wp_last_value"),
 		                   TclObject(int(value)));
 	}
@@ -1065,7 +1184,7 @@ void MSXCPUInterface::executeMemWatch(WatchPoint::Type type,
 		if ((w->getBeginAddress() <= address) &&
 		    (w->getEndAddress()   >= address) &&
 		    (w->getType()         == type)) {
-			bool remove = w->checkAndExecute(globalCliComm, interp);
+			bool remove = w->checkAndExecute(globalCliComm, interp, &context);
 			if (remove) {
 				removeWatchPoint(w);
 			}
@@ -1149,6 +1268,19 @@ uint8_t MSXCPUInterface::MemoryDebug::read(unsigned address, EmuTime time)
 	return interface.peekMem(narrow<uint16_t>(address), time);
 }
 
+void MSXCPUInterface::MemoryDebug::readBlock(unsigned start, std::span<uint8_t> output)
+{
+	const auto& interface = OUTER(MSXCPUInterface, memoryDebug);
+	interface.peekMemBlock(narrow<uint16_t>(start), output, getMotherBoard().getCurrentTime());
+
+#ifdef DEBUG
+	auto time = getMotherBoard().getCurrentTime();
+	for (auto i : xrange(output.size())) {
+		assert(output[i] == read(narrow<unsigned>(start + i), time));
+	}
+#endif
+}
+
 void MSXCPUInterface::MemoryDebug::write(unsigned address, uint8_t value,
                                          EmuTime time)
 {
@@ -28,6 +28,7 @@ class CliComm;
 class DummyDevice;
 class MSXCPU;
 class MSXMotherBoard;
+class Profiler;
 class VDPIODelay;
 
 inline constexpr bool PROFILE_CACHELINES = false;
@@ -237,11 +238,18 @@ public:
 	void fillRCache (unsigned start, unsigned size, const uint8_t* rData,                 int ps, int ss);
 	void fillWCache (unsigned start, unsigned size,                       uint8_t* wData, int ps, int ss);
 
+	/** While enabled, no memory is cacheable for the CPU (also not when a
+	  * device later fills the cache). So all CPU memory accesses go via
+	  * readMem()/writeMem(), used to record them (see InstructionTracer).
+	  */
+	void setMemoryTracing(bool enabled);
+
 	/**
 	 * Peek memory location
 	 * @see MSXDevice::peekMem()
 	 */
 	[[nodiscard]] uint8_t peekMem(uint16_t address, EmuTime time) const;
+	void peekMemBlock(uint16_t address, std::span<uint8_t> output, EmuTime time) const;
 	[[nodiscard]] uint8_t peekSlottedMem(unsigned address, EmuTime time) const;
 	void peekSlottedMemBlock(unsigned address, std::span<uint8_t> output, EmuTime time) const;
 	uint8_t readSlottedMem(unsigned address, EmuTime time);
@@ -314,8 +322,32 @@ public:
 	{
 		return !breakPoints.empty() || !conditions.empty();
 	}
+	[[nodiscard]] static bool anyConditions()
+	{
+		return !conditions.empty();
+	}
 	[[nodiscard]] bool checkBreakPoints(unsigned pc);
 
+	/** Is there an (enabled) breakpoint on the given address? Cache lines
+	  * that contain such an address are never cached. So CPUCore only
+	  * needs to check this when fetching an opcode from a non-cached
+	  * line. This allows it to keep running its fast loop while there are
+	  * breakpoints (but no conditions).
+	  */
+	[[nodiscard]] bool hasBreakPoint(unsigned address) const {
+		return breakPointSet[address >> CacheLine::BITS]
+		                    [address &  CacheLine::LOW];
+	}
+	/** Recalculate the set of breakpoint addresses. Breakpoints can be
+	  * changed in place (e.g. via the 'debug breakpoint configure'
+	  * command), so CPUCore calls this on entry of its loop and after
+	  * executing breakpoints.
+	  */
+	void updateBreakPointSet();
+
+	/** State needed to natively evaluate (compiled) conditions. */
+	[[nodiscard]] CompiledCondition::Context getConditionContext();
+
 	// cleanup global variables
 	static void cleanup();
 
@@ -354,9 +386,18 @@ private:
 	void executeMemWatch(WatchPoint::Type type, unsigned address,
 	                     unsigned value = ~0u);
 
+	// The view of the machine for CompiledCondition.
+	struct ConditionMachine final : CompiledCondition::Machine {
+		[[nodiscard]] uint8_t peekMem(uint16_t address, EmuTime time) const override;
+		[[nodiscard]] int getPrimarySlot(int page) const override;
+		[[nodiscard]] int getSecondarySlot(int page) const override;
+		[[nodiscard]] bool isExpanded(int ps) const override;
+	} conditionMachine;
+
 	struct MemoryDebug final : SimpleDebuggable {
 		explicit MemoryDebug(MSXMotherBoard& motherBoard);
 		[[nodiscard]] uint8_t read(unsigned address, EmuTime time) override;
+		void readBlock(unsigned start, std::span<uint8_t> output) override;
 		void write(unsigned address, uint8_t value, EmuTime time) override;
 	} memoryDebug;
 
@@ -427,6 +468,7 @@ private:
 
 	std::unique_ptr<DummyDevice> dummyDevice;
 	MSXCPU& msxcpu;
+	Profiler& profiler;
 	CliComm& cliComm;
 	MSXMotherBoard& motherBoard;
 	BooleanSetting& pauseSetting;
@@ -437,6 +479,9 @@ private:
 	std::array<uint8_t, CacheLine::NUM> disallowWriteCache;
 	std::array<std::bitset<CacheLine::SIZE>, CacheLine::NUM> readWatchSet;
 	std::array<std::bitset<CacheLine::SIZE>, CacheLine::NUM> writeWatchSet;
+	std::array<std::bitset<CacheLine::SIZE>, CacheLine::NUM> breakPointSet;
+	bool anyBreakPointSet = false; // any bit set in 'breakPointSet'?
+	std::vector<unsigned> checkIds; // only used in checkBreakPoints(), reused to avoid allocations
 
 	struct GlobalRwInfo {
 		MSXDevice* device;
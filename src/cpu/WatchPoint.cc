@@ -62,12 +62,14 @@ void WatchPoint::doReadCallback(MSXMotherBoard& motherBoard, unsigned port)
 	auto& cliComm = reactor.getGlobalCliComm();
 	auto& interp  = reactor.getInterpreter();
 	interp.setVariable(TclObject("wp_last_address"), TclObject(int(port)));
+	auto context = cpuInterface.getConditionContext();
+	context.wpLastAddress = port;
 
 	// keep this object alive by holding a shared_ptr to it, for the case
 	// this watchpoint deletes itself in checkAndExecute()
 	auto keepAlive = shared_from_this();
 	auto scopedBlock = motherBoard.getStateChangeDistributor().tempBlockNewEventsDuringReplay();
-	if (bool remove = checkAndExecute(cliComm, interp); remove) {
+	if (bool remove = checkAndExecute(cliComm, interp, &context); remove) {
 		cpuInterface.removeWatchPoint(keepAlive);
 	}
 
@@ -84,11 +86,14 @@ void WatchPoint::doWriteCallback(MSXMotherBoard& motherBoard, unsigned port, uns
 	auto& interp  = reactor.getInterpreter();
 	interp.setVariable(TclObject("wp_last_address"), TclObject(int(port)));
 	interp.setVariable(TclObject("wp_last_value"),   TclObject(int(value)));
+	auto context = cpuInterface.getConditionContext();
+	context.wpLastAddress = port;
+	context.wpLastValue = value;
 
 	// see comment in doReadCallback() above
 	auto keepAlive = shared_from_this();
 	auto scopedBlock = motherBoard.getStateChangeDistributor().tempBlockNewEventsDuringReplay();
-	if (bool remove = checkAndExecute(cliComm, interp); remove) {
+	if (bool remove = checkAndExecute(cliComm, interp, &context); remove) {
 		cpuInterface.removeWatchPoint(keepAlive);
 	}
 
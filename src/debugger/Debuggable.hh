@@ -31,6 +31,13 @@ public:
 			output[i] = read(narrow_cast<unsigned>(start + i));
 		}
 	}
+	virtual void writeBlock(unsigned start, std::span<const uint8_t> input) {
+		// default implementation, subclasses may override it with a more efficient version
+		assert(narrow<unsigned>(start + input.size()) <= getSize());
+		for (auto i : xrange(input.size())) {
+			write(narrow_cast<unsigned>(start + i), input[i]);
+		}
+	}
 
 protected:
 	Debuggable() = default;
@@ -39,6 +39,9 @@ Debugger::Debugger(MSXMotherBoard& motherBoard_)
 	      motherBoard.getStateChangeDistributor(),
 	      motherBoard.getScheduler())
 	, tracer(*this)
+	, profiler(*this)
+	, instructionTracer(*this)
+	, sharedMemoryExport(*this)
 {
 }
 
@@ -178,6 +181,9 @@ void Debugger::transfer(Debugger& other)
 	}
 
 	tracer.transfer(other, *this);
+	profiler.transfer(other.profiler);
+	instructionTracer.transfer(other.instructionTracer);
+	sharedMemoryExport.transfer(other.sharedMemoryExport);
 
 	// Breakpoints and conditions are (currently) global, so no need to
 	// copy those.
@@ -339,9 +345,7 @@ void Debugger::Cmd::writeBlock(std::span<const TclObject> tokens, TclObject& /*r
 		throw CommandException("Invalid size");
 	}
 
-	for (auto i : xrange(buf.size())) {
-		device.write(unsigned(addr + i), buf[i]);
-	}
+	device.writeBlock(addr, buf);
 }
 
 static constexpr char toHex(byte x)
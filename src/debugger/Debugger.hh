@@ -1,7 +1,10 @@
 #ifndef DEBUGGER_HH
 #define DEBUGGER_HH
 
+#include "InstructionTracer.hh"
 #include "Probe.hh"
+#include "Profiler.hh"
+#include "SharedMemoryExport.hh"
 #include "Tracer.hh"
 
 #include "ImGuiWatchExpr.hh"
@@ -57,6 +60,8 @@ public:
 
 	[[nodiscard]] auto& getProbes() { return probes; }
 	[[nodiscard]] Tracer& getTracer() { return tracer; }
+	[[nodiscard]] Profiler& getProfiler() { return profiler; }
+	[[nodiscard]] InstructionTracer& getInstructionTracer() { return instructionTracer; }
 
 private:
 	[[nodiscard]] Debuggable& getDebuggable(std::string_view name);
@@ -151,6 +156,9 @@ private:
 
 	Tracer tracer;
 	friend class Tracer;
+	Profiler profiler;
+	InstructionTracer instructionTracer;
+	SharedMemoryExport sharedMemoryExport;
 
 	hash_map<std::string, Debuggable*, XXHasher> debuggables;
 	std::vector<ProbeBase*> probes; // sorted on name
@@ -0,0 +1,386 @@
+#include "InstructionTracer.hh"
+
+#include "Debugger.hh"
+
+#include "CPURegs.hh"
+#include "CommandException.hh"
+#include "File.hh"
+#include "FileContext.hh"
+#include "FileOperations.hh"
+#include "MSXCPU.hh"
+#include "MSXCPUInterface.hh"
+#include "MSXException.hh"
+#include "MSXMotherBoard.hh"
+#include "TclArgParser.hh"
+#include "TclObject.hh"
+
+#include "outer.hh"
+#include "ranges.hh"
+#include "xrange.hh"
+
+#include "cstdiop.hh" // for dup()
+#include <bit>
+#include <cassert>
+
+using namespace std::literals;
+
+namespace openmsx {
+
+static constexpr std::string_view MAGIC = "openMSX instruction trace\n\x1a";
+static constexpr uint8_t VERSION = 1;
+static constexpr size_t RING_SIZE = 16 * 1024 * 1024; // must be a power of 2
+static constexpr size_t WAKEUP_THRESHOLD = 256 * 1024;
+static_assert(std::has_single_bit(RING_SIZE));
+
+InstructionTracer::InstructionTracer(Debugger& debugger_)
+	: debugger(debugger_)
+	, traceCmd(debugger.getMotherBoard().getCommandController())
+{
+}
+
+InstructionTracer::~InstructionTracer()
+{
+	// Note: the CPU may already be destroyed, so don't call stop().
+	if (recording) (void)closeFile();
+}
+
+void InstructionTracer::start(zstring_view filename_, bool memory)
+{
+	stop();
+
+	file = [&] {
+		auto f = FileOperations::openFile(filename_, "wb");
+		if (!f) throw CommandException("Cannot open file for writing: ", filename_);
+		int duped_fd = dup(fileno(f.get()));
+		if (duped_fd == -1) throw CommandException("Cannot open file for writing: ", filename_);
+		auto result = gzdopen(duped_fd, "wb1"); // speed over size
+		if (!result) {
+			::close(duped_fd);
+			throw CommandException("Cannot open file for writing: ", filename_);
+		}
+		// on scope-exit 'f' is closed, 'result' uses the dup()'ed file descriptor
+		return result;
+	}();
+	filename = filename_;
+
+	ring.assign(RING_SIZE, 0);
+	head = 0;
+	tail = 0;
+	lastWakeup = 0;
+	stopping = false;
+	writeError = false;
+	numRecords = 0;
+	numStalls = 0;
+	begun = false;
+	recordMemory = memory;
+
+	auto& motherBoard = debugger.getMotherBoard();
+	push(encoder.start(motherBoard.getCurrentTime(), memory));
+
+	thread = std::thread([this] { run(); });
+	recording = true;
+
+	// Make all memory uncacheable, so that all accesses go via the CPU's
+	// slow path (where they get recorded).
+	if (memory) motherBoard.getCPUInterface().setMemoryTracing(true);
+	// Switch to the one-instruction-at-a-time loop.
+	motherBoard.getCPU().exitCPULoopSync();
+}
+
+void InstructionTracer::stop()
+{
+	if (!recording) return;
+	bool ok = closeFile();
+	if (recordMemory) {
+		// allow caching again
+		debugger.getMotherBoard().getCPUInterface().setMemoryTracing(false);
+		recordMemory = false;
+	}
+	if (!ok) throw CommandException("Error while writing ", filename);
+}
+
+bool InstructionTracer::closeFile()
+{
+	recording = false;
+	stopping = true;
+	wakeup();
+	thread.join();
+
+	bool ok = !writeError && (gzclose(file) == Z_OK);
+	file = nullptr;
+	ring = {};
+	return ok;
+}
+
+void InstructionTracer::transfer(InstructionTracer& other)
+{
+	// The recording can't be continued in the new machine (e.g. after a
+	// reverse), the times and register values are unrelated.
+	try {
+		other.stop();
+	} catch (MSXException&) {
+		// ignore, there's no way to report this
+	}
+}
+
+void InstructionTracer::beginInstruction(
+	EmuTime time, uint16_t pc, uint8_t slot, std::span<const uint8_t, 4> bytes)
+{
+	if (!recording) return;
+	begun = true;
+	encoder.beginInstruction(time, pc, slot, bytes);
+}
+
+void InstructionTracer::endInstruction(const CPURegs& regs)
+{
+	if (!recording || !begun) return; // start/stop during the instruction
+	begun = false;
+
+	push(encoder.endInstruction({
+		regs.getAF(), regs.getBC(), regs.getDE(), regs.getHL(),
+		regs.getAF2(), regs.getBC2(), regs.getDE2(), regs.getHL2(),
+		regs.getIX(), regs.getIY(), regs.getSP(),
+		uint16_t((regs.getI() << 8) | regs.getR()),
+		uint16_t(regs.getIM() | (regs.getIFF1() << 2) | (regs.getIFF2() << 3) | (regs.getHALT() << 4)),
+	}));
+	++numRecords;
+}
+
+void InstructionTracer::push(std::span<const uint8_t> data)
+{
+	auto h = head.load(std::memory_order_relaxed);
+	while (true) {
+		auto t = tail.load(std::memory_order_acquire);
+		if ((ring.size() - (h - t)) >= data.size()) break;
+		// Full, wait till the helper thread made room.
+		++numStalls;
+		wakeup();
+		tail.wait(t, std::memory_order_acquire);
+	}
+	auto pos = h & (ring.size() - 1);
+	auto n = std::min(data.size(), ring.size() - pos);
+	copy_to_range(data.first(n), subspan(ring, pos));
+	copy_to_range(data.subspan(n), ring); // wrap around
+	h += data.size();
+	head.store(h, std::memory_order_release);
+
+	if ((h - lastWakeup) >= WAKEUP_THRESHOLD) wakeup();
+}
+
+void InstructionTracer::wakeup()
+{
+	lastWakeup = head.load(std::memory_order_relaxed);
+	wakeups.fetch_add(1, std::memory_order_release);
+	wakeups.notify_one();
+}
+
+void InstructionTracer::run()
+{
+	auto t = tail.load(std::memory_order_relaxed);
+	while (true) {
+		// Read 'wakeups' before checking for data, so that a wakeup
+		// between that check and wait() is not lost.
+		auto w = wakeups.load(std::memory_order_acquire);
+		auto h = head.load(std::memory_order_acquire);
+		if (h == t) {
+			if (stopping.load(std::memory_order_acquire)) return;
+			wakeups.wait(w, std::memory_order_acquire);
+			continue;
+		}
+		auto pos = t & (ring.size() - 1);
+		auto n = std::min(h - t, ring.size() - pos);
+		if (!writeError && (gzwrite(file, &ring[pos], unsigned(n)) != int(n))) {
+			// Keep on consuming (and dropping) the data, the
+			// error is reported when the recording is stopped.
+			writeError = true;
+		}
+		t += n;
+		tail.store(t, std::memory_order_release);
+		tail.notify_one();
+	}
+}
+
+void InstructionTracer::load(zstring_view filename,
+                             const std::function<void(const Record&)>& callback)
+{
+	File file(filename); // also handles the gzip compression
+	auto data = file.mmap<const uint8_t>();
+	std::span<const uint8_t> in{data.data(), data.size()};
+
+	auto error = [&] {
+		throw MSXException("Invalid instruction trace file: ", filename);
+	};
+	auto get8 = [&] {
+		if (in.empty()) error();
+		auto result = in.front();
+		in = in.subspan(1);
+		return result;
+	};
+	auto get16 = [&] {
+		auto lo = get8();
+		return uint16_t(lo | (get8() << 8));
+	};
+
+	if ((in.size() < MAGIC.size()) ||
+	    !std::ranges::equal(in.first(MAGIC.size()), MAGIC, {}, {}, [](char c) { return uint8_t(c); })) {
+		error();
+	}
+	in = in.subspan(MAGIC.size());
+	if (get8() != VERSION) {
+		throw MSXException("Unsupported instruction trace version: ", filename);
+	}
+	auto flags = get8();
+	uint64_t time = 0;
+	for (auto i : xrange(8)) time |= uint64_t(get8()) << (8 * i);
+
+	Record rec;
+	std::array<MemAccess, 256> accesses;
+	while (!in.empty()) {
+		uint64_t delta = 0;
+		for (unsigned shift = 0; true; shift += 7) {
+			if (shift > 63) error();
+			auto b = get8();
+			delta |= uint64_t(b & 0x7f) << shift;
+			if (!(b & 0x80)) break;
+		}
+		time += delta;
+		rec.time = EmuTime::fromUint64(time);
+		rec.pc = get16();
+		rec.slot = get8();
+		for (auto& b : rec.bytes) b = get8();
+		rec.changed = get16();
+		for (auto i : xrange(NUM_REGS)) {
+			if (rec.changed & (1 << i)) rec.regs[i] = get16();
+		}
+		size_t num = 0;
+		if (flags & FLAG_MEMORY) {
+			num = get8();
+			for (auto& a : std::span{accesses.data(), num}) {
+				a.address = get16();
+				a.value = get8();
+				a.write = get8() != 0;
+			}
+		}
+		rec.accesses = std::span{accesses.data(), num};
+		callback(rec);
+	}
+}
+
+
+// class InstructionTracer::Encoder
+
+std::span<const uint8_t> InstructionTracer::Encoder::start(EmuTime time, bool memory_)
+{
+	prevTime = time;
+	first = true;
+	memory = memory_;
+
+	recordSize = 0;
+	for (char c : MAGIC) put8(uint8_t(c));
+	put8(VERSION);
+	put8(memory ? FLAG_MEMORY : 0);
+	for (auto i : xrange(8)) put8(uint8_t(time.toUint64() >> (8 * i)));
+	return std::span{record.data(), recordSize};
+}
+
+void InstructionTracer::Encoder::beginInstruction(
+	EmuTime time, uint16_t pc, uint8_t slot, std::span<const uint8_t, 4> bytes)
+{
+	numAccesses = 0;
+	recordSize = 0;
+
+	auto delta = (time - prevTime).toUint64();
+	prevTime = time;
+	while (delta >= 0x80) {
+		put8(uint8_t(delta | 0x80));
+		delta >>= 7;
+	}
+	put8(uint8_t(delta));
+	put16(pc);
+	put8(slot);
+	for (auto b : bytes) put8(b);
+}
+
+std::span<const uint8_t> InstructionTracer::Encoder::endInstruction(
+	const std::array<uint16_t, NUM_REGS>& regs)
+{
+	uint16_t mask = 0;
+	for (auto i : xrange(NUM_REGS)) {
+		if (first || (regs[i] != prevRegs[i])) mask |= uint16_t(1 << i);
+	}
+	put16(mask);
+	for (auto i : xrange(NUM_REGS)) {
+		if (mask & (1 << i)) put16(regs[i]);
+	}
+	if (memory) {
+		put8(uint8_t(numAccesses));
+		for (const auto& a : std::span{accesses.data(), numAccesses}) {
+			put16(a.address);
+			put8(a.value);
+			put8(a.write ? 1 : 0);
+		}
+	}
+	prevRegs = regs;
+	first = false;
+	return std::span{record.data(), recordSize};
+}
+
+
+// class InstructionTracer::Cmd
+
+InstructionTracer::Cmd::Cmd(CommandController& commandController_)
+	: Command(commandController_, "record_instructions")
+{
+}
+
+void InstructionTracer::Cmd::execute(std::span<const TclObject> tokens, TclObject& result)
+{
+	checkNumArgs(tokens, AtLeast{2}, "subcommand ?arg ...?");
+	auto& tracer = OUTER(InstructionTracer, traceCmd);
+	executeSubCommand(tokens[1].getString(),
+		"start", [&]{
+			bool memory = false;
+			std::array info = {flagArg("-memory", memory)};
+			auto arguments = parseTclArgs(getInterpreter(), tokens.subspan(2), info);
+			if (arguments.size() != 1) throw SyntaxError();
+			tracer.start(arguments[0].getString(), memory); },
+		"stop", [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			tracer.stop(); },
+		"status", [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			result.addDictKeyValues(
+				"status", tracer.recording ? "running"sv : "stopped"sv,
+				"file", tracer.filename,
+				"memory", tracer.recordMemory,
+				"instructions", tracer.numRecords,
+				"stalls", tracer.numStalls); });
+}
+
+std::string InstructionTracer::Cmd::help(std::span<const TclObject> /*tokens*/) const
+{
+	return "Records all executed instructions to a file.\n"
+	       "record_instructions start [-memory] <filename>\n"
+	       "    Start recording. For each instruction the time, PC, slot, opcode bytes\n"
+	       "    and the changed registers are stored. With -memory also all memory\n"
+	       "    accesses of the CPU (including opcode fetches) are stored, this makes\n"
+	       "    the emulation quite a bit slower.\n"
+	       "record_instructions stop    Stop recording and close the file\n"
+	       "record_instructions status  Query the recording state\n"
+	       "\n"
+	       "The file can be loaded with 'debug trace load', e.g. to show it in the trace\n"
+	       "viewer. Instructions executed during fast-forward are not recorded.";
+}
+
+void InstructionTracer::Cmd::tabCompletion(std::vector<std::string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		static constexpr std::array cmds = {"start"sv, "stop"sv, "status"sv};
+		completeString(tokens, cmds);
+	} else if ((tokens.size() >= 3) && (tokens[1] == "start")) {
+		static constexpr std::array options = {"-memory"sv};
+		completeFileName(tokens, userFileContext(), options);
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,178 @@
+#ifndef INSTRUCTIONTRACER_HH
+#define INSTRUCTIONTRACER_HH
+
+#include "Command.hh"
+#include "EmuTime.hh"
+
+#include "zstring_view.hh"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+namespace openmsx {
+
+class CPURegs;
+class Debugger;
+
+/** Records every executed instruction to a (compressed) binary file,
+  * controlled via the 'record_instructions' command. Such a file can be
+  * loaded with 'debug trace load' (and then e.g. be shown in the trace
+  * viewer), and because the format is deterministic, two traces (e.g. from
+  * different openMSX builds) can be compared.
+  *
+  * CPUCore (the emulation thread) appends the records to a lock-free
+  * single-producer/single-consumer ring buffer. A helper thread compresses
+  * that data and writes it to the file. Only when that thread can't keep
+  * up, the emulation thread has to wait.
+  *
+  * File format (all values little endian), after gzip decompression:
+  *   header: "openMSX instruction trace\n\x1a", u8 version, u8 flags,
+  *           u64 start time (EmuTime units)
+  *   then one record per instruction:
+  *     varint  time since previous record (EmuTime units)
+  *     u16     PC
+  *     u8      slot: primary | (secondary << 2) | (expanded ? 0x10 : 0)
+  *     u8[4]   the 4 bytes at PC (not all necessarily part of the opcode)
+  *     u16     mask of the registers changed by this instruction
+  *     u16[]   the new value of each changed register, see Reg below
+  *     only when flags contains MEMORY:
+  *       u8    number of memory accesses (including the opcode fetches)
+  *       u8[4] per access: u16 address, u8 value, u8 type (0=read, 1=write)
+  * The first record lists all registers.
+  */
+class InstructionTracer
+{
+public:
+	enum Reg : uint8_t {
+		AF, BC, DE, HL, AF2, BC2, DE2, HL2, IX, IY, SP,
+		IR,   // (I << 8) | R
+		MISC, // IM | (IFF1 << 2) | (IFF2 << 3) | (HALT << 4)
+	};
+	static constexpr unsigned NUM_REGS = MISC + 1;
+	static constexpr uint8_t FLAG_MEMORY = 1;
+
+	struct MemAccess {
+		uint16_t address;
+		uint8_t value;
+		bool write;
+	};
+	struct Record {
+		EmuTime time = EmuTime::zero();
+		uint16_t pc = 0;
+		uint8_t slot = 0;
+		std::array<uint8_t, 4> bytes = {};
+		uint16_t changed = 0; // mask of 'regs' that changed
+		std::array<uint16_t, NUM_REGS> regs = {}; // after the instruction
+		std::span<const MemAccess> accesses;
+	};
+
+	/** Builds the records of the file format described above, independent
+	  * of where the resulting bytes end up. */
+	class Encoder {
+	public:
+		/** Start a new trace, returns the file header. */
+		[[nodiscard]] std::span<const uint8_t> start(EmuTime time, bool memory);
+
+		void beginInstruction(EmuTime time, uint16_t pc, uint8_t slot,
+		                      std::span<const uint8_t, 4> bytes);
+		void memoryAccess(uint16_t address, uint8_t value, bool write) {
+			if (numAccesses < accesses.size()) {
+				accesses[numAccesses++] = MemAccess{address, value, write};
+			}
+		}
+		/** Returns the complete record for this instruction. */
+		[[nodiscard]] std::span<const uint8_t> endInstruction(
+			const std::array<uint16_t, NUM_REGS>& regs);
+
+	private:
+		void put8(uint8_t value) { record[recordSize++] = value; }
+		void put16(uint16_t value) { put8(uint8_t(value)); put8(uint8_t(value >> 8)); }
+
+	private:
+		std::array<uint8_t, 256> record;
+		size_t recordSize = 0;
+		std::array<uint16_t, NUM_REGS> prevRegs = {};
+		std::array<MemAccess, 32> accesses = {};
+		size_t numAccesses = 0;
+		EmuTime prevTime = EmuTime::zero();
+		bool first = true;
+		bool memory = false;
+	};
+
+	explicit InstructionTracer(Debugger& debugger);
+	~InstructionTracer();
+	InstructionTracer(const InstructionTracer&) = delete;
+	InstructionTracer(InstructionTracer&&) = delete;
+	InstructionTracer& operator=(const InstructionTracer&) = delete;
+	InstructionTracer& operator=(InstructionTracer&&) = delete;
+
+	/** Is recording active? Then CPUCore must call beginInstruction()
+	  * before and endInstruction() after each instruction. */
+	[[nodiscard]] bool isRecording() const { return recording; }
+	/** Should CPUCore also report (all) its memory accesses? */
+	[[nodiscard]] bool isRecordingMemory() const { return recordMemory; }
+
+	void beginInstruction(EmuTime time, uint16_t pc, uint8_t slot,
+	                      std::span<const uint8_t, 4> bytes);
+	void memoryAccess(uint16_t address, uint8_t value, bool write) {
+		encoder.memoryAccess(address, value, write);
+	}
+	void endInstruction(const CPURegs& regs);
+
+	void transfer(InstructionTracer& other);
+
+	/** Decode a trace file, calls 'callback' for every record.
+	  * Throws MSXException on error. */
+	static void load(zstring_view filename,
+	                    const std::function<void(const Record&)>& callback);
+
+private:
+	void start(zstring_view filename, bool memory);
+	void stop();
+	[[nodiscard]] bool closeFile();
+	void push(std::span<const uint8_t> data);
+	void wakeup();
+	void run();
+
+private:
+	Debugger& debugger;
+
+	struct Cmd final : Command {
+		explicit Cmd(CommandController& commandController);
+		void execute(std::span<const TclObject> tokens, TclObject& result) override;
+		[[nodiscard]] std::string help(std::span<const TclObject> tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	} traceCmd;
+
+	// ring buffer, 'head' and 'tail' are the total number of bytes
+	// written/read so far
+	std::vector<uint8_t> ring;
+	std::atomic<size_t> head = 0; // only written by the emulation thread
+	std::atomic<size_t> tail = 0; // only written by the helper thread
+	std::atomic<uint32_t> wakeups = 0; // to wake up the helper thread
+	std::atomic<bool> stopping = false;
+	std::atomic<bool> writeError = false;
+	size_t lastWakeup = 0;
+	std::thread thread;
+	gzFile file = nullptr; // written by the helper thread
+
+	Encoder encoder;
+	bool begun = false;
+
+	std::string filename;
+	uint64_t numRecords = 0;
+	uint64_t numStalls = 0;
+	bool recording = false;
+	bool recordMemory = false;
+};
+
+} // namespace openmsx
+
+#endif
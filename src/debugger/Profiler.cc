@@ -0,0 +1,413 @@
+#include "Profiler.hh"
+
+#include "Debugger.hh"
+#include "SymbolManager.hh"
+
+#include "CPURegs.hh"
+#include "CommandException.hh"
+#include "FileContext.hh"
+#include "MSXCPU.hh"
+#include "MSXCPUInterface.hh"
+#include "MSXException.hh"
+#include "MSXMemoryMapperBase.hh"
+#include "MSXMotherBoard.hh"
+#include "MSXRom.hh"
+#include "Reactor.hh"
+#include "RomBlockDebuggable.hh"
+#include "TclArgParser.hh"
+#include "TclObject.hh"
+
+#include "narrow.hh"
+#include "outer.hh"
+#include "strCat.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <map>
+
+using namespace std::literals;
+
+namespace openmsx {
+
+// Layout of the keys returned by locate():
+//   bits  0-15: address
+//   bits 16-17: primary slot
+//   bits 18-19: secondary slot (only valid when EXPANDED_BIT is set)
+//   bits 22-37: segment (only valid when SEGMENT_BIT is set)
+static constexpr uint64_t EXPANDED_BIT = uint64_t(1) << 20;
+static constexpr uint64_t SEGMENT_BIT  = uint64_t(1) << 21;
+static constexpr unsigned SEGMENT_SHIFT = 22;
+
+Profiler::Location Profiler::Location::fromKey(uint64_t key)
+{
+	return {
+		.addr = uint16_t(key),
+		.ps = uint8_t((key >> 16) & 3),
+		.ss = (key & EXPANDED_BIT) ? std::optional(uint8_t((key >> 18) & 3)) : std::nullopt,
+		.segment = (key & SEGMENT_BIT) ? std::optional(uint16_t(key >> SEGMENT_SHIFT)) : std::nullopt,
+	};
+}
+
+uint64_t Profiler::Location::toKey() const
+{
+	uint64_t key = addr | (uint64_t(ps) << 16);
+	if (ss) key |= EXPANDED_BIT | (uint64_t(*ss) << 18);
+	if (segment) key |= SEGMENT_BIT | (uint64_t(*segment) << SEGMENT_SHIFT);
+	return key;
+}
+
+std::string Profiler::Location::formatSlot() const
+{
+	return ss ? strCat(ps, '-', *ss) : strCat(ps);
+}
+
+std::string Profiler::Location::formatSegment() const
+{
+	return segment ? strCat(*segment) : std::string{};
+}
+
+Profiler::Profiler(Debugger& debugger_)
+	: Schedulable(debugger_.getMotherBoard().getScheduler())
+	, debugger(debugger_)
+	, profileCmd(debugger.getMotherBoard().getCommandController())
+{
+}
+
+uint64_t Profiler::locate(uint16_t pc)
+{
+	assert(cpuInterface);
+	unsigned page = pc >> 14;
+	auto ps = cpuInterface->getPrimarySlot(narrow<int>(page));
+	return Location{
+		.addr = pc,
+		.ps = narrow<uint8_t>(ps),
+		.ss = cpuInterface->isExpanded(ps)
+		    ? std::optional(narrow<uint8_t>(cpuInterface->getSecondarySlot(narrow<int>(page))))
+		    : std::nullopt,
+		.segment = getSegment(page, pc),
+	}.toKey();
+}
+
+std::optional<uint16_t> Profiler::getSegment(unsigned page, uint16_t addr)
+{
+	auto& cache = pageCache[page];
+	if (!cache.valid) {
+		// Only when the visible device changed (see visibleDeviceChanged()),
+		// so it's ok that this is a bit slow.
+		const auto* device = cpuInterface->getVisibleMSXDevice(narrow<int>(page));
+		cache = PageCache{.valid = true};
+		if (const auto* mapper = dynamic_cast<const MSXMemoryMapperBase*>(device)) {
+			cache.mapper = mapper;
+		} else if (const auto* rom = dynamic_cast<const MSXRom*>(device)) {
+			if (auto* debug8 = dynamic_cast<RomBlockDebuggableBase::Debuggable8*>(
+				debugger.findDebuggable(tmpStrCat(rom->getName(), " romblocks")))) {
+				cache.romBlocks = &debug8->getRomBlocks();
+			}
+		}
+	}
+	if (cache.mapper) {
+		return cache.mapper->getSelectedSegment(narrow<uint8_t>(page));
+	} else if (cache.romBlocks) {
+		auto segment = cache.romBlocks->readExt(addr);
+		if (segment <= 0xffff) return uint16_t(segment);
+	}
+	return {};
+}
+
+void Profiler::start(std::optional<unsigned> interval)
+{
+	stop();
+	auto& motherBoard = debugger.getMotherBoard();
+	cpuInterface = &motherBoard.getCPUInterface();
+	pageCache = {};
+	if (interval) {
+		mode = Mode::SAMPLE;
+		sampleInterval = *interval;
+		lastSample = getCurrentTime();
+		setSyncPoint(lastSample + EmuDuration::hz(double(motherBoard.getCPU().getFreq())) * sampleInterval);
+	} else {
+		mode = Mode::EXACT;
+	}
+}
+
+void Profiler::stop()
+{
+	removeSyncPoints();
+	mode = Mode::OFF;
+	cpuInterface = nullptr;
+}
+
+void Profiler::clear()
+{
+	counters.clear();
+}
+
+void Profiler::transfer(Profiler& other)
+{
+	counters = std::move(other.counters);
+	other.counters.clear();
+	if (other.mode != Mode::OFF) {
+		start((other.mode == Mode::SAMPLE) ? std::optional(other.sampleInterval) : std::nullopt);
+	}
+	other.stop();
+}
+
+void Profiler::executeUntil(EmuTime time)
+{
+	assert(mode == Mode::SAMPLE);
+	auto& cpu = debugger.getMotherBoard().getCPU();
+	if (!cpuInterface->isFastForward()) {
+		// the instruction at PC is the next one that will be executed
+		add(locate(cpu.getRegisters().getPC()), time - lastSample);
+	}
+	lastSample = time;
+	setSyncPoint(time + EmuDuration::hz(double(cpu.getFreq())) * sampleInterval);
+}
+
+uint64_t Profiler::toCycles(uint64_t duration) const
+{
+	// Note: uses the current CPU frequency.
+	auto freq = debugger.getMotherBoard().getCPU().getFreq();
+	return uint64_t(double(duration) * freq / double(MAIN_FREQ) + 0.5);
+}
+
+std::vector<Profiler::Entry> Profiler::getEntries()
+{
+	// A function is the nearest symbol at or below an address (in a
+	// matching slot/segment).
+	auto& symbolManager = debugger.getMotherBoard().getReactor().getSymbolManager();
+
+	std::vector<Entry> result;
+	result.reserve(counters.size());
+	for (const auto& [key, counter] : counters) {
+		auto loc = Location::fromKey(key);
+		auto& entry = result.emplace_back(key, counter, toCycles(counter.duration), std::string{});
+		auto slot = uint8_t(loc.ps | (loc.ss.value_or(0) << 2));
+		if (auto nearest = symbolManager.lookupNearest(loc.addr, slot, loc.segment)) {
+			entry.function = nearest->symbol->name;
+		}
+	}
+	std::ranges::sort(result, [](const Entry& x, const Entry& y) {
+		if (x.counter.duration != y.counter.duration) {
+			return x.counter.duration > y.counter.duration;
+		}
+		return x.key < y.key;
+	});
+	return result;
+}
+
+void Profiler::report(std::span<const TclObject> tokens, TclObject& result)
+{
+	bool functions = false;
+	std::optional<int> limit;
+	std::array info = {
+		flagArg("-functions", functions),
+		valueArg("-limit", limit),
+	};
+	auto& interp = profileCmd.getInterpreter();
+	auto arguments = parseTclArgs(interp, tokens.subspan(2), info);
+	if (!arguments.empty()) throw SyntaxError();
+	auto maxSize = limit ? size_t(std::max(*limit, 0)) : size_t(-1);
+
+	auto entries = getEntries();
+	if (functions) {
+		struct Total {
+			std::string_view name;
+			uint64_t count = 0;
+			uint64_t duration = 0;
+		};
+		std::vector<Total> totals;
+		hash_map<std::string_view, size_t> index;
+		for (const auto& e : entries) {
+			auto name = e.function.empty() ? "?"sv : std::string_view(e.function);
+			auto [it, inserted] = index.try_emplace(name, totals.size());
+			if (inserted) totals.push_back(Total{name});
+			auto& t = totals[it->second];
+			t.count += e.counter.count;
+			t.duration += e.counter.duration;
+		}
+		std::ranges::stable_sort(totals, std::greater{}, &Total::duration);
+		for (const auto& t : totals) {
+			if (result.size() >= maxSize) break;
+			result.addListElement(makeTclList(t.name, t.count, toCycles(t.duration)));
+		}
+	} else {
+		for (const auto& e : entries) {
+			if (result.size() >= maxSize) break;
+			auto loc = Location::fromKey(e.key);
+			result.addListElement(makeTclList(
+				loc.addr, loc.formatSlot(), loc.formatSegment(), e.function,
+				e.counter.count, e.cycles));
+		}
+	}
+}
+
+void Profiler::status(TclObject& result) const
+{
+	result.addDictKeyValues(
+		"status", (mode == Mode::OFF) ? "stopped"sv : "running"sv,
+		"mode", (mode == Mode::OFF)    ? "off"sv
+		      : (mode == Mode::SAMPLE) ? "sample"sv : "exact"sv,
+		"interval", sampleInterval,
+		"entries", counters.size());
+}
+
+void Profiler::exportProfile(std::span<const TclObject> tokens, TclObject& result)
+{
+	std::string_view format = "callgrind";
+	std::array info = {valueArg("-format", format)};
+	auto& interp = profileCmd.getInterpreter();
+	auto arguments = parseTclArgs(interp, tokens.subspan(2), info);
+	if (arguments.size() != 1) throw SyntaxError();
+	auto filename = arguments[0].getString();
+	if (format == "callgrind") {
+		exportCallgrind(filename);
+	} else if (format == "flamegraph") {
+		exportFlameGraph(filename);
+	} else {
+		throw CommandException("Unknown format: ", format, ", must be one of 'callgrind' or 'flamegraph'.");
+	}
+	result = tmpStrCat("Profile written to ", filename);
+}
+
+void Profiler::exportCallgrind(zstring_view filename)
+{
+	std::ofstream os(filename.c_str());
+	if (!os) throw MSXException("Cannot open file for writing: ", filename);
+	writeCallgrind(os, getEntries());
+	if (!os) throw MSXException("Error writing file: ", filename);
+}
+
+void Profiler::exportFlameGraph(zstring_view filename)
+{
+	std::ofstream os(filename.c_str());
+	if (!os) throw MSXException("Cannot open file for writing: ", filename);
+	writeFlameGraph(os, getEntries());
+	if (!os) throw MSXException("Error writing file: ", filename);
+}
+
+// Format supported by e.g. KCachegrind. Without call stacks, only the
+// self-cost per instruction (grouped per function) is known.
+void Profiler::writeCallgrind(std::ostream& os, std::span<const Entry> entries)
+{
+	// group per slot/segment and function, within a group sort on address
+	std::map<std::pair<std::string, std::string>, std::vector<const Entry*>> groups;
+	uint64_t totalCount = 0;
+	uint64_t totalCycles = 0;
+	for (const auto& e : entries) {
+		auto loc = Location::fromKey(e.key);
+		auto file = strCat("slot ", loc.formatSlot(),
+		                   strCat_if(loc.segment, " segment ", STRCAT_LAZY(*loc.segment)));
+		auto function = e.function.empty() ? strCat("?_", file) : e.function;
+		groups[{std::move(file), std::move(function)}].push_back(&e);
+		totalCount += e.counter.count;
+		totalCycles += e.cycles;
+	}
+
+	os << "# callgrind format\n"
+	      "version: 1\n"
+	      "creator: openMSX\n"
+	      "positions: instr\n"
+	      "events: Cycles Instructions\n"
+	      "summary: " << totalCycles << ' ' << totalCount << "\n\n";
+	for (auto& [name, group] : groups) {
+		os << "fl=" << name.first << "\n"
+		      "fn=" << name.second << '\n';
+		std::ranges::sort(group, {}, [](const Entry* e) { return uint16_t(e->key); });
+		for (const auto* e : group) {
+			os << "0x" << hex_string<4>(uint16_t(e->key)) << ' '
+			   << e->cycles << ' ' << e->counter.count << '\n';
+		}
+		os << '\n';
+	}
+}
+
+// The 'folded stacks' format of the flamegraph.pl tool. Without call stacks
+// the hierarchy is: slot, segment, function.
+void Profiler::writeFlameGraph(std::ostream& os, std::span<const Entry> entries)
+{
+	std::map<std::string, uint64_t> stacks;
+	for (const auto& e : entries) {
+		auto loc = Location::fromKey(e.key);
+		auto stack = strCat(
+			"slot ", loc.formatSlot(),
+			strCat_if(loc.segment, ";segment ", STRCAT_LAZY(*loc.segment)),
+			';', e.function.empty() ? "?"sv : std::string_view(e.function));
+		stacks[std::move(stack)] += e.cycles;
+	}
+	for (const auto& [stack, cycles] : stacks) {
+		os << stack << ' ' << cycles << '\n';
+	}
+}
+
+// class Profiler::Cmd
+
+Profiler::Cmd::Cmd(CommandController& commandController_)
+	: Command(commandController_, "profile")
+{
+}
+
+void Profiler::Cmd::execute(std::span<const TclObject> tokens, TclObject& result)
+{
+	checkNumArgs(tokens, AtLeast{2}, "subcommand ?arg ...?");
+	auto& profiler = OUTER(Profiler, profileCmd);
+	executeSubCommand(tokens[1].getString(),
+		"start", [&]{
+			std::optional<int> sample;
+			std::array info = {valueArg("-sample", sample)};
+			auto arguments = parseTclArgs(getInterpreter(), tokens.subspan(2), info);
+			if (!arguments.empty()) throw SyntaxError();
+			if (sample && (*sample <= 0)) {
+				throw CommandException("Sample interval must be positive.");
+			}
+			profiler.start(sample ? std::optional(unsigned(*sample)) : std::nullopt); },
+		"stop", [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			profiler.stop(); },
+		"clear", [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			profiler.clear(); },
+		"status", [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			profiler.status(result); },
+		"report", [&]{ profiler.report(tokens, result); },
+		"export", [&]{ profiler.exportProfile(tokens, result); });
+}
+
+std::string Profiler::Cmd::help(std::span<const TclObject> /*tokens*/) const
+{
+	return "Profiles the emulated MSX code: measures the time spent at each address.\n"
+	       "profile start                   Start exact profiling: every instruction is measured\n"
+	       "profile start -sample <cycles>  Start sampling: record the PC every <cycles> CPU cycles\n"
+	       "profile stop                    Stop profiling (the results are kept)\n"
+	       "profile clear                   Drop all results\n"
+	       "profile status                  Query the profiler state\n"
+	       "profile report [-functions] [-limit <n>]\n"
+	       "    Returns a list of {<address> <slot> <segment> <function> <count> <cycles>},\n"
+	       "    sorted on cycles. With -functions, returns {<function> <count> <cycles>},\n"
+	       "    where a function is the nearest symbol at or below the address (see\n"
+	       "    'debug symbols'). In sampling mode <count> is the number of samples.\n"
+	       "profile export [-format callgrind|flamegraph] <filename>\n"
+	       "    Write the results in callgrind format (e.g. for KCachegrind) or in\n"
+	       "    the 'folded stacks' format of flamegraph.pl.\n"
+	       "\n"
+	       "Exact profiling makes the emulation slower (similar to having a debug\n"
+	       "condition), sampling has almost no overhead. Cycles are calculated with\n"
+	       "the current CPU frequency.";
+}
+
+void Profiler::Cmd::tabCompletion(std::vector<std::string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		static constexpr std::array cmds = {
+			"start"sv, "stop"sv, "clear"sv, "status"sv, "report"sv, "export"sv,
+		};
+		completeString(tokens, cmds);
+	} else if ((tokens.size() >= 3) && (tokens[1] == "export")) {
+		static constexpr std::array options = {"-format"sv};
+		completeFileName(tokens, userFileContext(), options);
+	}
+}
+
+} // namespace openmsx
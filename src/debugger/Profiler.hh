@@ -0,0 +1,143 @@
+#ifndef PROFILER_HH
+#define PROFILER_HH
+
+#include "Command.hh"
+#include "EmuDuration.hh"
+#include "EmuTime.hh"
+#include "Schedulable.hh"
+
+#include "hash_map.hh"
+#include "zstring_view.hh"
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+class Debugger;
+class MSXCPUInterface;
+class MSXMemoryMapperBase;
+class RomBlockDebuggableBase;
+class TclObject;
+
+/** Native profiler for the MSX code, controlled via the 'profile' command.
+  *
+  * It measures how much (emulated) time is spent at each instruction address.
+  * Addresses are further distinguished by the selected slot and (for memory
+  * mappers and mapper ROMs) the selected segment. The results can be
+  * aggregated per function, using the loaded symbol files.
+  *
+  * There are two modes:
+  * - exact: CPUCore reports the duration of every executed instruction.
+  *   While active, the CPU executes its (slower) one-instruction-at-a-time
+  *   loop, the same as when there are debug conditions.
+  * - sampling: every N cycles the current PC is recorded. This has almost
+  *   no overhead, but the result is only a statistical approximation.
+  */
+class Profiler final : public Schedulable
+{
+public:
+	enum class Mode : uint8_t { OFF, EXACT, SAMPLE };
+
+	explicit Profiler(Debugger& debugger);
+
+	/** Is the exact mode active? Then CPUCore must call locate() before and
+	  * add() after each instruction. */
+	[[nodiscard]] bool isCounting() const { return mode == Mode::EXACT; }
+
+	/** Returns a key that identifies the given address in the currently
+	  * selected slot and segment. */
+	[[nodiscard]] uint64_t locate(uint16_t pc);
+	void add(uint64_t key, EmuDuration duration) {
+		auto& counter = counters[key];
+		++counter.count;
+		counter.duration += duration.toUint64();
+	}
+
+	/** Called by MSXCPUInterface when the device that's visible in the
+	  * given page changed (slot selection, or a device got (un)registered,
+	  * e.g. because it's about to be deleted). */
+	void visibleDeviceChanged(unsigned page) { pageCache[page] = {}; }
+
+	void transfer(Profiler& other);
+
+	struct Counter {
+		uint64_t count = 0;
+		uint64_t duration = 0; // in EmuDuration units
+	};
+	struct Entry {
+		uint64_t key;
+		Counter counter;
+		uint64_t cycles;
+		std::string function; // empty if unknown
+	};
+	/** The decoded form of the keys returned by locate(). */
+	struct Location {
+		uint16_t addr = 0;
+		uint8_t ps = 0;
+		std::optional<uint8_t> ss = {}; // only for expanded slots
+		std::optional<uint16_t> segment = {};
+
+		[[nodiscard]] static Location fromKey(uint64_t key);
+		[[nodiscard]] uint64_t toKey() const;
+		[[nodiscard]] std::string formatSlot() const;
+		[[nodiscard]] std::string formatSegment() const;
+
+		[[nodiscard]] bool operator==(const Location&) const = default;
+	};
+
+//private:
+	// These should not be called directly, except by the unittest
+	static void writeCallgrind(std::ostream& os, std::span<const Entry> entries);
+	static void writeFlameGraph(std::ostream& os, std::span<const Entry> entries);
+
+private:
+	struct PageCache {
+		bool valid = false;
+		const MSXMemoryMapperBase* mapper = nullptr;
+		RomBlockDebuggableBase* romBlocks = nullptr;
+	};
+
+	void start(std::optional<unsigned> sampleInterval);
+	void stop();
+	void clear();
+	[[nodiscard]] std::optional<uint16_t> getSegment(unsigned page, uint16_t addr);
+	[[nodiscard]] std::vector<Entry> getEntries();
+	[[nodiscard]] uint64_t toCycles(uint64_t duration) const;
+	void exportCallgrind(zstring_view filename);
+	void exportFlameGraph(zstring_view filename);
+
+	void report(std::span<const TclObject> tokens, TclObject& result);
+	void status(TclObject& result) const;
+	void exportProfile(std::span<const TclObject> tokens, TclObject& result);
+
+	// Schedulable
+	void executeUntil(EmuTime time) override;
+
+private:
+	Debugger& debugger;
+
+	struct Cmd final : Command {
+		explicit Cmd(CommandController& commandController);
+		void execute(std::span<const TclObject> tokens, TclObject& result) override;
+		[[nodiscard]] std::string help(std::span<const TclObject> tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	} profileCmd;
+
+	hash_map<uint64_t, Counter> counters;
+	std::array<PageCache, 4> pageCache;
+	MSXCPUInterface* cpuInterface = nullptr; // only valid while active
+
+	Mode mode = Mode::OFF;
+	unsigned sampleInterval = 0; // in CPU cycles
+	EmuTime lastSample = EmuTime::zero();
+};
+
+} // namespace openmsx
+
+#endif
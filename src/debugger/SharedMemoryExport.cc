@@ -0,0 +1,376 @@
+#include "SharedMemoryExport.hh"
+
+#include "Debuggable.hh"
+#include "Debugger.hh"
+
+#include "CommandException.hh"
+#include "Event.hh"
+#include "EventDistributor.hh"
+#include "MSXException.hh"
+#include "MSXMotherBoard.hh"
+#include "Reactor.hh"
+#include "TclArgParser.hh"
+#include "TclObject.hh"
+
+#include "enumerate.hh"
+#include "narrow.hh"
+#include "outer.hh"
+#include "ranges.hh"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std::literals;
+
+namespace openmsx {
+
+static constexpr uint32_t VERSION = 1;
+static constexpr size_t DATA_ALIGNMENT = 64;
+
+struct SegmentHeader {
+	std::array<char, 8> magic;
+	uint32_t version;
+	uint32_t numEntries;
+	uint64_t sequence;
+	uint64_t time;
+};
+struct SegmentEntry {
+	std::array<char, 56> name;
+	uint32_t offset;
+	uint32_t size;
+};
+static_assert(sizeof(SegmentHeader) == 32);
+static_assert(sizeof(SegmentEntry) == 64);
+
+[[nodiscard]] static size_t alignUp(size_t offset, size_t alignment)
+{
+	return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+// The name as it's passed to the OS.
+[[nodiscard]] static std::string nativeName(const std::string& name)
+{
+#ifdef _WIN32
+	return name;
+#else
+	return name.starts_with('/') ? name : "/" + name;
+#endif
+}
+
+class SharedMemoryExport::Segment
+{
+public:
+	// Fails when a segment with this name already exists (e.g. one of
+	// another openMSX process), it's never shared or taken over.
+	Segment(const std::string& name, size_t size_)
+		: size(size_)
+	{
+#ifdef _WIN32
+		handle = CreateFileMappingA(
+			INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+			DWORD(uint64_t(size) >> 32), DWORD(size), name.c_str());
+		if (!handle) {
+			throw MSXException("Couldn't create shared memory segment ", name);
+		}
+		if (GetLastError() == ERROR_ALREADY_EXISTS) {
+			CloseHandle(handle);
+			throw MSXException("Shared memory segment name in use: ", name);
+		}
+		ptr = static_cast<uint8_t*>(MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size));
+		if (!ptr) {
+			CloseHandle(handle);
+			throw MSXException("Couldn't map shared memory segment ", name);
+		}
+#else
+		shmName = nativeName(name);
+		fd = shm_open(shmName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd == -1) {
+			if (errno == EEXIST) {
+				throw MSXException("Shared memory segment name in use: ", shmName);
+			}
+			throw MSXException("Couldn't create shared memory segment ",
+			                   shmName, ": ", strerror(errno));
+		}
+		if (ftruncate(fd, off_t(size)) == -1) {
+			auto error = errno;
+			cleanup();
+			throw MSXException("Couldn't resize shared memory segment ",
+			                   shmName, ": ", strerror(error));
+		}
+		auto* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (p == MAP_FAILED) {
+			auto error = errno;
+			cleanup();
+			throw MSXException("Couldn't map shared memory segment ",
+			                   shmName, ": ", strerror(error));
+		}
+		ptr = static_cast<uint8_t*>(p);
+#endif
+		std::ranges::fill(data(), 0);
+	}
+
+	~Segment()
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(ptr);
+		CloseHandle(handle);
+#else
+		munmap(ptr, size);
+		cleanup();
+#endif
+	}
+
+	Segment(const Segment&) = delete;
+	Segment(Segment&&) = delete;
+	Segment& operator=(const Segment&) = delete;
+	Segment& operator=(Segment&&) = delete;
+
+	[[nodiscard]] std::span<uint8_t> data() const { return {ptr, size}; }
+
+private:
+#ifndef _WIN32
+	void cleanup()
+	{
+		close(fd);
+		shm_unlink(shmName.c_str());
+	}
+#endif
+
+private:
+#ifdef _WIN32
+	HANDLE handle = nullptr;
+#else
+	std::string shmName;
+	int fd = -1;
+#endif
+	uint8_t* ptr = nullptr;
+	size_t size;
+};
+
+
+SharedMemoryExport::SharedMemoryExport(Debugger& debugger_)
+	: debugger(debugger_)
+	, shmCmd(debugger.getMotherBoard().getCommandController())
+{
+}
+
+SharedMemoryExport::~SharedMemoryExport()
+{
+	stop();
+}
+
+void SharedMemoryExport::start(std::string segmentName, std::span<const TclObject> names, Sync mode)
+{
+	std::vector<Entry> newEntries;
+	auto offset = alignUp(sizeof(SegmentHeader) + names.size() * sizeof(SegmentEntry), DATA_ALIGNMENT);
+	for (const auto& n : names) {
+		auto dbgName = n.getString();
+		if (dbgName.size() >= sizeof(SegmentEntry::name)) {
+			throw CommandException("Debuggable name too long: ", dbgName);
+		}
+		auto* d = debugger.findDebuggable(dbgName);
+		if (!d) throw CommandException("No such debuggable: ", dbgName);
+		newEntries.emplace_back(std::string(dbgName), narrow<uint32_t>(offset), d->getSize());
+		offset = alignUp(offset + d->getSize(), DATA_ALIGNMENT);
+	}
+
+	// Only replace the current export when the new one could be created.
+	// Except when the name stays the same: then the old segment must be
+	// removed first.
+	if (segment && (nativeName(segmentName) == nativeName(name))) stop();
+	auto newSegment = std::make_unique<Segment>(segmentName, offset);
+	stop();
+	segment = std::move(newSegment);
+	auto mem = segment->data();
+	auto* header = reinterpret_cast<SegmentHeader*>(mem.data());
+	memcpy(header->magic.data(), "openMSX", 8);
+	header->version = VERSION;
+	header->numEntries = narrow<uint32_t>(newEntries.size());
+	auto* table = reinterpret_cast<SegmentEntry*>(mem.data() + sizeof(SegmentHeader));
+	for (auto [i, e] : enumerate(newEntries)) {
+		copy_to_range(std::string_view(e.debuggable), table[i].name);
+		table[i].offset = e.offset;
+		table[i].size = e.size;
+	}
+
+	entries = std::move(newEntries);
+	name = std::move(segmentName);
+	syncMode = mode;
+	numSyncs = 0;
+	registerListeners();
+	sync();
+}
+
+void SharedMemoryExport::stop()
+{
+	if (!segment) return;
+	unregisterListeners();
+	segment.reset();
+	entries.clear();
+}
+
+void SharedMemoryExport::sync()
+{
+	if (!segment) return;
+	auto mem = segment->data();
+	auto* header = reinterpret_cast<SegmentHeader*>(mem.data());
+	std::atomic_ref<uint64_t> sequence(header->sequence);
+
+	auto seq = sequence.load(std::memory_order_relaxed);
+	sequence.store(seq + 1, std::memory_order_relaxed); // odd: update in progress
+	std::atomic_thread_fence(std::memory_order_release);
+
+	for (const auto& e : entries) {
+		auto out = mem.subspan(e.offset, e.size);
+		// Lookup by name: the debuggable may have been removed (or
+		// replaced after a machine switch) since the export was started.
+		size_t n = 0;
+		if (auto* d = debugger.findDebuggable(e.debuggable)) {
+			n = std::min<size_t>(e.size, d->getSize());
+			d->readBlock(0, out.first(n));
+		}
+		std::ranges::fill(out.subspan(n), 0);
+	}
+	header->time = debugger.getMotherBoard().getCurrentTime().toUint64();
+
+	sequence.store(seq + 2, std::memory_order_release);
+	++numSyncs;
+}
+
+void SharedMemoryExport::transfer(SharedMemoryExport& other)
+{
+	// Keep using the same segment, external tools shouldn't notice a
+	// machine switch (e.g. after a reverse).
+	if (!other.segment) return;
+	other.unregisterListeners();
+	stop();
+	segment = std::move(other.segment);
+	entries = std::move(other.entries);
+	other.entries.clear();
+	name = other.name;
+	syncMode = other.syncMode;
+	numSyncs = other.numSyncs;
+	registerListeners();
+	sync();
+}
+
+void SharedMemoryExport::registerListeners()
+{
+	auto& distributor = debugger.getMotherBoard().getReactor().getEventDistributor();
+	if (syncMode != Sync::MANUAL) distributor.registerEventListener(EventType::BREAK, *this);
+	if (syncMode == Sync::FRAME) distributor.registerEventListener(EventType::FINISH_FRAME, *this);
+}
+
+void SharedMemoryExport::unregisterListeners()
+{
+	auto& distributor = debugger.getMotherBoard().getReactor().getEventDistributor();
+	if (syncMode == Sync::FRAME) distributor.unregisterEventListener(EventType::FINISH_FRAME, *this);
+	if (syncMode != Sync::MANUAL) distributor.unregisterEventListener(EventType::BREAK, *this);
+}
+
+bool SharedMemoryExport::signalEvent(const Event& event)
+{
+	if (getType(event) == EventType::FINISH_FRAME) {
+		// once per frame, also when there are multiple video sources
+		const auto& ffe = get_event<FinishFrameEvent>(event);
+		if (ffe.getSource() != ffe.getSelectedSource()) return false;
+	}
+	sync();
+	return false;
+}
+
+
+// class SharedMemoryExport::Cmd
+
+static constexpr std::array syncNames = {"manual"sv, "break"sv, "frame"sv};
+
+SharedMemoryExport::Cmd::Cmd(CommandController& commandController_)
+	: Command(commandController_, "shared_memory_export")
+{
+}
+
+void SharedMemoryExport::Cmd::execute(std::span<const TclObject> tokens, TclObject& result)
+{
+	checkNumArgs(tokens, AtLeast{2}, "subcommand ?arg ...?");
+	auto& shm = OUTER(SharedMemoryExport, shmCmd);
+	executeSubCommand(tokens[1].getString(),
+		"start", [&]{
+			std::string_view syncStr = "frame";
+			std::array info = {valueArg("-sync", syncStr)};
+			auto arguments = parseTclArgs(getInterpreter(), tokens.subspan(2), info);
+			if (arguments.size() < 2) throw SyntaxError();
+			auto it = std::ranges::find(syncNames, syncStr);
+			if (it == syncNames.end()) {
+				throw CommandException("Invalid sync mode '", syncStr,
+				                       "', must be one of: frame, break, manual");
+			}
+			auto mode = Sync(it - syncNames.begin());
+			shm.start(std::string(arguments[0].getString()), subspan(arguments, 1), mode); },
+		"stop", [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			shm.stop(); },
+		"sync", [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			if (!shm.segment) throw CommandException("Not active");
+			shm.sync(); },
+		"status", [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			TclObject debuggables;
+			for (const auto& e : shm.entries) debuggables.addListElement(e.debuggable);
+			result.addDictKeyValues(
+				"status", shm.segment ? "running"sv : "stopped"sv,
+				"name", shm.name,
+				"sync", syncNames[size_t(shm.syncMode)],
+				"size", shm.segment ? shm.segment->data().size() : size_t(0),
+				"debuggables", debuggables,
+				"updates", shm.numSyncs); });
+}
+
+std::string SharedMemoryExport::Cmd::help(std::span<const TclObject> /*tokens*/) const
+{
+	return "Mirrors debuggables into a shared memory segment, for external tools.\n"
+	       "shared_memory_export start [-sync frame|break|manual] <name> <debuggable> ...\n"
+	       "    Create the segment with the given name and start mirroring the given\n"
+	       "    debuggables (see 'debug list'). Replaces a running export. It's an\n"
+	       "    error when a segment with that name already exists (e.g. one of\n"
+	       "    another openMSX process). The segment is updated:\n"
+	       "      frame:  every frame and when the emulation breaks (default)\n"
+	       "      break:  only when the emulation breaks\n"
+	       "      manual: only via 'shared_memory_export sync'\n"
+	       "shared_memory_export sync    Update the segment now\n"
+	       "shared_memory_export stop    Stop and remove the segment\n"
+	       "shared_memory_export status  Query the current state\n"
+	       "\n"
+	       "The layout of the segment is: a 32 byte header (\"openMSX\\0\", u32 version,\n"
+	       "u32 number of entries, u64 sequence counter, u64 time), per debuggable a\n"
+	       "64 byte entry (56 byte name, u32 offset, u32 size), followed by the data.\n"
+	       "The sequence counter is odd while an update is in progress.";
+}
+
+void SharedMemoryExport::Cmd::tabCompletion(std::vector<std::string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		static constexpr std::array cmds = {"start"sv, "stop"sv, "sync"sv, "status"sv};
+		completeString(tokens, cmds);
+	} else if ((tokens.size() >= 3) && (tokens[1] == "start")) {
+		if (tokens[tokens.size() - 2] == "-sync") {
+			completeString(tokens, syncNames);
+		} else {
+			auto& shm = OUTER(SharedMemoryExport, shmCmd);
+			completeString(tokens, std::views::keys(shm.debugger.getDebuggables()));
+		}
+	}
+}
+
+} // namespace openmsx
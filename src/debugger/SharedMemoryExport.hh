@@ -0,0 +1,91 @@
+#ifndef SHAREDMEMORYEXPORT_HH
+#define SHAREDMEMORYEXPORT_HH
+
+#include "Command.hh"
+#include "EventListener.hh"
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+class Debugger;
+
+/** Mirrors the content of a selection of debuggables into a shared memory
+  * segment, controlled via the 'shared_memory_export' command. External tools
+  * on the same host can read the whole state at memory speed, instead of via
+  * 'debug read_block' over the (XML) control connection.
+  *
+  * The segment is updated at configurable moments: every frame (and when the
+  * emulation breaks), only when the emulation breaks, or only on request.
+  *
+  * Layout of the segment (in host byte order):
+  *   header (32 bytes):
+  *     char[8]  "openMSX\0"
+  *     u32      version (1)
+  *     u32      number of entries
+  *     u64      sequence counter, odd while an update is in progress
+  *     u64      time of the last update (EmuTime units)
+  *   per entry (64 bytes):
+  *     char[56] name of the debuggable (zero terminated)
+  *     u32      offset of the data (from the start of the segment)
+  *     u32      size of the data
+  *   followed by the data of the entries.
+  * To get a consistent snapshot, a reader should: read the sequence counter
+  * (retry while it's odd), copy the data, then check that the sequence
+  * counter didn't change (retry otherwise).
+  */
+class SharedMemoryExport final : private EventListener
+{
+public:
+	enum class Sync : uint8_t { MANUAL, BREAK, FRAME };
+
+	explicit SharedMemoryExport(Debugger& debugger);
+	~SharedMemoryExport();
+	SharedMemoryExport(const SharedMemoryExport&) = delete;
+	SharedMemoryExport(SharedMemoryExport&&) = delete;
+	SharedMemoryExport& operator=(const SharedMemoryExport&) = delete;
+	SharedMemoryExport& operator=(SharedMemoryExport&&) = delete;
+
+	void transfer(SharedMemoryExport& other);
+
+private:
+	class Segment;
+	struct Entry {
+		std::string debuggable;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	void start(std::string segmentName, std::span<const TclObject> names, Sync mode);
+	void stop();
+	void sync();
+	void registerListeners();
+	void unregisterListeners();
+
+	// EventListener
+	bool signalEvent(const Event& event) override;
+
+private:
+	Debugger& debugger;
+
+	struct Cmd final : Command {
+		explicit Cmd(CommandController& commandController);
+		void execute(std::span<const TclObject> tokens, TclObject& result) override;
+		[[nodiscard]] std::string help(std::span<const TclObject> tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	} shmCmd;
+
+	std::unique_ptr<Segment> segment; // only non-nullptr while active
+	std::vector<Entry> entries;
+	std::string name;
+	Sync syncMode = Sync::FRAME;
+	uint64_t numSyncs = 0;
+};
+
+} // namespace openmsx
+
+#endif
@@ -17,6 +17,8 @@
 #include <cassert>
 #include <fstream>
 #include <ranges>
+#include <thread>
+#include <tuple>
 
 namespace openmsx {
 
@@ -56,6 +58,11 @@ SymbolManager::SymbolManager(CommandController& commandController_)
 {
 }
 
+SymbolManager::~SymbolManager()
+{
+	commandController.getInterpreter().unregisterLazyArray("sym", *this);
+}
+
 // detection logic taken from old openmsx-debugger, could probably be improved.
 [[nodiscard]] SymbolFile::Type SymbolManager::detectType(std::string_view filename, std::string_view buffer)
 {
@@ -102,6 +109,49 @@ SymbolManager::SymbolManager(CommandController& commandController_)
 	return GENERIC;
 }
 
+// Call 'parseLine' for each line in 'buffer'. Big buffers (e.g. the output of
+// a compiler for a big project) are split (on line boundaries) in chunks that
+// are parsed in parallel, so 'parseLine' must be thread-safe. The symbols are
+// returned in the same order as in the buffer.
+[[nodiscard]] static std::vector<Symbol> parseLines(
+	std::string_view buffer, function_ref<std::optional<Symbol>(std::string_view)> parseLine)
+{
+	static constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
+	auto maxChunks = std::max(1u, std::thread::hardware_concurrency());
+	auto numChunks = std::clamp<size_t>(buffer.size() / MIN_CHUNK_SIZE, 1, maxChunks);
+
+	std::vector<std::string_view> chunks;
+	auto chunkSize = buffer.size() / numChunks;
+	while (chunks.size() + 1 < numChunks) {
+		auto end = buffer.find('\n', chunkSize);
+		if (end == std::string_view::npos) break;
+		chunks.push_back(buffer.substr(0, end + 1));
+		buffer.remove_prefix(end + 1);
+	}
+	chunks.push_back(buffer);
+
+	std::vector<std::vector<Symbol>> results(chunks.size());
+	auto work = [&](size_t i) {
+		for (std::string_view line : StringOp::split_view(chunks[i], '\n')) {
+			if (auto symbol = parseLine(line)) {
+				results[i].push_back(std::move(*symbol));
+			}
+		}
+	};
+	std::vector<std::thread> helpers;
+	for (size_t i = 1; i < chunks.size(); ++i) {
+		helpers.emplace_back(work, i);
+	}
+	work(0);
+	for (auto& t : helpers) t.join();
+
+	auto result = std::move(results[0]);
+	for (auto& r : std::views::drop(results, 1)) {
+		append(result, std::move(r));
+	}
+	return result;
+}
+
 [[nodiscard]] SymbolFile SymbolManager::loadLines(
 	std::string_view filename, std::string_view buffer, SymbolFile::Type type,
 	function_ref<std::optional<Symbol>(std::span<std::string_view>)> lineParser)
@@ -111,15 +161,13 @@ SymbolManager::SymbolManager(CommandController& commandController_)
 	result.type = type;
 
 	static constexpr std::string_view whitespace = " \t\r";
-	for (std::string_view fullLine : StringOp::split_view(buffer, '\n')) {
+	result.symbols = parseLines(buffer, [&](std::string_view fullLine) {
 		auto [line, _] = StringOp::splitOnFirst(fullLine, ';');
 
 		auto tokens = static_vector<std::string_view, 3 + 1>{from_range,
 			std::views::take(StringOp::split_view<StringOp::EmptyParts::REMOVE>(line, whitespace), 3 + 1)};
-		if (auto symbol = lineParser(tokens)) {
-			result.symbols.push_back(std::move(*symbol));
-		}
-	}
+		return lineParser(tokens);
+	});
 
 	return result;
 }
@@ -193,22 +241,19 @@ template std::optional<uint32_t> SymbolManager::parseValue<uint32_t>(std::string
 
 [[nodiscard]] SymbolFile SymbolManager::loadNoICE(std::string_view filename, std::string_view buffer)
 {
-	bool anySegment = false;
-	auto parseLine = [&](std::span<std::string_view> tokens) -> std::optional<Symbol> {
+	auto parseLine = [](std::span<std::string_view> tokens) -> std::optional<Symbol> {
 		if (tokens.size() != 3) return {};
 		auto def   = tokens[0];
 		auto label = tokens[1];
 		auto value = tokens[2];
 		if (StringOp::casecmp cmp; !cmp(def, "def")) return {};
 		// detecting segment information above 16bits
-		auto symbol = checkLabelSegmentAndValue(label, value);
-		anySegment |= symbol->segment.has_value();
-		return symbol;
+		return checkLabelSegmentAndValue(label, value);
 	};
 	auto file = loadLines(filename, buffer, SymbolFile::Type::NOICE, parseLine);
 	 // Heuristic: if all segments in the symbol file are 0,
 	 // then assume the file contains no segment information.
-	if (anySegment) {
+	if (std::ranges::any_of(file.symbols, [](const Symbol& sym) { return sym.segment.has_value(); })) {
 		file.hasSegmentInfo = true;
 		for (auto& symbol: file.getSymbols()) {
 			if (!symbol.segment) symbol.segment = 0;
@@ -239,28 +284,25 @@ template std::optional<uint32_t> SymbolManager::parseValue<uint32_t>(std::string
 	result.filename = filename;
 	result.type = SymbolFile::Type::VASM;
 
-	static constexpr std::string_view whitespace = " \t\r";
-	bool skipLines = true;
-	for (std::string_view line : StringOp::split_view(buffer, '\n')) {
-		if (skipLines) {
-			if (line.starts_with("Symbols by value:")) {
-				skipLines = false;
-			}
-			continue;
-		}
+	// skip everything up to (and including) the line "Symbols by value:"
+	static constexpr std::string_view header = "Symbols by value:";
+	auto pos = buffer.starts_with(header) ? 0 : buffer.find(strCat('\n', header));
+	if (pos == std::string_view::npos) return result;
+	auto eol = buffer.find('\n', pos + 1);
+	buffer = (eol == std::string_view::npos) ? std::string_view{} : buffer.substr(eol + 1);
 
+	static constexpr std::string_view whitespace = " \t\r";
+	result.symbols = parseLines(buffer, [](std::string_view line) -> std::optional<Symbol> {
 		auto tokens = static_vector<std::string_view, 2 + 1>{from_range,
 			std::views::take(StringOp::split_view<StringOp::EmptyParts::REMOVE>(line, whitespace), 2 + 1)};
-		if (tokens.size() != 2) continue;
+		if (tokens.size() != 2) return {};
 		auto value = tokens[0];
 		auto label = tokens[1];
 
-		if (auto val = StringOp::stringToBase<16, uint16_t>(value)) {
-			if (auto symbol = checkLabel(label, *val)) {
-				result.symbols.push_back(std::move(*symbol));
-			}
-		}
-	}
+		auto val = StringOp::stringToBase<16, uint16_t>(value);
+		if (!val) return {};
+		return checkLabel(label, *val);
+	});
 
 	return result;
 }
@@ -442,16 +484,12 @@ void SymbolManager::refresh()
 {
 	// Drop caches
 	lookupValueCache.clear();
+	lookupNameCache.clear();
+	nearestCache.clear();
 
 	// Allow to access symbol-values in Tcl expression with syntax: $sym(JIFFY)
-	auto& interp = commandController.getInterpreter();
-	TclObject arrayName("sym");
-	interp.unsetVariable(arrayName.getString().c_str());
-	for (const auto& file : files) {
-		for (const auto& sym : file.symbols) {
-			interp.setVariable(arrayName, TclObject(sym.name), TclObject(sym.value));
-		}
-	}
+	// The elements are only created when used, see getElement().
+	commandController.getInterpreter().registerLazyArray("sym", *this);
 
 	if (observer) observer->notifySymbolsChanged();
 }
@@ -532,6 +570,79 @@ std::span<Symbol const * const> SymbolManager::lookupValue(uint16_t value)
 	return {};
 }
 
+static constexpr auto nearestKey = [](const Symbol* sym) {
+	return std::tuple(sym->slot, sym->segment, sym->value);
+};
+
+void SymbolManager::sortForNearest(std::vector<const Symbol*>& index)
+{
+	std::ranges::stable_sort(index, {}, nearestKey);
+}
+
+std::optional<SymbolManager::NearestSymbol> SymbolManager::findNearest(
+	std::span<const Symbol* const> index,
+	uint16_t addr, uint8_t slot, std::optional<uint16_t> segment)
+{
+	std::optional<NearestSymbol> result;
+	// from least to most specific, on equal values the latter wins
+	for (auto s : {std::optional<uint8_t>{}, std::optional<uint8_t>{slot}}) {
+		for (auto seg : {std::optional<uint16_t>{}, segment}) {
+			auto it = std::ranges::upper_bound(index, std::tuple(s, seg, addr), {}, nearestKey);
+			if (it == index.begin()) continue;
+			const auto* sym = *std::prev(it);
+			if ((sym->slot != s) || (sym->segment != seg)) continue; // nothing below 'addr' in this group
+			if (!result || (sym->value >= result->symbol->value)) {
+				result = NearestSymbol{.symbol = sym, .offset = uint16_t(addr - sym->value)};
+			}
+		}
+	}
+	return result;
+}
+
+std::optional<SymbolManager::NearestSymbol> SymbolManager::lookupNearest(
+	uint16_t addr, uint8_t slot, std::optional<uint16_t> segment)
+{
+	if (nearestCache.empty()) {
+		for (const auto& file : files) {
+			for (const auto& sym : file.symbols) {
+				nearestCache.push_back(&sym);
+			}
+		}
+		sortForNearest(nearestCache);
+	}
+	return findNearest(nearestCache, addr, slot, segment);
+}
+
+const hash_map<std::string, uint16_t, XXHasher>& SymbolManager::getNameCache()
+{
+	if (lookupNameCache.empty()) {
+		// on duplicates, later files (and later symbols) win
+		for (const auto& file : files) {
+			for (const auto& sym : file.symbols) {
+				lookupNameCache.insert_or_assign(sym.name, sym.value);
+			}
+		}
+	}
+	return lookupNameCache;
+}
+
+std::optional<TclObject> SymbolManager::getElement(std::string_view index)
+{
+	if (const auto* value = lookup(getNameCache(), index)) {
+		return TclObject(*value);
+	}
+	return {};
+}
+
+TclObject SymbolManager::getAllElements()
+{
+	TclObject result;
+	for (const auto& [name, value] : getNameCache()) {
+		result.addListElement(name, value);
+	}
+	return result;
+}
+
 SymbolFile* SymbolManager::findFile(std::string_view filename)
 {
 	if (auto it = std::ranges::find(files, filename, &SymbolFile::filename); it == files.end()) {
@@ -1,8 +1,11 @@
 #ifndef SYMBOL_MANAGER_HH
 #define SYMBOL_MANAGER_HH
 
+#include "Interpreter.hh"
+
 #include "function_ref.hh"
 #include "hash_map.hh"
+#include "xxhash.hh"
 #include "zstring_view.hh"
 
 #include <cassert>
@@ -61,10 +64,21 @@ struct SymbolObserver
 	virtual void notifySymbolsChanged() = 0;
 };
 
-class SymbolManager
+class SymbolManager : private Interpreter::LazyArray
 {
+public:
+	struct NearestSymbol {
+		const Symbol* symbol;
+		uint16_t offset; // distance from the symbol value to the looked up address
+	};
+
 public:
 	explicit SymbolManager(CommandController& commandController);
+	~SymbolManager();
+	SymbolManager(const SymbolManager&) = delete;
+	SymbolManager(SymbolManager&&) = delete;
+	SymbolManager& operator=(const SymbolManager&) = delete;
+	SymbolManager& operator=(SymbolManager&&) = delete;
 
 	void setObserver(SymbolObserver* observer_) {
 		assert(!observer || !observer_);
@@ -87,6 +101,12 @@ public:
 	[[nodiscard]] const auto& getFiles() const { return files; }
 	[[nodiscard]] SymbolFile* findFile(std::string_view filename);
 	[[nodiscard]] std::span<Symbol const * const> lookupValue(uint16_t value);
+	// Find the symbol with the highest value <= 'addr' (e.g. the start of
+	// the function that contains 'addr'). Symbols without slot or segment
+	// info match any slot or segment, when there are multiple candidates
+	// with the same value, the most specific one is returned.
+	[[nodiscard]] std::optional<NearestSymbol> lookupNearest(
+		uint16_t addr, uint8_t slot, std::optional<uint16_t> segment);
 	[[nodiscard]] std::optional<uint16_t> lookupSymbol(std::string_view s) const;
 	[[nodiscard]] std::optional<uint16_t> parseSymbolOrValue(std::string_view s) const;
 
@@ -116,15 +136,27 @@ public:
 	[[nodiscard]] static SymbolFile loadSymbolFile(
 		zstring_view filename, SymbolFile::Type type,
 		std::optional<uint8_t> slot, std::optional<uint16_t> segment);
+	static void sortForNearest(std::vector<const Symbol*>& index);
+	[[nodiscard]] static std::optional<NearestSymbol> findNearest(
+		std::span<const Symbol* const> index, // sorted via sortForNearest()
+		uint16_t addr, uint8_t slot, std::optional<uint16_t> segment);
 
 private:
 	void refresh();
+	[[nodiscard]] const hash_map<std::string, uint16_t, XXHasher>& getNameCache();
+
+	// Interpreter::LazyArray
+	[[nodiscard]] std::optional<TclObject> getElement(std::string_view index) override;
+	[[nodiscard]] TclObject getAllElements() override;
 
 private:
 	CommandController& commandController;
 	SymbolObserver* observer = nullptr; // only one for now, could become a vector later
 	std::vector<SymbolFile> files;
-	hash_map<uint16_t, std::vector<const Symbol*>> lookupValueCache; // calculated from 'files'
+	// calculated from 'files'
+	hash_map<uint16_t, std::vector<const Symbol*>> lookupValueCache;
+	hash_map<std::string, uint16_t, XXHasher> lookupNameCache; // for the Tcl 'sym' array
+	std::vector<const Symbol*> nearestCache; // sorted on (slot, segment, value)
 };
 
 
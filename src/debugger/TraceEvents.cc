@@ -0,0 +1,306 @@
+#include "TraceEvents.hh"
+
+#include "MSXException.hh"
+
+#include "stl.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+namespace openmsx {
+
+// Serialized format of the values of one chunk (only used for the temporary
+// spill file, so in host byte order): per value a tag byte, followed by
+//   string: u32 length + characters
+//   int/double: 8 bytes
+enum ValueTag : uint8_t { STRING, MONOSTATE, U64, DOUBLE };
+
+[[nodiscard]] static std::vector<uint8_t> serialize(std::span<const TraceValue> values)
+{
+	std::vector<uint8_t> result;
+	auto put = [&](const void* data, size_t size) {
+		const auto* p = static_cast<const uint8_t*>(data);
+		result.insert(result.end(), p, p + size);
+	};
+	for (const auto& v : values) {
+		v.visit(overloaded{
+			[&](std::string_view s) {
+				result.push_back(STRING);
+				auto len = uint32_t(s.size());
+				put(&len, sizeof(len));
+				put(s.data(), len);
+			},
+			[&](std::monostate) { result.push_back(MONOSTATE); },
+			[&](uint64_t u) { result.push_back(U64); put(&u, sizeof(u)); },
+			[&](double d) { result.push_back(DOUBLE); put(&d, sizeof(d)); },
+		});
+	}
+	return result;
+}
+
+[[nodiscard]] static std::vector<TraceValue> deserialize(std::span<const uint8_t> buf, size_t num)
+{
+	auto get = [&](size_t size) {
+		if (buf.size() < size) throw MSXException("Corrupt trace spill file");
+		auto result = buf.first(size);
+		buf = buf.subspan(size);
+		return result;
+	};
+	auto getPod = [&]<typename T>(T result) {
+		memcpy(&result, get(sizeof(T)).data(), sizeof(T));
+		return result;
+	};
+
+	std::vector<TraceValue> result;
+	result.reserve(num);
+	repeat(num, [&] {
+		switch (getPod(uint8_t(0))) {
+		case STRING: {
+			auto str = get(getPod(uint32_t(0)));
+			result.emplace_back(std::string_view(
+				reinterpret_cast<const char*>(str.data()), str.size()));
+			break;
+		}
+		case MONOSTATE: result.emplace_back(std::monostate{}); break;
+		case U64:       result.emplace_back(getPod(uint64_t(0))); break;
+		case DOUBLE:    result.emplace_back(getPod(double(0.0))); break;
+		default: throw MSXException("Corrupt trace spill file");
+		}
+	});
+	return result;
+}
+
+[[nodiscard]] static size_t valuesMemory(std::span<const TraceValue> values)
+{
+	size_t result = values.size() * sizeof(TraceValue);
+	for (const auto& v : values) {
+		if (v.index() == size_t(TraceValue::Tag::HeapStr)) {
+			result += v.get_string().size() + 1;
+		}
+	}
+	return result;
+}
+
+
+// class TraceStorage
+
+TraceStorage& TraceStorage::instance()
+{
+	static TraceStorage oneInstance;
+	return oneInstance;
+}
+
+void TraceStorage::setMemoryLimit(size_t bytes)
+{
+	memoryLimit = bytes;
+	evict();
+}
+
+void TraceStorage::loaded(const TraceEvents& events, size_t chunk, size_t bytes)
+{
+	memoryUsage += bytes;
+	lru.push_back({&events, chunk});
+	evict();
+}
+
+void TraceStorage::forget(const TraceEvents& events, size_t firstChunk)
+{
+	std::erase_if(lru, [&](const ChunkRef& r) {
+		return (r.events == &events) && (r.chunk >= firstChunk);
+	});
+}
+
+void TraceStorage::evict()
+{
+	// Always keep the most recently loaded chunk, the caller may be using it.
+	while ((memoryUsage > memoryLimit) && (lru.size() > 1) && !spillFailed) {
+		auto [events, chunk] = lru.front();
+		try {
+			events->unload(chunk);
+		} catch (MSXException&) {
+			// E.g. disk full, then keep everything in memory.
+			spillFailed = true;
+			return;
+		}
+		lru.pop_front();
+	}
+}
+
+uint64_t TraceStorage::write(std::span<const uint8_t> data)
+{
+	if (!file.is_open()) {
+		file = File::createTemporary();
+	}
+	// Note: the space of dropped chunks is not reused.
+	auto pos = diskUsage;
+	file.seek(pos);
+	file.write(data);
+	diskUsage += data.size();
+	return pos;
+}
+
+void TraceStorage::read(uint64_t pos, std::span<uint8_t> data)
+{
+	file.seek(pos);
+	file.read(data);
+}
+
+
+// class TraceEvents
+
+EmuTime TraceEvents::getTime(size_t i) const
+{
+	assert(i < numEvents);
+	return EmuTime::fromUint64(chunks[i >> CHUNK_BITS].getTime(i & (CHUNK_SIZE - 1)));
+}
+
+TraceValue TraceEvents::getValue(size_t i) const
+{
+	assert(i < numEvents);
+	return getLoadedChunk(i >> CHUNK_BITS).values[i & (CHUNK_SIZE - 1)];
+}
+
+const TraceEvents::Chunk& TraceEvents::getLoadedChunk(size_t c) const
+{
+	auto& chunk = chunks[c];
+	if (!chunk.loaded) {
+		assert(chunk.onDisk);
+		auto& storage = TraceStorage::instance();
+		std::vector<uint8_t> buf(chunk.fileSize);
+		storage.read(chunk.filePos, buf);
+		chunk.values = deserialize(buf, chunk.size);
+		chunk.loaded = true;
+		storage.loaded(*this, c, chunk.memory);
+	}
+	return chunk;
+}
+
+void TraceEvents::unload(size_t c) const
+{
+	auto& chunk = chunks[c];
+	assert(chunk.loaded && (chunk.size == CHUNK_SIZE));
+	auto& storage = TraceStorage::instance();
+	if (!chunk.onDisk) {
+		// The values of a complete chunk don't change anymore, so the
+		// copy on disk remains valid when the chunk is reloaded.
+		auto buf = serialize(chunk.values);
+		chunk.filePos = storage.write(buf);
+		chunk.fileSize = uint32_t(buf.size());
+		chunk.onDisk = true;
+	}
+	chunk.values = {}; // also free the memory
+	chunk.loaded = false;
+	storage.unloaded(chunk.memory);
+}
+
+void TraceEvents::push_back(EmuTime t, TraceValue value)
+{
+	auto time = t.toUint64();
+	if ((numEvents & (CHUNK_SIZE - 1)) == 0) {
+		auto& newChunk = chunks.emplace_back();
+		newChunk.firstTime = time;
+	}
+	auto& chunk = chunks.back();
+	assert(chunk.loaded);
+	assert((chunk.size == 0) || (chunk.lastTime <= time));
+
+	auto offset = time - chunk.firstTime;
+	if (chunk.times.empty() && (offset > std::numeric_limits<uint32_t>::max())) {
+		// (rare) doesn't fit in an offset, switch to full times
+		chunk.times.reserve(chunk.offsets.size() + 1);
+		for (auto o : chunk.offsets) chunk.times.push_back(chunk.firstTime + o);
+		chunk.offsets = {};
+	}
+	if (chunk.times.empty()) {
+		chunk.offsets.push_back(uint32_t(offset));
+	} else {
+		chunk.times.push_back(time);
+	}
+	chunk.values.push_back(std::move(value));
+	chunk.lastTime = time;
+	++chunk.size;
+	++numEvents;
+
+	if (chunk.size == CHUNK_SIZE) {
+		// complete, from now on this chunk can be moved to disk
+		chunk.memory = valuesMemory(chunk.values);
+		TraceStorage::instance().loaded(*this, chunks.size() - 1, chunk.memory);
+	}
+}
+
+void TraceEvents::truncate(size_t n)
+{
+	if (n >= numEvents) return;
+	auto& storage = TraceStorage::instance();
+
+	auto first = n >> CHUNK_BITS; // first chunk that changes
+	auto keep = n & (CHUNK_SIZE - 1); // number of events to keep in that chunk
+	if (keep) (void)getLoadedChunk(first);
+
+	storage.forget(*this, first);
+	for (auto c : xrange(first, chunks.size())) {
+		const auto& chunk = chunks[c];
+		if (chunk.loaded && (chunk.size == CHUNK_SIZE)) storage.unloaded(chunk.memory);
+	}
+	chunks.resize(first + (keep ? 1 : 0));
+
+	if (keep) {
+		// this becomes the (incomplete) last chunk again
+		auto& chunk = chunks.back();
+		if (chunk.times.empty()) {
+			chunk.offsets.resize(keep);
+		} else {
+			chunk.times.resize(keep);
+		}
+		chunk.values.resize(keep);
+		chunk.size = keep;
+		chunk.lastTime = chunk.getTime(keep - 1);
+		chunk.memory = 0;
+		chunk.onDisk = false;
+	}
+	numEvents = n;
+}
+
+size_t TraceEvents::findInChunk(size_t c, uint64_t time, bool upper) const
+{
+	const auto& chunk = chunks[c];
+	auto search = [&](const auto& column, auto value) {
+		auto it = upper ? std::ranges::upper_bound(column, value)
+		                : std::ranges::lower_bound(column, value);
+		return size_t(it - column.begin());
+	};
+	if (time < chunk.firstTime) return 0;
+	if (!chunk.times.empty()) return search(chunk.times, time);
+	auto offset = time - chunk.firstTime;
+	if (offset > std::numeric_limits<uint32_t>::max()) return chunk.size;
+	return search(chunk.offsets, uint32_t(offset));
+}
+
+TraceEvents::Iterator TraceEvents::bound(Iterator first, Iterator last, EmuTime t, bool upper) const
+{
+	if (first == last) return last;
+	auto time = t.toUint64();
+	// First find the chunk (using the in-memory index), then search within that chunk.
+	auto it = std::ranges::partition_point(chunks, [&](const Chunk& chunk) {
+		return upper ? (chunk.lastTime <= time) : (chunk.lastTime < time);
+	});
+	if (it == chunks.end()) return last;
+	auto c = size_t(it - chunks.begin());
+	auto index = (c << CHUNK_BITS) + findInChunk(c, time, upper);
+	return {this, std::clamp(index, first.getIndex(), last.getIndex())};
+}
+
+TraceEvents::Iterator TraceEvents::findClosest(Iterator first, Iterator last, EmuTime t)
+{
+	if (first == last) return last;
+	auto it = first.events->lowerBound(first, last, t);
+	if (it == first) return it;
+	auto prev = it - 1;
+	if (it == last) return prev;
+	return ((t - prev.getTime()) <= (it.getTime() - t)) ? prev : it;
+}
+
+} // namespace openmsx
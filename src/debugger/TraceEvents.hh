@@ -0,0 +1,208 @@
+#ifndef TRACEEVENTS_HH
+#define TRACEEVENTS_HH
+
+#include "EmuTime.hh"
+#include "File.hh"
+#include "TraceValue.hh"
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <vector>
+
+namespace openmsx {
+
+struct TraceEvent {
+	EmuTime time;
+	TraceValue value;
+};
+
+class TraceEvents;
+
+/** Keeps the memory used by the values of all traces below a limit (see the
+  * 'trace_memory_limit' setting), by moving the values of the least recently
+  * loaded chunks to a temporary file. Shared by all TraceEvents objects (also
+  * of different machines), because traces can move between machines.
+  */
+class TraceStorage
+{
+public:
+	[[nodiscard]] static TraceStorage& instance();
+
+	void setMemoryLimit(size_t bytes);
+	[[nodiscard]] size_t getMemoryUsage() const { return memoryUsage; }
+	[[nodiscard]] size_t getDiskUsage() const { return diskUsage; }
+
+private:
+	friend class TraceEvents;
+	struct ChunkRef {
+		const TraceEvents* events;
+		size_t chunk;
+	};
+
+	void loaded(const TraceEvents& events, size_t chunk, size_t bytes);
+	void unloaded(size_t bytes) { memoryUsage -= bytes; }
+	void forget(const TraceEvents& events, size_t firstChunk);
+	void evict();
+
+	[[nodiscard]] uint64_t write(std::span<const uint8_t> data);
+	void read(uint64_t pos, std::span<uint8_t> data);
+
+private:
+	std::deque<ChunkRef> lru; // loaded (complete) chunks, oldest first
+	File file; // opened on the first spill
+	size_t memoryLimit = size_t(-1);
+	size_t memoryUsage = 0;
+	size_t diskUsage = 0;
+	bool spillFailed = false;
+};
+
+/** The events of one trace, sorted on time.
+  *
+  * The events are stored in chunks of a fixed size, per chunk the times and
+  * values are stored in separate columns. Times are stored as a 32-bit offset
+  * relative to the first event in the chunk (with a 64-bit fallback for sparse
+  * chunks). The times always stay in memory: together with the per chunk
+  * first/last time they form the index for O(log n) time queries. The values
+  * of complete chunks can be moved to disk (see TraceStorage), then they're
+  * transparently reloaded when accessed.
+  *
+  * Because of this, the events are accessed by value (e.g. the iterators
+  * return a TraceEvent, not a reference).
+  */
+class TraceEvents
+{
+public:
+	static constexpr size_t CHUNK_BITS = 12;
+	static constexpr size_t CHUNK_SIZE = size_t(1) << CHUNK_BITS;
+
+	class Iterator {
+	public:
+		using iterator_concept = std::random_access_iterator_tag;
+		using iterator_category = std::input_iterator_tag;
+		using value_type = TraceEvent;
+		using difference_type = ptrdiff_t;
+		using reference = TraceEvent;
+		struct ArrowProxy {
+			TraceEvent event;
+			[[nodiscard]] const TraceEvent* operator->() const { return &event; }
+		};
+
+		Iterator() : events(nullptr), index(0) {} // not '= default', see Range below
+		Iterator(const TraceEvents* events_, size_t index_)
+			: events(events_), index(index_) {}
+
+		[[nodiscard]] reference operator*() const { return (*events)[index]; }
+		[[nodiscard]] ArrowProxy operator->() const { return {**this}; }
+		[[nodiscard]] reference operator[](difference_type n) const { return *(*this + n); }
+		[[nodiscard]] EmuTime getTime() const { return events->getTime(index); }
+		[[nodiscard]] size_t getIndex() const { return index; }
+
+		Iterator& operator++() { ++index; return *this; }
+		Iterator& operator--() { --index; return *this; }
+		Iterator operator++(int) { auto r = *this; ++index; return r; }
+		Iterator operator--(int) { auto r = *this; --index; return r; }
+		Iterator& operator+=(difference_type n) { index += n; return *this; }
+		Iterator& operator-=(difference_type n) { index -= n; return *this; }
+		[[nodiscard]] friend Iterator operator+(Iterator it, difference_type n) { it += n; return it; }
+		[[nodiscard]] friend Iterator operator+(difference_type n, Iterator it) { it += n; return it; }
+		[[nodiscard]] friend Iterator operator-(Iterator it, difference_type n) { it -= n; return it; }
+		[[nodiscard]] friend difference_type operator-(const Iterator& x, const Iterator& y) {
+			return difference_type(x.index) - difference_type(y.index);
+		}
+		[[nodiscard]] friend bool operator==(const Iterator& x, const Iterator& y) { return x.index == y.index; }
+		[[nodiscard]] friend auto operator<=>(const Iterator& x, const Iterator& y) { return x.index <=> y.index; }
+
+		// Only use the (in-memory) times, used by processTimeline().
+		[[nodiscard]] friend EmuTime timelineTime(const Iterator& it) { return it.getTime(); }
+		[[nodiscard]] friend Iterator timelineUpperBound(Iterator first, Iterator last, EmuTime time) {
+			return first.events->upperBound(first, last, time);
+		}
+
+	private:
+		friend class TraceEvents;
+		const TraceEvents* events;
+		size_t index;
+	};
+	using Range = std::ranges::subrange<Iterator>;
+
+	TraceEvents() = default;
+	~TraceEvents() { clear(); }
+	TraceEvents(const TraceEvents&) = delete;
+	TraceEvents(TraceEvents&&) = delete;
+	TraceEvents& operator=(const TraceEvents&) = delete;
+	TraceEvents& operator=(TraceEvents&&) = delete;
+
+	[[nodiscard]] size_t size() const { return numEvents; }
+	[[nodiscard]] bool empty() const { return numEvents == 0; }
+	[[nodiscard]] Iterator begin() const { return {this, 0}; }
+	[[nodiscard]] Iterator end() const { return {this, numEvents}; }
+	[[nodiscard]] TraceEvent operator[](size_t i) const { return {getTime(i), getValue(i)}; }
+	[[nodiscard]] TraceEvent front() const { return (*this)[0]; }
+	[[nodiscard]] TraceEvent back() const { return (*this)[numEvents - 1]; }
+	[[nodiscard]] EmuTime getTime(size_t i) const;
+	[[nodiscard]] TraceValue getValue(size_t i) const;
+
+	/** First event with time >= 't', resp. time > 't'. */
+	[[nodiscard]] Iterator lowerBound(EmuTime t) const { return lowerBound(begin(), end(), t); }
+	[[nodiscard]] Iterator upperBound(EmuTime t) const { return upperBound(begin(), end(), t); }
+	[[nodiscard]] Iterator lowerBound(Iterator first, Iterator last, EmuTime t) const {
+		return bound(first, last, t, false);
+	}
+	[[nodiscard]] Iterator upperBound(Iterator first, Iterator last, EmuTime t) const {
+		return bound(first, last, t, true);
+	}
+	/** The event in [first, last) that is closest in time to 't' (or
+	  * 'last' if that range is empty). On a tie the earlier event is
+	  * returned. Like find_closest(), but only uses the times. */
+	[[nodiscard]] static Iterator findClosest(Iterator first, Iterator last, EmuTime t);
+	/** All events with a time in the interval [from, to). */
+	[[nodiscard]] Range between(EmuTime from, EmuTime to) const {
+		return {lowerBound(from), lowerBound(to)};
+	}
+
+	/** Append an event, its time must be >= the time of the last event. */
+	void push_back(EmuTime time, TraceValue value);
+	void clear() { truncate(0); }
+	/** Drop all events with time >= 't'. */
+	void eraseFrom(EmuTime t) { truncate(lowerBound(t).getIndex()); }
+
+private:
+	friend class TraceStorage;
+	struct Chunk {
+		uint64_t firstTime = 0;
+		uint64_t lastTime = 0;
+		std::vector<uint32_t> offsets; // time - firstTime, when those all fit
+		std::vector<uint64_t> times;   // otherwise the full times
+		std::vector<TraceValue> values; // only valid when 'loaded'
+		size_t size = 0; // number of events (also when not loaded)
+		size_t memory = 0; // memory used by 'values' (only for complete chunks)
+		uint64_t filePos = 0; // only valid when 'onDisk'
+		uint32_t fileSize = 0;
+		bool loaded = true;
+		bool onDisk = false;
+
+		[[nodiscard]] uint64_t getTime(size_t i) const {
+			return times.empty() ? firstTime + offsets[i] : times[i];
+		}
+	};
+
+	[[nodiscard]] const Chunk& getLoadedChunk(size_t c) const;
+	void unload(size_t c) const;
+	void truncate(size_t n);
+	[[nodiscard]] size_t findInChunk(size_t c, uint64_t time, bool upper) const;
+	[[nodiscard]] Iterator bound(Iterator first, Iterator last, EmuTime t, bool upper) const;
+
+private:
+	// mutable: chunks get loaded on access
+	mutable std::vector<Chunk> chunks;
+	size_t numEvents = 0;
+};
+
+} // namespace openmsx
+
+#endif
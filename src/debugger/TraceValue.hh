@@ -61,6 +61,7 @@ public:
 			char* dst = new char[len + 1];
 			memcpy(dst, src, len + 1);
 			write_payload(dst);
+			set_tag(Tag::HeapStr);
 		} else {
 			memcpy(raw.data(), other.raw.data(), 16);
 		}
@@ -1,8 +1,11 @@
 #include "Tracer.hh"
 
 #include "Debugger.hh"
+#include "InstructionTracer.hh"
 #include "ProbeBreakPoint.hh"
 
+#include "Dasm.hh"
+#include "FileContext.hh"
 #include "Interpreter.hh"
 #include "MSXMotherBoard.hh"
 #include "ReverseManager.hh"
@@ -47,7 +50,7 @@ void Tracer::Trace::addEvent(EmuTime t, TraceValue v, bool merge)
 		[](std::string_view) { return STRING; }
 	});
 	type = std::max(type, valueFormat);
-	events.emplace_back(t, std::move(v));
+	events.push_back(t, std::move(v));
 }
 
 void Tracer::Trace::clear()
@@ -124,8 +127,7 @@ void Tracer::stopReplay(EmuTime time) noexcept
 {
 	// when replay stops, drop all future events
 	for (auto& trace : traces) {
-		auto it = std::ranges::lower_bound(trace->events, time, {}, &Event::time);
-		trace->events.erase(it, trace->events.end());
+		trace->events.eraseFrom(time);
 	}
 }
 
@@ -160,7 +162,8 @@ void Tracer::execute(Debugger& debugger, std::span<const TclObject> tokens, TclO
 		"add",   [&]{ add(debugger, tokens, result, time); },
 		"list",  [&]{ list(cmd, tokens, result); },
 		"drop",  [&]{ drop(debugger, tokens, result); },
-		"probe", [&]{ probe(debugger, tokens, result); });
+		"probe", [&]{ probe(debugger, tokens, result); },
+		"load",  [&]{ load(debugger, tokens, result); });
 }
 
 void Tracer::add(Debugger& debugger, std::span<const TclObject> tokens, TclObject& /*result*/, EmuTime time)
@@ -296,10 +299,82 @@ void Tracer::probe(Debugger& debugger, std::span<const TclObject> tokens, TclObj
 	(void)trace;
 }
 
+void Tracer::load(Debugger& debugger, std::span<const TclObject> tokens, TclObject& result)
+{
+	std::string_view prefix = "cpu";
+	std::array info = {valueArg("-prefix", prefix)};
+	auto& interp = debugger.cmd.getInterpreter();
+	auto arguments = parseTclArgs(interp, tokens.subspan(3), info);
+	if (arguments.size() != 1) {
+		interp.wrongNumArgs(3, tokens, "filename ?-prefix <name>?");
+	}
+	auto filename = arguments[0].getString();
+	try {
+		loadInstructionTrace(debugger, filename, prefix);
+	} catch (MSXException& e) {
+		throw CommandException(e.getMessage());
+	}
+	result = tmpStrCat("Loaded ", filename);
+}
+
+void Tracer::loadInstructionTrace(Debugger& debugger, zstring_view filename, std::string_view prefix)
+{
+	auto getTrace = [&](std::string_view name, Trace::Type type, std::string_view description) -> Trace& {
+		auto& trace = getOrCreateTrace(debugger, tmpStrCat(prefix, '.', name));
+		trace.clear(); // replace a previously loaded trace
+		trace.type = type;
+		trace.format = Trace::Format::HEX;
+		trace.description = description;
+		return trace;
+	};
+	using enum Trace::Type;
+	auto& pcTrace = getTrace("pc", INTEGER, "program counter");
+	auto& instrTrace = getTrace("instr", STRING, "executed instruction");
+	auto& slotTrace = getTrace("slot", STRING, "slot of the program counter");
+	static constexpr std::array<std::string_view, InstructionTracer::NUM_REGS> regNames = {
+		"af", "bc", "de", "hl", "af2", "bc2", "de2", "hl2", "ix", "iy", "sp",
+		"ir", "misc",
+	};
+	std::array<Trace*, InstructionTracer::NUM_REGS> regTraces;
+	for (auto i : xrange(InstructionTracer::NUM_REGS)) {
+		regTraces[i] = &getTrace(regNames[i], INTEGER,
+			(i == InstructionTracer::MISC) ? "IM | (IFF1 << 2) | (IFF2 << 3) | (HALT << 4)" : "");
+	}
+	std::array<Trace*, 2> memTraces = {}; // read, write (only created when needed)
+
+	std::string instr;
+	InstructionTracer::load(filename, [&](const InstructionTracer::Record& rec) {
+		pcTrace.addEvent(rec.time, rec.pc, false);
+
+		auto len = instructionLength(rec.bytes).value_or(1);
+		instr.clear();
+		dasm(std::span{rec.bytes}.first(len), rec.pc, instr);
+		instrTrace.addEvent(rec.time, std::string_view(instr), false);
+
+		auto ps = rec.slot & 3;
+		auto slot = (rec.slot & 0x10) ? tmpStrCat(ps, '-', (rec.slot >> 2) & 3) : tmpStrCat(ps);
+		slotTrace.addEvent(rec.time, std::string_view(slot), true);
+
+		for (auto i : xrange(InstructionTracer::NUM_REGS)) {
+			if (rec.changed & (1 << i)) {
+				regTraces[i]->addEvent(rec.time, rec.regs[i], false);
+			}
+		}
+		for (const auto& a : rec.accesses) {
+			if (!memTraces[0]) {
+				memTraces = {&getTrace("mem_read",  STRING, "memory reads (address=value)"),
+				             &getTrace("mem_write", STRING, "memory writes (address=value)")};
+			}
+			memTraces[a.write]->addEvent(rec.time, std::string_view(
+				tmpStrCat(hex_string<4>(a.address), '=', hex_string<2>(a.value))), false);
+		}
+	});
+}
+
 void Tracer::tabCompletion(const Debugger& debugger, std::vector<std::string>& tokens) const
 {
 	static constexpr std::array cmds = {
-		"add"sv, "list"sv, "drop"sv, "probe"sv,
+		"add"sv, "list"sv, "drop"sv, "probe"sv, "load"sv,
 	};
 	auto& cmd = debugger.cmd;
 	if (tokens.size() == 3) {
@@ -311,6 +386,10 @@ void Tracer::tabCompletion(const Debugger& debugger, std::vector<std::string>& t
 			cmd.completeString(tokens, std::views::transform(debugger.probes, &ProbeBase::getName));
 		}
 	}
+	if ((tokens.size() >= 4) && (tokens[2] == "load"sv)) {
+		static constexpr std::array options = {"-prefix"sv};
+		cmd.completeFileName(tokens, userFileContext(), options);
+	}
 }
 
 [[nodiscard]] std::string Tracer::help(std::span<const TclObject> tokens) const
@@ -322,6 +401,7 @@ void Tracer::tabCompletion(const Debugger& debugger, std::vector<std::string>& t
 		"    list   list the created traces\n"
 		"    drop   drop trace data\n"
 		"    probe  start collecting probe changes\n"
+		"    load   load a recorded instruction trace\n"
 		"  The arguments are specific for each subcommand.\n"
 		"  Type 'help debug trace <subcommand>' for help about a specific subcommand.\n";
 
@@ -359,6 +439,14 @@ void Tracer::tabCompletion(const Debugger& debugger, std::vector<std::string>& t
 		"debug trace probe <name>\n"
 		"  Start collecting changes for the given probe. As if on each change there's an automatic 'debug trace add <name> <value>'.\n";
 
+	constexpr auto loadHelp =
+		"debug trace load <filename> [-prefix <name>]\n"
+		"  Load a file recorded with 'record_instructions'. This creates the traces\n"
+		"  <name>.pc, <name>.instr, <name>.slot, one trace per register (only\n"
+		"  containing the changes) and, if recorded, <name>.mem_read and\n"
+		"  <name>.mem_write.\n"
+		"  The default prefix is 'cpu'. Existing traces with these names are replaced.\n";
+
 	constexpr auto unknownHelp =
 		"Unknown subcommand, use 'help debug trace' to see a list of valid subcommands.\n";
 
@@ -374,6 +462,8 @@ void Tracer::tabCompletion(const Debugger& debugger, std::vector<std::string>& t
 		return dropHelp;
 	} else if (tokens[2] == "probe") {
 		return probeHelp;
+	} else if (tokens[2] == "load") {
+		return loadHelp;
 	} else {
 		return unknownHelp;
 	}
@@ -506,7 +596,7 @@ void Tracer::exportVCD(zstring_view filename)
 
 		size_t pos = idx[tr];
 		const auto& t = *traces[tr];
-		const auto& val = t.events[pos].value;
+		auto val = t.events.getValue(pos);
 		emitValue(t.getType(), tr, val, true);
 
 		// advance index and push next event for this trace
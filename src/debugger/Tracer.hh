@@ -4,6 +4,7 @@
 #include "EmuTime.hh"
 #include "StateChangeListener.hh"
 #include "TclObject.hh"
+#include "TraceEvents.hh"
 #include "TraceValue.hh"
 
 #include "Observer.hh"
@@ -21,10 +22,7 @@ class StateChangeDistributor;
 class Tracer final : public StateChangeListener
 {
 public:
-	struct Event {
-		EmuTime time;
-		TraceValue value;
-	};
+	using Event = TraceEvent;
 	struct Trace final : Observer<ProbeBase> {
 		// Type of values seen so far. Ordered from specific to general:
 		enum class Type : uint8_t { MONOSTATE = 0, BOOL = 1, INTEGER = 2, DOUBLE = 3, STRING = 4 };
@@ -49,7 +47,7 @@ public:
 
 		std::string name;
 		std::string description;
-		std::vector<Event> events;
+		TraceEvents events;
 		MSXMotherBoard* motherBoard = nullptr; // non-nullptr if attached to a Probe
 		Type type = Type::MONOSTATE;
 		Format format = Format::DEC;
@@ -75,6 +73,7 @@ public:
 	void unselectProbe(Debugger& debugger, std::string_view name);
 
 	void exportVCD(zstring_view filename);
+	void loadInstructionTrace(Debugger& debugger, zstring_view filename, std::string_view prefix);
 
 	void transfer(Debugger& oldDebugger, Debugger& newDebugger);
 
@@ -84,6 +83,7 @@ private:
 	void list (Command& cmd, std::span<const TclObject> tokens, TclObject& result);
 	void drop (Debugger& debugger, std::span<const TclObject> tokens, TclObject& result);
 	void probe(Debugger& debugger, std::span<const TclObject> tokens, TclObject& result);
+	void load (Debugger& debugger, std::span<const TclObject> tokens, TclObject& result);
 	void dropTrace(Debugger& debugger, std::string_view name);
 
 	// StateChangeListener
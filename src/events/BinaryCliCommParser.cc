@@ -0,0 +1,78 @@
+#include "BinaryCliCommParser.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+namespace openmsx {
+
+static void appendLE32(std::string& out, uint32_t value)
+{
+	for (int i = 0; i < 4; ++i) {
+		out += char(value >> (8 * i));
+	}
+}
+
+static uint32_t readLE32(std::string_view s)
+{
+	assert(s.size() >= 4);
+	uint32_t result = 0;
+	for (int i = 0; i < 4; ++i) {
+		result |= uint32_t(uint8_t(s[i])) << (8 * i);
+	}
+	return result;
+}
+
+BinaryCliCommParser::BinaryCliCommParser(Callback callback_, ErrorCallback errorCallback_)
+	: callback(std::move(callback_))
+	, errorCallback(std::move(errorCallback_))
+{
+}
+
+void BinaryCliCommParser::parse(std::span<const char> buf)
+{
+	while (!buf.empty()) {
+		if (lengthBytes < 4) {
+			length |= uint32_t(uint8_t(buf.front())) << (8 * lengthBytes);
+			buf = buf.subspan(1);
+			if (++lengthBytes < 4) continue;
+			tooLarge = length > MAX_FRAME_SIZE;
+			frame.clear();
+			if (!tooLarge) frame.reserve(length);
+		}
+		auto n = std::min<size_t>(length - received, buf.size());
+		uint32_t keep = tooLarge ? 4 : length;
+		if (received < keep) {
+			frame.append(buf.data(), std::min<size_t>(n, keep - received));
+		}
+		received += uint32_t(n);
+		buf = buf.subspan(n);
+		if (received < length) continue;
+
+		std::string_view f = frame;
+		if (tooLarge) {
+			errorCallback(readLE32(f), "frame too large");
+		} else if (length < HEADER_SIZE - 4) {
+			errorCallback((length >= 4) ? readLE32(f) : 0, "frame too short");
+		} else {
+			callback(readLE32(f), FrameType(f[4]), f.substr(5));
+		}
+		length = 0;
+		received = 0;
+		lengthBytes = 0;
+	}
+}
+
+void BinaryCliCommParser::appendFrame(std::string& out, uint32_t id, FrameType type,
+                                      std::span<const std::string_view> payload)
+{
+	auto payloadSize = std::accumulate(payload.begin(), payload.end(), size_t(0),
+		[](size_t sum, std::string_view s) { return sum + s.size(); });
+	out.reserve(out.size() + HEADER_SIZE + payloadSize);
+	appendLE32(out, uint32_t(HEADER_SIZE - 4 + payloadSize));
+	appendLE32(out, id);
+	out += char(type);
+	for (auto s : payload) out += s;
+}
+
+} // namespace openmsx
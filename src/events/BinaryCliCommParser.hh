@@ -0,0 +1,77 @@
+#ifndef BINARYCLICOMMPARSER_HH
+#define BINARYCLICOMMPARSER_HH
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace openmsx {
+
+/** Parser (and encoder) for the binary variant of the control protocol.
+  *
+  * A client selects this protocol by sending MAGIC as the very first bytes
+  * on the connection (instead of an XML '<command>' element). The server
+  * then answers with a HELLO frame, from then on all communication (in both
+  * directions) consists of frames:
+  *    u32  length of the rest of the frame (id + type + payload)
+  *    u32  request id, chosen by the client, repeated in the reply
+  *    u8   frame type
+  *    ...  payload (raw bytes, no escaping)
+  * All integers are little endian. Commands don't need to wait for the reply
+  * of the previous command, the replies are sent in the same order as the
+  * commands were received.
+  *
+  * A frame that is too short (no room for the id and type) or too large
+  * (more than MAX_FRAME_SIZE) is skipped, and answered with REPLY_ERROR.
+  * That reply carries the id of the frame, or 0 when the frame is too short
+  * to contain one.
+  *
+  * Payloads per frame type:
+  *    HELLO        u32 protocol version (id is 0)
+  *    COMMAND      the command (client to server)
+  *    REPLY_OK     the result of the command
+  *    REPLY_BINARY the result of the command, when it's a Tcl byte array
+  *                 (e.g. 'debug read_block'), contains the raw bytes
+  *    REPLY_ERROR  the error message
+  *    LOG          u8 log level + message (id is 0)
+  *    UPDATE       u8 update type, u16 length + machine, u16 length + name,
+  *                 followed by the value (id is 0)
+  */
+class BinaryCliCommParser
+{
+public:
+	static constexpr std::string_view MAGIC = {"\0OMSXBIN", 8};
+	static constexpr uint32_t VERSION = 1;
+	static constexpr size_t HEADER_SIZE = 4 + 4 + 1;
+	// Bigger frames are skipped (see above).
+	static constexpr size_t MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
+	enum class FrameType : uint8_t {
+		HELLO, COMMAND, REPLY_OK, REPLY_BINARY, REPLY_ERROR, LOG, UPDATE,
+	};
+
+	using Callback = std::function<void(uint32_t id, FrameType type, std::string_view payload)>;
+	using ErrorCallback = std::function<void(uint32_t id, std::string_view message)>;
+
+	BinaryCliCommParser(Callback callback, ErrorCallback errorCallback);
+	void parse(std::span<const char> buf);
+
+	/** Append a frame, with a payload consisting of the given parts. */
+	static void appendFrame(std::string& out, uint32_t id, FrameType type,
+	                        std::span<const std::string_view> payload);
+
+private:
+	Callback callback;
+	ErrorCallback errorCallback;
+	std::string frame; // (partial) frame, without the length field
+	uint32_t length = 0; // of the current frame
+	uint32_t received = 0; // number of bytes of the current frame received
+	uint8_t lengthBytes = 0; // number of bytes of 'length' received
+	bool tooLarge = false; // if so, only the id is stored in 'frame'
+};
+
+} // namespace openmsx
+
+#endif
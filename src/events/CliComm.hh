@@ -14,6 +14,8 @@ namespace openmsx {
 class CliComm
 {
 public:
+	// Note: the numeric values of LogLevel and UpdateType are used in the
+	// binary control protocol (see BinaryCliCommParser), only append.
 	enum class LogLevel : uint8_t {
 		INFO,
 		WARNING,
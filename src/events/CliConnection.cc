@@ -38,9 +38,16 @@ using namespace std::literals;
 
 CliConnection::CliConnection(CommandController& commandController_,
                              EventDistributor& eventDistributor_)
-	: parser([this](const std::string& cmd) { execute(cmd); })
-	, commandController(commandController_)
+	: commandController(commandController_)
 	, eventDistributor(eventDistributor_)
+	, parser([this](const std::string& cmd) { execute(cmd); })
+	, binaryParser([this](uint32_t id, BinaryCliCommParser::FrameType type, std::string_view payload) {
+		// other frame types are ignored
+		if (type == BinaryCliCommParser::FrameType::COMMAND) execute(payload, id);
+	  }, [this](uint32_t id, std::string_view message) {
+		// via the event queue, so that the replies stay in order
+		eventDistributor.distributeEvent(CliCommandEvent(message, this, id, true));
+	  })
 {
 	std::ranges::fill(updateEnabled, false);
 
@@ -58,6 +65,13 @@ void CliConnection::log(CliComm::LogLevel level, std::string_view message, float
 	if (level == CliComm::LogLevel::PROGRESS && fraction >= 0.0f) {
 		strAppend(fullMessage, "... ", int(100.0f * fraction), '%');
 	}
+	std::scoped_lock lock(outputMutex);
+	if (binaryOutput) {
+		std::array levelByte = {char(level)};
+		outputFrame(0, BinaryCliCommParser::FrameType::LOG,
+		            std::array{std::string_view(levelByte.data(), 1), std::string_view(fullMessage)});
+		return;
+	}
 	output(tmpStrCat("<log level=\"", toString(level), "\">",
 	                 XMLEscape(fullMessage), "</log>\n"));
 }
@@ -67,6 +81,24 @@ void CliConnection::update(CliComm::UpdateType type, std::string_view machine,
 {
 	if (!getUpdateEnable(type)) return;
 
+	std::scoped_lock lock(outputMutex);
+	if (binaryOutput) {
+		auto withLength = [](std::string_view str, std::array<char, 2>& len) {
+			str = str.substr(0, 0xffff);
+			len = {char(str.size()), char(str.size() >> 8)};
+			return str;
+		};
+		std::array typeByte = {char(type)};
+		std::array<char, 2> machineLen, nameLen;
+		machine = withLength(machine, machineLen);
+		name = withLength(name, nameLen);
+		outputFrame(0, BinaryCliCommParser::FrameType::UPDATE, std::array{
+			std::string_view(typeByte.data(), 1),
+			std::string_view(machineLen.data(), 2), machine,
+			std::string_view(nameLen.data(), 2), name,
+			value});
+		return;
+	}
 	auto tmp = tmpStrCat(
 		"<update type=\"", toString(type), '\"',
 		strCat_if(!machine.empty(), " machine=\"", machine, '"'),
@@ -87,7 +119,10 @@ void CliConnection::start()
 
 void CliConnection::end()
 {
-	output("</openmsx-output>\n");
+	{
+		std::scoped_lock lock(outputMutex);
+		if (!binaryOutput) output("</openmsx-output>\n");
+	}
 	close();
 
 	poller.abort();
@@ -97,9 +132,53 @@ void CliConnection::end()
 	}
 }
 
-void CliConnection::execute(const std::string& command)
+void CliConnection::parse(std::span<const char> buf)
+{
+	// runs in helper thread
+	static constexpr auto MAGIC = BinaryCliCommParser::MAGIC;
+	while ((inputProtocol == Protocol::UNDECIDED) && !buf.empty()) {
+		if (buf.front() == MAGIC[magicMatched]) {
+			buf = buf.subspan(1);
+			if (++magicMatched == MAGIC.size()) {
+				inputProtocol = Protocol::BINARY;
+				switchToBinary();
+			}
+		} else {
+			// (most likely) the start of an XML command
+			inputProtocol = Protocol::XML;
+			parser.parse(std::span{MAGIC.data(), magicMatched});
+		}
+	}
+	switch (inputProtocol) {
+		case Protocol::XML:    parser.parse(buf); break;
+		case Protocol::BINARY: binaryParser.parse(buf); break;
+		case Protocol::UNDECIDED: break;
+	}
+}
+
+void CliConnection::switchToBinary()
 {
-	eventDistributor.distributeEvent(CliCommandEvent(command, this));
+	// runs in helper thread
+	std::scoped_lock lock(outputMutex);
+	binaryOutput = true;
+	auto v = BinaryCliCommParser::VERSION;
+	std::array version = {char(v), char(v >> 8), char(v >> 16), char(v >> 24)};
+	outputFrame(0, BinaryCliCommParser::FrameType::HELLO,
+	            std::array{std::string_view(version.data(), version.size())});
+}
+
+void CliConnection::outputFrame(uint32_t id, BinaryCliCommParser::FrameType type,
+                                std::span<const std::string_view> payload)
+{
+	// called with 'outputMutex' locked
+	frameBuffer.clear();
+	BinaryCliCommParser::appendFrame(frameBuffer, id, type, payload);
+	output(frameBuffer);
+}
+
+void CliConnection::execute(std::string_view command, uint32_t requestId)
+{
+	eventDistributor.distributeEvent(CliCommandEvent(command, this, requestId));
 }
 
 static TemporaryString reply(std::string_view message, bool status)
@@ -111,13 +190,35 @@ static TemporaryString reply(std::string_view message, bool status)
 bool CliConnection::signalEvent(const Event& event)
 {
 	assert(getType(event) == EventType::CLICOMMAND);
-	if (const auto& commandEvent = get_event<CliCommandEvent>(event);
-	    commandEvent.getId() == this) {
-		try {
-			auto result = commandController.executeCommand(
-				commandEvent.getCommand(), this).getString();
-			output(reply(result, true));
-		} catch (CommandException& e) {
+	const auto& commandEvent = get_event<CliCommandEvent>(event);
+	if (commandEvent.getId() != this) return false;
+
+	using enum BinaryCliCommParser::FrameType;
+	auto id = commandEvent.getRequestId();
+	if (commandEvent.isInvalid()) {
+		std::scoped_lock lock(outputMutex);
+		outputFrame(id, REPLY_ERROR, std::array{std::string_view(commandEvent.getCommand())});
+		return false;
+	}
+	try {
+		auto result = commandController.executeCommand(
+			commandEvent.getCommand(), this);
+		std::scoped_lock lock(outputMutex);
+		if (!binaryOutput) {
+			output(reply(result.getString(), true));
+		} else if (result.isByteArray()) {
+			// send the raw bytes, instead of the (utf8) string representation
+			auto bytes = result.getBinary(commandController.getInterpreter());
+			outputFrame(id, REPLY_BINARY, std::array{std::string_view(
+				reinterpret_cast<const char*>(bytes.data()), bytes.size())});
+		} else {
+			outputFrame(id, REPLY_OK, std::array{std::string_view(result.getString())});
+		}
+	} catch (CommandException& e) {
+		std::scoped_lock lock(outputMutex);
+		if (binaryOutput) {
+			outputFrame(id, REPLY_ERROR, std::array{std::string_view(e.getMessage())});
+		} else {
 			std::string result = std::move(e).getMessage() + '\n';
 			output(reply(result, false));
 		}
@@ -153,7 +254,7 @@ void StdioConnection::run()
 		std::array<char, BUF_SIZE> buf;
 		auto n = read(STDIN_FILENO, buf.data(), sizeof(buf));
 		if (n > 0) {
-			parser.parse(subspan(buf, 0, n));
+			parse(subspan(buf, 0, n));
 		} else if (n < 0) {
 			break;
 		}
@@ -243,7 +344,7 @@ void PipeConnection::run()
 			if (!GetOverlappedResult(pipeHandle, &overlapped, &bytesRead, TRUE)) {
 				break; // Pipe broke
 			}
-			parser.parse(std::span{buf, bytesRead});
+			parse(std::span{buf, bytesRead});
 		} else if (wait == WAIT_OBJECT_0) {
 			break; // Shutdown
 		} else {
@@ -322,7 +423,7 @@ void SocketConnection::run()
 		std::array<char, BUF_SIZE> buf;
 		auto n = sock_recv(sd, buf.data(), sizeof(buf));
 		if (n > 0) {
-			parser.parse(subspan(buf, 0, n));
+			parse(subspan(buf, 0, n));
 		} else if (n < 0) {
 			break;
 		}
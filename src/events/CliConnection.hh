@@ -2,6 +2,7 @@
 #define CLICONNECTION_HH
 
 #include "AdhocCliCommParser.hh"
+#include "BinaryCliCommParser.hh"
 #include "CliComm.hh"
 #include "CliListener.hh"
 #include "EventListener.hh"
@@ -11,6 +12,7 @@
 #include "stl.hh"
 
 #include <mutex>
+#include <span>
 #include <string>
 #include <thread>
 
@@ -61,13 +63,21 @@ protected:
 	  */
 	void startOutput();
 
-	AdhocCliCommParser parser;
+	/** Feed data received from the client (called from the helper thread).
+	  * Uses the XML protocol, unless the client starts with the magic
+	  * sequence of the binary protocol (see BinaryCliCommParser).
+	  */
+	void parse(std::span<const char> buf);
+
 	Poller poller;
 
 private:
 	virtual void run() = 0;
 
-	void execute(const std::string& command);
+	void execute(std::string_view command, uint32_t requestId = 0);
+	void switchToBinary();
+	void outputFrame(uint32_t id, BinaryCliCommParser::FrameType type,
+	                 std::span<const std::string_view> payload);
 
 	// CliListener
 	void log(CliComm::LogLevel level, std::string_view message, float fraction) noexcept override;
@@ -82,6 +92,17 @@ private:
 
 	std::thread thread;
 
+	AdhocCliCommParser parser;
+	BinaryCliCommParser binaryParser;
+	size_t magicMatched = 0; // number of bytes of MAGIC received so far
+	enum class Protocol : uint8_t { UNDECIDED, XML, BINARY } inputProtocol = Protocol::UNDECIDED;
+
+	// Protects the switch to the binary protocol (by the helper thread)
+	// against output of the main thread.
+	std::mutex outputMutex;
+	bool binaryOutput = false;
+	std::string frameBuffer; // also protected by 'outputMutex'
+
 	array_with_enum_index<CliComm::UpdateType, bool> updateEnabled;
 };
 
@@ -335,8 +335,9 @@ private:
 class CliCommandEvent final : public EventBase
 {
 public:
-	CliCommandEvent(std::string_view command_, const CliConnection* id_)
-		: command(allocate_c_string(command_)), id(id_) {}
+	CliCommandEvent(std::string_view command_, const CliConnection* id_, uint32_t requestId_ = 0,
+	                bool invalid_ = false)
+		: command(allocate_c_string(command_)), id(id_), requestId(requestId_), invalid(invalid_) {}
 	CliCommandEvent(const CliCommandEvent&) { assert(false); }
 	CliCommandEvent& operator=(const CliCommandEvent&) { assert(false); return *this; }
 	CliCommandEvent(CliCommandEvent&&) = default;
@@ -345,10 +346,17 @@ public:
 
 	[[nodiscard]] zstring_view getCommand() const { return command.get(); }
 	[[nodiscard]] const CliConnection* getId() const { return id; }
+	/** Only used by the binary protocol, see BinaryCliCommParser. */
+	[[nodiscard]] uint32_t getRequestId() const { return requestId; }
+	/** Only used by the binary protocol: the request couldn't be parsed,
+	  * getCommand() returns the error message to reply with. */
+	[[nodiscard]] bool isInvalid() const { return invalid; }
 
 private:
 	StringStorage command;
 	const CliConnection* id;
+	uint32_t requestId;
+	bool invalid;
 };
 
 class ImGuiActiveEvent final : public EventBase
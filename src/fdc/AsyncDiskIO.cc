@@ -0,0 +1,185 @@
+#include "AsyncDiskIO.hh"
+
+#include "MSXException.hh"
+#include "SectorAccessibleDisk.hh"
+
+#include "ranges.hh"
+
+#include <algorithm>
+
+namespace openmsx {
+
+AsyncDiskIO::~AsyncDiskIO()
+{
+	{
+		std::unique_lock lock(mutex);
+		waitIdle(lock); // pending writes must still reach the disk
+		stop = true;
+	}
+	jobCond.notify_all();
+	if (thread.joinable()) thread.join();
+}
+
+void AsyncDiskIO::read(SectorAccessibleDisk& disk,
+                       std::span<SectorBuffer> buffers, size_t startSector)
+{
+	bool hit = [&] {
+		std::unique_lock lock(mutex);
+		// Wait for queued writes to the requested sectors (other writes
+		// may remain queued), and for a read-ahead that contains these
+		// sectors. In the common (sequential) case, that read-ahead is
+		// exactly what we need.
+		idleCond.wait(lock, [&] { return !isPending(disk, startSector, buffers.size()); });
+		if (!isCached(disk, startSector, buffers.size())) {
+			++readAheadId; // cancel an unrelated read-ahead
+			return false;
+		}
+		auto offset = startSector - cache.startSector;
+		copy_to_range(subspan(cache.buffers, offset, buffers.size()), buffers);
+		++cacheHits;
+		return true;
+	}();
+	if (!hit) {
+		disk.readSectorsNoWait(buffers, startSector);
+	}
+
+	if (!disk.allowBackgroundAccess()) return;
+	auto next = startSector + buffers.size();
+	auto total = disk.getNbSectors();
+	if (next >= total) return;
+	auto num = std::min(std::clamp(buffers.size(), MIN_READ_AHEAD, MAX_READ_AHEAD),
+	                    total - next);
+	{
+		std::scoped_lock lock(mutex);
+		// Still enough data for a next read of the same size?
+		if (isCached(disk, next, std::min(buffers.size(), num))) return;
+	}
+	startJob({&disk, next, std::vector<SectorBuffer>(num), 0, false});
+}
+
+void AsyncDiskIO::write(SectorAccessibleDisk& disk,
+                        std::span<const SectorBuffer> buffers, size_t startSector)
+{
+	if (!disk.allowBackgroundAccess()) {
+		disk.writeSectors(buffers, startSector);
+		return;
+	}
+	disk.addQueuedWrites(1);
+	startJob({&disk, startSector, {buffers.begin(), buffers.end()}, 0, true});
+}
+
+void AsyncDiskIO::flush()
+{
+	std::unique_lock lock(mutex);
+	waitIdle(lock);
+	++readAheadId;
+	cache = {nullptr, 0, {}, 0, false};
+}
+
+void AsyncDiskIO::startJob(Job&& job)
+{
+	{
+		std::scoped_lock lock(mutex);
+		job.readAheadId = ++readAheadId;
+		jobs.push_back(std::move(job));
+	}
+	if (!thread.joinable()) {
+		thread = std::thread([this] { run(); });
+	}
+	jobCond.notify_one();
+}
+
+void AsyncDiskIO::waitIdle(std::unique_lock<std::mutex>& lock)
+{
+	idleCond.wait(lock, [&] { return jobs.empty() && !active; });
+}
+
+// Is there a queued (or active) write that overlaps the given sectors, or a
+// read-ahead (that's not cancelled) that contains them?
+bool AsyncDiskIO::isPending(const SectorAccessibleDisk& disk,
+                            size_t startSector, size_t num) const
+{
+	auto check = [&](const Job& job) {
+		if (job.disk != &disk) return false;
+		auto jobEnd = job.startSector + job.buffers.size();
+		if (job.write) {
+			return (job.startSector < (startSector + num)) &&
+			       (startSector < jobEnd);
+		} else {
+			return (job.readAheadId == readAheadId) &&
+			       (job.startSector <= startSector) &&
+			       ((startSector + num) <= jobEnd);
+		}
+	};
+	return (active && check(*active)) || std::ranges::any_of(jobs, check);
+}
+
+bool AsyncDiskIO::isCached(const SectorAccessibleDisk& disk,
+                           size_t startSector, size_t num) const
+{
+	return (cache.disk == &disk) &&
+	       (cache.readAheadId == readAheadId) &&
+	       (cacheWriteCount == disk.getWriteCount()) && // not modified via another path
+	       (cache.startSector <= startSector) &&
+	       ((startSector + num) <= (cache.startSector + cache.buffers.size()));
+}
+
+// Called with 'lock' unlocked. Returns false when the job failed or was
+// cancelled.
+bool AsyncDiskIO::execute(Job& job, std::unique_lock<std::mutex>& lock)
+{
+	try {
+		if (job.write) {
+			job.disk->writeSectorsNoWait(job.buffers, job.startSector);
+			return true;
+		}
+		for (size_t i = 0; i < job.buffers.size(); i += READ_AHEAD_CHUNK) {
+			lock.lock();
+			bool cancelled = job.readAheadId != readAheadId;
+			lock.unlock();
+			if (cancelled) return false;
+			auto chunk = std::min(READ_AHEAD_CHUNK, job.buffers.size() - i);
+			job.disk->readSectorsNoWait(subspan(job.buffers, i, chunk),
+			                            job.startSector + i);
+		}
+		return true;
+	} catch (MSXException&) {
+		// A failed read-ahead is simply not used (a later read of
+		// these sectors will report the error). Write errors are
+		// ignored.
+		return false;
+	}
+}
+
+void AsyncDiskIO::run()
+{
+	std::unique_lock lock(mutex);
+	while (true) {
+		jobCond.wait(lock, [&] { return stop || !jobs.empty(); });
+		if (stop) return; // destructor first waits till 'jobs' is empty
+
+		auto job = std::move(jobs.front());
+		jobs.pop_front();
+		if (!job.write && (job.readAheadId != readAheadId)) {
+			// read-ahead was already cancelled
+			if (jobs.empty()) idleCond.notify_all();
+			continue;
+		}
+		active = &job;
+		auto writeCount = job.disk->getWriteCount();
+		lock.unlock();
+
+		bool ok = execute(job, lock);
+		if (job.write) job.disk->addQueuedWrites(-1);
+
+		lock.lock();
+		active = nullptr;
+		if (!job.write && ok && (job.readAheadId == readAheadId)) {
+			cacheWriteCount = writeCount;
+			cache = std::move(job);
+		}
+		idleCond.notify_all();
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,113 @@
+#ifndef ASYNCDISKIO_HH
+#define ASYNCDISKIO_HH
+
+#include "DiskImageUtils.hh"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace openmsx {
+
+class SectorAccessibleDisk;
+
+/** Performs sector reads and writes on a helper thread, so that slow host
+  * storage (e.g. a network share) doesn't stall the emulation thread.
+  *
+  * - Writes are queued and performed in order (write-behind). Write errors
+  *   are not reported. Other accesses to the disk (e.g. diskmanipulator)
+  *   wait till the queued writes are done (see
+  *   SectorAccessibleDisk::waitForQueuedWrites()).
+  * - After a read, the next sectors are read ahead. The amount depends on the
+  *   size of that read.
+  *
+  * The data returned by read() never depends on how far the helper thread has
+  * progressed: it's the same data a synchronous read would return at that
+  * moment. For this, read() only waits for queued writes to the requested
+  * sectors, and for a read-ahead that contains those sectors. Any other
+  * read-ahead is cancelled. So the emulation, and thus also replay, stays
+  * deterministic. Only the (host) time spent on the emulation thread changes.
+  *
+  * Disks for which allowBackgroundAccess() returns false are accessed
+  * synchronously.
+  */
+class AsyncDiskIO
+{
+public:
+	AsyncDiskIO() = default;
+	AsyncDiskIO(const AsyncDiskIO&) = delete;
+	AsyncDiskIO(AsyncDiskIO&&) = delete;
+	AsyncDiskIO& operator=(const AsyncDiskIO&) = delete;
+	AsyncDiskIO& operator=(AsyncDiskIO&&) = delete;
+	~AsyncDiskIO();
+
+	/** Like SectorAccessibleDisk::readSectors(), throws on error. */
+	void read(SectorAccessibleDisk& disk,
+	          std::span<SectorBuffer> buffers, size_t startSector);
+
+	/** Like SectorAccessibleDisk::writeSectors(), but possibly only queued. */
+	void write(SectorAccessibleDisk& disk,
+	           std::span<const SectorBuffer> buffers, size_t startSector);
+
+	/** Wait till all pending writes are done and drop the read-ahead data.
+	  * Must be called before a disk that was passed to read() or write() is
+	  * removed or replaced.
+	  */
+	void flush();
+
+//private:
+	// This should not be called directly, except by the unittest
+	[[nodiscard]] unsigned getNbCacheHits() const { return cacheHits; }
+
+private:
+	struct Job {
+		SectorAccessibleDisk* disk;
+		size_t startSector;
+		std::vector<SectorBuffer> buffers;
+		unsigned readAheadId;
+		bool write;
+	};
+	void startJob(Job&& job);
+	void waitIdle(std::unique_lock<std::mutex>& lock);
+	[[nodiscard]] bool isPending(const SectorAccessibleDisk& disk,
+	                             size_t startSector, size_t num) const;
+	[[nodiscard]] bool isCached(const SectorAccessibleDisk& disk,
+	                            size_t startSector, size_t num) const;
+	[[nodiscard]] bool execute(Job& job, std::unique_lock<std::mutex>& lock);
+	void run();
+
+private:
+	static constexpr size_t MIN_READ_AHEAD = 16;
+	static constexpr size_t MAX_READ_AHEAD = 128;
+	// A read-ahead is performed in chunks of this size, so that it can be
+	// cancelled in between.
+	static constexpr size_t READ_AHEAD_CHUNK = 16;
+
+	// All members below are shared with the helper thread and protected
+	// by 'mutex'.
+	std::mutex mutex;
+	std::condition_variable jobCond;  // helper thread waits for jobs
+	std::condition_variable idleCond; // emulation thread waits for the helper
+	std::deque<Job> jobs;
+	const Job* active = nullptr; // job (popped from 'jobs') that the helper thread is executing
+	bool stop = false;
+
+	// Result of the last read-ahead. Only valid when 'cache.readAheadId'
+	// is the current 'readAheadId' (it's incremented for every new job, so
+	// each write invalidates the read-ahead data, and to cancel a
+	// read-ahead).
+	Job cache = {nullptr, 0, {}, 0, false};
+	uint64_t cacheWriteCount = 0; // disk write-count at the time of reading
+	unsigned readAheadId = 0;
+	unsigned cacheHits = 0; // only accessed by the emulation thread
+
+	std::thread thread; // only started on the first job
+};
+
+} // namespace openmsx
+
+#endif
@@ -5,6 +5,7 @@
 #include "FilePool.hh"
 #include "RawTrack.hh"
 
+#include "enumerate.hh"
 #include "narrow.hh"
 #include "one_of.hh"
 #include "xrange.hh"
@@ -175,18 +176,26 @@ void DMKDiskImage::extendImageToTrack(uint8_t track)
 }
 
 
-void DMKDiskImage::readSectorImpl(size_t logicalSector, SectorBuffer& buf)
+void DMKDiskImage::readSectorsImpl(std::span<SectorBuffer> buffers, size_t startSector)
 {
-	auto [track, side, sector] = logToPhys(logicalSector);
+	// Consecutive logical sectors are mostly on the same track, so only
+	// read each track once.
 	RawTrack rawTrack;
-	readTrack(track, side, rawTrack);
+	int cachedTrackNum = -1;
+	for (auto [i, buf] : enumerate(buffers)) {
+		auto [track, side, sector] = logToPhys(startSector + i);
+		if (int num = track | (side << 8); num != cachedTrackNum) {
+			readTrack(track, side, rawTrack);
+			cachedTrackNum = num;
+		}
 
-	if (auto sectorInfo = rawTrack.decodeSector(sector)) {
-		// TODO should we check sector size == 512?
-		//      crc errors? correct track/head?
-		rawTrack.readBlock(sectorInfo->dataIdx, buf.raw);
-	} else {
-		throw NoSuchSectorException("Sector not found");
+		if (auto sectorInfo = rawTrack.decodeSector(sector)) {
+			// TODO should we check sector size == 512?
+			//      crc errors? correct track/head?
+			rawTrack.readBlock(sectorInfo->dataIdx, buf.raw);
+		} else {
+			throw NoSuchSectorException("Sector not found");
+		}
 	}
 }
 
@@ -22,7 +22,7 @@ public:
 	void writeTrackImpl(uint8_t track, uint8_t side, const RawTrack& input) override;
 
 	// logical sector emulation for SectorAccessibleDisk
-	void readSectorImpl (size_t sector,       SectorBuffer& buf) override;
+	void readSectorsImpl(std::span<SectorBuffer> buffers, size_t startSector) override;
 	void writeSectorImpl(size_t sector, const SectorBuffer& buf) override;
 	[[nodiscard]] size_t getNbSectorsImpl() override;
 	[[nodiscard]] bool isWriteProtectedImpl() const override;
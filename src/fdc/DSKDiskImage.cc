@@ -28,10 +28,11 @@ void DSKDiskImage::readSectorsImpl(
 	file->read(buffers);
 }
 
-void DSKDiskImage::writeSectorImpl(size_t sector, const SectorBuffer& buf)
+void DSKDiskImage::writeSectorsImpl(
+	std::span<const SectorBuffer> buffers, size_t startSector)
 {
-	file->seek(sector * sizeof(buf));
-	file->write(buf.raw);
+	file->seek(startSector * sizeof(SectorBuffer));
+	file->write(buffers);
 }
 
 bool DSKDiskImage::isWriteProtectedImpl() const
@@ -9,6 +9,7 @@
 #include "Scheduler.hh"
 
 #include "StringOp.hh"
+#include "hash_set.hh"
 #include "narrow.hh"
 #include "one_of.hh"
 #include "ranges.hh"
@@ -18,6 +19,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <map>
 #include <vector>
 
 namespace openmsx {
@@ -273,6 +275,7 @@ DirAsDSK::DirAsDSK(DiskChanger& diskChanger_, CliComm& cliComm_,
 	, cliComm(cliComm_)
 	, hostDir(FileOperations::expandTilde(hostDir_.getResolved() + '/'))
 	, syncMode(syncMode_)
+	, watcher(hostDir)
 	, nofSectors((diskChanger_.isDoubleSidedDrive() ? 2 : 1) * SECTORS_PER_TRACK * NUM_TRACKS)
 	, nofSectorsPerFat(narrow<unsigned>((((3 * nofSectors) / (2 * SECTORS_PER_CLUSTER)) + SECTOR_SIZE - 1) / SECTOR_SIZE))
 	, firstSector2ndFAT(FIRST_FAT_SECTOR + nofSectorsPerFat)
@@ -351,6 +354,13 @@ bool DirAsDSK::hasChanged() const
 	return true;
 }
 
+bool DirAsDSK::allowBackgroundAccess() const
+{
+	// Reads and writes depend on the current EmuTime (see checkCaches()),
+	// so they must happen on the emulation thread.
+	return false;
+}
+
 void DirAsDSK::checkCaches()
 {
 	bool needSync = [&] {
@@ -370,9 +380,9 @@ void DirAsDSK::checkCaches()
 	}
 }
 
-void DirAsDSK::readSectorImpl(size_t sector, SectorBuffer& buf)
+void DirAsDSK::readSectorsImpl(std::span<SectorBuffer> buffers, size_t startSector)
 {
-	assert(sector < nofSectors);
+	assert((startSector + buffers.size()) <= nofSectors);
 
 	// 'Peek-mode' is used to periodically calculate a sha1sum for the
 	// whole disk (used by reverse). We don't want this calculation to
@@ -400,32 +410,86 @@ void DirAsDSK::readSectorImpl(size_t sector, SectorBuffer& buf)
 		}
 	}
 
-	// Simply return the sector from our virtual disk image.
-	buf = sectors[sector];
+	// Simply return the sectors from our virtual disk image.
+	copy_to_range(std::span{sectors}.subspan(startSector, buffers.size()), buffers);
 }
 
 void DirAsDSK::syncWithHost()
 {
+	// When possible, only look at the host files that actually changed.
+	if (auto changes = watcher.getChanges(); !changes.full) {
+		if (changes.entries.empty()) return; // nothing changed
+		if (!hostFilesSkipped) {
+			syncChangedHostFiles(changes.entries);
+			return;
+		}
+	}
+	watcher.startFullScan(); // watches are re-added by addNewHostFiles()
+	hostFilesSkipped = false;
+
 	// Check for removed host files. This frees up space in the virtual
 	// disk. Do this first because otherwise later actions may fail (run
 	// out of virtual disk space) for no good reason.
-	checkDeletedHostFiles();
+	checkDeletedHostFiles(mapDirs);
 
 	// Next update existing files. This may enlarge or shrink virtual
 	// files. In case not all host files fit on the virtual disk it's
 	// better to update the existing files than to (partly) add a too big
 	// new file and have no space left to enlarge the existing files.
-	checkModifiedHostFiles();
+	checkModifiedHostFiles(mapDirs);
 
 	// Last add new host files (this can only consume virtual disk space).
 	addNewHostFiles({}, firstDirSector);
 }
 
-void DirAsDSK::checkDeletedHostFiles()
+// Same steps as in syncWithHost(), but limited to the given changed entries.
+void DirAsDSK::syncChangedHostFiles(std::span<const DirWatcher::Change> changes)
+{
+	hash_set<std::string, std::identity, XXHasher> changedPaths;
+	// Sorted, so that a directory is handled before its subdirectories.
+	std::map<std::string, std::vector<std::string>> changedDirs;
+	for (const auto& c : changes) {
+		changedPaths.insert(c.subDir + c.name);
+		changedDirs[c.subDir].push_back(c.name);
+	}
+	auto changedMapDirs = [&] {
+		MapDirs result;
+		for (const auto& [dirIdx, mapDir] : mapDirs) {
+			if (changedPaths.contains(mapDir.hostName)) {
+				result.emplace(dirIdx, mapDir);
+			}
+		}
+		return result;
+	};
+
+	checkDeletedHostFiles(changedMapDirs());
+	checkModifiedHostFiles(changedMapDirs());
+
+	for (auto& [subDir, names] : changedDirs) {
+		unsigned msxDirSector = firstDirSector;
+		if (!subDir.empty()) {
+			auto dirIndex = findHostFileInDSK(std::string_view(subDir).substr(0, subDir.size() - 1));
+			if (dirIndex.sector == unsigned(-1)) continue; // directory itself not (yet) mapped
+			if (!(msxDir(dirIndex).attrib & MSXDirEntry::Attrib::DIRECTORY)) continue;
+			unsigned cluster = msxDir(dirIndex).startCluster;
+			if ((cluster < FIRST_CLUSTER) || (cluster >= maxCluster)) continue;
+			msxDirSector = clusterToSector(cluster);
+		}
+		std::ranges::sort(names);
+		auto [first, last] = std::ranges::unique(names);
+		names.erase(first, last);
+		// removed entries were already handled above
+		std::erase_if(names, [&](const std::string& n) {
+			return !FileOperations::exists(tmpStrCat(hostDir, subDir, n));
+		});
+		addNewHostEntries(subDir, std::move(names), msxDirSector);
+	}
+}
+
+void DirAsDSK::checkDeletedHostFiles(MapDirs candidates)
 {
 	// This handles both host files and directories.
-	auto copy = mapDirs;
-	for (const auto& [dirIdx, mapDir] : copy) {
+	for (const auto& [dirIdx, mapDir] : candidates) {
 		if (!mapDirs.contains(dirIdx)) {
 			// While iterating over (the copy of) mapDirs we delete
 			// entries of mapDirs (when we delete files only the
@@ -515,10 +579,9 @@ void DirAsDSK::freeFATChain(unsigned cluster)
 	}
 }
 
-void DirAsDSK::checkModifiedHostFiles()
+void DirAsDSK::checkModifiedHostFiles(MapDirs candidates)
 {
-	auto copy = mapDirs;
-	for (const auto& [dirIdx, mapDir] : copy) {
+	for (const auto& [dirIdx, mapDir] : candidates) {
 		if (!mapDirs.contains(dirIdx)) {
 			// See comment in checkDeletedHostFiles().
 			continue;
@@ -633,6 +696,7 @@ void DirAsDSK::importHostFile(DirIndex dirIndex, const FileOperations::Stat& fst
 			}
 		}
 		if (remainingSize != 0) {
+			hostFilesSkipped = true;
 			cliComm.printWarning("Virtual disk image full: ",
 			                     mapDir.hostName, " truncated.");
 		}
@@ -710,6 +774,10 @@ void DirAsDSK::addNewHostFiles(const std::string& hostSubDir, unsigned msxDirSec
 	assert(!hostSubDir.starts_with('/'));
 	assert(hostSubDir.empty() || hostSubDir.ends_with('/'));
 
+	// Start watching before reading the directory, so that no changes
+	// can get lost.
+	watcher.watch(hostSubDir);
+
 	std::vector<std::string> hostNames;
 	{
 		ReadDir dir(tmpStrCat(hostDir, hostSubDir));
@@ -717,6 +785,12 @@ void DirAsDSK::addNewHostFiles(const std::string& hostSubDir, unsigned msxDirSec
 			hostNames.emplace_back(d->d_name);
 		}
 	}
+	addNewHostEntries(hostSubDir, std::move(hostNames), msxDirSector);
+}
+
+void DirAsDSK::addNewHostEntries(const std::string& hostSubDir, std::vector<std::string> hostNames,
+                                 unsigned msxDirSector)
+{
 	std::ranges::sort(hostNames, {}, [](const std::string& n) { return weight(n); });
 
 	for (auto& hostName : hostNames) {
@@ -739,6 +813,7 @@ void DirAsDSK::addNewHostFiles(const std::string& hostSubDir, unsigned msxDirSec
 				throw MSXException("Not a regular file: ", fullHostName);
 			}
 		} catch (MSXException& e) {
+			hostFilesSkipped = true;
 			cliComm.printWarning(e.getMessage());
 		}
 	}
@@ -795,6 +870,7 @@ void DirAsDSK::addNewDirectory(const std::string& hostSubDir, const std::string&
 			// directory is *just*recently* created with the same
 			// name as an existing msx file). Ignore, it will be
 			// corrected in the next sync.
+			hostFilesSkipped = true;
 			return;
 		}
 		unsigned cluster = msxDir(dirIndex).startCluster;
@@ -819,6 +895,7 @@ void DirAsDSK::addNewHostFile(const std::string& hostSubDir, const std::string&
 	// TODO check for available free space on disk instead of max free space
 	if (auto diskSpace = (nofSectors - firstDataSector) * SECTOR_SIZE;
 	    narrow<size_t>(fst.st_size) > diskSpace) {
+		hostFilesSkipped = true;
 		cliComm.printWarning("File too large: ",
 		                     hostDir, hostSubDir, hostName);
 		return;
@@ -1,6 +1,7 @@
 #ifndef DIRASDSK_HH
 #define DIRASDSK_HH
 
+#include "DirWatcher.hh"
 #include "DiskImageUtils.hh"
 #include "EmuTime.hh"
 #include "FileOperations.hh"
@@ -27,11 +28,12 @@ public:
 	         BootSectorType bootSectorType);
 
 	// SectorBasedDisk
-	void readSectorImpl (size_t sector,       SectorBuffer& buf) override;
+	void readSectorsImpl(std::span<SectorBuffer> buffers, size_t startSector) override;
 	void writeSectorImpl(size_t sector, const SectorBuffer& buf) override;
 	[[nodiscard]] bool isWriteProtectedImpl() const override;
 	[[nodiscard]] bool hasChanged() const override;
 	void checkCaches() override;
+	[[nodiscard]] bool allowBackgroundAccess() const override;
 
 private:
 	struct DirIndex {
@@ -60,6 +62,7 @@ private:
 		                 // filesize, except when the host file was
 		                 // truncated.
 	};
+	using MapDirs = hash_map<DirIndex, MapDir, HashDirIndex>;
 
 	[[nodiscard]] std::span<SectorBuffer> fat();
 	[[nodiscard]] std::span<SectorBuffer> fat2();
@@ -71,11 +74,14 @@ private:
 	void writeDIREntry(DirIndex dirIndex, DirIndex dirDirIndex,
 	                   const MSXDirEntry& newEntry);
 	void syncWithHost();
-	void checkDeletedHostFiles();
+	void syncChangedHostFiles(std::span<const DirWatcher::Change> changes);
+	void checkDeletedHostFiles(MapDirs candidates);
 	void deleteMSXFile(DirIndex dirIndex);
 	void deleteMSXFilesInDir(unsigned msxDirSector);
 	void freeFATChain(unsigned cluster);
 	void addNewHostFiles(const std::string& hostSubDir, unsigned msxDirSector);
+	void addNewHostEntries(const std::string& hostSubDir, std::vector<std::string> hostNames,
+	                       unsigned msxDirSector);
 	void addNewDirectory(const std::string& hostSubDir, const std::string& hostName,
 	                     unsigned msxDirSector, const FileOperations::Stat& fst);
 	void addNewHostFile(const std::string& hostSubDir, const std::string& hostName,
@@ -89,7 +95,7 @@ private:
 	[[nodiscard]] unsigned nextMsxDirSector(unsigned sector);
 	[[nodiscard]] bool checkMSXFileExists(std::span<const char, 11> msxfilename,
 	                                      unsigned msxDirSector);
-	void checkModifiedHostFiles();
+	void checkModifiedHostFiles(MapDirs candidates);
 	void setMSXTimeStamp(DirIndex dirIndex, const FileOperations::Stat& fst);
 	void importHostFile(DirIndex dirIndex, const FileOperations::Stat& fst);
 	void exportToHost(DirIndex dirIndex, DirIndex dirDirIndex);
@@ -132,12 +138,19 @@ private:
 	const std::string hostDir;
 	const SyncMode syncMode;
 
+	// Tells which host files changed since the last sync, so that we don't
+	// need to rescan the whole host directory tree (when supported).
+	DirWatcher watcher;
+	// Set when not all host files could be added to the virtual disk
+	// (disk full, name conflict, ...). Then any host change triggers a
+	// full rescan, because that change may allow to add those files.
+	bool hostFilesSkipped = false;
+
 	EmuTime lastAccess = EmuTime::zero(); // last time there was a sector read/write
 
 	// For each directory entry that has a mapped host file/directory we
 	// store the name, last modification time and size of the corresponding
 	// host file/dir.
-	using MapDirs = hash_map<DirIndex, MapDir, HashDirIndex>;
 	MapDirs mapDirs;
 
 	// format parameters which depend on single/double sided
@@ -58,7 +58,7 @@ std::unique_ptr<Disk> DiskFactory::createDisk(
 		auto file = std::make_shared<File>(filename.getResolved(), File::OpenMode::PRE_CACHE);
 		try {
 			// first try XSA
-			return std::make_unique<XSADiskImage>(filename, *file);
+			return std::make_unique<XSADiskImage>(filename, *file, reactor.getFilePool());
 		} catch (MSXException&) {
 			// XSA didn't work, still no problem
 		}
@@ -16,6 +16,7 @@
 #include <cassert>
 #include <ctime>
 #include <ranges>
+#include <vector>
 
 namespace openmsx::DiskImageUtils {
 
@@ -437,10 +438,13 @@ void format(SectorAccessibleDisk& disk, MSXBootSectorType bootType, size_t nbSec
 		disk.writeSector(result.fatStart + fat * result.sectorsPerFat, buf);
 	}
 
-	// write 'empty' data sectors
+	// write 'empty' data sectors, in chunks of multiple sectors
 	std::ranges::fill(buf.raw, 0xE5);
-	for (auto i : xrange(result.dataStart, nbSectors)) {
-		disk.writeSector(i, buf);
+	std::vector<SectorBuffer> chunk(std::min<size_t>(64, nbSectors), buf);
+	for (size_t i = result.dataStart; i < nbSectors; /**/) {
+		auto num = std::min(chunk.size(), nbSectors - i);
+		disk.writeSectors(subspan(chunk, 0, num), i);
+		i += num;
 	}
 }
 
@@ -508,11 +508,14 @@ void DiskManipulator::savedsk(const DriveSettings& driveData,
                               std::string filename) const
 {
 	auto partition = getPartition(driveData);
-	SectorBuffer buf;
+	std::array<SectorBuffer, 64> bufs;
 	File file(std::move(filename), File::OpenMode::CREATE);
-	for (auto i : xrange(partition.getNbSectors())) {
-		partition.readSector(i, buf);
-		file.write(buf.raw);
+	auto nbSectors = partition.getNbSectors();
+	for (size_t i = 0; i < nbSectors; /**/) {
+		auto chunk = subspan(bufs, 0, std::min(bufs.size(), nbSectors - i));
+		partition.readSectors(chunk, i);
+		file.write(std::span{chunk[0].raw.data(), chunk.size_bytes()});
+		i += chunk.size();
 	}
 }
 
@@ -49,14 +49,16 @@ DiskPartition::DiskPartition(SectorAccessibleDisk& parent_,
 	setNbSectors(length);
 }
 
-void DiskPartition::readSectorImpl(size_t sector, SectorBuffer& buf)
+// readSectors() and writeSectors() of this partition already waited for the
+// queued writes of the parent (see waitForQueuedWrites() below).
+void DiskPartition::readSectorsImpl(std::span<SectorBuffer> buffers, size_t startSector)
 {
-	parent.readSector(start + sector, buf);
+	parent.readSectorsNoWait(buffers, start + startSector);
 }
 
-void DiskPartition::writeSectorImpl(size_t sector, const SectorBuffer& buf)
+void DiskPartition::writeSectorsImpl(std::span<const SectorBuffer> buffers, size_t startSector)
 {
-	parent.writeSector(start + sector, buf);
+	parent.writeSectorsNoWait(buffers, start + startSector);
 }
 
 bool DiskPartition::isWriteProtectedImpl() const
@@ -64,4 +66,21 @@ bool DiskPartition::isWriteProtectedImpl() const
 	return parent.isWriteProtected();
 }
 
+bool DiskPartition::allowBackgroundAccess() const
+{
+	return parent.allowBackgroundAccess();
+}
+
+// Queued writes are tracked on the parent: also other partitions of that disk
+// (or the disk itself) must wait for them.
+void DiskPartition::addQueuedWrites(int n)
+{
+	parent.addQueuedWrites(n);
+}
+
+void DiskPartition::waitForQueuedWrites()
+{
+	parent.waitForQueuedWrites();
+}
+
 } // namespace openmsx
@@ -24,9 +24,13 @@ public:
 	DiskPartition(SectorAccessibleDisk& parent,
 	              size_t start, size_t length);
 
+	[[nodiscard]] bool allowBackgroundAccess() const override;
+	void addQueuedWrites(int n) override;
+	void waitForQueuedWrites() override;
+
 private:
-	void readSectorImpl (size_t sector,       SectorBuffer& buf) override;
-	void writeSectorImpl(size_t sector, const SectorBuffer& buf) override;
+	void readSectorsImpl (std::span<      SectorBuffer> buffers, size_t startSector) override;
+	void writeSectorsImpl(std::span<const SectorBuffer> buffers, size_t startSector) override;
 	[[nodiscard]] bool isWriteProtectedImpl() const override;
 
 private:
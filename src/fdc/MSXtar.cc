@@ -9,6 +9,7 @@
 
 #include "File.hh"
 #include "StringOp.hh"
+#include "enumerate.hh"
 #include "narrow.hh"
 #include "one_of.hh"
 #include "ranges.hh"
@@ -189,6 +190,33 @@ void MSXtar::readLogicalSector(unsigned sector, SectorBuffer& buf)
 	}
 }
 
+bool MSXtar::overlapsFatCache(unsigned sector, size_t num) const
+{
+	return (sector < (fatStart + sectorsPerFat)) && ((sector + num) > fatStart);
+}
+
+void MSXtar::writeLogicalSectors(unsigned sector, std::span<const SectorBuffer> bufs)
+{
+	if (overlapsFatCache(sector, bufs.size())) {
+		for (auto [i, buf] : enumerate(bufs)) {
+			writeLogicalSector(narrow<unsigned>(sector + i), buf);
+		}
+	} else {
+		disk.writeSectors(bufs, sector);
+	}
+}
+
+void MSXtar::readLogicalSectors(unsigned sector, std::span<SectorBuffer> bufs)
+{
+	if (overlapsFatCache(sector, bufs.size())) {
+		for (auto [i, buf] : enumerate(bufs)) {
+			readLogicalSector(narrow<unsigned>(sector + i), buf);
+		}
+	} else {
+		disk.readSectors(bufs, sector);
+	}
+}
+
 MSXtar::MSXtar(SectorAccessibleDisk& sectorDisk, const MsxChar2Unicode& msxChars_)
 	: disk(sectorDisk)
 	, msxChars(msxChars_)
@@ -627,6 +655,7 @@ void MSXtar::alterFileInDSK(MSXDirEntry& msxDirEntry, const std::string& hostNam
 		[](Cluster cluster) -> FatCluster { return cluster; }
 	}, getStartCluster(msxDirEntry));
 
+	std::vector<SectorBuffer> clusterBuf(sectorsPerCluster);
 	while (remaining) {
 		Cluster cluster;
 		// allocate new cluster if needed
@@ -651,14 +680,14 @@ void MSXtar::alterFileInDSK(MSXDirEntry& msxDirEntry, const std::string& hostNam
 
 		// fill cluster
 		unsigned logicalSector = clusterToSector(cluster);
-		for (unsigned j = 0; (j < sectorsPerCluster) && remaining; ++j) {
-			SectorBuffer buf;
-			unsigned chunkSize = std::min(SECTOR_SIZE, remaining);
-			file.read(subspan(buf.raw, 0, chunkSize));
-			std::ranges::fill(subspan(buf.raw, chunkSize), 0);
-			writeLogicalSector(logicalSector + j, buf);
-			remaining -= chunkSize;
-		}
+		auto numSectors = std::min(sectorsPerCluster, (remaining + SECTOR_SIZE - 1) / SECTOR_SIZE);
+		auto bufs = subspan(clusterBuf, 0, numSectors);
+		std::span bytes{bufs[0].raw.data(), bufs.size_bytes()};
+		unsigned chunkSize = std::min(narrow<unsigned>(bytes.size()), remaining);
+		file.read(bytes.first(chunkSize));
+		std::ranges::fill(bytes.subspan(chunkSize), 0);
+		writeLogicalSectors(logicalSector, bufs);
+		remaining -= chunkSize;
 
 		// advance to next cluster
 		prevCl = cluster;
@@ -1034,13 +1063,24 @@ void MSXtar::fileExtract(const std::string& resultFile, const MSXDirEntry& dirEn
 	}, getStartCluster(dirEntry));
 
 	File file(resultFile, "wb");
+	std::vector<SectorBuffer> bufs;
 	while (size && sector) {
-		SectorBuffer buf;
-		readLogicalSector(sector, buf);
-		unsigned saveSize = std::min(size, SECTOR_SIZE);
-		file.write(subspan(buf.raw, 0, saveSize));
+		// Typically (most of) a file is stored in consecutive sectors,
+		// read such a run of sectors in one go.
+		static constexpr unsigned MAX_RUN = 64;
+		unsigned first = sector;
+		unsigned needed = (size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+		unsigned num = 0;
+		do {
+			++num;
+			sector = getNextSector(sector);
+		} while ((sector == (first + num)) && (num < std::min(needed, MAX_RUN)));
+
+		bufs.resize(num);
+		readLogicalSectors(first, bufs);
+		unsigned saveSize = std::min(size, num * SECTOR_SIZE);
+		file.write(std::span{bufs[0].raw.data(), saveSize});
 		size -= saveSize;
-		sector = getNextSector(sector);
 	}
 	// now change the access time
 	changeTime(resultFile, dirEntry);
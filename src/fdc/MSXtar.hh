@@ -81,6 +81,9 @@ private:
 
 	void writeLogicalSector(unsigned sector, const SectorBuffer& buf);
 	void readLogicalSector (unsigned sector,       SectorBuffer& buf);
+	void writeLogicalSectors(unsigned sector, std::span<const SectorBuffer> bufs);
+	void readLogicalSectors (unsigned sector, std::span<      SectorBuffer> bufs);
+	[[nodiscard]] bool overlapsFatCache(unsigned sector, size_t num) const;
 
 	[[nodiscard]] unsigned clusterToSector(FAT::Cluster cluster) const;
 	[[nodiscard]] FAT::Cluster sectorToCluster(unsigned sector) const;
@@ -39,7 +39,8 @@ std::unique_ptr<DiskChanger> NowindCommand::createDiskChanger(
 	return std::make_unique<DiskChanger>(
 			motherBoard,
 			strCat(basename, n + 1),
-			false, true);
+			false, true,
+			[&host = interface.host] { host.flushDiskIO(); });
 }
 
 [[nodiscard]] static unsigned searchRomDisk(const NowindHost::Drives& drives)
@@ -231,6 +232,7 @@ void NowindCommand::execute(std::span<const TclObject> tokens, TclObject& result
 			optionsChanged = true;
 		}
 		if (changeDrives) {
+			host.flushDiskIO();
 			std::swap(tmpDrives, drives);
 		}
 	}
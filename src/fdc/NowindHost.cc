@@ -267,10 +267,12 @@ void NowindHost::DSKCHG()
 	assert(num < drives.size());
 	if (drives[num]->diskChanged()) {
 		send(255); // changed
+		// e.g. the image file was modified on the host
+		diskIO.flush();
 		// read first FAT sector (contains media descriptor)
 		SectorBuffer sectorBuffer;
 		try {
-			disk->readSectors(std::span{&sectorBuffer, 1}, 1);
+			diskIO.read(*disk, std::span{&sectorBuffer, 1}, 1);
 		} catch (MSXException&) {
 			// TODO read error
 			sectorBuffer.raw[0] = 0;
@@ -357,7 +359,7 @@ void NowindHost::diskReadInit(SectorAccessibleDisk& disk)
 	buffer.resize(sectorAmount);
 	unsigned startSector = getStartSector();
 	try {
-		disk.readSectors(std::span{buffer.data(), sectorAmount}, startSector);
+		diskIO.read(disk, std::span{buffer.data(), sectorAmount}, startSector);
 	} catch (MSXException&) {
 		// read error
 		state = State::SYNC1;
@@ -502,7 +504,7 @@ void NowindHost::doDiskWrite1()
 		unsigned startSector = getStartSector();
 		if (auto* disk = getDisk()) {
 			try {
-				disk->writeSectors(std::span{buffer.data(), sectorAmount}, startSector);
+				diskIO.write(*disk, std::span{buffer.data(), sectorAmount}, startSector);
 			} catch (MSXException&) {
 				// TODO write error
 			}
@@ -1,7 +1,9 @@
 #ifndef NOWINDHOST_HH
 #define NOWINDHOST_HH
 
+#include "AsyncDiskIO.hh"
 #include "DiskImageUtils.hh"
+
 #include "circular_buffer.hh"
 
 #include <array>
@@ -40,6 +42,12 @@ public:
 	// time, USB-host can pass real time.
 	void write(uint8_t data, unsigned time);
 
+	/** Wait till pending disk writes are done and drop read-ahead data.
+	 * Must be called before the drives (or the disks in them) change and
+	 * before the drives are serialized.
+	 */
+	void flushDiskIO() { diskIO.flush(); }
+
 	void setAllowOtherDiskRoms(bool allow) { allowOtherDiskRoms = allow; }
 	[[nodiscard]] bool getAllowOtherDiskRoms() const { return allowOtherDiskRoms; }
 
@@ -132,6 +140,9 @@ private:
 	uint8_t romDisk = 255;      // index of rom disk (255 = no rom disk)
 	bool allowOtherDiskRoms = false;
 	bool enablePhantomDrives = true;
+
+	// must come last: on destruction, pending writes still use the drives
+	AsyncDiskIO diskIO;
 };
 
 } // namespace openmsx
@@ -144,6 +144,9 @@ void NowindInterface::serialize(Archive& ar, unsigned /*version*/)
 {
 	ar.template serializeBase<MSXDevice>(*this);
 	ar.serialize("flash", flash);
+	// pending writes must reach the disks before their checksum is
+	// calculated (on save) or before they get replaced (on load)
+	host.flushDiskIO();
 	ar.serializeWithID("drives", drives, std::ref(getMotherBoard()));
 	ar.serialize("nowindhost", host,
 	             "bank",       bank);
@@ -21,9 +21,10 @@ void RamDSKDiskImage::readSectorsImpl(
 	copy_to_range(data.subspan(startSector, buffers.size()), buffers);
 }
 
-void RamDSKDiskImage::writeSectorImpl(size_t sector, const SectorBuffer& buf)
+void RamDSKDiskImage::writeSectorsImpl(
+	std::span<const SectorBuffer> buffers, size_t startSector)
 {
-	data[sector] = buf;
+	copy_to_range(buffers, data.subspan(startSector, buffers.size()));
 }
 
 bool RamDSKDiskImage::isWriteProtectedImpl() const
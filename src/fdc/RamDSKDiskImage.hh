@@ -16,7 +16,8 @@ private:
 	// SectorBasedDisk
 	void readSectorsImpl(
 		std::span<SectorBuffer> buffers, size_t startSector) override;
-	void writeSectorImpl(size_t sector, const SectorBuffer& buf) override;
+	void writeSectorsImpl(
+		std::span<const SectorBuffer> buffers, size_t startSector) override;
 	[[nodiscard]] bool isWriteProtectedImpl() const override;
 
 private:
@@ -9,6 +9,7 @@
 #include "sha1.hh"
 
 #include <array>
+#include <cassert>
 #include <memory>
 
 namespace openmsx {
@@ -28,6 +29,14 @@ void SectorAccessibleDisk::readSector(size_t sector, SectorBuffer& buf)
 void SectorAccessibleDisk::readSectors(
 	std::span<SectorBuffer> buffers, size_t startSector)
 {
+	waitForQueuedWrites();
+	readSectorsNoWait(buffers, startSector);
+}
+
+void SectorAccessibleDisk::readSectorsNoWait(
+	std::span<SectorBuffer> buffers, size_t startSector)
+{
+	std::scoped_lock lock(accessMutex);
 	auto last = startSector + buffers.size() - 1;
 	if (!isDummyDisk() && // in that case we want DriveEmptyException
 	    (last > 1) && // allow reading sector 0 and 1 without calling
@@ -66,38 +75,79 @@ void SectorAccessibleDisk::readSectorImpl(size_t /*sector*/, SectorBuffer& /*buf
 
 void SectorAccessibleDisk::writeSector(size_t sector, const SectorBuffer& buf)
 {
+	writeSectors(std::span{&buf, 1}, sector);
+}
+
+void SectorAccessibleDisk::writeSectors(
+	std::span<const SectorBuffer> buffers, size_t startSector)
+{
+	waitForQueuedWrites();
+	writeSectorsNoWait(buffers, startSector);
+}
+
+void SectorAccessibleDisk::writeSectorsNoWait(
+	std::span<const SectorBuffer> buffers, size_t startSector)
+{
+	if (buffers.empty()) return;
+	std::scoped_lock lock(accessMutex);
 	if (isWriteProtected()) {
 		throw WriteProtectedException();
 	}
-	if (!isDummyDisk() && (getNbSectors() <= sector)) {
+	if (!isDummyDisk() && (getNbSectors() < (startSector + buffers.size()))) {
 		throw NoSuchSectorException("No such sector");
 	}
+	++writeCount;
 	try {
-		writeSectorImpl(sector, buf);
+		writeSectorsImpl(buffers, startSector);
 	} catch (MSXException& e) {
 		throw DiskIOErrorException("Disk I/O error: ", e.getMessage());
 	}
-	flushCaches();
+	flushCaches(); // only once for the whole batch
 }
 
-void SectorAccessibleDisk::writeSectors(
+void SectorAccessibleDisk::writeSectorsImpl(
 	std::span<const SectorBuffer> buffers, size_t startSector)
 {
-	// Simply write one-at-a-time. There's no possibility (nor any need) yet
-	// to allow to optimize this
+	// Default implementation writes one sector at a time. But subclasses
+	// can override this method if they can do it more efficiently.
 	for (auto [i, buf] : enumerate(buffers)) {
-		writeSector(startSector + i, buf);
+		writeSectorImpl(startSector + i, buf);
 	}
 }
 
+void SectorAccessibleDisk::writeSectorImpl(size_t /*sector*/, const SectorBuffer& /*buf*/)
+{
+	// subclass should override exactly one of
+	//    writeSectorImpl() or writeSectorsImpl()
+	assert(false);
+}
+
 
 size_t SectorAccessibleDisk::getNbSectors()
 {
+	std::scoped_lock lock(accessMutex);
 	return getNbSectorsImpl();
 }
 
+void SectorAccessibleDisk::addQueuedWrites(int n)
+{
+	std::scoped_lock lock(queuedMutex);
+	queuedWrites += n;
+	assert(queuedWrites >= 0);
+	if (queuedWrites == 0) queuedCond.notify_all();
+}
+
+void SectorAccessibleDisk::waitForQueuedWrites()
+{
+	std::unique_lock lock(queuedMutex);
+	queuedCond.wait(lock, [&] { return queuedWrites == 0; });
+}
+
 void SectorAccessibleDisk::applyPatch(Filename patchFile)
 {
+	waitForQueuedWrites();
+	std::scoped_lock lock(accessMutex);
+	++writeCount;
 	patch = std::make_unique<IPSPatch>(std::move(patchFile), std::move(patch));
 }
 
@@ -113,6 +163,8 @@ bool SectorAccessibleDisk::hasPatches() const
 
 Sha1Sum SectorAccessibleDisk::getSha1Sum(FilePool& filePool)
 {
+	waitForQueuedWrites();
+	std::scoped_lock lock(accessMutex);
 	checkCaches();
 	if (sha1cache.empty()) {
 		sha1cache = getSha1SumImpl(filePool);
@@ -161,6 +213,11 @@ bool SectorAccessibleDisk::isDummyDisk() const
 	return false;
 }
 
+bool SectorAccessibleDisk::allowBackgroundAccess() const
+{
+	return true;
+}
+
 void SectorAccessibleDisk::checkCaches()
 {
 	// nothing
@@ -6,7 +6,11 @@
 
 #include "sha1.hh"
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <span>
 #include <vector>
 
@@ -27,12 +31,41 @@ public:
 	void writeSectors(std::span<const SectorBuffer> buffers, size_t startSector);
 	[[nodiscard]] size_t getNbSectors();
 
+	/** Writes to this disk can be queued by AsyncDiskIO. Until those are
+	 * done, all other accesses (via the methods above, getSha1Sum() or
+	 * applyPatch()) first wait for them. So e.g. diskmanipulator sees the
+	 * same content as without write-behind, and an older queued write can't
+	 * overwrite a newer write via another path. For a partition the writes
+	 * are tracked on the whole disk (see DiskPartition).
+	 */
+	virtual void addQueuedWrites(int n);
+	virtual void waitForQueuedWrites();
+
+	/** Like readSectors() and writeSectors(), but without waiting for
+	 * queued writes. Only for AsyncDiskIO, which keeps the order itself.
+	 */
+	void readSectorsNoWait (std::span<      SectorBuffer> buffers, size_t startSector);
+	void writeSectorsNoWait(std::span<const SectorBuffer> buffers, size_t startSector);
+
 	// write protected stuff
 	[[nodiscard]] bool isWriteProtected() const;
 	void forceWriteProtect();
 
 	[[nodiscard]] virtual bool isDummyDisk() const;
 
+	/** Can this disk be read and written from a helper thread (see
+	 * AsyncDiskIO)? Not when the result of an access depends on the state
+	 * of the emulation (e.g. DirAsDSK uses the current EmuTime). Accesses
+	 * through the methods above are serialized, so a helper thread and
+	 * the emulation thread can both use the same disk.
+	 */
+	[[nodiscard]] virtual bool allowBackgroundAccess() const;
+
+	/** Incremented on every write (and when a patch is applied). Allows
+	 * to detect that previously read data may be outdated.
+	 */
+	[[nodiscard]] uint64_t getWriteCount() const { return writeCount; }
+
 	// patch stuff
 	void applyPatch(Filename patchFile);
 	[[nodiscard]] std::vector<Filename> getPatches() const;
@@ -65,13 +98,22 @@ protected:
 	virtual Sha1Sum getSha1SumImpl(FilePool& filePool);
 
 private:
-	virtual void writeSectorImpl(size_t sector, const SectorBuffer& buf) = 0;
+	// Default writeSectorsImpl() implementation delegates to writeSectorImpl.
+	// Subclasses should override exactly one of these two.
+	virtual void writeSectorsImpl(
+		std::span<const SectorBuffer> buffers, size_t startSector);
+	virtual void writeSectorImpl(size_t sector, const SectorBuffer& buf);
 	[[nodiscard]] virtual size_t getNbSectorsImpl() = 0;
 	[[nodiscard]] virtual bool isWriteProtectedImpl() const = 0;
 
 private:
 	std::unique_ptr<const PatchInterface> patch;
 	Sha1Sum sha1cache;
+	std::recursive_mutex accessMutex; // see allowBackgroundAccess()
+	std::atomic<uint64_t> writeCount = 0;
+	std::mutex queuedMutex;
+	std::condition_variable queuedCond;
+	int queuedWrites = 0; // protected by 'queuedMutex'
 	bool forcedWriteProtect = false;
 	bool peekMode = false;
 };
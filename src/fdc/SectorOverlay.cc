@@ -0,0 +1,219 @@
+#include "SectorOverlay.hh"
+
+#include "File.hh"
+#include "MSXException.hh"
+
+#include "serialize.hh"
+#include "serialize_stl.hh"
+
+#include "DeltaBlock.hh"
+#include "stl.hh"
+#include "unreachable.hh"
+#include "xrange.hh"
+
+#include <bit>
+#include <cassert>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace openmsx {
+
+class SectorOverlay::DeltaFile
+{
+public:
+	/** Create a new (empty) delta file. */
+	DeltaFile();
+	DeltaFile(const DeltaFile&) = delete;
+	DeltaFile(DeltaFile&&) = delete;
+	DeltaFile& operator=(const DeltaFile&) = delete;
+	DeltaFile& operator=(DeltaFile&&) = delete;
+	~DeltaFile();
+
+	/** Returns a record that's not in use, with reference count 1. */
+	[[nodiscard]] uint32_t allocate();
+	void ref(uint32_t record) { ++refCounts[record]; }
+	void unref(uint32_t record);
+	[[nodiscard]] bool isShared(uint32_t record) const { return refCounts[record] > 1; }
+
+	void write(uint32_t record, const SectorBuffer& buf);
+	void read(uint32_t record, SectorBuffer& buf);
+
+	[[nodiscard]] uint32_t getNbRecords() const { return uint32_t(refCounts.size()); }
+
+private:
+	File file;
+	// For each record: the number of sector maps (in overlays or snapshots)
+	// that refer to it. Records with count 0 are in 'freeRecords'.
+	std::vector<uint32_t> refCounts;
+	std::vector<uint32_t> freeRecords;
+};
+
+SectorOverlay::DeltaFile::DeltaFile()
+	: file(File::createTemporary()) // removed when it's closed
+{
+}
+
+SectorOverlay::DeltaFile::~DeltaFile()
+{
+	assert(freeRecords.size() == refCounts.size()); // nothing in use anymore
+}
+
+uint32_t SectorOverlay::DeltaFile::allocate()
+{
+	if (freeRecords.empty()) {
+		refCounts.push_back(1);
+		return uint32_t(refCounts.size() - 1);
+	}
+	auto record = freeRecords.back();
+	freeRecords.pop_back();
+	assert(refCounts[record] == 0);
+	refCounts[record] = 1;
+	return record;
+}
+
+void SectorOverlay::DeltaFile::unref(uint32_t record)
+{
+	assert(refCounts[record] > 0);
+	if (--refCounts[record] == 0) {
+		freeRecords.push_back(record);
+	}
+}
+
+void SectorOverlay::DeltaFile::write(uint32_t record, const SectorBuffer& buf)
+{
+	assert(refCounts[record] == 1);
+	file.seek(size_t(record) * sizeof(SectorBuffer));
+	file.write(buf.raw);
+}
+
+void SectorOverlay::DeltaFile::read(uint32_t record, SectorBuffer& buf)
+{
+	assert(refCounts[record] > 0);
+	file.seek(size_t(record) * sizeof(SectorBuffer));
+	file.read(buf.raw);
+}
+
+
+// The state of an overlay in a reverse snapshot. Holding a copy of the overlay
+// keeps the delta file and all records it refers to alive for as long as the
+// snapshot exists.
+class SectorOverlay::Snapshot final : public DeltaBlock
+{
+public:
+	explicit Snapshot(const SectorOverlay& overlay_) : overlay(overlay_) {}
+	void apply(std::span<uint8_t> /*dst*/) const override {
+		UNREACHABLE; // only stored by reference, see serialize()
+	}
+
+	const SectorOverlay overlay;
+};
+
+
+SectorOverlay::SectorOverlay(const SectorOverlay& other)
+	: delta(other.delta)
+	, sectors(other.sectors)
+{
+	for (auto record : std::views::values(sectors)) delta->ref(record);
+}
+
+SectorOverlay& SectorOverlay::operator=(const SectorOverlay& other)
+{
+	if (this != &other) {
+		SectorOverlay tmp(other);
+		std::swap(delta, tmp.delta);
+		std::swap(sectors, tmp.sectors);
+	}
+	return *this;
+}
+
+SectorOverlay::~SectorOverlay()
+{
+	clear();
+}
+
+void SectorOverlay::clear()
+{
+	for (auto record : std::views::values(sectors)) delta->unref(record);
+	sectors.clear();
+	delta.reset();
+}
+
+void SectorOverlay::read(std::span<SectorBuffer> buffers, size_t startSector)
+{
+	auto endSector = startSector + buffers.size();
+	for (auto it = sectors.lower_bound(startSector);
+	     (it != sectors.end()) && (it->first < endSector); ++it) {
+		delta->read(it->second, buffers[it->first - startSector]);
+	}
+}
+
+void SectorOverlay::write(size_t sector, const SectorBuffer& buf)
+{
+	// Created lazily: (re)creating a machine, e.g. on a reverse jump, should
+	// not create yet another empty delta file.
+	if (!delta) delta = std::make_shared<DeltaFile>();
+	auto [it, inserted] = sectors.try_emplace(sector);
+	if (inserted) {
+		it->second = delta->allocate();
+	} else if (delta->isShared(it->second)) {
+		// a snapshot still needs the old content
+		delta->unref(it->second);
+		it->second = delta->allocate();
+	}
+	delta->write(it->second, buf);
+}
+
+size_t SectorOverlay::getNbRecords() const
+{
+	return delta ? delta->getNbRecords() : 0;
+}
+
+// In a reverse snapshot the overlay is stored by reference (see class
+// comment). In all other cases the content of the modified sectors is stored.
+template<typename Archive>
+void SectorOverlay::serialize(Archive& ar, unsigned /*version*/)
+{
+	bool shared = false;
+	if constexpr (std::is_same_v<Archive, MemOutputArchive>) {
+		shared = ar.isReverseSnapshot();
+	}
+	ar.serialize("shared", shared);
+	if (shared) {
+		if constexpr (std::is_same_v<Archive, MemOutputArchive>) {
+			ar.saveSharedBlock(std::make_shared<Snapshot>(*this));
+		} else if constexpr (std::is_same_v<Archive, MemInputArchive>) {
+			const auto* snapshot = dynamic_cast<const Snapshot*>(ar.loadSharedBlock().get());
+			assert(snapshot);
+			*this = snapshot->overlay;
+		} else {
+			throw MSXException("Invalid hard disk overlay in savestate.");
+		}
+		return;
+	}
+
+	std::vector<size_t> numbers;
+	if constexpr (!Archive::IS_LOADER) {
+		numbers = to_vector(std::views::keys(sectors));
+	}
+	ar.serialize("sectors", numbers);
+
+	std::vector<SectorBuffer> data(numbers.size());
+	if constexpr (!Archive::IS_LOADER) {
+		for (auto i : xrange(numbers.size())) {
+			delta->read(sectors[numbers[i]], data[i]);
+		}
+	}
+	ar.serialize_blob("data", std::span{std::bit_cast<uint8_t*>(data.data()),
+	                                    data.size() * sizeof(SectorBuffer)});
+	if constexpr (Archive::IS_LOADER) {
+		clear();
+		for (auto i : xrange(numbers.size())) {
+			write(numbers[i], data[i]);
+		}
+	}
+}
+INSTANTIATE_SERIALIZE_METHODS(SectorOverlay);
+
+} // namespace openmsx
@@ -0,0 +1,65 @@
+#ifndef SECTOROVERLAY_HH
+#define SECTOROVERLAY_HH
+
+#include "DiskImageUtils.hh"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <span>
+
+namespace openmsx {
+
+/** Copy-on-write layer on top of a (read-only) disk image.
+ *
+ * Modified sectors are not written to the image itself, instead they are
+ * stored in a temporary delta file. The in-memory 'sectors' map tells which
+ * record in that file holds the current content of each modified sector.
+ *
+ * A reverse snapshot stores the overlay by reference: it shares the delta
+ * file and holds on to the records it refers to. Only records that are no
+ * longer referenced (by any overlay or snapshot) get overwritten or reused,
+ * so the file doesn't grow when the same sectors are written over and over
+ * again. The delta file is deleted when nothing refers to it anymore (on
+ * platforms where that's possible it's already removed from the directory
+ * right after creation). It's only created on the first write.
+ *
+ * Many machines can run from the same base image, each with their own
+ * overlay, without modifying or copying that image.
+ */
+class SectorOverlay
+{
+public:
+	SectorOverlay() = default;
+	SectorOverlay(const SectorOverlay& other);
+	SectorOverlay& operator=(const SectorOverlay& other);
+	~SectorOverlay();
+
+	/** Replace the modified sectors in the range
+	 * [startSector, startSector + buffers.size()) in 'buffers'.
+	 */
+	void read(std::span<SectorBuffer> buffers, size_t startSector);
+	void write(size_t sector, const SectorBuffer& buf);
+
+	[[nodiscard]] size_t getNbModifiedSectors() const { return sectors.size(); }
+
+	template<typename Archive>
+	void serialize(Archive& ar, unsigned version);
+
+//private:
+	// This should not be called directly, except by the unittest
+	[[nodiscard]] size_t getNbRecords() const;
+
+private:
+	void clear();
+
+private:
+	class DeltaFile;
+	class Snapshot;
+	std::shared_ptr<DeltaFile> delta; // nullptr iff 'sectors' is empty
+	std::map<size_t, uint32_t> sectors; // sector number -> record in 'delta'
+};
+
+} // namespace openmsx
+
+#endif
@@ -4,18 +4,61 @@
 #include "XSAExtractor.hh"
 
 #include "File.hh"
+#include "FileOperations.hh"
+#include "FilePool.hh"
+#include "MSXException.hh"
+
+#include "strCat.hh"
+
 
 namespace openmsx {
 
-XSADiskImage::XSADiskImage(const Filename& filename, File& file)
+XSADiskImage::XSADiskImage(const Filename& filename, File& file, FilePool& filePool)
 	: SectorBasedDisk(DiskName(filename))
 {
 	auto mmap = file.mmap<const uint8_t>();
-	XSAExtractor extractor(mmap);
-	data = std::move(extractor).extractData();
+	auto numSectors = XSAExtractor::getNbSectors(mmap); // throws when not XSA
+
+	// Decompressed images are cached, keyed on the sha1sum of the XSA file.
+	// The filepool usually already knows that sha1sum (without reading
+	// the file).
+	auto cacheName = getCacheName(filePool.getSha1Sum(file, filename.getResolved()));
+	if (!loadFromCache(cacheName, numSectors)) {
+		XSAExtractor extractor(mmap);
+		data = std::move(extractor).extractData();
+		saveToCache(cacheName);
+	}
 	setNbSectors(data.size());
 }
 
+std::string XSADiskImage::getCacheName(const Sha1Sum& sha1)
+{
+	return strCat(FileOperations::getUserDataDir(), "/xsacache/", sha1, ".dsk");
+}
+
+bool XSADiskImage::loadFromCache(const std::string& cacheName, size_t numSectors)
+{
+	try {
+		File cache(cacheName);
+		if (cache.getSize() != numSectors * sizeof(SectorBuffer)) return false;
+		data.resize(numSectors);
+		cache.read(std::span{data.data(), numSectors});
+		return true;
+	} catch (MSXException&) {
+		// not (yet) in the cache
+		return false;
+	}
+}
+
+void XSADiskImage::saveToCache(const std::string& cacheName) const
+{
+	try {
+		FileOperations::writeFileAtomically(cacheName, std::span{data});
+	} catch (MSXException&) {
+		// ignore, the cache is only an optimization
+	}
+}
+
 void XSADiskImage::readSectorsImpl(
 	std::span<SectorBuffer> buffers, size_t startSector)
 {
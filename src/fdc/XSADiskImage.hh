@@ -12,16 +12,24 @@
 
 #include "MemBuffer.hh"
 
+#include <string>
+
 namespace openmsx {
 
 class File;
+class FilePool;
+class Sha1Sum;
 
 class XSADiskImage final : public SectorBasedDisk
 {
 public:
-	XSADiskImage(const Filename& filename, File& file);
+	XSADiskImage(const Filename& filename, File& file, FilePool& filePool);
 
 private:
+	[[nodiscard]] static std::string getCacheName(const Sha1Sum& sha1);
+	[[nodiscard]] bool loadFromCache(const std::string& cacheName, size_t numSectors);
+	void saveToCache(const std::string& cacheName) const;
+
 	// SectorBasedDisk
 	void readSectorsImpl(
 		std::span<SectorBuffer> buffers, size_t startSector) override;
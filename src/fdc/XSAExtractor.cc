@@ -5,8 +5,22 @@
 #include "narrow.hh"
 #include "xrange.hh"
 
+#include <algorithm>
+#include <cassert>
+
 namespace openmsx {
 
+size_t XSAExtractor::getNbSectors(std::span<const uint8_t> file)
+{
+	if ((file.size() < 8) ||
+	    (file[0] != 'P') || (file[1] != 'C') ||
+	    (file[2] != 'K') || (file[3] != '\010')) {
+		throw MSXException("Not an XSA image");
+	}
+	unsigned outBufLen = file[4] | (file[5] << 8) | (file[6] << 16) | (file[7] << 24);
+	return (size_t(outBufLen) + 511) / 512;
+}
+
 XSAExtractor::XSAExtractor(std::span<const uint8_t> file_)
 	: file(file_)
 {
@@ -68,7 +82,9 @@ void XSAExtractor::unLz77()
 			// 1-bit
 			unsigned strLen = rdStrLen();
 			if (strLen == (MAX_STR_LEN + 1)) {
-				 return;
+				// don't leave garbage in the tail of the last sector
+				std::ranges::fill(out.subspan(outIdx), 0);
+				return;
 			}
 			unsigned strPos = rdStrPos();
 			if ((strPos == 0) || (strPos > outIdx)) {
@@ -80,9 +96,15 @@ void XSAExtractor::unLz77()
 					"Invalid XSA image: too small output buffer");
 			}
 			remaining -= strLen;
-			while (strLen--) {
-				out[outIdx] = out[outIdx - strPos];
-				++outIdx;
+			if (strPos >= strLen) {
+				// source and destination don't overlap
+				std::copy_n(&out[outIdx - strPos], strLen, &out[outIdx]);
+				outIdx += strLen;
+			} else {
+				while (strLen--) {
+					out[outIdx] = out[outIdx - strPos];
+					++outIdx;
+				}
 			}
 		} else {
 			// 0-bit
@@ -99,45 +121,42 @@ void XSAExtractor::unLz77()
 // read string length
 unsigned XSAExtractor::rdStrLen()
 {
-	if (!bitIn()) return 2;
-	if (!bitIn()) return 3;
-	if (!bitIn()) return 4;
+	// short lengths (the common case) are encoded as '0', '10' or '110'
+	auto bits = peekBits();
+	if (!(bits & 1)) { skipBits(1); return 2; }
+	if (!(bits & 2)) { skipBits(2); return 3; }
+	if (!(bits & 4)) { skipBits(3); return 4; }
+	skipBits(3);
 
 	uint8_t nrBits = 2;
 	while ((nrBits != 7) && bitIn()) {
 		++nrBits;
 	}
 
-	unsigned len = 1;
-	while (nrBits--) {
-		len = (len << 1) | (bitIn() ? 1 : 0);
-	}
-	return (len + 1);
+	return getNBits(nrBits) + (1 << nrBits) + 1;
 }
 
 // read string pos
 int XSAExtractor::rdStrPos()
 {
-	HufNode* hufPos = &hufTbl[2 * TBL_SIZE - 2];
-
-	while (hufPos->child1) {
-		if (bitIn()) {
-			hufPos = hufPos->child2;
-		} else {
-			hufPos = hufPos->child1;
+	auto cpdIndex = [&] {
+		if (auto entry = hufLookup[peekBits() & 255]) {
+			// short code: decode all bits at once
+			skipBits(entry >> 4);
+			return uint8_t(entry & 15);
 		}
-	}
-	auto cpdIndex = narrow<uint8_t>(hufPos - &hufTbl[0]);
+		HufNode* hufPos = &hufTbl[2 * TBL_SIZE - 2];
+		while (hufPos->child1) {
+			if (bitIn()) {
+				hufPos = hufPos->child2;
+			} else {
+				hufPos = hufPos->child1;
+			}
+		}
+		return narrow<uint8_t>(hufPos - &hufTbl[0]);
+	}();
 	++tblSizes[cpdIndex];
 
-	auto getNBits = [&](unsigned n) {
-		assert(n <= 8);
-		uint8_t result = 0;
-		repeat(n, [&]{
-			result = uint8_t((result << 1) | (bitIn() ? 1 : 0));
-		});
-		return result;
-	};
 	int strPos = [&] {
 		if (cpdExt[cpdIndex] >= 8) {
 			uint8_t strPosLsb = charIn();
@@ -167,6 +186,49 @@ bool XSAExtractor::bitIn()
 	return temp;
 }
 
+// Return the next input bits (at least 8, unless near the end of the file)
+// without consuming them. Bits and bytes are interleaved in the input, but
+// within a multi-bit value the next flag byte is always the next input byte.
+unsigned XSAExtractor::peekBits() const
+{
+	unsigned result = bitFlg & ((1 << bitCnt) - 1);
+	if (!file.empty()) result |= unsigned(file.front()) << bitCnt;
+	return result;
+}
+
+// Consume 'n' (at most 8) bits, previously inspected via peekBits().
+void XSAExtractor::skipBits(unsigned n)
+{
+	assert(n <= 8);
+	if (n <= bitCnt) {
+		bitFlg = uint8_t(bitFlg >> n);
+		bitCnt = uint8_t(bitCnt - n);
+	} else {
+		n -= bitCnt;
+		bitFlg = uint8_t(charIn() >> n);
+		bitCnt = uint8_t(8 - n);
+	}
+}
+
+// Read a 'n'-bit (at most 8) value, most significant bit first.
+uint8_t XSAExtractor::getNBits(unsigned n)
+{
+	static constexpr auto reverse = [] {
+		std::array<uint8_t, 256> result = {};
+		for (auto i : xrange(256)) {
+			for (auto b : xrange(8)) {
+				if (i & (1 << b)) result[i] |= uint8_t(0x80 >> b);
+			}
+		}
+		return result;
+	}();
+	assert(n <= 8);
+	if (n == 0) return 0;
+	auto result = uint8_t(reverse[peekBits() & ((1 << n) - 1)] >> (8 - n));
+	skipBits(n);
+	return result;
+}
+
 // initialize the huffman info tables
 void XSAExtractor::initHufInfo()
 {
@@ -229,7 +291,26 @@ void XSAExtractor::mkHufTbl()
 		(hufPos->child1 = l1Pos)->weight = 0;
 		(hufPos->child2 = l2Pos)->weight = 0;
 	}
+	fillHufLookup(hufTbl[2 * TBL_SIZE - 2], 0, 0);
 	updHufCnt = MAX_HUF_CNT;
 }
 
+// Fill 'hufLookup' for all codes that start with the 'len' bits in 'code'
+// (first bit in the least significant position).
+void XSAExtractor::fillHufLookup(const HufNode& node, unsigned code, unsigned len)
+{
+	if (!node.child1) {
+		// leaf, 'len' <= 8, all possible values of the remaining bits
+		auto entry = uint8_t((len << 4) | unsigned(&node - &hufTbl[0]));
+		for (unsigned i = code; i < 256; i += 1 << len) {
+			hufLookup[i] = entry;
+		}
+	} else if (len == 8) {
+		hufLookup[code] = 0; // code is too long, fall back to tree walk
+	} else {
+		fillHufLookup(*node.child1, code,              len + 1);
+		fillHufLookup(*node.child2, code | (1 << len), len + 1);
+	}
+}
+
 } // namespace openmsx
@@ -17,6 +17,11 @@ public:
 	explicit XSAExtractor(std::span<const uint8_t> file);
 	MemBuffer<SectorBuffer> extractData() &&;
 
+	/** Check the XSA header and return the size (in sectors) of the
+	  * decompressed image. Throws when 'file' is not an XSA image.
+	  */
+	[[nodiscard]] static size_t getNbSectors(std::span<const uint8_t> file);
+
 private:
 	static constexpr int MAX_STR_LEN = 254;
 	static constexpr int TBL_SIZE = 16;
@@ -28,6 +33,9 @@ private:
 	[[nodiscard]] unsigned rdStrLen();
 	[[nodiscard]] int rdStrPos();
 	[[nodiscard]] bool bitIn();
+	[[nodiscard]] unsigned peekBits() const;
+	void skipBits(unsigned n);
+	[[nodiscard]] uint8_t getNBits(unsigned n);
 	void initHufInfo();
 	void mkHufTbl();
 
@@ -36,6 +44,7 @@ private:
 		HufNode* child2;
 		int weight;
 	};
+	void fillHufLookup(const HufNode& node, unsigned code, unsigned len);
 
 private:
 	std::span<const uint8_t> file; // the not-yet-consumed part of the file
@@ -45,6 +54,9 @@ private:
 	std::array<int, TBL_SIZE + 1> cpDist;
 	std::array<int, TBL_SIZE> tblSizes;
 	std::array<HufNode, 2 * TBL_SIZE - 1> hufTbl;
+	// Indexed by the next 8 input bits: 'length << 4 | leaf' for codes of
+	// at most 8 bits, or 0 when more bits are needed (walk 'hufTbl').
+	std::array<uint8_t, 256> hufLookup;
 
 	uint8_t bitFlg; // flag with the bits
 	uint8_t bitCnt; // nb bits left
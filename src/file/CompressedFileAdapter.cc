@@ -1,12 +1,18 @@
 #include "CompressedFileAdapter.hh"
 
+#include "File.hh"
 #include "FileException.hh"
-#include "MappedFile.hh"
+#include "FileOperations.hh"
+#include "MSXException.hh"
+#include "ZlibInflate.hh"
 
 #include "hash_set.hh"
 #include "ranges.hh"
+#include "strCat.hh"
+#include "xrange.hh"
 #include "xxhash.hh"
 
+#include <algorithm>
 #include <cstring>
 
 namespace openmsx {
@@ -18,6 +24,13 @@ struct GetURLFromDecompressed {
 };
 static hash_set<std::unique_ptr<CompressedFileAdapter::Decompressed>,
                 GetURLFromDecompressed, XXHasher> decompressCache;
+// Files can be opened from helper threads (e.g. the FilePool hashes files in
+// parallel), so access to 'decompressCache' must be serialized.
+static std::mutex decompressMutex;
+
+// Files of at least this (uncompressed or compressed) size are not fully
+// decompressed in memory.
+static constexpr size_t RANDOM_ACCESS_THRESHOLD = 32 * 1024 * 1024;
 
 
 CompressedFileAdapter::CompressedFileAdapter(std::unique_ptr<FileBase> file_, zstring_view filename_)
@@ -29,6 +42,7 @@ CompressedFileAdapter::CompressedFileAdapter(std::unique_ptr<FileBase> file_, zs
 CompressedFileAdapter::~CompressedFileAdapter()
 {
 	if (decompressed) {
+		std::lock_guard lock(decompressMutex);
 		auto it = decompressCache.find(decompressed->cachedURL);
 		assert(it != end(decompressCache));
 		assert(it->get() == decompressed);
@@ -44,31 +58,119 @@ void CompressedFileAdapter::decompress()
 {
 	if (decompressed) return;
 
+	std::unique_lock lock(decompressMutex);
 	auto it = decompressCache.find(filename);
 	if (it == end(decompressCache)) {
+		// Don't hold the lock while decompressing. Another thread
+		// could decompress the same file in the mean time, in that
+		// case use its result and drop ours.
+		lock.unlock();
 		auto d = std::make_unique<Decompressed>();
 		decompress(*file, *d);
 		d->cachedModificationDate = getModificationDate();
 		d->cachedURL = filename;
-		it = decompressCache.insert_noDuplicateCheck(std::move(d));
+		lock.lock();
+		it = decompressCache.find(filename);
+		if (it == end(decompressCache)) {
+			it = decompressCache.insert_noDuplicateCheck(std::move(d));
+		}
 	}
 	++(*it)->useCount;
 	decompressed = it->get();
+	lock.unlock();
 
 	// close original file after successful decompress
 	file.reset();
 }
 
+void CompressedFileAdapter::decompress(FileBase& f, Decompressed& d)
+{
+	auto mmap = MappedFile<const uint8_t>(f.mmap(0, true));
+	ZlibInflate zlib(mmap);
+	auto header = parseHeader(zlib, mmap);
+	d.originalName = std::move(header.originalName);
+
+	if (std::max(header.size, mmap.size()) < RANDOM_ACCESS_THRESHOLD) {
+		d.buf = zlib.inflate(std::max<size_t>(header.size, 1));
+		return;
+	}
+
+	auto deflateData = zlib.getRemainingInput();
+	auto time = f.getModificationDate();
+	d.index = loadIndex(deflateData, time);
+	if (!d.index) {
+		d.index = std::make_unique<ZlibRandomAccess>(deflateData);
+		saveIndex(*d.index, time);
+	}
+	d.deflateData = deflateData;
+	d.compressed = std::move(mmap);
+}
+
+std::string CompressedFileAdapter::getIndexCacheName() const
+{
+	return strCat(FileOperations::getUserDataDir(), "/zindex/",
+	              hex_string<8>(xxhash(filename)), ".zidx");
+}
+
+std::unique_ptr<ZlibRandomAccess> CompressedFileAdapter::loadIndex(
+	std::span<const uint8_t> deflateData, time_t time) const
+{
+	try {
+		File cache(getIndexCacheName());
+		auto mem = cache.mmap<const uint8_t>();
+		return ZlibRandomAccess::load(mem, filename, deflateData.size(), time);
+	} catch (MSXException&) {
+		// ignore, the index is only a cache
+		return {};
+	}
+}
+
+void CompressedFileAdapter::saveIndex(const ZlibRandomAccess& index, time_t time) const
+{
+	auto buf = index.save(filename, time);
+	try {
+		FileOperations::writeFileAtomically(getIndexCacheName(), std::span{buf});
+	} catch (MSXException&) {
+		// ignore, the index is only a cache
+	}
+}
+
 void CompressedFileAdapter::read(std::span<uint8_t> buffer)
 {
 	decompress();
-	if (decompressed->buf.size() < (pos + buffer.size())) {
+	if (getSize() < (pos + buffer.size())) {
 		throw FileException("Read beyond end of file");
 	}
-	copy_to_range(decompressed->buf.subspan(pos, buffer.size()), buffer);
+	if (decompressed->index) {
+		readChunks(buffer);
+	} else {
+		copy_to_range(decompressed->buf.subspan(pos, buffer.size()), buffer);
+	}
 	pos += buffer.size();
 }
 
+// Only decompress the chunks that overlap with the requested range. The last
+// used chunk is kept, reads are typically sequential or at least localized.
+void CompressedFileAdapter::readChunks(std::span<uint8_t> buffer)
+{
+	const auto& index = *decompressed->index;
+	auto p = pos;
+	while (!buffer.empty()) {
+		auto chunk = index.findChunk(p);
+		auto start = index.getChunkStart(chunk);
+		if (chunk != chunkNum) {
+			chunkNum = size_t(-1); // in case inflateChunk() throws
+			chunkBuf.resize(index.getChunkStart(chunk + 1) - start);
+			index.inflateChunk(decompressed->deflateData, chunk, chunkBuf);
+			chunkNum = chunk;
+		}
+		auto num = std::min(buffer.size(), chunkBuf.size() - (p - start));
+		copy_to_range(chunkBuf.subspan(p - start, num), buffer);
+		buffer = buffer.subspan(num);
+		p += num;
+	}
+}
+
 void CompressedFileAdapter::write(std::span<const uint8_t> /*buffer*/)
 {
 	throw FileException("Writing to compressed files not yet supported");
@@ -77,13 +179,28 @@ void CompressedFileAdapter::write(std::span<const uint8_t> /*buffer*/)
 MappedFileImpl CompressedFileAdapter::mmap(size_t extra, bool is_const)
 {
 	decompress();
+	if (auto& d = *decompressed; d.index) {
+		// Only now decompress all of it. This is shared with the other
+		// users of this file, and stays until the last one closes it.
+		std::lock_guard lock(d.bufMutex);
+		if (d.buf.empty() && (d.index->getSize() != 0)) {
+			MemBuffer<uint8_t> all(d.index->getSize());
+			for (auto chunk : xrange(d.index->getNumChunks())) {
+				auto start = d.index->getChunkStart(chunk);
+				auto end   = d.index->getChunkStart(chunk + 1);
+				d.index->inflateChunk(d.deflateData, chunk, all.subspan(start, end - start));
+			}
+			d.buf = std::move(all);
+		}
+	}
 	return {std::span{decompressed->buf}, extra, is_const};
 }
 
 size_t CompressedFileAdapter::getSize()
 {
 	decompress();
-	return decompressed->buf.size();
+	return decompressed->index ? decompressed->index->getSize()
+	                           : decompressed->buf.size();
 }
 
 void CompressedFileAdapter::seek(size_t newPos)
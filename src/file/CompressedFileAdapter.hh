@@ -2,19 +2,41 @@
 #define COMPRESSEDFILEADAPTER_HH
 
 #include "FileBase.hh"
+#include "MappedFile.hh"
+#include "ZlibRandomAccess.hh"
 
 #include "MemBuffer.hh"
 #include "zstring_view.hh"
 
 #include <memory>
+#include <mutex>
+#include <span>
 
 namespace openmsx {
 
+class ZlibInflate;
+
+/** Base class for files that are stored compressed (in a deflate stream).
+  *
+  * Small files are completely decompressed in memory on first access. For
+  * large files (e.g. hard disk images) only an index with checkpoints into
+  * the compressed stream is kept (see ZlibRandomAccess), and read() only
+  * decompresses the parts that are actually accessed. That index is stored
+  * on disk, so that the next time the file doesn't need to be decompressed
+  * at all to build it. Only mmap() still requires the full decompressed data.
+  */
 class CompressedFileAdapter : public FileBase
 {
 public:
 	struct Decompressed {
+		// Full decompressed data. For large files only filled in by mmap().
 		MemBuffer<uint8_t> buf;
+		std::mutex bufMutex;
+		// Only for large files.
+		std::unique_ptr<ZlibRandomAccess> index;
+		MappedFile<const uint8_t> compressed;
+		std::span<const uint8_t> deflateData; // part of 'compressed'
+
 		std::string originalName;
 		std::string cachedURL;
 		time_t cachedModificationDate;
@@ -34,19 +56,37 @@ public:
 	[[nodiscard]] time_t getModificationDate() final;
 
 protected:
+	struct Header {
+		std::string originalName;
+		size_t size = 0; // as stored in the file, possibly only the lower 32 bits
+	};
+
 	explicit CompressedFileAdapter(std::unique_ptr<FileBase> file, zstring_view filename);
 	~CompressedFileAdapter() override;
-	virtual void decompress(FileBase& file, Decompressed& decompressed) = 0;
+
+	/** Parse the header of the compressed file 'data'. On return, 'zlib'
+	  * must be positioned at the start of the deflate stream. */
+	[[nodiscard]] virtual Header parseHeader(ZlibInflate& zlib, std::span<const uint8_t> data) = 0;
 
 private:
 	void decompress();
+	void decompress(FileBase& f, Decompressed& d);
+	void readChunks(std::span<uint8_t> buffer);
+	[[nodiscard]] std::string getIndexCacheName() const;
+	[[nodiscard]] std::unique_ptr<ZlibRandomAccess> loadIndex(
+		std::span<const uint8_t> deflateData, time_t time) const;
+	void saveIndex(const ZlibRandomAccess& index, time_t time) const;
 
 private:
 	// invariant: exactly one of 'file' and 'decompressed' is '!= nullptr'
 	std::unique_ptr<FileBase> file;
 	std::string filename;
-	const Decompressed* decompressed = nullptr;
+	Decompressed* decompressed = nullptr;
 	size_t pos = 0;
+
+	// For large files: the most recently decompressed chunk.
+	MemBuffer<uint8_t> chunkBuf;
+	size_t chunkNum = size_t(-1);
 };
 
 } // namespace openmsx
@@ -0,0 +1,117 @@
+#include "DirWatcher.hh"
+
+#include "systemfuncs.hh"
+
+#if HAVE_INOTIFY
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <array>
+#include <cstring>
+#endif
+
+namespace openmsx {
+
+DirWatcher::DirWatcher(std::string root_)
+	: root(std::move(root_))
+{
+}
+
+DirWatcher::~DirWatcher()
+{
+	close();
+}
+
+void DirWatcher::close()
+{
+#if HAVE_INOTIFY
+	if (fd != -1) ::close(fd);
+#endif
+	fd = -1;
+	watches.clear();
+}
+
+void DirWatcher::startFullScan()
+{
+	// Simply start from scratch: this drops all watches (also on
+	// directories that have been renamed in the mean time) and all
+	// pending events.
+	close();
+	fullScanNeeded = false;
+#if HAVE_INOTIFY
+	if (!failed) {
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd == -1) failed = true;
+	}
+#endif
+}
+
+void DirWatcher::watch([[maybe_unused]] const std::string& subDir)
+{
+#if HAVE_INOTIFY
+	if (fd == -1) return;
+	auto path = root + subDir;
+	int wd = inotify_add_watch(
+		fd, path.empty() ? "." : path.c_str(),
+		IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+		IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+		IN_ONLYDIR);
+	if (wd == -1) {
+		// Typically because the (per user) limit on the number of
+		// watches is reached. Changes in this directory would go
+		// unnoticed, so permanently fall back to periodic scanning.
+		failed = true;
+		close();
+		return;
+	}
+	watches.insert_or_assign(wd, subDir);
+#endif
+}
+
+DirWatcher::Changes DirWatcher::getChanges()
+{
+	Changes result;
+#if HAVE_INOTIFY
+	if (fd != -1) {
+		alignas(inotify_event) std::array<char, 4096> buf;
+		while (true) {
+			auto len = read(fd, buf.data(), buf.size());
+			if (len <= 0) break; // typically EAGAIN: no more events
+			for (ssize_t pos = 0; pos < len; ) {
+				inotify_event event;
+				memcpy(&event, &buf[pos], sizeof(event));
+				const char* name = &buf[pos + sizeof(event)];
+				pos += ssize_t(sizeof(event) + event.len);
+
+				if (event.mask & IN_Q_OVERFLOW) {
+					fullScanNeeded = true;
+					continue;
+				}
+				if (event.mask & IN_IGNORED) {
+					// watch was removed (e.g. directory deleted)
+					watches.erase(event.wd);
+					continue;
+				}
+				if ((event.mask & IN_MOVE_SELF) ||
+				    ((event.mask & (IN_MOVED_FROM | IN_MOVED_TO)) && (event.mask & IN_ISDIR))) {
+					// A renamed directory invalidates the paths
+					// of the watches in that subtree. This is
+					// rare, so keep it simple.
+					fullScanNeeded = true;
+				}
+				auto* subDir = lookup(watches, event.wd);
+				if (!subDir) continue;
+				if (event.len != 0) {
+					result.entries.push_back({*subDir, std::string(name)});
+				} else if ((event.mask & IN_DELETE_SELF) && subDir->empty()) {
+					// root directory itself was removed
+					fullScanNeeded = true;
+				}
+			}
+		}
+	}
+#endif
+	result.full = fullScanNeeded || !isActive();
+	return result;
+}
+
+} // namespace openmsx
@@ -0,0 +1,73 @@
+#ifndef DIRWATCHER_HH
+#define DIRWATCHER_HH
+
+#include "hash_map.hh"
+
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+/** Reports changes in a host directory tree, so that a user of that tree
+  * doesn't need to periodically rescan all of it.
+  *
+  * This is only implemented on Linux (via inotify). On other platforms (or
+  * when e.g. the inotify watch limit is reached) isActive() returns false,
+  * and the user should fall back to periodic scanning.
+  *
+  * Only directories explicitly passed to watch() are monitored (not
+  * recursively). Typically the user calls watch() for each directory it
+  * visits during a full scan, right before reading that directory.
+  */
+class DirWatcher
+{
+public:
+	struct Change {
+		std::string subDir; // relative to the root, empty or ends with '/'
+		std::string name;   // name of the changed entry in that directory
+	};
+	struct Changes {
+		// When true, changes could not be tracked precisely, the user
+		// must do a full scan (and call startFullScan() before that).
+		bool full = false;
+		std::vector<Change> entries;
+	};
+
+public:
+	/** @param root Directory to watch, should end with a '/'. */
+	explicit DirWatcher(std::string root);
+	DirWatcher(const DirWatcher&) = delete;
+	DirWatcher(DirWatcher&&) = delete;
+	DirWatcher& operator=(const DirWatcher&) = delete;
+	DirWatcher& operator=(DirWatcher&&) = delete;
+	~DirWatcher();
+
+	/** Is change tracking active? Only after startFullScan() was called. */
+	[[nodiscard]] bool isActive() const { return fd != -1; }
+
+	/** Forget all watched directories. Must be called right before a full
+	  * scan of the directory tree (which re-adds the watches). */
+	void startFullScan();
+
+	/** Start watching the given directory.
+	  * @param subDir Relative to the root, empty or ends with '/'.
+	  */
+	void watch(const std::string& subDir);
+
+	/** Return (and forget) all changes since the previous call. */
+	[[nodiscard]] Changes getChanges();
+
+private:
+	void close();
+
+private:
+	std::string root;
+	hash_map<int, std::string> watches; // watch descriptor -> subDir
+	int fd = -1;
+	bool fullScanNeeded = true;
+	bool failed = false; // e.g. out of watches, don't retry
+};
+
+} // namespace openmsx
+
+#endif
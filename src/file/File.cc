@@ -59,6 +59,12 @@ File::File(std::unique_ptr<FileBase> file_)
 {
 }
 
+File File::createTemporary()
+{
+	return File(std::make_unique<LocalFile>(
+		FileOperations::openTemporaryFile(FileOperations::getTempDir())));
+}
+
 File::~File() = default;
 
 File& File::operator=(File&& other) noexcept
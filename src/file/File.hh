@@ -53,6 +53,13 @@ public:
 	/* Used by MemoryBufferFile. */
 	explicit File(std::unique_ptr<FileBase> file_);
 
+	/** Create a new temporary file, opened in read/write mode. The file
+	 * has no name, it's removed when it's closed (see
+	 * FileOperations::openTemporaryFile()).
+	 * @throws FileException
+	 */
+	[[nodiscard]] static File createTemporary();
+
 	~File();
 
 	File& operator=(File&& other) noexcept;
@@ -191,6 +191,31 @@ int deleteRecursive(zstring_view path)
 	return ec ? -1 : 0;
 }
 
+int rename(zstring_view oldPath, zstring_view newPath)
+{
+	std::error_code ec;
+	fs::rename(makeFsPath(oldPath), makeFsPath(newPath), ec);
+	return ec ? -1 : 0;
+}
+
+void writeFileAtomically(zstring_view filename, std::span<const uint8_t> data)
+{
+	auto dir = std::string(getDirName(filename));
+	if (!dir.empty()) mkdirp(dir);
+	std::string tmpName;
+	auto f = openUniqueFile(dir.empty() ? "." : dir, tmpName);
+	bool ok = f && (data.empty() || (fwrite(data.data(), data.size(), 1, f.get()) == 1));
+	if (f && (fclose(f.release()) != 0)) ok = false;
+	if (!ok) {
+		unlink(tmpName);
+		throw FileException("Error while writing ", tmpName);
+	}
+	if (rename(tmpName, filename) != 0) {
+		unlink(tmpName);
+		throw FileException("Couldn't rename ", tmpName, " to ", filename);
+	}
+}
+
 FILE_t openFile(zstring_view filename, zstring_view mode)
 {
 	// Mode must contain a 'b' character. On unix this doesn't make any
@@ -712,4 +737,39 @@ FILE_t openUniqueFile(const std::string& directory, std::string& filename)
 #endif
 }
 
+FILE_t openTemporaryFile(const std::string& directory)
+{
+#ifdef _WIN32
+	std::wstring directoryW = utf8to16(directory);
+	std::array<wchar_t, MAX_PATH> filenameW;
+	if (!GetTempFileNameW(directoryW.c_str(), L"msx", 0, filenameW.data())) {
+		throw FileException("GetTempFileNameW failed: ", GetLastError());
+	}
+	// An open file can't be removed on windows, 'D' removes it on close.
+	FILE_t result(_wfopen(filenameW.data(), L"w+bD"));
+	if (!result) {
+		_wunlink(filenameW.data());
+		throw FileException("Couldnt open temp file");
+	}
+	return result;
+#else
+	std::string filename = directory + "/XXXXXX";
+	auto oldMask = umask(S_IRWXO | S_IRWXG);
+	int fd = mkstemp(filename.data());
+	umask(oldMask);
+	if (fd == -1) {
+		throw FileException("Couldnt get temp file name");
+	}
+	// The file remains accessible via 'fd'. This way it also gets cleaned
+	// up when openMSX doesn't exit normally.
+	::unlink(filename.c_str());
+	FILE_t result(fdopen(fd, "wb+"));
+	if (!result) {
+		::close(fd);
+		throw FileException("Couldnt open temp file");
+	}
+	return result;
+#endif
+}
+
 } // namespace openmsx::FileOperations
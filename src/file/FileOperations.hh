@@ -6,9 +6,12 @@
 #include "unistdp.hh" // needed for mode_t definition when building with VC++
 #include "zstring_view.hh"
 
+#include <bit>
+#include <cstdint>
 #include <fstream>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string_view>
 #include <sys/types.h>
 
@@ -75,6 +78,28 @@ namespace openmsx::FileOperations {
 	  */
 	int deleteRecursive(zstring_view path);
 
+	/** Rename (move) a file, replacing 'newPath' if it already exists.
+	  * When both paths are on the same filesystem this is an atomic
+	  * operation: other processes either see the old or the new file.
+	  * @result 0 on success, -1 on error
+	  */
+	int rename(zstring_view oldPath, zstring_view newPath);
+
+	/** Write the given data to a file. The data is first written to a
+	  * temporary file in the same directory, which is then renamed. So
+	  * other (openMSX) processes never see a partially written file.
+	  * The directory is created if it doesn't exist yet.
+	  * @param filename the file path
+	  * @param data the new content of the file
+	  * @throw FileException
+	  */
+	void writeFileAtomically(zstring_view filename, std::span<const uint8_t> data);
+	template<typename T>
+	void writeFileAtomically(zstring_view filename, std::span<T> data) {
+		writeFileAtomically(filename, std::span<const uint8_t>{
+			std::bit_cast<const uint8_t*>(data.data()), data.size_bytes()});
+	}
+
 	/** Call fopen() in a platform-independent manner
 	  * @param filename the file path
 	  * @param mode the mode parameter, same as fopen
@@ -331,6 +356,16 @@ namespace openmsx::FileOperations {
 	 */
 	[[nodiscard]] FILE_t openUniqueFile(const std::string& directory, std::string& filename);
 
+	/**
+	 * Create and open (in read/write mode) a new temporary file in the
+	 * provided directory. The file has no name (anymore), it's removed
+	 * when the returned handle is closed.
+	 * @param directory directory in which to create the temp file
+	 * @result pointer to the opened file
+	 * @throw FileException
+	 */
+	[[nodiscard]] FILE_t openTemporaryFile(const std::string& directory);
+
 } // namespace openmsx::FileOperations
 
 #endif
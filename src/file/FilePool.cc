@@ -46,6 +46,7 @@ FilePool::FilePool(CommandController& controller, Reactor& reactor_)
 {
 	filePoolSetting.attach(*this);
 	reactor.getEventDistributor().registerEventListener(EventType::QUIT, *this);
+	core.startBackgroundScan();
 }
 
 FilePool::~FilePool()
@@ -144,7 +145,7 @@ FilePoolCore::Directories FilePool::getDirectories() const
 void FilePool::update(const Setting& setting) noexcept
 {
 	assert(&setting == &filePoolSetting); (void)setting;
-	(void)getDirectories(); // check for syntax errors
+	core.startBackgroundScan(); // also checks for syntax errors
 }
 
 void FilePool::reportProgress(std::string_view message, float fraction)
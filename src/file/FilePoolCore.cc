@@ -5,10 +5,14 @@
 
 #include "Date.hh"
 #include "Timer.hh"
+#include "enumerate.hh"
+#include "narrow.hh"
 #include "one_of.hh"
 #include "ranges.hh"
+#include "xrange.hh"
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <optional>
 #include <tuple>
@@ -23,16 +27,43 @@ struct GetSha1 {
 	}
 };
 
+// Layout of the binary version of '.filecache':
+// - header
+// - 'count' records, sorted on sha1sum
+// - all filenames (not zero-terminated)
+// Values are stored in host byte order, a file from a host with a different
+// byte order is rejected because its version number doesn't match.
+struct BinaryCacheHeader {
+	std::array<char, 8> magic;
+	uint32_t version;
+	uint32_t count;
+};
+struct BinaryCacheRecord {
+	int64_t time;
+	uint32_t nameOffset; // relative to the start of the filenames
+	uint32_t nameLength;
+	Sha1Sum sum;
+	uint32_t padding = 0; // make padding explicit, so that it's initialized
+};
+static_assert(sizeof(BinaryCacheHeader) == 16);
+static_assert(sizeof(BinaryCacheRecord) == 40);
+static constexpr std::array<char, 8> BINARY_CACHE_MAGIC = {'o', 'M', 'S', 'X', 'p', 'o', 'o', 'l'};
+static constexpr uint32_t BINARY_CACHE_VERSION = 1;
+
 
 FilePoolCore::FilePoolCore(std::string fileCache_,
                            std::function<Directories()> getDirectories_,
                            std::function<void(std::string_view, float)> reportProgress_)
 	: fileCache(std::move(fileCache_))
+	, binaryCache(fileCache + ".bin")
 	, getDirectories(std::move(getDirectories_))
 	, reportProgress(std::move(reportProgress_))
 {
 	try {
-		readSha1sums();
+		if (!readBinarySha1sums()) {
+			readSha1sums();
+			needWrite = true; // (re)create the binary version
+		}
 	} catch (MSXException&) {
 		// ignore, probably .filecache doesn't exist yet
 	}
@@ -40,8 +71,13 @@ FilePoolCore::FilePoolCore(std::string fileCache_,
 
 FilePoolCore::~FilePoolCore()
 {
+	stopBackgroundScan();
+	sync();
 	if (needWrite) {
+		// Keep writing the text version, older openMSX versions (and
+		// external tools) only understand that format.
 		writeSha1sums();
+		writeBinarySha1sums(); // must be last, see there
 	}
 }
 
@@ -197,6 +233,11 @@ void FilePoolCore::readSha1sums()
 		});
 	}
 
+	buildFilenameIndex();
+}
+
+void FilePoolCore::buildFilenameIndex()
+{
 	if (!std::ranges::is_sorted(sha1Index, {}, GetSha1{pool})) {
 		// This should _rarely_ happen. In fact it should only happen
 		// when .filecache was manually edited. Though because it's
@@ -241,8 +282,112 @@ void FilePoolCore::writeSha1sums()
 	}
 }
 
+// Loading the binary cache requires no parsing and no sorting, and the
+// filenames are used directly from the memory mapped file.
+// Returns false if there's no (usable) binary cache.
+bool FilePoolCore::readBinarySha1sums()
+{
+	assert(sha1Index.empty());
+
+	// Only use the binary cache if it's at least as recent as the text
+	// version, e.g. older openMSX versions only update the latter.
+	auto binaryStat = FileOperations::getStat(binaryCache);
+	if (!binaryStat) return false;
+	if (auto textStat = FileOperations::getStat(fileCache);
+	    textStat && (FileOperations::getModificationDate(*textStat) >
+	                 FileOperations::getModificationDate(*binaryStat))) {
+		return false;
+	}
+
+	File file(binaryCache);
+	if (file.getSize() < sizeof(BinaryCacheHeader)) return false;
+	auto mem = file.mmap<const char>();
+	std::span<const char> data{mem.data(), mem.size()};
+
+	BinaryCacheHeader header;
+	memcpy(&header, data.data(), sizeof(header));
+	if ((header.magic != BINARY_CACHE_MAGIC) || (header.version != BINARY_CACHE_VERSION)) {
+		return false;
+	}
+	auto namesStart = sizeof(header) + size_t(header.count) * sizeof(BinaryCacheRecord);
+	if (data.size() < namesStart) return false;
+	auto names = data.subspan(namesStart);
+
+	auto getRecord = [&](size_t i) {
+		BinaryCacheRecord record;
+		memcpy(&record, &data[sizeof(header) + i * sizeof(record)], sizeof(record));
+		return record;
+	};
+	// validate before modifying the database
+	for (auto i : xrange(header.count)) {
+		auto record = getRecord(i);
+		if ((size_t(record.nameOffset) + record.nameLength) > names.size()) return false;
+	}
+
+	sha1Index.reserve(header.count);
+	for (auto i : xrange(header.count)) {
+		auto record = getRecord(i);
+		auto time = narrow_cast<time_t>(record.time);
+		if (time == Date::INVALID_TIME_T) continue;
+		std::string_view filename(&names[record.nameOffset], record.nameLength);
+		sha1Index.push_back(pool.emplace(record.sum, time, filename).idx);
+	}
+	buildFilenameIndex();
+	binaryMem = std::move(mem);
+	return true;
+}
+
+// This releases the memory mapping of the binary cache (needed to overwrite
+// that file on all platforms), which invalidates the filenames of the entries
+// that were loaded from it. So this must be the last operation on the database.
+void FilePoolCore::writeBinarySha1sums()
+{
+	std::vector<Index> valid;
+	valid.reserve(sha1Index.size());
+	size_t namesSize = 0;
+	for (auto idx : sha1Index) {
+		auto& entry = pool[idx];
+		if (entry.getTime() == Date::INVALID_TIME_T) continue;
+		valid.push_back(idx);
+		namesSize += entry.filename.size();
+	}
+
+	auto recordsStart = sizeof(BinaryCacheHeader);
+	auto namesStart = recordsStart + valid.size() * sizeof(BinaryCacheRecord);
+	std::vector<uint8_t> buf(namesStart + namesSize);
+
+	BinaryCacheHeader header{
+		.magic = BINARY_CACHE_MAGIC,
+		.version = BINARY_CACHE_VERSION,
+		.count = narrow<uint32_t>(valid.size()),
+	};
+	memcpy(buf.data(), &header, sizeof(header));
+	size_t nameOffset = 0;
+	for (auto [i, idx] : enumerate(valid)) {
+		auto& entry = pool[idx];
+		BinaryCacheRecord record{
+			.time = entry.getTime(),
+			.nameOffset = narrow<uint32_t>(nameOffset),
+			.nameLength = narrow<uint32_t>(entry.filename.size()),
+			.sum = entry.sum,
+		};
+		memcpy(&buf[recordsStart + i * sizeof(record)], &record, sizeof(record));
+		memcpy(&buf[namesStart + nameOffset], entry.filename.data(), entry.filename.size());
+		nameOffset += entry.filename.size();
+	}
+
+	binaryMem = {};
+	try {
+		File file(binaryCache, File::OpenMode::TRUNCATE);
+		file.write(buf);
+	} catch (FileException&) {
+		// ignore, same as for the text version
+	}
+}
+
 FilePoolCore::Result FilePoolCore::getFile(FileType fileType, const Sha1Sum& sha1sum)
 {
+	sync();
 	auto result = getFromPool(sha1sum);
 	if (result.file.is_open()) return result;
 
@@ -370,7 +515,27 @@ FilePoolCore::Result FilePoolCore::scanDirectory(
 	const Sha1Sum& sha1sum, const std::string& directory, std::string_view poolPath,
 	ScanProgress& progress)
 {
+	// Files that still need to be hashed are collected and then hashed in
+	// parallel. A batch is large enough to keep all threads busy, yet
+	// small enough to not delay finding the file by too much.
+	static constexpr size_t BATCH_SIZE = 256;
+
 	Result result;
+	std::vector<HashJob> jobs;
+	auto hashPending = [&] {
+		hashFiles(jobs);
+		for (const auto& job : jobs) {
+			storeHash(job);
+			if (!result.file.is_open() && job.hashed && (job.sum == sha1sum)) {
+				try {
+					result = {.file = File(job.filename), .filename = job.filename};
+				} catch (FileException&) {
+					// ignore, continue searching
+				}
+			}
+		}
+		jobs.clear();
+	};
 	auto fileAction = [&](const std::string& path, const FileOperations::Stat& st) {
 		if (stop) {
 			// Scanning can take a long time. Allow to exit
@@ -379,16 +544,24 @@ FilePoolCore::Result FilePoolCore::scanDirectory(
 			assert(!result.file.is_open());
 			return false; // abort foreach_file_recursive
 		}
-		result = scanFile(sha1sum, path, st, poolPath, progress);
+		result = scanFile(sha1sum, path, st, poolPath, progress, jobs);
+		if (!result.file.is_open() && (jobs.size() == BATCH_SIZE)) {
+			hashPending();
+		}
 		return !result.file.is_open(); // abort traversal when found
 	};
 	foreach_file_recursive(directory, fileAction);
+	if (!result.file.is_open() && !stop) {
+		hashPending();
+	}
 	return result;
 }
 
+// If the file is in the database and up to date, only compare the sha1sum.
+// Otherwise queue it in 'jobs' for hashing.
 FilePoolCore::Result FilePoolCore::scanFile(const Sha1Sum& sha1sum, zstring_view filename,
                             const FileOperations::Stat& st, std::string_view poolPath,
-                            ScanProgress& progress)
+                            ScanProgress& progress, std::vector<HashJob>& jobs)
 {
 	++progress.amountScanned;
 	// Periodically send a progress message with the current filename
@@ -405,43 +578,172 @@ FilePoolCore::Result FilePoolCore::scanFile(const Sha1Sum& sha1sum, zstring_view
 	}
 
 	auto time = FileOperations::getModificationDate(st);
-	if (auto [idx, entry] = findInDatabase(filename); idx == Index(-1)) {
-		// not in pool
-		try {
-			File file(filename);
-			auto sum = calcSha1sum(file, filename);
-			insert(sum, time, filename);
-			if (sum == sha1sum) {
-				return {.file = std::move(file), .filename = std::string(filename)};
+	if (auto [idx, entry] = findInDatabase(filename);
+	    (idx != Index(-1)) && (entry->getTime() == time)) {
+		// already in pool, and db is still up to date
+		assert(filename == entry->filename);
+		if (entry->sum == sha1sum) {
+			try {
+				return {.file = File(filename), .filename = std::string(filename)};
+			} catch (FileException&) {
+				// error reading file, remove from db
+				remove(idx, *entry);
 			}
-		} catch (FileException&) {
-			// ignore
 		}
-	} else {
-		// already in pool
-		assert(filename == entry->filename);
-		try {
-			if (entry->getTime() == time) {
-				// db is still up to date
-				if (entry->sum == sha1sum) {
-					return {.file = File(filename), .filename = std::string(filename)};
-				}
-			} else {
-				// db outdated
-				File file(filename);
-				auto sum = calcSha1sum(file, filename);
-				entry->setTime(time);
-				adjustSha1(idx, *entry, sum);
-				if (sum == sha1sum) {
-					return {.file = std::move(file), .filename = std::string(filename)};
-				}
+		return {}; // not found
+	}
+	// not in pool, or db outdated
+	jobs.push_back({.filename = std::string(filename), .time = time});
+	return {}; // not found (yet)
+}
+
+// Returns nullopt on error, or when 'abort' gets set while hashing. The file
+// is read (and hashed) in chunks, and that flag is checked between chunks, so
+// that also for a huge file (e.g. a disk image of several GB) the calculation
+// stops quickly. (So don't use mmap() here, that already reads the whole file
+// upfront.)
+[[nodiscard]] static std::optional<Sha1Sum> hashFile(zstring_view filename, const std::atomic<bool>& abort)
+{
+	constexpr size_t CHUNK_SIZE = 1024 * 1024; // 1MB
+	try {
+		File file(filename);
+		auto remaining = file.getSize();
+		MemBuffer<uint8_t> buffer(std::min(remaining, CHUNK_SIZE));
+		SHA1 sha1;
+		while (remaining) {
+			if (abort) return {};
+			auto chunk = std::span{buffer}.first(std::min(remaining, CHUNK_SIZE));
+			file.read(chunk);
+			sha1.update(chunk);
+			remaining -= chunk.size();
+		}
+		return sha1.digest();
+	} catch (MSXException&) {
+		return {};
+	}
+}
+
+// Hash all files in 'jobs', spread over multiple threads. The calling thread
+// takes part in the work and (only it) reports progress.
+void FilePoolCore::hashFiles(std::span<HashJob> jobs)
+{
+	std::atomic<size_t> next = 0;
+	std::atomic<size_t> done = 0;
+	auto work = [&](bool report) {
+		auto lastTime = Timer::getTime();
+		while (!stop) {
+			auto i = next++;
+			if (i >= jobs.size()) break;
+			auto sum = hashFile(jobs[i].filename, stop);
+			if (stop) break; // don't store a partial result
+			jobs[i].sum = sum;
+			jobs[i].hashed = true;
+			++done;
+
+			if (!report) continue;
+			if (auto now = Timer::getTime(); now > (lastTime + 250'000)) { // 4Hz
+				lastTime = now;
+				size_t d = done;
+				reportProgress(tmpStrCat("Calculating SHA1 sums: [", d, '/', jobs.size(), ']'),
+				               float(d) / float(jobs.size()));
 			}
-		} catch (FileException&) {
-			// error reading file, remove from db
-			remove(idx, *entry);
 		}
+	};
+
+	auto numThreads = std::min<size_t>(std::thread::hardware_concurrency(), jobs.size());
+	std::vector<std::thread> helpers;
+	for (size_t t = 1; t < numThreads; ++t) {
+		helpers.emplace_back(work, false);
+	}
+	work(true);
+	for (auto& t : helpers) t.join();
+}
+
+// Store the result of hashing a file (see hashFiles() and backgroundScan()).
+void FilePoolCore::storeHash(const HashJob& job)
+{
+	if (!job.hashed) return;
+	auto [idx, entry] = findInDatabase(job.filename);
+	if (!job.sum) {
+		// error reading file, remove from db
+		if (idx != Index(-1)) remove(idx, *entry);
+	} else if (idx == Index(-1)) {
+		// not in pool
+		insert(*job.sum, job.time, job.filename);
+	} else if (entry->getTime() != job.time) {
+		// db outdated
+		entry->setTime(job.time);
+		adjustSha1(idx, *entry, *job.sum);
+	}
+}
+
+void FilePoolCore::startBackgroundScan()
+{
+	stopBackgroundScan();
+	sync();
+
+	std::vector<std::string> directories;
+	for (const auto& dir : getDirectories()) {
+		directories.push_back(FileOperations::expandTilde(std::string(dir.path)));
+	}
+	// The background thread may not access the database, instead give it
+	// a copy of the timestamps of all files in it.
+	KnownFiles known;
+	known.reserve(narrow<unsigned>(sha1Index.size()));
+	for (auto idx : sha1Index) {
+		auto& entry = pool[idx];
+		known.insert_or_assign(std::string(entry.filename), entry.getTime());
+	}
+
+	stopScan = false;
+	scanThread = std::thread([this, directories = std::move(directories), known = std::move(known)] {
+		backgroundScan(directories, known);
+	});
+}
+
+void FilePoolCore::stopBackgroundScan()
+{
+	if (!scanThread.joinable()) return;
+	stopScan = true;
+	scanThread.join();
+}
+
+// Runs in the background thread: hash all files that are not (or with a
+// different timestamp) in 'known'.
+void FilePoolCore::backgroundScan(std::span<const std::string> directories, const KnownFiles& known)
+{
+	for (const auto& directory : directories) {
+		auto fileAction = [&](const std::string& path, const FileOperations::Stat& st) {
+			if (stopScan) return false;
+			auto time = FileOperations::getModificationDate(st);
+			if (const auto* t = lookup(known, path); t && (*t == time)) {
+				return true; // unchanged
+			}
+			auto sum = hashFile(path, stopScan);
+			if (stopScan) return false; // abandon the partial hash
+			HashJob job{.filename = path, .time = time, .sum = sum, .hashed = true};
+			std::lock_guard lock(scanMutex);
+			scanResults.push_back(std::move(job));
+			return true;
+		};
+		if (!foreach_file_recursive(directory, fileAction)) return;
+	}
+}
+
+void FilePoolCore::sync()
+{
+	std::vector<HashJob> results;
+	{
+		std::lock_guard lock(scanMutex);
+		std::swap(results, scanResults);
+	}
+	for (const auto& job : results) {
+		// The file could have been modified (and possibly already
+		// re-hashed by getFile()) after the background thread hashed it.
+		auto st = FileOperations::getStat(job.filename);
+		if (!st || (FileOperations::getModificationDate(*st) != job.time)) continue;
+		storeHash(job);
 	}
-	return {}; // not found
 }
 
 std::pair<FilePoolCore::Index, FilePoolCore::Entry*> FilePoolCore::findInDatabase(std::string_view filename)
@@ -462,6 +764,7 @@ std::pair<FilePoolCore::Index, FilePoolCore::Entry*> FilePoolCore::findInDatabas
 
 Sha1Sum FilePoolCore::getSha1Sum(File& file, std::string_view filename)
 {
+	sync();
 	auto time = file.getModificationDate();
 
 	auto [idx, entry] = findInDatabase(filename);
@@ -3,19 +3,26 @@
 
 #include "File.hh"
 #include "FileOperations.hh"
+#include "MappedFile.hh"
 
 #include "MemBuffer.hh"
 #include "ObjectPool.hh"
 #include "SimpleHashSet.hh"
+#include "hash_map.hh"
 #include "sha1.hh"
 #include "xxhash.hh"
 
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <ctime>
 #include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 namespace openmsx {
@@ -75,6 +82,18 @@ public:
 	 */
 	void abort() { stop = true; }
 
+	/** (Re)start scanning all filepool directories in a background thread.
+	 * New or modified files are hashed in that thread, the results are
+	 * merged into the database by sync(). This keeps the database up to
+	 * date, so that getFile() rarely has to scan the directories itself.
+	 */
+	void startBackgroundScan();
+
+	/** Merge the results of the background scan (so far) into the
+	 * database. This is done automatically by getFile() and getSha1Sum().
+	 */
+	void sync();
+
 private:
 	struct ScanProgress {
 		uint64_t lastTime;
@@ -82,6 +101,15 @@ private:
 		bool printed = false;
 	};
 
+	// A file that is not (or not correctly) in the database yet.
+	struct HashJob {
+		std::string filename;
+		time_t time;
+		std::optional<Sha1Sum> sum = {}; // empty if the file couldn't be read
+		bool hashed = false; // false if hashing was aborted
+	};
+	using KnownFiles = hash_map<std::string, time_t, XXHasher>;
+
 	struct Entry {
 		Entry(const Sha1Sum& s, time_t t, std::string_view f)
 			: filename(f), time(t), sum(s)
@@ -145,6 +173,9 @@ private:
 
 	void readSha1sums();
 	void writeSha1sums();
+	[[nodiscard]] bool readBinarySha1sums();
+	void writeBinarySha1sums();
+	void buildFilenameIndex();
 
 	[[nodiscard]] Result getFromPool(const Sha1Sum& sha1sum);
 	[[nodiscard]] Result scanDirectory(
@@ -157,25 +188,39 @@ private:
 	        zstring_view filename,
 	        const FileOperations::Stat& st,
 	        std::string_view poolPath,
-	        ScanProgress& progress);
+	        ScanProgress& progress,
+	        std::vector<HashJob>& jobs);
+	void hashFiles(std::span<HashJob> jobs);
+	void storeHash(const HashJob& job);
 	[[nodiscard]] Sha1Sum calcSha1sum(File& file, std::string_view filename) const;
 	[[nodiscard]] std::pair<Index, Entry*> findInDatabase(std::string_view filename);
 
+	void backgroundScan(std::span<const std::string> directories, const KnownFiles& known);
+	void stopBackgroundScan();
+
 private:
 	std::string fileCache; // path of the '.filecache' file.
+	std::string binaryCache; // path of the binary version of the above
 	std::function<Directories()> getDirectories;
 	std::function<void(std::string_view, float)> reportProgress;
 
 	MemBuffer<char> fileMem; // content of initial .filecache
+	MappedFile<const char> binaryMem; // or content of the initial binary cache
 	std::vector<std::string> stringBuffer; // owns strings that are not in 'fileMem'
 
 	Pool pool; // the actual entries
 	Sha1Index sha1Index; // entries accessible via sha1, sorted on 'CompareSha1'
 	FilenameIndex filenameIndex{FilenameIndexHash(pool), FilenameIndexEqual(pool)}; // accessible via filename
 
-	bool stop = false; // abort long search (set via reportProgress callback)
+	std::atomic<bool> stop = false; // abort long search (set via reportProgress callback)
 	bool needWrite = false; // dirty '.filecache'? write on exit
 
+	// background scan
+	std::thread scanThread;
+	std::atomic<bool> stopScan = false;
+	std::mutex scanMutex;
+	std::vector<HashJob> scanResults; // protected by 'scanMutex'
+
 	friend struct GetSha1;
 };
 
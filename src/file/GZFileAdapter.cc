@@ -1,7 +1,6 @@
 #include "GZFileAdapter.hh"
 
 #include "FileException.hh"
-#include "MappedFile.hh"
 #include "ZlibInflate.hh"
 
 namespace openmsx {
@@ -54,14 +53,19 @@ GZFileAdapter::GZFileAdapter(std::unique_ptr<FileBase> file_, zstring_view filen
 	return true;
 }
 
-void GZFileAdapter::decompress(FileBase& f, Decompressed& d)
+CompressedFileAdapter::Header GZFileAdapter::parseHeader(
+	ZlibInflate& zlib, std::span<const uint8_t> data)
 {
-	auto mmap = MappedFile<const uint8_t>(f.mmap(0, true));
-	ZlibInflate zlib(mmap);
-	if (!skipHeader(zlib, d.originalName)) {
+	Header header;
+	if (!skipHeader(zlib, header.originalName)) {
 		throw FileException("Not a gzip header");
 	}
-	d.buf = zlib.inflate();
+	// The gzip trailer ends with the (lower 32 bits of the) original size.
+	if (data.size() >= 4) {
+		auto t = data.last(4);
+		header.size = t[0] | (t[1] << 8) | (t[2] << 16) | (size_t(t[3]) << 24);
+	}
+	return header;
 }
 
 } // namespace openmsx
@@ -25,6 +25,7 @@
 #include <cassert>
 #include <cerrno>
 #include <cstring> // for strchr, strerror
+#include <utility>
 
 namespace openmsx {
 
@@ -75,6 +76,13 @@ LocalFile::LocalFile(zstring_view filename, const char* mode)
 	(void)getSize(); // query filesize, but ignore result
 }
 
+LocalFile::LocalFile(FileOperations::FILE_t file_)
+	: file(std::move(file_))
+{
+	assert(file);
+	(void)getSize(); // query filesize, but ignore result
+}
+
 void LocalFile::preCacheFile()
 {
 #ifdef __unix__
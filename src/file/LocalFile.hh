@@ -18,6 +18,7 @@ class LocalFile final : public FileBase
 public:
 	LocalFile(zstring_view filename, File::OpenMode mode);
 	LocalFile(zstring_view filename, const char* mode);
+	explicit LocalFile(FileOperations::FILE_t file_);
 
 	void read(std::span<uint8_t> buffer) override;
 	void write(std::span<const uint8_t> buffer) override;
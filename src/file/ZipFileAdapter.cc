@@ -1,7 +1,6 @@
 #include "ZipFileAdapter.hh"
 
 #include "FileException.hh"
-#include "MappedFile.hh"
 #include "ZlibInflate.hh"
 
 namespace openmsx {
@@ -11,11 +10,10 @@ ZipFileAdapter::ZipFileAdapter(std::unique_ptr<FileBase> file_, zstring_view fil
 {
 }
 
-void ZipFileAdapter::decompress(FileBase& f, Decompressed& d)
+CompressedFileAdapter::Header ZipFileAdapter::parseHeader(
+	ZlibInflate& zlib, std::span<const uint8_t> /*data*/)
 {
-	auto mmap = MappedFile<const uint8_t>(f.mmap(0, true));
-	ZlibInflate zlib(mmap);
-
+	Header header;
 	if (zlib.get32LE() != 0x04034B50) {
 		throw FileException("Invalid ZIP file");
 	}
@@ -32,13 +30,12 @@ void ZipFileAdapter::decompress(FileBase& f, Decompressed& d)
 	//      "crc32",              "compressed size"
 	zlib.skip(2 + 2 + 4 + 4);
 
-	unsigned origSize = zlib.get32LE(); // uncompressed size
+	header.size = zlib.get32LE(); // uncompressed size
 	unsigned filenameLen = zlib.get16LE(); // filename length
 	unsigned extraFieldLen = zlib.get16LE(); // extra field length
-	d.originalName = zlib.getString(filenameLen); // original filename
+	header.originalName = zlib.getString(filenameLen); // original filename
 	zlib.skip(extraFieldLen); // skip "extra field"
-
-	d.buf = zlib.inflate(origSize);
+	return header;
 }
 
 } // namespace openmsx
@@ -0,0 +1,234 @@
+#include "ZlibRandomAccess.hh"
+
+#include "FileException.hh"
+
+#include "enumerate.hh"
+#include "narrow.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+
+#define ZLIB_CONST
+#include <zlib.h>
+
+namespace openmsx {
+
+// Format of the data produced by save(). This is only a cache on the local
+// machine, so there's no need to care about endianness.
+struct IndexHeader {
+	std::array<char, 8> magic;
+	uint32_t version;
+	uint32_t nameSize;
+	uint64_t deflateSize;
+	int64_t time;
+	uint64_t size;
+	uint64_t numPoints;
+	// followed by 'nameSize' bytes and 'numPoints' IndexPoint structs
+};
+struct IndexPoint {
+	uint64_t out;
+	uint64_t in;
+	uint64_t bits;
+	// followed by WINDOW_SIZE bytes
+};
+static constexpr std::array<char, 8> INDEX_MAGIC = {'o', 'M', 'S', 'X', 'z', 'i', 'd', 'x'};
+static constexpr uint32_t INDEX_VERSION = 1;
+
+// zlib counts in 'uInt', feed it input/output in pieces of at most this size
+static constexpr size_t MAX_PIECE = size_t(1) << 30;
+
+namespace {
+class Inflater
+{
+public:
+	Inflater() {
+		if (int err = inflateInit2(&s, -MAX_WBITS); err != Z_OK) {
+			throw FileException("Error initializing inflate struct: ", zError(err));
+		}
+	}
+	Inflater(const Inflater&) = delete;
+	Inflater(Inflater&&) = delete;
+	Inflater& operator=(const Inflater&) = delete;
+	Inflater& operator=(Inflater&&) = delete;
+	~Inflater() { inflateEnd(&s); }
+
+	// provide more input when all given input was consumed
+	void refill(std::span<const uint8_t> data) {
+		if (s.avail_in != 0) return;
+		auto consumed = size_t(s.next_in - data.data());
+		s.avail_in = uInt(std::min(data.size() - consumed, MAX_PIECE));
+	}
+
+	z_stream s = {};
+};
+} // namespace
+
+ZlibRandomAccess::ZlibRandomAccess(std::span<const uint8_t> deflateData)
+	: deflateSize(deflateData.size())
+{
+	Inflater inflater;
+	auto& s = inflater.s;
+	s.next_in = deflateData.data();
+
+	// The output is only needed to fill the checkpoint windows, so use a
+	// circular buffer of the window size.
+	std::array<uint8_t, WINDOW_SIZE> window;
+	s.next_out = window.data();
+	s.avail_out = WINDOW_SIZE;
+
+	points.push_back({.out = 0, .in = 0, .bits = 0, .window = {}});
+	size_t totalOut = 0;
+	while (true) {
+		inflater.refill(deflateData);
+		if (s.avail_out == 0) {
+			s.next_out = window.data();
+			s.avail_out = WINDOW_SIZE;
+		}
+		auto before = s.avail_out;
+		int err = ::inflate(&s, Z_BLOCK);
+		totalOut += before - s.avail_out;
+		if (err == Z_STREAM_END) break;
+		if (err != Z_OK) {
+			throw FileException("Error decompressing: ", zError(err));
+		}
+		// At a block boundary (but not at the end of the last block)?
+		if ((s.data_type & 128) && !(s.data_type & 64) &&
+		    ((totalOut - points.back().out) >= SPAN)) {
+			auto& p = points.emplace_back();
+			p.out = totalOut;
+			p.in = size_t(s.next_in - deflateData.data());
+			p.bits = narrow<uint8_t>(s.data_type & 7);
+			// oldest bytes are at the current output position
+			auto left = s.avail_out;
+			std::copy_n(window.data() + WINDOW_SIZE - left, left, p.window.data());
+			std::copy_n(window.data(), WINDOW_SIZE - left, p.window.data() + left);
+		}
+	}
+	size = totalOut;
+}
+
+std::unique_ptr<ZlibRandomAccess> ZlibRandomAccess::load(
+	std::span<const uint8_t> buf, std::string_view name,
+	size_t deflateSize, time_t time)
+{
+	if (buf.size() < sizeof(IndexHeader)) return {};
+	IndexHeader header;
+	memcpy(&header, buf.data(), sizeof(header));
+	if ((header.magic != INDEX_MAGIC) ||
+	    (header.version != INDEX_VERSION) ||
+	    (header.nameSize != name.size()) ||
+	    (header.deflateSize != deflateSize) ||
+	    (header.time != int64_t(time)) ||
+	    (header.numPoints == 0)) {
+		return {};
+	}
+	static constexpr auto POINT_SIZE = sizeof(IndexPoint) + WINDOW_SIZE;
+	auto pointsStart = sizeof(header) + name.size();
+	if ((header.numPoints > (buf.size() / POINT_SIZE)) ||
+	    (buf.size() != (pointsStart + header.numPoints * POINT_SIZE))) {
+		return {};
+	}
+	if (std::string_view(std::bit_cast<const char*>(&buf[sizeof(header)]), name.size()) != name) {
+		return {};
+	}
+
+	auto result = std::unique_ptr<ZlibRandomAccess>(new ZlibRandomAccess());
+	result->size = header.size;
+	result->deflateSize = deflateSize;
+	result->points.resize(header.numPoints);
+	for (auto [i, p] : enumerate(result->points)) {
+		auto offset = pointsStart + i * POINT_SIZE;
+		IndexPoint ip;
+		memcpy(&ip, &buf[offset], sizeof(ip));
+		if ((ip.in > deflateSize) || (ip.out > header.size) || (ip.bits > 7) ||
+		    ((ip.bits != 0) && (ip.in == 0)) ||
+		    ((i == 0) ? (ip.out != 0)
+		              : (ip.out <= result->points[i - 1].out))) {
+			return {}; // corrupt
+		}
+		p.out = ip.out;
+		p.in = ip.in;
+		p.bits = uint8_t(ip.bits);
+		memcpy(p.window.data(), &buf[offset + sizeof(ip)], WINDOW_SIZE);
+	}
+	return result;
+}
+
+std::vector<uint8_t> ZlibRandomAccess::save(std::string_view name, time_t time) const
+{
+	IndexHeader header = {
+		.magic = INDEX_MAGIC,
+		.version = INDEX_VERSION,
+		.nameSize = narrow<uint32_t>(name.size()),
+		.deflateSize = deflateSize,
+		.time = time,
+		.size = size,
+		.numPoints = points.size(),
+	};
+	static constexpr auto POINT_SIZE = sizeof(IndexPoint) + WINDOW_SIZE;
+	auto pointsStart = sizeof(header) + name.size();
+	std::vector<uint8_t> result(pointsStart + points.size() * POINT_SIZE);
+	memcpy(&result[0], &header, sizeof(header));
+	memcpy(&result[sizeof(header)], name.data(), name.size());
+	for (auto [i, p] : enumerate(points)) {
+		auto offset = pointsStart + i * POINT_SIZE;
+		IndexPoint ip = {.out = p.out, .in = p.in, .bits = p.bits};
+		memcpy(&result[offset], &ip, sizeof(ip));
+		memcpy(&result[offset + sizeof(ip)], p.window.data(), WINDOW_SIZE);
+	}
+	return result;
+}
+
+size_t ZlibRandomAccess::getChunkStart(size_t chunk) const
+{
+	assert(chunk <= points.size());
+	return (chunk < points.size()) ? points[chunk].out : size;
+}
+
+size_t ZlibRandomAccess::findChunk(size_t pos) const
+{
+	assert(pos < size);
+	auto it = std::ranges::upper_bound(points, pos, {}, &Point::out);
+	assert(it != points.begin());
+	return std::distance(points.begin(), it) - 1;
+}
+
+void ZlibRandomAccess::inflateChunk(
+	std::span<const uint8_t> deflateData, size_t chunk, std::span<uint8_t> output) const
+{
+	assert(deflateData.size() == deflateSize);
+	assert(output.size() == (getChunkStart(chunk + 1) - getChunkStart(chunk)));
+	const auto& p = points[chunk];
+
+	Inflater inflater;
+	auto& s = inflater.s;
+	if (p.bits) {
+		// checkpoint is in the middle of a byte
+		inflatePrime(&s, p.bits, deflateData[p.in - 1] >> (8 - p.bits));
+	}
+	if (p.out != 0) {
+		inflateSetDictionary(&s, p.window.data(), WINDOW_SIZE);
+	}
+	s.next_in = deflateData.data() + p.in;
+
+	size_t done = 0;
+	while (done < output.size()) {
+		inflater.refill(deflateData);
+		s.next_out = output.data() + done;
+		s.avail_out = uInt(std::min(output.size() - done, MAX_PIECE));
+		auto before = s.avail_out;
+		int err = ::inflate(&s, Z_NO_FLUSH);
+		done += before - s.avail_out;
+		if (err == Z_STREAM_END) break;
+		if (err != Z_OK) {
+			throw FileException("Error decompressing: ", zError(err));
+		}
+	}
+	if (done != output.size()) {
+		throw FileException("Error decompressing: unexpected end of stream");
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,76 @@
+#ifndef ZLIBRANDOMACCESS_HH
+#define ZLIBRANDOMACCESS_HH
+
+#include <array>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace openmsx {
+
+/** Random access into a raw deflate stream, based on the 'zran.c' example
+  * from the zlib distribution.
+  *
+  * A first pass decompresses the whole stream (without keeping the output)
+  * and records a checkpoint roughly every SPAN bytes of output. A checkpoint
+  * holds the (bit) position in the compressed stream of a deflate block
+  * boundary and the last 32kB of output before it (the LZ77 window). From
+  * there decompression can restart. So to read at some position, only the
+  * 'chunk' between two checkpoints needs to be decompressed.
+  *
+  * The index can be saved, so that the first pass can be skipped the next
+  * time the same file is opened.
+  */
+class ZlibRandomAccess
+{
+public:
+	static constexpr size_t SPAN = 1024 * 1024;
+	static constexpr size_t WINDOW_SIZE = 32768;
+
+	/** Build the index (this decompresses the full stream once).
+	  * Throws FileException when the stream is corrupt. */
+	explicit ZlibRandomAccess(std::span<const uint8_t> deflateData);
+
+	/** Restore an index created by save(). Returns nullptr when 'buf'
+	  * doesn't contain a valid index for the given name, stream size and
+	  * modification time. */
+	[[nodiscard]] static std::unique_ptr<ZlibRandomAccess> load(
+		std::span<const uint8_t> buf, std::string_view name,
+		size_t deflateSize, time_t time);
+	[[nodiscard]] std::vector<uint8_t> save(std::string_view name, time_t time) const;
+
+	/** Size of the decompressed data. */
+	[[nodiscard]] size_t getSize() const { return size; }
+
+	/** Chunk 'i' covers the range '[getChunkStart(i), getChunkStart(i + 1))'
+	  * of the decompressed data. */
+	[[nodiscard]] size_t getNumChunks() const { return points.size(); }
+	[[nodiscard]] size_t getChunkStart(size_t chunk) const;
+	[[nodiscard]] size_t findChunk(size_t pos) const;
+
+	/** Decompress a full chunk, 'output' must have the size of that chunk. */
+	void inflateChunk(std::span<const uint8_t> deflateData, size_t chunk,
+	                  std::span<uint8_t> output) const;
+
+private:
+	struct Point {
+		uint64_t out; // position in the decompressed data
+		uint64_t in;  // position in the compressed data (first full byte)
+		uint8_t bits; // number of bits (1-7) from the byte before 'in', or 0
+		std::array<uint8_t, WINDOW_SIZE> window; // only valid when 'out != 0'
+	};
+
+	ZlibRandomAccess() = default;
+
+private:
+	std::vector<Point> points; // sorted on 'out', first point is at 0
+	size_t size = 0;
+	size_t deflateSize = 0;
+};
+
+} // namespace openmsx
+
+#endif
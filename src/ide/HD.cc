@@ -3,6 +3,7 @@
 #include "DeviceConfig.hh"
 #include "Display.hh"
 #include "FileContext.hh"
+#include "FileOperations.hh"
 #include "FilePool.hh"
 #include "GlobalSettings.hh"
 #include "HDImageCLI.hh"
@@ -12,9 +13,12 @@
 #include "Reactor.hh"
 #include "Timer.hh"
 
+#include "enumerate.hh"
 #include "narrow.hh"
 #include "serialize.hh"
+#include "strCat.hh"
 #include "tiger.hh"
+#include "xxhash.hh"
 
 #include <array>
 #include <cassert>
@@ -43,6 +47,11 @@ HD::HD(const DeviceConfig& config)
 	// for exception safety, set hdInUse only at the end
 	name[2] = narrow<char>('a' + id);
 
+	// With an overlay the image itself is never modified, so it can be
+	// shared by multiple machines (or openMSX instances). Then it's opened
+	// read-only (and it's not created when it doesn't exist yet).
+	bool useOverlay = config.getChildDataAsBool("overlay", false);
+
 	// For the initial hd image, savestate should only try exactly this
 	// (resolved) filename. For user-specified hd images (command line or
 	// via hda command) savestate will try to re-resolve the filename.
@@ -50,13 +59,18 @@ HD::HD(const DeviceConfig& config)
 	if (std::string cliImage = HDImageCLI::getImageForId(id);
 	    cliImage.empty()) {
 		const auto& original = config.getChildData("filename");
-		filename = Filename(config.getFileContext().resolveCreate(original));
-		mode = File::OpenMode::CREATE;
+		if (useOverlay) {
+			filename = Filename(config.getFileContext().resolve(original));
+		} else {
+			filename = Filename(config.getFileContext().resolveCreate(original));
+			mode = File::OpenMode::CREATE;
+		}
 	} else {
 		filename = Filename(std::move(cliImage), userFileContext());
 	}
 
-	file = File(filename.getResolved(), mode);
+	file = useOverlay ? File(filename.getResolved(), "rb")
+	                  : File(filename.getResolved(), mode);
 	filesize = file.getSize();
 	if (mode == File::OpenMode::CREATE && filesize == 0) {
 		// OK, the file was just newly created. Now make sure the file
@@ -64,7 +78,9 @@ HD::HD(const DeviceConfig& config)
 		file.truncate(size_t(config.getChildDataAsInt("size", 0)) * 1024 * 1024);
 		filesize = file.getSize();
 	}
+	if (useOverlay) overlay.emplace();
 	tigerTree.emplace(*this, filesize, filename.getResolved());
+	loadTigerTreeCache();
 
 	(*hdInUse)[id] = true;
 	hdCommand.emplace(
@@ -80,6 +96,7 @@ HD::HD(const DeviceConfig& config)
 
 HD::~HD()
 {
+	saveTigerTreeCache();
 	motherBoard.unregisterMediaProvider(*this);
 	motherBoard.getMSXCliComm().update(CliComm::UpdateType::HARDWARE, name, "remove");
 
@@ -104,10 +121,14 @@ void HD::setMedia(const TclObject& info, EmuTime /*time*/)
 
 void HD::switchImage(const Filename& newFilename)
 {
-	file = File(newFilename.getResolved());
+	saveTigerTreeCache();
+	file = overlay ? File(newFilename.getResolved(), "rb")
+	               : File(newFilename.getResolved());
 	filename = newFilename;
+	if (overlay) overlay.emplace();
 	filesize = file.getSize();
 	tigerTree.emplace(*this, filesize, filename.getResolved());
+	loadTigerTreeCache();
 	motherBoard.getMSXCliComm().update(CliComm::UpdateType::MEDIA, getName(),
 	                                   filename.getResolved());
 }
@@ -122,24 +143,34 @@ void HD::readSectorsImpl(
 {
 	file.seek(startSector * sizeof(SectorBuffer));
 	file.read(buffers);
+	if (overlay) overlay->read(buffers, startSector);
 }
 
-void HD::writeSectorImpl(size_t sector, const SectorBuffer& buf)
+void HD::writeSectorsImpl(
+	std::span<const SectorBuffer> buffers, size_t startSector)
 {
-	file.seek(sector * sizeof(buf));
-	file.write(buf.raw);
-	tigerTree->notifyChange(sector * sizeof(buf), sizeof(buf),
+	if (overlay) {
+		// The image file doesn't change, so neither does its tiger tree.
+		for (auto [i, buf] : enumerate(buffers)) {
+			overlay->write(startSector + i, buf);
+		}
+		return;
+	}
+	file.seek(startSector * sizeof(SectorBuffer));
+	file.write(buffers);
+	tigerTree->notifyChange(startSector * sizeof(SectorBuffer), buffers.size_bytes(),
 	                        file.getModificationDate());
 }
 
 bool HD::isWriteProtectedImpl() const
 {
+	if (overlay) return false;
 	return file.isReadOnly();
 }
 
 Sha1Sum HD::getSha1SumImpl(FilePool& filePool)
 {
-	if (hasPatches()) {
+	if (hasPatches() || (overlay && overlay->getNbModifiedSectors() != 0)) {
 		return SectorAccessibleDisk::getSha1SumImpl(filePool);
 	}
 	return filePool.getSha1Sum(file, filename.getResolved());
@@ -172,6 +203,39 @@ std::string HD::getTigerTreeHash()
 	return tigerTree->calcHash(callback).toString(); // calls HD::getData()
 }
 
+// The upper part of the tiger tree is stored in a file in the user data
+// directory, so that a large hard disk image doesn't have to be rehashed after
+// every restart. A hash of the image name (plus the size) keeps the name of
+// that file short, the full name is stored (and checked) inside the file.
+std::string HD::getTigerTreeCacheName() const
+{
+	return strCat(FileOperations::getUserDataDir(), "/tthcache/",
+	              hex_string<8>(xxhash(filename.getResolved())), '-', filesize, ".tth");
+}
+
+void HD::loadTigerTreeCache()
+{
+	try {
+		File cache(getTigerTreeCacheName());
+		auto mem = cache.mmap<const uint8_t>();
+		(void)tigerTree->loadPersistent(mem);
+	} catch (MSXException&) {
+		// ignore, the cache is only an optimization
+	}
+}
+
+void HD::saveTigerTreeCache()
+{
+	if (!tigerTree || !tigerTree->needSavePersistent()) return;
+	auto buf = tigerTree->savePersistent();
+	if (buf.empty()) return;
+	try {
+		FileOperations::writeFileAtomically(getTigerTreeCacheName(), std::span{buf});
+	} catch (MSXException&) {
+		// ignore, the cache is only an optimization
+	}
+}
+
 uint8_t* HD::getData(size_t offset, size_t size)
 {
 	assert(size <= TigerTree::BLOCK_SIZE);
@@ -187,7 +251,14 @@ uint8_t* HD::getData(size_t offset, size_t size)
 
 	size_t sector = offset / sizeof(SectorBuffer);
 	size_t num    = size   / sizeof(SectorBuffer);
-	readSectors(std::span{work.bufs.data(), num}, sector); // This possibly applies IPS patches.
+	if (overlay) {
+		// Only hash the (unmodified) image itself, the content of the
+		// overlay is stored separately in the savestate.
+		file.seek(offset);
+		file.read(std::span{work.bufs.data(), num});
+	} else {
+		readSectors(std::span{work.bufs.data(), num}, sector); // This possibly applies IPS patches.
+	}
 	return work.bufs[0].raw.data();
 }
 
@@ -226,6 +297,7 @@ int HD::insertDisk(const std::string& newFilename)
 
 // version 1: initial version
 // version 2: replaced 'checksum'(=sha1) with 'tthsum`
+// version 3: added (optional) copy-on-write 'overlay'
 template<typename Archive>
 void HD::serialize(Archive& ar, unsigned version)
 {
@@ -257,6 +329,12 @@ void HD::serialize(Archive& ar, unsigned version)
 		}
 	}
 
+	// Whether there's an overlay is determined by the config, so it's
+	// the same when saving and loading.
+	if (overlay && ar.versionAtLeast(version, 3)) {
+		ar.serialize("overlay", *overlay);
+	}
+
 	// store/check checksum
 	if (file.is_open()) {
 		bool mismatch = false;
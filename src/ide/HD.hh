@@ -8,6 +8,7 @@
 #include "Filename.hh"
 #include "MSXMotherBoard.hh"
 #include "SectorAccessibleDisk.hh"
+#include "SectorOverlay.hh"
 #include "serialize_meta.hh"
 
 #include "TigerTree.hh"
@@ -51,7 +52,8 @@ private:
 	// SectorAccessibleDisk:
 	void readSectorsImpl(
 		std::span<SectorBuffer> buffers, size_t startSector) override;
-	void writeSectorImpl(size_t sector, const SectorBuffer& buf) override;
+	void writeSectorsImpl(
+		std::span<const SectorBuffer> buffers, size_t startSector) override;
 	[[nodiscard]] size_t getNbSectorsImpl() override;
 	[[nodiscard]] bool isWriteProtectedImpl() const override;
 	[[nodiscard]] Sha1Sum getSha1SumImpl(FilePool& filePool) override;
@@ -68,6 +70,10 @@ private:
 
 	void showProgress(size_t position, size_t maxPosition);
 
+	[[nodiscard]] std::string getTigerTreeCacheName() const;
+	void loadTigerTreeCache();
+	void saveTigerTreeCache();
+
 private:
 	MSXMotherBoard& motherBoard;
 	std::string name;
@@ -78,6 +84,10 @@ private:
 	Filename filename;
 	size_t filesize;
 
+	// When engaged, the image file is opened read-only and all writes go
+	// to this copy-on-write layer instead.
+	std::optional<SectorOverlay> overlay;
+
 	std::shared_ptr<HDInUse> hdInUse;
 
 	uint64_t lastProgressTime;
@@ -85,7 +95,7 @@ private:
 };
 
 REGISTER_BASE_CLASS(HD, "HD");
-SERIALIZE_CLASS_VERSION(HD, 2);
+SERIALIZE_CLASS_VERSION(HD, 3);
 
 } // namespace openmsx
 
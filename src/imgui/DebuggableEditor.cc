@@ -21,6 +21,7 @@
 
 #include "enumerate.hh"
 #include "narrow.hh"
+#include "ranges.hh"
 #include "unreachable.hh"
 
 #include "CustomFont.h"
@@ -34,6 +35,7 @@
 #include <cstdio>
 #include <expected>
 #include <span>
+#include <vector>
 
 namespace openmsx {
 
@@ -299,7 +301,10 @@ void DebuggableEditor::drawExport(const Sizes& s, Debuggable& debuggable)
 			  (exportDestination != OUTPUT_FILE || !exportFilename.empty());
 		im::Disabled(!ok, [&]{
 			if (ImGui::Button("Export")) {
-				auto fetch = [&](unsigned address) { return debuggable.read(address); };
+				// read the whole range at once, instead of byte per byte
+				std::vector<uint8_t> data(*end - *begin + 1);
+				debuggable.readBlock(*begin, data);
+				auto fetch = [&](unsigned address) { return data[address - *begin]; };
 				try {
 					auto output = (exportFormatted == EXPORT_FORMATTED)
 						? ((exportFormat == FORMAT_ASCII)
@@ -583,10 +588,15 @@ void DebuggableEditor::drawContents(const Sizes& s, Debuggable& debuggable, unsi
 	auto greyColor = getColor(imColor::TEXT_DISABLED);
 
 	const auto totalLineCount = int((memSize + columns - 1) / columns);
+	std::array<uint8_t, MAX_COLUMNS> lineBuf;
 	im::ListClipper(totalLineCount, -1, s.lineHeight, [&](int line) {
 		auto addr = unsigned(line) * columns;
 		ImGui::StrCat(formatAddr(s, addr), ':');
 
+		// read the whole (visible) line at once
+		auto lineData = subspan(lineBuf, 0, std::min(unsigned(columns), memSize - addr));
+		debuggable.readBlock(addr, lineData);
+
 		auto previewDataTypeSize = DataTypeGetSize(previewDataType);
 		auto inside = [](unsigned a, unsigned start, unsigned size) {
 			return (start <= a) && (a < (start + size));
@@ -655,7 +665,7 @@ void DebuggableEditor::drawContents(const Sizes& s, Debuggable& debuggable, unsi
 					},
 					ImGuiInputTextFlags_CharsHexadecimal);
 			} else {
-				uint8_t b = debuggable.read(addr);
+				uint8_t b = lineData[n];
 				bool changed = drawChanges && (b != snapshot[addr]);
 				bool grey = (b == 0) && greyOutZeroes;
 				im::StyleColor(changed || grey, ImGuiCol_Text, changed ? changedColor : greyColor, [&]{
@@ -707,7 +717,7 @@ void DebuggableEditor::drawContents(const Sizes& s, Debuggable& debuggable, unsi
 							return b;
 						});
 				} else {
-					uint8_t c = debuggable.read(addr);
+					uint8_t c = lineData[n];
 					bool changed = drawChanges && (c != snapshot[addr]);
 					char display = formatAsciiData(c);
 					bool grey = display != char(c);
@@ -1007,9 +1017,14 @@ bool DebuggableEditor::match(Debuggable& debuggable, unsigned memSize, unsigned
 
 void DebuggableEditor::search(const Sizes& s, Debuggable& debuggable, unsigned memSize)
 {
+	assert(searchPattern);
+	// read everything at once, instead of byte per byte for each candidate address
+	std::vector<uint8_t> mem(memSize);
+	debuggable.readBlock(0, mem);
 	std::optional<unsigned> found;
 	auto test = [&](unsigned addr) {
-		if (match(debuggable, memSize, addr)) {
+		if (((addr + searchPattern->size()) <= memSize) &&
+		    std::ranges::equal(*searchPattern, subspan(mem, addr, searchPattern->size()))) {
 			found = addr;
 			return true;
 		}
@@ -464,6 +464,13 @@ void ImGuiDisassembly::paint(MSXMotherBoard* motherBoard)
 								if (ImGui::InvisibleButton("##addrButton", {-FLT_MIN, textSize})) {
 									++cycleLabelsCounter;
 								}
+							} else {
+								// e.g. inside a function: show the offset from the preceding symbol
+								simpleToolTip([&]() -> std::string {
+									auto nearest = symbolManager.lookupNearest(addr16, psSs, slot.seg);
+									if (!nearest) return {};
+									return strCat(nearest->symbol->name, '+', nearest->offset);
+								});
 							}
 						}
 
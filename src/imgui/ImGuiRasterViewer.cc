@@ -13,7 +13,6 @@
 #include "one_of.hh"
 #include "ranges.hh"
 #include "stl.hh"
-#include "subrange_between.hh"
 #include "unreachable.hh"
 
 #include <imgui.h>
@@ -483,8 +482,7 @@ void ImGuiRasterViewer::paintDisplay(MSXMotherBoard& motherBoard)
 			for (const auto* trace : traces) {
 				const auto& traceInfo = getTraceInfoFor(trace->name);
 				if (!traceInfo.enabled) continue;
-				auto subEvents = subrange_between(trace->events, from, to, {}, &Tracer::Event::time);
-				for (const auto& event : subEvents) {
+				for (const auto& event : trace->events.between(from, to)) {
 					auto tt = event.time + frameDuration; // bring event into the 'future' (doesn't change screen position)
 					auto print = [&]{
 						std::array<char, 64> buf;
@@ -521,9 +519,9 @@ void ImGuiRasterViewer::paintDisplay(MSXMotherBoard& motherBoard)
 				    t_it != traces.end()) {
 					const auto& trace = **t_it;
 
-					auto it0 = std::ranges::lower_bound(trace.events, from, {}, &Tracer::Event::time);
+					auto it0 = trace.events.lowerBound(from);
 					if (it0 != trace.events.begin()) --it0;
-					auto it1 = std::ranges::upper_bound(trace.events, to, {}, &Tracer::Event::time);
+					auto it1 = trace.events.upperBound(it0, trace.events.end(), to);
 
 					for (auto it = it0; it != it1; ++it) {
 						bool skip = it->value.visit(overloaded{
@@ -533,9 +531,9 @@ void ImGuiRasterViewer::paintDisplay(MSXMotherBoard& motherBoard)
 							[](std::string_view s) { return s.empty(); }
 						});
 						if (skip) continue;
-						auto mStart = std::max(from, it->time);
+						auto mStart = std::max(from, it.getTime());
 						auto next = it + 1;
-						auto mStop = std::min(to, (next == it1) ? to : next->time);
+						auto mStop = std::min(to, (next == it1) ? to : next.getTime());
 						drawRegion(
 							timeToVdpPos(mStart + frameDuration), timeToVdpPos(mStop + frameDuration),
 							shadeColor, scrnPos, zoom, std::span(allLineWidths.data(), numLines));
@@ -10,7 +10,6 @@
 #include "MSXMotherBoard.hh"
 #include "ReverseManager.hh"
 
-#include "find_closest.h"
 #include "one_of.hh"
 #include "timeline.hh"
 
@@ -18,11 +17,23 @@
 
 #include <algorithm>
 #include <cassert>
+#include <optional>
+#include <utility>
 
 namespace openmsx {
 
 using Traces = std::span<Tracer::Trace*>;
-using Events = std::span<const Tracer::Event>;
+using Events = TraceEvents::Range;
+
+// Like find_closest(), but without loading the event values.
+[[nodiscard]] static std::pair<TraceEvents::Iterator, EmuDuration> findClosest(
+	TraceEvents::Iterator first, TraceEvents::Iterator last, EmuTime time)
+{
+	auto it = TraceEvents::findClosest(first, last, time);
+	if (it == last) return {it, EmuDuration::zero()};
+	auto t = it.getTime();
+	return {it, (t < time) ? (time - t) : (t - time)};
+}
 
 constexpr float splitterWidth = 7.0f; // should be odd
 
@@ -195,8 +206,7 @@ struct DrawCoarse {
 		drawList->AddLine({mouseX, y0}, {mouseX, y1}, colorHover, 2.0f);
 
 		if (!convertor) return;
-		auto [it, _] = find_closest(
-			first, last, convertor->xToTime(mouseX), {}, &Tracer::Event::time);
+		auto [it, _] = findClosest(first, last, convertor->xToTime(mouseX));
 		if (it == last) return;
 		if (it->value.template holds_alternative<std::monostate>()) {
 			++it; // 2nd try
@@ -230,10 +240,9 @@ static void drawEventsVoid(
 		if (!rowHovered) return EmuTime::infinity(); // no highlight
 		const auto& io = ImGui::GetIO();
 		auto mouseX = io.MousePos.x - topLeft.x; // includes scroll offset
-		auto [it, dist] = find_closest(
-			events, convertor.xToTime(mouseX), {}, &Tracer::Event::time);
+		auto [it, dist] = findClosest(events.begin(), events.end(), convertor.xToTime(mouseX));
 		assert(it != events.end());
-		return (dist < convertor.deltaXtoDuration(h5)) ? it->time : EmuTime::infinity();
+		return (dist < convertor.deltaXtoDuration(h5)) ? it.getTime() : EmuTime::infinity();
 	}();
 
 	auto colorNormal = ImGui::GetColorU32(ImGuiCol_PlotHistogram);
@@ -435,6 +444,14 @@ void ImGuiTraceViewer::drawMenuBar(EmuTime minT, EmuDuration totalT, Tracer& tra
 					}
 				});
 		}
+		if (ImGui::MenuItem("Load instruction trace ...")) {
+			manager.openFile->selectFile(
+				"Load instruction trace", "Instruction trace (*.gz){.gz}",
+				[&](const auto& fn) {
+					manager.executeDelayed(makeTclList("debug", "trace", "load", fn));
+				});
+		}
+		simpleToolTip("Load a file recorded with the 'record_instructions' command");
 		if (ImGui::MenuItem("Close")) show = false;
 	});
 	im::Menu("View", [&]{
@@ -801,18 +818,18 @@ void ImGuiTraceViewer::scrollTo(EmuTime time)
 	}
 }
 
-[[nodiscard]] static const Tracer::Event* findStrictlySmaller(const Tracer::Trace& trace, EmuTime time)
+[[nodiscard]] static std::optional<Tracer::Event> findStrictlySmaller(const Tracer::Trace& trace, EmuTime time)
 {
-	auto it = std::ranges::lower_bound(trace.events, time, {}, &Tracer::Event::time);
-	if (it == trace.events.begin()) return nullptr;
-	return std::to_address(it - 1);
+	auto it = trace.events.lowerBound(time);
+	if (it == trace.events.begin()) return {};
+	return *(it - 1);
 }
 
-[[nodiscard]] static const Tracer::Event* findStrictlyBigger(const Tracer::Trace& trace, EmuTime time)
+[[nodiscard]] static std::optional<Tracer::Event> findStrictlyBigger(const Tracer::Trace& trace, EmuTime time)
 {
-	auto it = std::ranges::upper_bound(trace.events, time, {}, &Tracer::Event::time);
-	if (it == trace.events.end()) return nullptr;
-	return std::to_address(it);
+	auto it = trace.events.upperBound(time);
+	if (it == trace.events.end()) return {};
+	return *it;
 }
 
 void ImGuiTraceViewer::gotoPrevNegEdge(EmuTime& selectedTime)
@@ -820,7 +837,7 @@ void ImGuiTraceViewer::gotoPrevNegEdge(EmuTime& selectedTime)
 	if (const auto* trace = getTrace(traces, selectedRow)) {
 		auto time = selectedTime;
 		while (true) {
-			const auto* event = findStrictlySmaller(*trace, time);
+			auto event = findStrictlySmaller(*trace, time);
 			if (!event) return;
 			time = event->time;
 			if (!trace->isBool() || event->value.get_u64() == 0) break;
@@ -835,7 +852,7 @@ void ImGuiTraceViewer::gotoPrevPosEdge(EmuTime& selectedTime)
 	if (const auto* trace = getTrace(traces, selectedRow)) {
 		auto time = selectedTime;
 		while (true) {
-			const auto* event = findStrictlySmaller(*trace, time);
+			auto event = findStrictlySmaller(*trace, time);
 			if (!event) return;
 			time = event->time;
 			if (!trace->isBool() || event->value.get_u64() != 0) break;
@@ -848,7 +865,7 @@ void ImGuiTraceViewer::gotoPrevPosEdge(EmuTime& selectedTime)
 void ImGuiTraceViewer::gotoPrevEdge(EmuTime& selectedTime)
 {
 	if (const auto* trace = getTrace(traces, selectedRow)) {
-		if (const auto* event = findStrictlySmaller(*trace, selectedTime)) {
+		if (auto event = findStrictlySmaller(*trace, selectedTime)) {
 			selectedTime = event->time;
 			scrollTo(event->time);
 		}
@@ -858,7 +875,7 @@ void ImGuiTraceViewer::gotoPrevEdge(EmuTime& selectedTime)
 void ImGuiTraceViewer::gotoNextEdge(EmuTime& selectedTime)
 {
 	if (const auto* trace = getTrace(traces, selectedRow)) {
-		if (const auto* event = findStrictlyBigger(*trace, selectedTime)) {
+		if (auto event = findStrictlyBigger(*trace, selectedTime)) {
 			selectedTime = event->time;
 			scrollTo(event->time);
 		}
@@ -870,7 +887,7 @@ void ImGuiTraceViewer::gotoNextNegEdge(EmuTime& selectedTime)
 	if (const auto* trace = getTrace(traces, selectedRow)) {
 		auto time = selectedTime;
 		while (true) {
-			const auto* event = findStrictlyBigger(*trace, time);
+			auto event = findStrictlyBigger(*trace, time);
 			if (!event) return;
 			time = event->time;
 			if (!trace->isBool() || event->value.get_u64() == 0) break;
@@ -885,7 +902,7 @@ void ImGuiTraceViewer::gotoNextPosEdge(EmuTime& selectedTime)
 	if (const auto* trace = getTrace(traces, selectedRow)) {
 		auto time = selectedTime;
 		while (true) {
-			const auto* event = findStrictlyBigger(*trace, time);
+			auto event = findStrictlyBigger(*trace, time);
 			if (!event) return;
 			time = event->time;
 			if (!trace->isBool() || event->value.get_u64() != 0) break;
@@ -1244,14 +1261,14 @@ void ImGuiTraceViewer::drawRuler(gl::vec2 size, const Convertor& convertor, EmuT
 	}
 }
 
-static EmuTime snapToEvent(EmuTime time, auto convertor, std::span<const Tracer::Event> events)
+static EmuTime snapToEvent(EmuTime time, auto convertor, Events events)
 {
-	auto [it, dist] = find_closest(events, time, {}, &Tracer::Event::time);
+	auto [it, dist] = findClosest(events.begin(), events.end(), time);
 	if (it == events.end()) return time;
 	auto h5 = ImGui::GetFrameHeight() * 0.20f;
-	return (dist < convertor.deltaXtoDuration(h5)) ? it->time : time;
+	return (dist < convertor.deltaXtoDuration(h5)) ? it.getTime() : time;
 }
-static EmuTime snapToEvent(float mouseX, auto convertor, std::span<const Tracer::Event> events)
+static EmuTime snapToEvent(float mouseX, auto convertor, Events events)
 {
 	auto time = convertor.xToTime(mouseX);
 	return snapToEvent(time, convertor, events);
@@ -1328,11 +1345,11 @@ void ImGuiTraceViewer::drawGraphs(float rulerHeight, float rowHeight, int mouseR
 		drawList->PushClipRect(clipMin, clipMax);
 		im::ListClipperID(traces.size(), rowHeight, [&](int row) {
 			const auto& trace = *traces[row];
-			auto it0 = std::ranges::lower_bound(trace.events, viewStartTime, {}, &Tracer::Event::time);
+			auto it0 = trace.events.lowerBound(viewStartTime);
 			if (it0 != trace.events.begin()) --it0;
 			auto graphEndTime = viewStartTime + viewDuration;
-			auto it1 = std::ranges::upper_bound(trace.events, graphEndTime, {}, &Tracer::Event::time);
-			std::span<const Tracer::Event> visibleEvents(it0, it1);
+			auto it1 = trace.events.upperBound(it0, trace.events.end(), graphEndTime);
+			Events visibleEvents(it0, it1);
 
 			bool rowHovered = hovered && (row == mouseRow);
 			if (rowHovered && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
@@ -1432,7 +1449,7 @@ void ImGuiTraceViewer::drawGraphs(float rulerHeight, float rowHeight, int mouseR
 				if (ImGui::MenuItem("Reverse emulation to here")) {
 					auto time = convertor.xToTime(ctxMouseX);
 					if (const auto* trace = getTrace(traces, ctxMouseRow)) {
-						time = snapToEvent(time, convertor, trace->events);
+						time = snapToEvent(time, convertor, Events(trace->events));
 					}
 					manager.executeDelayed(makeTclList("reverse", "goto", time.toDouble()));
 				}
@@ -1519,8 +1536,8 @@ void ImGuiTraceViewer::paintMain(MSXMotherBoard& motherBoard)
 	if (timelineStart || timelineStop) {
 		for (const auto& trace : traces) {
 			if (trace->events.empty()) continue;
-			minT = std::min(minT, trace->events.front().time);
-			maxT = std::max(maxT, trace->events.back().time);
+			minT = std::min(minT, trace->events.getTime(0));
+			maxT = std::max(maxT, trace->events.getTime(trace->events.size() - 1));
 		}
 		if (minT > maxT) minT = maxT;
 	}
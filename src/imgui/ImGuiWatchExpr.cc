@@ -5,6 +5,8 @@
 #include "ImGuiUtils.hh"
 
 #include "CommandException.hh"
+#include "MSXCPUInterface.hh"
+#include "MSXMotherBoard.hh"
 #include "SymbolManager.hh"
 
 #include "narrow.hh"
@@ -54,7 +56,7 @@ void ImGuiWatchExpr::loadLine(std::string_view name, zstring_view value)
 	}
 }
 
-void ImGuiWatchExpr::paint(MSXMotherBoard* /*motherBoard*/)
+void ImGuiWatchExpr::paint(MSXMotherBoard* motherBoard)
 {
 	if (!show) return;
 
@@ -84,7 +86,7 @@ void ImGuiWatchExpr::paint(MSXMotherBoard* /*motherBoard*/)
 				checkSort();
 
 				im::ID_for_range(watches.size(), [&](int row) {
-					drawRow(row);
+					drawRow(row, motherBoard);
 				});
 			});
 		});
@@ -179,23 +181,63 @@ void ImGuiWatchExpr::refreshSymbols()
 {
 	// symbols changed, expression might have used those symbols
 	for (auto& watch : watches) {
-		watch.expression.reset(); // drop cache
+		watch.dropCache();
 	}
 }
 
-std::expected<TclObject, std::string> ImGuiWatchExpr::evalExpr(WatchExpr& watch, Interpreter& interp) const
+// Replace '$sym(name)' by the value of that symbol (so that the expression can
+// be compiled). Returns nullopt when a symbol doesn't exist.
+[[nodiscard]] static std::optional<std::string> substituteSymbols(std::string_view expr, Interpreter& interp)
 {
-	if (watch.exprStr.empty()) return {};
+	static constexpr std::string_view prefix = "$sym(";
+	std::string result;
+	while (true) {
+		auto pos = expr.find(prefix);
+		if (pos == std::string_view::npos) break;
+		auto end = expr.find(')', pos);
+		if (end == std::string_view::npos) return {};
+		try {
+			auto value = TclObject(expr.substr(pos, end + 1 - pos)).eval(interp).getOptionalInt64();
+			if (!value) return {};
+			strAppend(result, expr.substr(0, pos), *value);
+		} catch (CommandException&) {
+			return {};
+		}
+		expr.remove_prefix(end + 1);
+	}
+	result += expr;
+	return result;
+}
+
+void ImGuiWatchExpr::prepareExpr(WatchExpr& watch, Interpreter& interp) const
+{
+	if (watch.expression) return;
 
-	if (!watch.expression) {
-		if (auto addr = symbolManager.parseSymbolOrValue(watch.exprStr)) {
-			// expression is a symbol or an integer -> rewrite
-			watch.expression = TclObject(tmpStrCat("[peek ", *addr, ']'));
-		} else {
-			// keep original expression
-			watch.expression = watch.exprStr;
+	if (auto addr = symbolManager.parseSymbolOrValue(watch.exprStr)) {
+		// expression is a symbol or an integer -> rewrite
+		watch.expression = TclObject(tmpStrCat("[peek ", *addr, ']'));
+	} else {
+		// keep original expression
+		watch.expression = watch.exprStr;
+	}
+
+	// Most watch expressions only read some registers and memory locations,
+	// those don't have to be re-evaluated (via Tcl) every frame. The symbol
+	// values are substituted now, refreshSymbols() drops this cache.
+	watch.compiled.reset();
+	if (!watch.exprStr.empty()) {
+		if (auto str = substituteSymbols(watch.expression->getString(), interp)) {
+			watch.compiled = CompiledCondition::compile(*str);
 		}
 	}
+	watch.value.reset();
+}
+
+std::expected<TclObject, std::string> ImGuiWatchExpr::evalExpr(WatchExpr& watch, Interpreter& interp) const
+{
+	if (watch.exprStr.empty()) return {};
+
+	prepareExpr(watch, interp);
 	assert(watch.expression);
 
 	try {
@@ -205,26 +247,60 @@ std::expected<TclObject, std::string> ImGuiWatchExpr::evalExpr(WatchExpr& watch,
 	}
 }
 
-void ImGuiWatchExpr::drawRow(int row)
+void ImGuiWatchExpr::formatResult(WatchExpr& watch, Interpreter& interp)
 {
-	auto& interp = manager.getInterpreter();
-	auto& watch = watches[row];
-
-	// evaluate 'expression'
-	auto exprVal = evalExpr(watch, interp);
-
-	// format the result
-	std::expected<TclObject, std::string> formatted;
-	if (!watch.format.getString().empty()) {
+	watch.formattedWith = watch.format.getString();
+	const auto& exprVal = watch.exprVal;
+	if (!watch.formattedWith.empty()) {
 		auto frmtCmd = makeTclList("format", watch.format, exprVal ? *exprVal : TclObject("0"));
 		try {
-			formatted = frmtCmd.executeCommand(interp);
+			watch.formatted = frmtCmd.executeCommand(interp);
 		} catch (CommandException& e) {
-			formatted = std::unexpected(e.getMessage());
+			watch.formatted = std::unexpected(e.getMessage());
 		}
 	} else {
-		formatted = exprVal ? *exprVal : TclObject();
+		watch.formatted = exprVal ? *exprVal : TclObject();
 	}
+}
+
+void ImGuiWatchExpr::update(WatchExpr& watch, MSXMotherBoard* motherBoard, Interpreter& interp)
+{
+	prepareExpr(watch, interp);
+	bool formatChanged = watch.format.getString() != watch.formattedWith;
+
+	if (watch.compiled && motherBoard) {
+		auto context = motherBoard->getCPUInterface().getConditionContext();
+		if (!watch.compiled->getInputs().dynamic) {
+			// nothing to do when none of the inputs changed
+			inputBuffer.clear();
+			watch.compiled->readInputs(context, inputBuffer);
+			if (watch.value && !formatChanged && (inputBuffer == watch.inputValues)) return;
+			std::swap(inputBuffer, watch.inputValues);
+		}
+		if (auto v = watch.compiled->evaluateValue(context)) {
+			if ((watch.value == v) && !formatChanged) return;
+			watch.value = v;
+			watch.exprVal = TclObject(*v);
+			formatResult(watch, interp);
+			return;
+		}
+	}
+
+	// evaluate via Tcl, every frame
+	watch.value.reset();
+	watch.exprVal = evalExpr(watch, interp);
+	formatResult(watch, interp);
+}
+
+void ImGuiWatchExpr::drawRow(int row, MSXMotherBoard* motherBoard)
+{
+	auto& interp = manager.getInterpreter();
+	auto& watch = watches[row];
+
+	// evaluate 'expression' and format the result
+	update(watch, motherBoard, interp);
+	const auto& exprVal = watch.exprVal;
+	const auto& formatted = watch.formatted;
 
 	const auto& display = exprVal ? (formatted ? formatted->getString() : exprVal->getString())
 	                              : exprVal.error();
@@ -255,7 +331,7 @@ void ImGuiWatchExpr::drawRow(int row)
 			auto avail = ImGui::GetContentRegionAvail().x;
 			ImGui::SetNextItemWidth(-FLT_MIN);
 			if (ImGui::InputText("##expr", &watch.exprStr)) {
-				watch.expression.reset();
+				watch.dropCache();
 			}
 			tooWideToolTip(avail, watch.exprStr);
 		});
@@ -3,9 +3,13 @@
 
 #include "ImGuiPart.hh"
 
+#include "CompiledCondition.hh"
 #include "TclObject.hh"
 
+#include <cstdint>
 #include <expected>
+#include <memory>
+#include <optional>
 #include <vector>
 
 namespace openmsx {
@@ -31,15 +35,25 @@ public:
 		[[nodiscard]] const auto& getExpression()  const { return exprStr; }
 		[[nodiscard]] const auto& getFormat()      const { return format; }
 		void setDescription(const TclObject& d) { description = d.getString(); }
-		void setExpression (const TclObject& e) { exprStr = e.getString(); expression.reset(); }
+		void setExpression (const TclObject& e) { exprStr = e.getString(); dropCache(); }
 		void setFormat     (const TclObject& f) { format = f.getString(); }
+		void dropCache() { expression.reset(); compiled.reset(); value.reset(); }
 
 		unsigned id = 0;
 		std::string description;
 		std::string exprStr;
 		std::optional<TclObject> expression; // cache, generate from 'expression'
+		std::shared_ptr<const CompiledCondition> compiled; // nullptr if only Tcl can evaluate it
 		TclObject format;
 
+		// Result of the last evaluation, 'value' is only set when it was
+		// evaluated natively (then it's reused while the inputs don't change).
+		std::vector<uint8_t> inputValues;
+		std::optional<int64_t> value;
+		std::expected<TclObject, std::string> exprVal;
+		std::expected<TclObject, std::string> formatted;
+		std::string formattedWith; // the 'format' used for 'formatted'
+
 		static inline unsigned lastId = 0;
 	};
 
@@ -56,7 +70,7 @@ public:
 	[[nodiscard]] auto& getWatchExprs() { return watches; }
 
 private:
-	void drawRow(int row);
+	void drawRow(int row, MSXMotherBoard* motherBoard);
 	void checkSort();
 
 public:
@@ -67,7 +81,11 @@ private:
 
 	std::vector<WatchExpr> watches;
 
+	void prepareExpr(WatchExpr& watch, Interpreter& interp) const;
 	[[nodiscard]] std::expected<TclObject, std::string> evalExpr(WatchExpr& watch, Interpreter& interp) const;
+	void update(WatchExpr& watch, MSXMotherBoard* motherBoard, Interpreter& interp);
+	static void formatResult(WatchExpr& watch, Interpreter& interp);
+	std::vector<uint8_t> inputBuffer; // only used in update()
 
 	int selectedRow = -1;
 
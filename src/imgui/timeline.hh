@@ -4,8 +4,9 @@
 #include <algorithm>
 #include <cmath>
 #include <concepts>
+#include <iterator>
 #include <optional>
-#include <span>
+#include <ranges>
 
 namespace openmsx {
 
@@ -22,6 +23,20 @@ concept TimelineMapper = requires(T c, Time time, float x) {
 	{ c.xToTime(x) } -> std::convertible_to<Time>;
 };
 
+// Customization points, found via ADL. Can be overloaded for iterators that
+// can provide the time more efficiently than via the full event (e.g. when
+// the values are stored separately from the times).
+template<typename It>
+[[nodiscard]] auto timelineTime(const It& it)
+{
+	return it->time;
+}
+template<typename It, typename Time>
+[[nodiscard]] It timelineUpperBound(It first, It last, const Time& time)
+{
+	return std::ranges::upper_bound(first, last, time, {}, [](const auto& e) { return e.time; });
+}
+
 /**
  * Classifies and processes timeline events as either DETAILED or COARSE regions.
  *
@@ -52,7 +67,8 @@ concept TimelineMapper = requires(T c, Time time, float x) {
  * - The binary search allows efficient skipping of dense event clusters
  *
  * @tparam Time       Time type (e.g., int, std::chrono::duration, EmuTime)
- * @tparam Event      Event type (must satisfy HasTime<Event, Time> concept)
+ * @tparam Events     Random access range of events (the value type must satisfy the
+ *                    HasTime<Event, Time> concept)
  * @tparam Mapper     Mapper type (must satisfy TimelineMapper<Mapper, Time> concept)
  * @param events      Sorted list of events (must be sorted by time, ascending)
  * @param endTime     End time of the visible timeline (must be >= last event time)
@@ -60,7 +76,7 @@ concept TimelineMapper = requires(T c, Time time, float x) {
  * @param onDetailed  Callable invoked for detailed events: (float fromX, float toX, const Event&)
  *                    - Called when an event has > threshold pixels of space
  *                    - [fromX, toX) defines the half-open interval in screen space
- * @param onCoarse    Callable invoked for coarse regions: (float fromX, float toX)
+ * @param onCoarse    Callable invoked for coarse regions: (float fromX, float toX, first, last)
  *                    - Called when multiple events are densely packed (spacing <= threshold)
  *                    - Adjacent coarse pixels are automatically merged into single calls
  *                    - [fromX, toX) defines the half-open interval in screen space
@@ -72,19 +88,20 @@ concept TimelineMapper = requires(T c, Time time, float x) {
  * - events must be sorted by time (ascending order)
  * - endTime >= events.back().time (if events not empty)
  */
-template<typename Time, HasTime<Time> Event, TimelineMapper<Time> Mapper>
+template<typename Time, std::ranges::random_access_range Events, TimelineMapper<Time> Mapper>
+	requires HasTime<std::ranges::range_value_t<Events>, Time>
 void processTimeline(
-	std::span<const Event> events,
+	const Events& events,
 	Time endTime,
 	const Mapper& mapper,
-	std::invocable<float, float, const Event&> auto onDetailed,
-	std::invocable<float, float, typename std::span<const Event>::iterator, typename std::span<const Event>::iterator> auto onCoarse,
+	std::invocable<float, float, std::ranges::range_reference_t<const Events>> auto onDetailed,
+	std::invocable<float, float, std::ranges::iterator_t<const Events>, std::ranges::iterator_t<const Events>> auto onCoarse,
 	float threshold = 1.0)
 {
 	if (events.empty()) return;
 
 	std::optional<float> coarseStart; // start of current coarse region
-	decltype(events.begin()) coarseBeginIt;
+	std::ranges::iterator_t<const Events> coarseBeginIt;
 	auto flushCoarse = [&](float endPixel, auto endIt) {
 		if (coarseStart) {
 			onCoarse(*coarseStart, endPixel, coarseBeginIt, endIt);
@@ -94,12 +111,12 @@ void processTimeline(
 	};
 
 	auto currentIt = events.begin();
-	auto currentPixel = mapper.timeToX(currentIt->time);
+	auto currentPixel = mapper.timeToX(timelineTime(currentIt));
 	while (currentIt != events.end()) {
 		// get next time (either next event or endTime)
-		const auto nextIt = std::next(currentIt);
+		const auto nextIt = std::ranges::next(currentIt);
 		const auto nextTimestamp = (nextIt != events.end())
-		                         ? nextIt->time
+		                         ? timelineTime(nextIt)
 		                         : endTime;
 		const auto nextPixel = mapper.timeToX(nextTimestamp);
 		const auto spacing = nextPixel - currentPixel; // event spans [currentPixel, nextPixel)
@@ -124,10 +141,10 @@ void processTimeline(
 			// Find last event at or before the next pixel boundary.
 			// upper_bound gives first event > targetTime, then back up one.
 			// Important: Start from next event to ensure we make progress.
-			if (auto it = std::ranges::upper_bound(nextIt, events.end(), targetTime, {}, &Event::time);
+			if (auto it = timelineUpperBound(nextIt, events.end(), targetTime);
 			    it != nextIt) {
-				currentIt = std::prev(it);
-				currentPixel = mapper.timeToX(currentIt->time);
+				currentIt = std::ranges::prev(it);
+				currentPixel = mapper.timeToX(timelineTime(currentIt));
 			} else {
 				// no more events in this pixel, jump to next event
 				currentIt = nextIt;
@@ -17,6 +17,7 @@
 #include <cstdlib> // for atoi
 #include <memory>
 #include <ranges>
+#include <utility>
 
 // TODO
 // - Improve error handling
@@ -24,6 +25,11 @@
 // - Clean up this mess!
 namespace openmsx {
 
+// The prefetch thread keeps at most this many decoded frames and audio
+// fragments ready (the audio limit corresponds to ~3 seconds at 44.1kHz).
+static constexpr size_t PREFETCH_FRAMES = 16;
+static constexpr size_t PREFETCH_AUDIO = 64;
+
 Frame::Frame(const th_ycbcr_buffer& yuv)
 {
 	unsigned y_size  = yuv[0].height * yuv[0].stride;
@@ -192,6 +198,9 @@ OggReader::OggReader(const std::string& filename, CliComm& cli_)
 	th_setup_free(tsi);
 	th_info_clear(&ti);
 	th_comment_clear(&tc);
+
+	indexThread = std::thread([this, filename] { buildIndex(filename); });
+	prefetchThread = std::thread([this] { prefetchLoop(); });
 }
 
 void OggReader::cleanup()
@@ -218,9 +227,56 @@ void OggReader::cleanup()
 
 OggReader::~OggReader()
 {
+	{
+		std::lock_guard lock(mutex);
+		stopPrefetch = true;
+	}
+	prefetchCond.notify_all();
+	prefetchThread.join();
+
+	stopIndex = true;
+	if (indexThread.joinable()) indexThread.join();
+
 	cleanup();
 }
 
+void OggReader::flushWarnings()
+{
+	// Called from the emulation thread with 'mutex' locked.
+	for (const auto& w : pendingWarnings) {
+		cli.printWarning(w);
+	}
+	pendingWarnings.clear();
+}
+
+bool OggReader::wantPrefetch() const
+{
+	// Stay below the 'sanity check' limit in getFrameNo().
+	auto maxFrames = std::min(PREFETCH_FRAMES, 1uz << granuleShift);
+	return prefetchActive && !endOfStream &&
+	       (frameList.size() < maxFrames) &&
+	       (audioList.size() < PREFETCH_AUDIO);
+}
+
+void OggReader::prefetchLoop()
+{
+	std::unique_lock lock(mutex);
+	while (true) {
+		prefetchCond.wait(lock, [&] { return stopPrefetch || wantPrefetch(); });
+		if (stopPrefetch) return;
+
+		if (!nextPacket()) {
+			endOfStream = true;
+		}
+
+		// Decoding one packet is the unit of work, in between give the
+		// emulation thread the opportunity to take the lock.
+		lock.unlock();
+		std::this_thread::yield();
+		lock.lock();
+	}
+}
+
 /** Vorbis only records the ogg position (in no. of samples) once per ogg
  * page. After seeking we have already decoded some audio before we encounter
  * the exact position we are at. Fixup the positions and discard any unwanted
@@ -236,7 +292,7 @@ void OggReader::vorbisFoundPosition()
 
 	// last is now the first vorbis audio decoded
 	if (last > currentSample) {
-		cli.printWarning("missing part of audio stream");
+		warning("missing part of audio stream");
 	}
 
 	currentSample = std::max(currentSample, vorbisPos);
@@ -393,7 +449,7 @@ void OggReader::readVorbis(ogg_packet* packet)
 			vorbisFoundPosition();
 		} else {
 			if (vorbisPos != size_t(packet->granulepos)) {
-				cli.printWarning(
+				warning(
 					"vorbis audio out of sync, expected ",
 					vorbisPos, ", got ", packet->granulepos);
 				vorbisPos = packet->granulepos;
@@ -514,25 +570,25 @@ void OggReader::readTheora(ogg_packet* packet)
 	switch (rc) {
 	case TH_DUPFRAME:
 		if (frameList.empty()) {
-			cli.printWarning("Theora error: dup frame encountered "
+			warning("Theora error: dup frame encountered "
 					 "without preceding frame");
 		} else {
 			frameList.back()->length++;
 		}
 		break;
 	case TH_EIMPL:
-		cli.printWarning("Theora error: not capable of reading this");
+		warning("Theora error: not capable of reading this");
 		break;
 	case TH_EFAULT:
-		cli.printWarning("Theora error: API not used correctly");
+		warning("Theora error: API not used correctly");
 		break;
 	case TH_EBADPACKET:
-		cli.printWarning("Theora error: bad packet");
+		warning("Theora error: bad packet");
 		break;
 	case 0:
 		break;
 	default:
-		cli.printWarning("Theora error: unknown error ", rc);
+		warning("Theora error: unknown error ", rc);
 		break;
 	}
 
@@ -572,7 +628,7 @@ void OggReader::readTheora(ogg_packet* packet)
 	Frame* last = frameList.empty() ? nullptr : frameList.back().get();
 	if (last && (last->no != size_t(-1))) {
 		if (frameno != one_of(size_t(-1), last->no + last->length)) {
-			cli.printWarning("Theora frame sequence wrong");
+			warning("Theora frame sequence wrong");
 		} else {
 			frameno = last->no + last->length;
 		}
@@ -597,6 +653,7 @@ void OggReader::readTheora(ogg_packet* packet)
 
 void OggReader::getFrameNo(RawFrame& rawFrame, size_t frameno)
 {
+	std::unique_lock lock(mutex);
 	Frame* frame;
 	while (true) {
 		// If there are no frames or the frames we have read
@@ -604,6 +661,7 @@ void OggReader::getFrameNo(RawFrame& rawFrame, size_t frameno)
 		// more data
 		if (frameList.empty() || (frameList[0]->no == size_t(-1))) {
 			if (!nextPacket()) {
+				flushWarnings();
 				return;
 			}
 			continue;
@@ -619,7 +677,7 @@ void OggReader::getFrameNo(RawFrame& rawFrame, size_t frameno)
 		if (!frameList.empty() && frameList[0]->no > frameno) {
 			// we're missing frames!
 			frame = frameList[0].get();
-			cli.printWarning(
+			warning(
 					"Cannot find frame ", frameno, " using ",
 			        frame->no, " instead");
 			break;
@@ -643,16 +701,24 @@ void OggReader::getFrameNo(RawFrame& rawFrame, size_t frameno)
 		if (frameList.size() > (2uz << granuleShift)) {
 			// We've got more than twice as many frames
 			// as the maximum distance between key frames.
-			cli.printWarning("Cannot find frame ", frameno);
+			warning("Cannot find frame ", frameno);
+			flushWarnings();
 			return;
 		}
 
 		// ..add read some new ones
 		if (!nextPacket()) {
+			flushWarnings();
 			return;
 		}
 	}
+	flushWarnings();
+	lock.unlock();
+	prefetchCond.notify_one();
 
+	// The prefetch thread never modifies the pixel data of a frame that
+	// is in 'frameList', and only this thread removes frames from that
+	// list. So the conversion can run in parallel with the prefetching.
 	yuv2rgb::convert(frame->buffer, rawFrame);
 }
 
@@ -663,6 +729,17 @@ void OggReader::recycleAudio(std::unique_ptr<AudioFragment> audio)
 }
 
 const AudioFragment* OggReader::getAudio(size_t sample)
+{
+	// The returned fragment remains valid (and unmodified) until the next
+	// call to getAudio() or seek(), see also getFrameNo().
+	std::lock_guard lock(mutex);
+	auto result = getAudioImpl(sample);
+	flushWarnings();
+	prefetchCond.notify_one();
+	return result;
+}
+
+const AudioFragment* OggReader::getAudioImpl(size_t sample)
 {
 	// Read while position is unknown
 	while (audioList.empty() ||
@@ -736,14 +813,14 @@ bool OggReader::nextPacket()
 		int serial = ogg_page_serialno(&page);
 		if (serial == audioSerial) {
 			if (ogg_stream_pagein(&vorbisStream, &page)) {
-				cli.printWarning("Failed to submit vorbis page");
+				warning("Failed to submit vorbis page");
 			}
 		} else if (serial == videoSerial) {
 			if (ogg_stream_pagein(&theoraStream, &page)) {
-				cli.printWarning("Failed to submit theora page");
+				warning("Failed to submit theora page");
 			}
 		} else if (serial != skeletonSerial) {
-			cli.printWarning("Unexpected stream with serial ",
+			warning("Unexpected stream with serial ",
 			                 serial, " in ogg file");
 		}
 	}
@@ -774,7 +851,7 @@ bool OggReader::nextPage(ogg_page* page)
 		fileOffset += chunk;
 
 		if (ogg_sync_wrote(&sync, long(chunk)) == -1) {
-			cli.printWarning("Internal error: ogg_sync_wrote failed");
+			warning("Internal error: ogg_sync_wrote failed");
 		}
 	}
 
@@ -847,6 +924,15 @@ size_t OggReader::findOffset(size_t frame, size_t sample)
 	// we assume that only data will be added to it and the ogg streams
 	// are exactly as before
 	fileSize = file.getSize();
+
+	// Wait till the index is complete (only the first seek has to wait).
+	// Otherwise the method used, and thus the exact start offset, would
+	// depend on how far the index thread got, and the emulation would no
+	// longer be deterministic.
+	if (indexThread.joinable()) indexThread.join();
+	if (indexReady && (fileSize == indexFileSize)) {
+		return findOffsetIndexed(frame, sample);
+	}
 	auto offset = fileSize - 1;
 
 	while (offset > 0) {
@@ -917,8 +1003,116 @@ size_t OggReader::findOffset(size_t frame, size_t sample)
 	return bisection(keyFrame, sample, maxOffset, maxSamples, maxFrames);
 }
 
+size_t OggReader::findOffsetIndexed(size_t frame, size_t sample)
+{
+	// Like the bisection based search below, but found with a few binary
+	// searches in the page index. The returned offset is usually not the
+	// same as the one bisection() finds (both are at or before the
+	// required key frame and audio page). Only one of both methods is
+	// ever used for a given file, see findOffset().
+	totalFrames = videoIndex.back().lastFrame;
+
+	if (sample < getSampleRate() || frame <= 30) {
+		keyFrame = 1;
+		return 0;
+	}
+
+	auto maxSamples = audioIndex.back().sample;
+	if ((sample > maxSamples) || (frame > totalFrames)) {
+		sample = maxSamples;
+		frame = totalFrames;
+	}
+
+	// Key frame: taken from the first page that completes a frame at or
+	// after the requested one. If a new key frame starts between those
+	// two frames, the previous page still belongs to the right group.
+	auto v = std::ranges::lower_bound(videoIndex, frame, {}, &VideoPage::lastFrame);
+	if (v == videoIndex.end()) --v;
+	keyFrame = v->keyFrame;
+	if ((keyFrame > frame) && (v != videoIndex.begin())) {
+		keyFrame = std::prev(v)->keyFrame;
+	}
+
+	// Start reading at the page that completes the frame before the key
+	// frame, the key frame packet may already start in that page.
+	auto k = std::ranges::lower_bound(videoIndex, keyFrame, {}, &VideoPage::lastFrame);
+	size_t videoOffset = (k == videoIndex.begin()) ? 0 : std::prev(k)->offset;
+
+	// Vorbis needs the preceding packet to decode a packet, so start two
+	// pages before the page that contains the requested sample.
+	auto a = std::ranges::lower_bound(audioIndex, sample, {}, &AudioPage::sample);
+	auto n = std::distance(audioIndex.begin(), a);
+	size_t audioOffset = (n < 2) ? 0 : audioIndex[n - 2].offset;
+
+	return std::min(videoOffset, audioOffset);
+}
+
+void OggReader::buildIndex(const std::string& filename)
+{
+	// Runs on 'indexThread'. Uses its own file handle and Ogg sync state,
+	// the other members it reads (the stream serial numbers and
+	// 'granuleShift') don't change anymore after the constructor.
+	static constexpr size_t CHUNK = 65536;
+	try {
+		File indexFile(filename);
+		auto size = indexFile.getSize();
+
+		ogg_sync_state indexSync;
+		ogg_sync_init(&indexSync);
+		size_t readOffset = 0; // next byte to pass to 'indexSync'
+		size_t pageOffset = 0; // file offset of the next page
+		ogg_page page;
+		while (!stopIndex) {
+			long ret = ogg_sync_pageseek(&indexSync, &page);
+			if (ret > 0) {
+				auto granule = ogg_page_granulepos(&page);
+				if (granule != -1) {
+					int serial = ogg_page_serialno(&page);
+					if (serial == videoSerial) {
+						size_t intra = granule & ((1uz << granuleShift) - 1);
+						size_t key = granule >> granuleShift;
+						videoIndex.push_back(VideoPage{
+							.offset = pageOffset,
+							.keyFrame = key,
+							.lastFrame = key + intra});
+					} else if (serial == audioSerial) {
+						audioIndex.push_back(AudioPage{
+							.offset = pageOffset,
+							.sample = size_t(granule)});
+					}
+				}
+				pageOffset += ret;
+			} else if (ret < 0) {
+				// skipped garbage
+				pageOffset += -ret;
+			} else {
+				if (readOffset >= size) break;
+				auto chunk = std::min(CHUNK, size - readOffset);
+				char* buffer = ogg_sync_buffer(&indexSync, long(chunk));
+				indexFile.read(std::span{buffer, chunk});
+				ogg_sync_wrote(&indexSync, long(chunk));
+				readOffset += chunk;
+			}
+		}
+		ogg_sync_clear(&indexSync);
+
+		if (stopIndex || videoIndex.empty() || audioIndex.empty() ||
+		    !std::ranges::is_sorted(videoIndex, {}, &VideoPage::lastFrame) ||
+		    !std::ranges::is_sorted(audioIndex, {}, &AudioPage::sample)) {
+			// can't use the index, keep on bisecting
+			return;
+		}
+		indexFileSize = size;
+		indexReady = true;
+	} catch (MSXException&) {
+		// idem
+	}
+}
+
 bool OggReader::seek(size_t frame, size_t samples)
 {
+	std::unique_lock lock(mutex);
+
 	// Remove all queued frames
 	recycleFrameList.insert(end(recycleFrameList),
 		std::move_iterator(begin(frameList)),
@@ -945,6 +1139,12 @@ bool OggReader::seek(size_t frame, size_t samples)
 
 	vorbis_synthesis_restart(&vd);
 
+	prefetchActive = true;
+	endOfStream = false;
+	flushWarnings();
+	lock.unlock();
+	prefetchCond.notify_one();
+
 	return true;
 }
 
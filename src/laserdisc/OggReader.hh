@@ -5,16 +5,21 @@
 
 #include "circular_buffer.hh"
 #include "narrow.hh"
+#include "strCat.hh"
 
 #include <ogg/ogg.h>
 #include <theora/theoradec.h>
 #include <vorbis/codec.h>
 
 #include <array>
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace openmsx {
@@ -45,6 +50,21 @@ struct Frame
 	int length;
 };
 
+/** Reads and decodes a Theora/Vorbis Ogg file for the LaserdiscPlayer.
+  *
+  * Two helper threads take work away from the emulation thread:
+  *  - The prefetch thread decodes packets ahead of the current play
+  *    position into (bounded) frame and audio queues. getFrameNo() and
+  *    getAudio() mostly find their data already decoded. The result of
+  *    these methods does not depend on how far the prefetching has
+  *    progressed.
+  *  - The index thread scans the file once (only the Ogg page headers,
+  *    nothing is decoded) and records the position of all audio and video
+  *    pages. The first seek() waits till that index is complete, then
+  *    all seeks look up the required file offset instead of bisecting
+  *    through the file. Waiting keeps the result independent of the
+  *    timing of the index thread.
+  */
 class OggReader
 {
 public:
@@ -68,6 +88,14 @@ public:
 
 private:
 	void cleanup();
+	template<typename... Args> void warning(Args&&... args) {
+		pendingWarnings.push_back(strCat(std::forward<Args>(args)...));
+	}
+	void flushWarnings();
+	void prefetchLoop();
+	[[nodiscard]] bool wantPrefetch() const;
+	void buildIndex(const std::string& filename);
+	[[nodiscard]] size_t findOffsetIndexed(size_t frame, size_t sample);
 	void readTheora(ogg_packet* packet);
 	void theoraHeaderPage(ogg_page* page, th_info& ti, th_comment& tc,
 	                      th_setup_info*& tsi);
@@ -77,6 +105,7 @@ private:
 	bool nextPage(ogg_page* page);
 	bool nextPacket();
 	void recycleAudio(std::unique_ptr<AudioFragment> audio);
+	[[nodiscard]] const AudioFragment* getAudioImpl(size_t sample);
 	void vorbisFoundPosition();
 	size_t frameNo(const ogg_packet* packet) const;
 
@@ -134,6 +163,35 @@ private:
 		size_t frame;
 	};
 	std::vector<ChapterFrame> chapters; // sorted on chapter
+
+	// All decoder state above (except the metadata) is shared between
+	// the emulation thread and the prefetch thread and protected by
+	// 'mutex'.
+	std::mutex mutex;
+	std::condition_variable prefetchCond;
+	std::vector<std::string> pendingWarnings; // printed from the emulation thread
+	bool prefetchActive{false}; // only after the first seek()
+	bool endOfStream{false};
+	bool stopPrefetch{false};
+	std::thread prefetchThread;
+
+	// Page index, written by 'indexThread', only read (by the emulation
+	// thread) after that thread was joined and if 'indexReady' is true.
+	struct VideoPage {
+		size_t offset;    // file offset of the page
+		size_t keyFrame;  // key frame of the last packet in this page
+		size_t lastFrame; // frame number of the last packet in this page
+	};
+	struct AudioPage {
+		size_t offset;    // file offset of the page
+		size_t sample;    // sample position at the end of this page
+	};
+	std::vector<VideoPage> videoIndex; // sorted on offset and on lastFrame
+	std::vector<AudioPage> audioIndex; // sorted on offset and on sample
+	size_t indexFileSize{0};
+	bool indexReady{false};
+	std::atomic<bool> stopIndex{false};
+	std::thread indexThread;
 };
 
 } // namespace openmsx
@@ -108,6 +108,12 @@ void RamDebuggable::write(unsigned address, uint8_t value)
 	*debugWrite = true; // for TrackedRam
 }
 
+void RamDebuggable::writeBlock(unsigned start, std::span<const uint8_t> input)
+{
+	copy_to_range(input, std::span{ram}.subspan(start, input.size()));
+	*debugWrite = true; // for TrackedRam
+}
+
 
 template<typename Archive>
 void Ram::serialize(Archive& ar, unsigned /*version*/)
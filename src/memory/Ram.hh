@@ -24,6 +24,7 @@ public:
 	uint8_t read(unsigned address) override;
 	void write(unsigned address, uint8_t value) override;
 	void readBlock(unsigned start, std::span<uint8_t> output) override;
+	void writeBlock(unsigned start, std::span<const uint8_t> input) override;
 private:
 	Ram& ram;
 	bool* debugWrite;
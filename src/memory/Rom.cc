@@ -5,6 +5,7 @@
 #include "Debugger.hh"
 #include "DeviceConfig.hh"
 #include "EmptyPatch.hh"
+#include "File.hh"
 #include "FileContext.hh"
 #include "FileException.hh"
 #include "FilePool.hh"
@@ -26,10 +27,31 @@
 #include "stl.hh"
 
 #include <algorithm>
+#include <bit>
+#include <map>
 #include <memory>
+#include <vector>
 
 namespace openmsx {
 
+class Rom::Image
+{
+public:
+	// For a compressed file, 'mmap' points into the decompressed data which
+	// is owned by the (shared) File object. Both are released once patched.
+	File file;
+	MappedFile<const uint8_t> mmap;
+	MemBuffer<uint8_t> patched;
+
+	std::span<const uint8_t> data;
+	std::string originalName;
+	Sha1Sum actualSha1; // only when patched
+};
+
+// All images, keyed on the sha1sum of the ROM file (combined with the sha1sums
+// of the patch files, if any).
+static std::map<Sha1Sum, std::weak_ptr<const Rom::Image>> sharedImages;
+
 class RomDebuggable final : public Debuggable
 {
 public:
@@ -117,6 +139,7 @@ void Rom::init(MSXMotherBoard& motherBoard, XMLElement& config,
 	} else if (resolvedFilenameElem || resolvedSha1Elem ||
 	           !std::ranges::empty(sums) || !std::ranges::empty(filenames)) {
 		auto& filePool = motherBoard.getReactor().getFilePool();
+		File file;
 		// first try already resolved filename ..
 		if (resolvedFilenameElem) {
 			try {
@@ -190,19 +213,20 @@ void Rom::init(MSXMotherBoard& motherBoard, XMLElement& config,
 				"inside a <rom> section are no longer "
 				"supported.");
 		}
-		try {
-			mmap = file.mmap<uint8_t>();
-			rom = *mmap;
-		} catch (FileException&) {
-			throw MSXException("Error reading ROM image: ", filename);
-		}
-
 		// For file-based roms, calc sha1 via File::getSha1Sum(). It can
 		// possibly use the FilePool cache to avoid the calculation.
 		if (originalSha1.empty()) {
-			originalSha1 = filePool.getSha1Sum(file, filename);
+			try {
+				originalSha1 = filePool.getSha1Sum(file, filename);
+			} catch (FileException&) {
+				throw MSXException("Error reading ROM image: ", filename);
+			}
 		}
 
+		image = getImage(file, config.findChild("patches"), context, filePool);
+		rom = image->data;
+		actualSha1 = image->actualSha1;
+
 		// verify SHA1
 		if (!checkSHA1(config)) {
 			motherBoard.getMSXCliComm().printWarning(
@@ -228,28 +252,21 @@ void Rom::init(MSXMotherBoard& motherBoard, XMLElement& config,
 		checkResolvedSha1 = false;
 	}
 
-	if (!rom.empty()) {
+	// (Patches for file-based roms are already applied in getImage().)
+	if (!rom.empty() && !image) {
 		if (const auto* patchesElem = config.findChild("patches")) {
 			// calculate before content is altered
 			(void)getOriginalSHA1(); // fills cache
 
-			std::unique_ptr<PatchInterface> patch =
-				std::make_unique<EmptyPatch>(rom);
-
+			// Never patch in place: 'rom' can point into a shared,
+			// read-only image (e.g. for a Panasonic firstblock/lastblock
+			// ROM, see PanasonicMemory::getRomRange()).
+			std::vector<Filename> patchFiles;
 			for (const auto* p : patchesElem->getChildren("ips")) {
-				patch = std::make_unique<IPSPatch>(
-					Filename(p->getData(), context),
-					std::move(patch));
-			}
-			auto patchSize = patch->getSize();
-			if (patchSize <= rom.size()) {
-				patch->copyBlock(0, std::span{const_cast<uint8_t*>(rom.data()), rom.size()});
-			} else {
-				MemBuffer<uint8_t> extendedRom2(patchSize);
-				patch->copyBlock(0, std::span{extendedRom2});
-				extendedRom = std::move(extendedRom2);
-				rom = std::span{extendedRom};
+				patchFiles.emplace_back(p->getData(), context);
 			}
+			extendedRom = applyPatches(rom, std::move(patchFiles));
+			rom = std::span{extendedRom};
 
 			// calculated because it's different from original
 			actualSha1 = SHA1::calc(rom);
@@ -271,7 +288,7 @@ void Rom::init(MSXMotherBoard& motherBoard, XMLElement& config,
 			name = title;
 		} else {
 			// unknown ROM, use file name
-			name = file.getOriginalName();
+			if (image) name = image->originalName;
 			if (name.empty()) name = filename;
 		}
 	}
@@ -294,7 +311,7 @@ void Rom::init(MSXMotherBoard& motherBoard, XMLElement& config,
 		const auto* actualSha1Elem = doc.getOrCreateChild(
 			config, "resolvedSha1", doc.allocateString(patchedSha1Str));
 		if (actualSha1Elem->getData() != patchedSha1Str) {
-			const auto& tmp = file.is_open() ? filename : name;
+			const auto& tmp = !filename.empty() ? filename : name;
 			// can only happen in case of loadstate
 			motherBoard.getMSXCliComm().printWarning(
 				"The content of the rom ", tmp, " has "
@@ -324,6 +341,75 @@ void Rom::init(MSXMotherBoard& motherBoard, XMLElement& config,
 	}
 }
 
+std::shared_ptr<const Rom::Image> Rom::getImage(
+	File& file, const XMLElement* patchesElem,
+	const FileContext& context, FilePool& filePool)
+{
+	// Key on the content of the ROM file and of all patch files.
+	Sha1Sum key = originalSha1;
+	std::vector<Filename> patchFiles;
+	if (patchesElem) {
+		SHA1 keySha1;
+		auto addToKey = [&](const Sha1Sum& sum) {
+			std::array<char, 40> buf;
+			sum.toBuffer(buf);
+			keySha1.update(std::span{std::bit_cast<const uint8_t*>(buf.data()), buf.size()});
+		};
+		addToKey(originalSha1);
+		for (const auto* p : patchesElem->getChildren("ips")) {
+			const auto& patchFile = patchFiles.emplace_back(p->getData(), context);
+			if (auto patchSha1 = filePool.getSha1Sum(patchFile.getResolved())) {
+				addToKey(*patchSha1);
+			} else {
+				key.clear(); // don't share, IPSPatch reports the error
+			}
+		}
+		if (!key.empty()) key = keySha1.digest();
+	}
+	if (!key.empty()) {
+		if (auto it = sharedImages.find(key); it != sharedImages.end()) {
+			if (auto result = it->second.lock()) return result;
+		}
+	}
+
+	auto result = std::make_shared<Image>();
+	try {
+		result->mmap = file.mmap<const uint8_t>();
+		result->originalName = file.getOriginalName();
+	} catch (FileException&) {
+		throw MSXException("Error reading ROM image: ", filename);
+	}
+	result->data = std::span{result->mmap.data(), result->mmap.size()};
+	result->file = std::move(file);
+
+	if (!patchFiles.empty() && !result->data.empty()) {
+		result->patched = applyPatches(result->data, std::move(patchFiles));
+		result->data = std::span{result->patched};
+		result->mmap = {};
+		result->file.close();
+
+		// calculated because it's different from original
+		result->actualSha1 = SHA1::calc(result->data);
+	}
+
+	if (!key.empty()) {
+		std::erase_if(sharedImages, [](const auto& p) { return p.second.expired(); });
+		sharedImages.insert_or_assign(key, result);
+	}
+	return result;
+}
+
+MemBuffer<uint8_t> Rom::applyPatches(std::span<const uint8_t> rom, std::vector<Filename> patchFiles)
+{
+	std::unique_ptr<PatchInterface> patch = std::make_unique<EmptyPatch>(rom);
+	for (auto& patchFile : patchFiles) {
+		patch = std::make_unique<IPSPatch>(std::move(patchFile), std::move(patch));
+	}
+	MemBuffer<uint8_t> result(std::max(rom.size(), patch->getSize()));
+	patch->copyBlock(0, std::span{result});
+	return result;
+}
+
 bool Rom::checkSHA1(const XMLElement& config) const
 {
 	auto sums = config.getChildren("sha1");
@@ -335,9 +421,8 @@ bool Rom::checkSHA1(const XMLElement& config) const
 Rom::Rom(Rom&& r) noexcept
 	: rom          (r.rom)
 	, extendedRom  (std::move(r.extendedRom))
-	, file         (std::move(r.file))
 	, filename     (std::move(r.filename))
-	, mmap         (std::move(r.mmap))
+	, image        (std::move(r.image))
 	, originalSha1 (r.originalSha1)
 	, actualSha1   (r.actualSha1)
 	, name         (std::move(r.name))
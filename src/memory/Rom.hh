@@ -1,8 +1,6 @@
 #ifndef ROM_HH
 #define ROM_HH
 
-#include "File.hh"
-
 #include "MemBuffer.hh"
 #include "sha1.hh"
 #include "static_string_view.hh"
@@ -10,17 +8,20 @@
 #include <cassert>
 #include <cstdint>
 #include <memory>
-#include <optional>
 #include <span>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace openmsx {
 
 class MSXMotherBoard;
 class XMLElement;
 class DeviceConfig;
+class File;
 class FileContext;
+class Filename;
+class FilePool;
 class RomDebuggable;
 class TclObject;
 
@@ -53,9 +54,23 @@ public:
 	 */
 	void getInfo(TclObject& result) const;
 
+	/** The (read-only) content of a file-based ROM, possibly patched.
+	  * Shared by all Rom objects, of all machines, with the same content. */
+	class Image;
+
+	/** Apply the given IPS patches on top of 'rom'. The result is always a
+	  * new buffer, 'rom' itself is left untouched: it may be read-only or
+	  * shared (e.g. a range of a Panasonic ROM, or a shared Image).
+	  */
+	[[nodiscard]] static MemBuffer<uint8_t> applyPatches(
+		std::span<const uint8_t> rom, std::vector<Filename> patchFiles);
+
 private:
 	void init(MSXMotherBoard& motherBoard, XMLElement& config,
 	          const FileContext& context);
+	[[nodiscard]] std::shared_ptr<const Image> getImage(
+		File& file, const XMLElement* patchesElem,
+		const FileContext& context, FilePool& filePool);
 	[[nodiscard]] bool checkSHA1(const XMLElement& config) const;
 
 private:
@@ -63,9 +78,8 @@ private:
 	std::span<const uint8_t> rom;
 	MemBuffer<uint8_t> extendedRom;
 
-	File file; // can be a closed file
-	std::string filename;
-	std::optional<MappedFile<uint8_t>> mmap; // non-const to allow patching
+	std::string filename; // empty if not a file-based ROM
+	std::shared_ptr<const Image> image; // only for file-based ROMs
 
 	mutable Sha1Sum originalSha1;
 	mutable Sha1Sum actualSha1;
@@ -3,7 +3,9 @@
 #include "CliComm.hh"
 #include "File.hh"
 #include "FileContext.hh"
+#include "FileOperations.hh"
 #include "MSXException.hh"
+#include "Version.hh"
 
 #include "String32.hh"
 #include "StringOp.hh"
@@ -13,13 +15,18 @@
 #include "rapidsax.hh"
 #include "stl.hh"
 #include "unreachable.hh"
+#include "xrange.hh"
 #include "xxhash.hh"
 
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstring>
 #include <ranges>
+#include <span>
 #include <string_view>
+#include <type_traits>
+#include <vector>
 
 namespace openmsx {
 
@@ -643,7 +650,74 @@ static void parseDB(CliComm& cliComm, char* buf, char* bufStart,
 	}
 }
 
+// Layout of the precompiled database:
+// - header
+// - signature (see getSignature())
+// - 'numEntries' x ImageEntry, sorted on sha1sum
+// - string pool, all strings are zero-terminated, offset 0 is the empty string
+// The records are written field by field (there are no uninitialized padding
+// bytes in the file). The string offsets are the String32 values, so this only
+// works when String32 is an offset (and not a pointer). Values are stored in
+// host byte order, an image from a host with a different byte order is
+// rejected because the version doesn't match.
+struct ImageHeader {
+	std::array<char, 8> magic;
+	uint32_t version;
+	uint32_t entrySize;
+	uint32_t signatureSize;
+	uint32_t numEntries;
+	uint32_t stringsSize;
+	uint32_t padding = 0;
+};
+static_assert(sizeof(ImageHeader) == 32);
+struct ImageEntry {
+	Sha1Sum sha1;
+	std::array<uint32_t, 6> strings; // title, year, company, country, origType, remark
+	uint32_t genMSXid;
+	uint8_t romType;
+	uint8_t original;
+	std::array<uint8_t, 2> padding = {};
+};
+static_assert(sizeof(ImageEntry) == 52);
+static_assert(std::has_unique_object_representations_v<ImageEntry>);
+static constexpr std::array<char, 8> IMAGE_MAGIC = {'o', 'M', 'S', 'X', 's', 'w', 'd', 'b'};
+static constexpr uint32_t IMAGE_VERSION = 2;
+static constexpr bool IMAGE_SUPPORTED = std::is_same_v<String32, uint32_t>;
+
+// Identifies the inputs of the precompiled database: when a softwaredb.xml
+// file is added, removed or modified, or when openMSX is upgraded (e.g. the
+// list of mapper types changed), the signature changes.
+[[nodiscard]] static std::string getSignature()
+{
+	std::string result = strCat(Version::full(), '\n');
+	for (const auto& p : systemFileContext().getPaths()) {
+		auto filename = p + "/softwaredb.xml";
+		strAppend(result, filename);
+		if (auto st = FileOperations::getStat(filename)) {
+			strAppend(result, ' ', st->st_size, ' ', FileOperations::getModificationDate(*st));
+		}
+		result += '\n';
+	}
+	return result;
+}
+
 RomDatabase::RomDatabase(CliComm& cliComm)
+{
+	auto signature = getSignature();
+	auto imageName = FileOperations::getUserDataDir() + "/.softwaredb.cache";
+	if (!loadImage(imageName, signature)) {
+		parseXML(cliComm);
+		compact();
+		if (!db.empty()) saveImage(imageName, signature);
+	}
+	if (db.empty()) {
+		cliComm.printWarning(
+			"Couldn't load software database.\n"
+			"This may cause incorrect ROM mapper types to be used.");
+	}
+}
+
+void RomDatabase::parseXML(CliComm& cliComm)
 {
 	db.reserve(3500);
 	UnknownTypes unknownTypes;
@@ -680,11 +754,7 @@ RomDatabase::RomDatabase(CliComm& cliComm)
 		}
 	}
 	if (bufferSize) buffer[0] = 0;
-	if (db.empty()) {
-		cliComm.printWarning(
-			"Couldn't load software database.\n"
-			"This may cause incorrect ROM mapper types to be used.");
-	}
+	bufferStart = buffer.data();
 	if (!unknownTypes.empty()) {
 		std::string output = "Unknown mapper types in software database: ";
 		for (const auto& [type, count] : unknownTypes) {
@@ -694,6 +764,150 @@ RomDatabase::RomDatabase(CliComm& cliComm)
 	}
 }
 
+// The XML buffer is large and mostly contains markup. Replace it with a pool
+// that only contains the (deduplicated) strings that are actually used.
+void RomDatabase::compact()
+{
+	const char* oldBuf = buffer.data();
+	std::string strings(1, '\0'); // offset 0: empty string
+	hash_map<std::string_view, uint32_t, XXHasher> interned;
+	auto intern = [&](std::string_view str) -> uint32_t {
+		if (str.empty()) return 0;
+		auto [it, inserted] = interned.try_emplace(str, narrow<uint32_t>(strings.size()));
+		if (inserted) {
+			strings += str;
+			strings += '\0';
+		}
+		return it->second;
+	};
+	std::vector<std::array<uint32_t, 6>> offsets;
+	offsets.reserve(db.size());
+	for (const auto& [sha1, info] : db) {
+		offsets.push_back({intern(info.getTitle(oldBuf)), intern(info.getYear(oldBuf)),
+		                   intern(info.getCompany(oldBuf)), intern(info.getCountry(oldBuf)),
+		                   intern(info.getOrigType(oldBuf)), intern(info.getRemark(oldBuf))});
+	}
+
+	MemBuffer<char> newBuffer(strings.size());
+	copy_to_range(strings, newBuffer);
+	const char* newBuf = newBuffer.data();
+	auto str32 = [&](uint32_t offset) {
+		String32 result;
+		toString32(newBuf, newBuf + offset, result);
+		return result;
+	};
+	for (auto i : xrange(db.size())) {
+		auto& info = db[i].romInfo;
+		const auto& o = offsets[i];
+		info = RomInfo(str32(o[0]), str32(o[1]), str32(o[2]), str32(o[3]),
+		               info.getOriginal(), str32(o[4]), str32(o[5]),
+		               info.getRomType(), info.getGenMSXid());
+	}
+	buffer = std::move(newBuffer);
+	bufferStart = buffer.data();
+}
+
+// Returns false when there's no image, or when it's outdated or corrupt.
+bool RomDatabase::loadImage(const std::string& filename, std::string_view signature)
+{
+	if (!IMAGE_SUPPORTED) return false;
+	try {
+		File file(filename);
+		if (file.getSize() < sizeof(ImageHeader)) return false;
+		auto mem = file.mmap<const char>();
+		std::span<const char> data{mem.data(), mem.size()};
+
+		ImageHeader header;
+		memcpy(&header, data.data(), sizeof(header));
+		if ((header.magic != IMAGE_MAGIC) ||
+		    (header.version != IMAGE_VERSION) ||
+		    (header.entrySize != sizeof(ImageEntry))) {
+			return false;
+		}
+		auto entriesStart = sizeof(header) + header.signatureSize;
+		auto stringsStart = entriesStart + size_t(header.numEntries) * sizeof(ImageEntry);
+		if (data.size() != (stringsStart + header.stringsSize)) return false;
+		if (std::string_view(&data[sizeof(header)], header.signatureSize) != signature) return false;
+		if ((header.stringsSize == 0) || (data.back() != '\0')) return false;
+
+		const char* strings = &data[stringsStart];
+		auto str32 = [&](uint32_t offset) {
+			String32 result;
+			toString32(strings, strings + offset, result);
+			return result;
+		};
+		RomDB newDb;
+		newDb.reserve(header.numEntries);
+		for (auto i : xrange(header.numEntries)) {
+			ImageEntry e;
+			memcpy(&e, &data[entriesStart + i * sizeof(ImageEntry)], sizeof(e));
+			if ((e.romType >= uint8_t(RomType::NUM)) ||
+			    std::ranges::any_of(e.strings, [&](uint32_t o) { return o >= header.stringsSize; })) {
+				return false;
+			}
+			const auto& o = e.strings;
+			newDb.push_back(Entry{e.sha1, RomInfo(
+				str32(o[0]), str32(o[1]), str32(o[2]), str32(o[3]),
+				e.original != 0, str32(o[4]), str32(o[5]),
+				RomType(e.romType), e.genMSXid)});
+		}
+		db = std::move(newDb);
+		image = std::move(mem);
+		bufferStart = image.data() + stringsStart;
+		return true;
+	} catch (MSXException&) {
+		return false;
+	}
+}
+
+void RomDatabase::saveImage(const std::string& filename, std::string_view signature) const
+{
+	if (!IMAGE_SUPPORTED) return;
+	ImageHeader header{
+		.magic = IMAGE_MAGIC,
+		.version = IMAGE_VERSION,
+		.entrySize = sizeof(ImageEntry),
+		.signatureSize = narrow<uint32_t>(signature.size()),
+		.numEntries = narrow<uint32_t>(db.size()),
+		.stringsSize = narrow<uint32_t>(buffer.size()),
+	};
+	std::vector<uint8_t> out(sizeof(header) + signature.size() +
+	                         db.size() * sizeof(ImageEntry) + buffer.size());
+	auto* p = out.data();
+	auto append = [&](const void* src, size_t size) {
+		if (size) memcpy(p, src, size);
+		p += size;
+	};
+	append(&header, sizeof(header));
+	append(signature.data(), signature.size());
+	const char* buf = buffer.data();
+	auto offset = [&](std::string_view str) {
+		return narrow<uint32_t>(str.data() - buf);
+	};
+	for (const auto& [sha1, info] : db) {
+		ImageEntry e{
+			.sha1 = sha1,
+			.strings = {offset(info.getTitle(buf)), offset(info.getYear(buf)),
+			            offset(info.getCompany(buf)), offset(info.getCountry(buf)),
+			            offset(info.getOrigType(buf)), offset(info.getRemark(buf))},
+			.genMSXid = info.getGenMSXid(),
+			.romType = uint8_t(info.getRomType()),
+			.original = uint8_t(info.getOriginal()),
+		};
+		append(&e, sizeof(e));
+	}
+	append(buf, buffer.size());
+	assert(p == out.data() + out.size());
+
+	try {
+		// Many openMSX processes can start at the same time, they must
+		// never see a partially written image.
+		FileOperations::writeFileAtomically(filename, std::span{out});
+	} catch (MSXException&) {
+		// ignore, the image is only an optimization
+	}
+}
+
 const RomInfo* RomDatabase::fetchRomInfo(const Sha1Sum& sha1sum) const
 {
 	auto d = binary_find(db, sha1sum, {}, &Entry::sha1);
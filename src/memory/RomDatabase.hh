@@ -1,11 +1,15 @@
 #ifndef ROMDATABASE_HH
 #define ROMDATABASE_HH
 
+#include "MappedFile.hh"
 #include "RomInfo.hh"
 
 #include "MemBuffer.hh"
 #include "sha1.hh"
 
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace openmsx {
@@ -21,6 +25,10 @@ public:
 	};
 	using RomDB = std::vector<Entry>; // sorted on sha1
 
+	/** Loads the precompiled database (see saveImage()) when it's still up
+	 * to date, otherwise parses all softwaredb.xml files and (re)creates
+	 * the precompiled database.
+	 */
 	explicit RomDatabase(CliComm& cliComm);
 
 	/** Lookup an entry in the database by sha1sum.
@@ -29,11 +37,25 @@ public:
 	[[nodiscard]] const RomInfo* fetchRomInfo(const Sha1Sum& sha1sum) const;
 
 	[[nodiscard]] const RomDB& getFullDB() const { return db; }
-	[[nodiscard]] const char* getBufferStart() const { return buffer.data(); }
+	[[nodiscard]] const char* getBufferStart() const { return bufferStart; }
+
+//private:
+	// These should not be called directly, except by the unittest
+	RomDatabase(RomDB db_, MemBuffer<char> buffer_)
+		: db(std::move(db_)), buffer(std::move(buffer_))
+		, bufferStart(buffer.data()) {}
+	[[nodiscard]] bool loadImage(const std::string& filename, std::string_view signature);
+	void saveImage(const std::string& filename, std::string_view signature) const;
+
+private:
+	void parseXML(CliComm& cliComm);
+	void compact();
 
 private:
 	RomDB db;
-	MemBuffer<char> buffer;
+	MemBuffer<char> buffer; // strings, when parsed from XML
+	MappedFile<const char> image; // or the precompiled database
+	const char* bufferStart = nullptr; // points into 'buffer' or 'image'
 };
 
 } // namespace openmsx
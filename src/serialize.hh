@@ -681,6 +681,15 @@ public:
 	void serialize_blob(const char* tag, std::span<const uint8_t> data,
 	                    bool diff = true);
 
+	/** Store 'block' by reference instead of by value. The snapshot keeps
+	  * it alive, and MemInputArchive::loadSharedBlock() returns the same
+	  * object again. */
+	void saveSharedBlock(std::shared_ptr<DeltaBlock> block)
+	{
+		save(unsigned(deltaBlocks.size()));
+		deltaBlocks.push_back(std::move(block));
+	}
+
 	using OutputArchiveBase<MemOutputArchive>::serialize;
 	template<typename T, typename ...Args>
 	ALWAYS_INLINE void serialize(const char* tag, const T& t, Args&& ...args)
@@ -789,6 +798,12 @@ public:
 	void serialize_blob(const char* tag, std::span<uint8_t> data,
 	                    bool diff = true);
 
+	[[nodiscard]] const std::shared_ptr<DeltaBlock>& loadSharedBlock()
+	{
+		unsigned idx; load(idx);
+		return deltaBlocks[idx];
+	}
+
 	using InputArchiveBase<MemInputArchive>::serialize;
 	template<typename T, typename ...Args>
 	ALWAYS_INLINE void serialize(const char* tag, T& t, Args&& ...args)
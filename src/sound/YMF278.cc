@@ -1070,6 +1070,23 @@ uint8_t YMF278::DebugMemory::read(unsigned address)
 	return ymf278.readMem(address);
 }
 
+void YMF278::DebugMemory::readBlock(unsigned start, std::span<uint8_t> output)
+{
+	const auto& ymf278 = OUTER(YMF278, debugMemory);
+	while (!output.empty()) {
+		// per 128kB chunk, same as readMem()
+		auto offset = start & 0x1'FFFF;
+		auto n = std::min<size_t>(output.size(), 0x2'0000 - offset);
+		if (auto chunk = ymf278.memPtrs[start >> 17].asOptional()) {
+			copy_to_range(chunk->subspan(offset, n), output);
+		} else {
+			std::ranges::fill(output.first(n), 0xFF);
+		}
+		output = output.subspan(n);
+		start += narrow<unsigned>(n);
+	}
+}
+
 void YMF278::DebugMemory::write(unsigned address, uint8_t value)
 {
 	auto& ymf278 = OUTER(YMF278, debugMemory);
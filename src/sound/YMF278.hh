@@ -127,6 +127,7 @@ private:
 	struct DebugMemory final : SimpleDebuggable {
 		DebugMemory(MSXMotherBoard& motherBoard, const std::string& name);
 		[[nodiscard]] uint8_t read(unsigned address) override;
+		void readBlock(unsigned start, std::span<uint8_t> output) override;
 		void write(unsigned address, uint8_t value) override;
 	} debugMemory;
 
@@ -0,0 +1,99 @@
+#include "catch.hpp"
+#include "AsyncDiskIO.hh"
+
+#include "DiskPartition.hh"
+#include "RamDSKDiskImage.hh"
+
+#include "xrange.hh"
+
+#include <vector>
+
+using namespace openmsx;
+
+static SectorBuffer filled(uint8_t value)
+{
+	SectorBuffer buf;
+	buf.raw.fill(value);
+	return buf;
+}
+
+// first byte of each sector, all bytes in a sector are the same in this test
+static std::vector<uint8_t> readVia(AsyncDiskIO& io, SectorAccessibleDisk& disk,
+                                    size_t start, size_t num)
+{
+	std::vector<SectorBuffer> buffers(num);
+	io.read(disk, buffers, start);
+	std::vector<uint8_t> result;
+	for (const auto& buf : buffers) result.push_back(buf.raw[0]);
+	return result;
+}
+
+static uint8_t readDirect(SectorAccessibleDisk& disk, size_t sector)
+{
+	SectorBuffer buf;
+	disk.readSector(sector, buf);
+	return buf.raw[0];
+}
+
+TEST_CASE("AsyncDiskIO")
+{
+	RamDSKDiskImage disk;
+	for (auto i : xrange(64)) disk.writeSector(i, filled(uint8_t(i)));
+	AsyncDiskIO io;
+	using V = std::vector<uint8_t>;
+
+	SECTION("read-ahead") {
+		CHECK(readVia(io, disk, 10, 4) == V{10, 11, 12, 13});
+		CHECK(io.getNbCacheHits() == 0);
+		// the next sectors were read ahead
+		CHECK(readVia(io, disk, 14, 4) == V{14, 15, 16, 17});
+		CHECK(io.getNbCacheHits() == 1);
+		CHECK(readVia(io, disk, 18, 4) == V{18, 19, 20, 21});
+		CHECK(io.getNbCacheHits() == 2);
+		// a non-sequential read is not in the cache
+		CHECK(readVia(io, disk, 40, 2) == V{40, 41});
+		CHECK(io.getNbCacheHits() == 2);
+		CHECK(readVia(io, disk, 42, 2) == V{42, 43});
+		CHECK(io.getNbCacheHits() == 3);
+	}
+	SECTION("invalidation") {
+		CHECK(readVia(io, disk, 10, 4) == V{10, 11, 12, 13});
+		// write via AsyncDiskIO
+		io.write(disk, std::vector{filled(0xA5)}, 15);
+		CHECK(readVia(io, disk, 14, 4) == V{14, 0xA5, 16, 17});
+		CHECK(io.getNbCacheHits() == 0);
+
+		CHECK(readVia(io, disk, 18, 4) == V{18, 19, 20, 21});
+		CHECK(io.getNbCacheHits() == 1);
+		// write via another path (like diskmanipulator)
+		disk.writeSector(23, filled(0x5A));
+		CHECK(readVia(io, disk, 22, 4) == V{22, 0x5A, 24, 25});
+		CHECK(io.getNbCacheHits() == 1);
+	}
+	SECTION("write ordering") {
+		io.write(disk, std::vector{filled(0x11), filled(0x12)}, 5);
+		io.write(disk, std::vector{filled(0x22)}, 6);
+		// other accesses see all queued writes ...
+		CHECK(readDirect(disk, 5) == 0x11);
+		CHECK(readDirect(disk, 6) == 0x22);
+
+		// ... and a queued write can't overwrite a later write via
+		// another path
+		io.write(disk, std::vector{filled(0x33)}, 7);
+		disk.writeSector(7, filled(0x44));
+		io.flush();
+		CHECK(readDirect(disk, 7) == 0x44);
+		CHECK(readVia(io, disk, 4, 4) == V{4, 0x11, 0x22, 0x44});
+	}
+	SECTION("partition") {
+		// queued writes to a partition are also waited for by other
+		// partitions on the same disk
+		DiskPartition part1(disk, 8, 16);
+		DiskPartition part2(disk, 0, 64);
+		io.write(part1, std::vector{filled(0x77)}, 2);
+		CHECK(readDirect(part2, 10) == 0x77);
+		CHECK(readDirect(disk, 10) == 0x77);
+		CHECK(readVia(io, part1, 1, 3) == V{9, 0x77, 11});
+		io.flush(); // before the partitions are destroyed
+	}
+}
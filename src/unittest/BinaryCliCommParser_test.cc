@@ -0,0 +1,101 @@
+#include "catch.hpp"
+#include "BinaryCliCommParser.hh"
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace openmsx;
+using namespace std;
+using FrameType = BinaryCliCommParser::FrameType;
+
+struct Frame {
+	uint32_t id;
+	FrameType type;
+	string payload;
+	bool operator==(const Frame&) const = default;
+};
+
+static string frame(uint32_t id, FrameType type, string_view payload)
+{
+	string result;
+	BinaryCliCommParser::appendFrame(result, id, type, std::array{payload});
+	return result;
+}
+
+// parse the stream in pieces of the given size, errors are returned as
+// REPLY_ERROR frames
+static vector<Frame> parse(string_view stream, size_t step = size_t(-1))
+{
+	vector<Frame> result;
+	BinaryCliCommParser parser([&](uint32_t id, FrameType type, string_view payload) {
+		result.emplace_back(id, type, string(payload));
+	}, [&](uint32_t id, string_view message) {
+		result.emplace_back(id, FrameType::REPLY_ERROR, string(message));
+	});
+	while (!stream.empty()) {
+		auto part = stream.substr(0, step);
+		parser.parse(part);
+		stream.remove_prefix(part.size());
+	}
+	return result;
+}
+
+TEST_CASE("BinaryCliCommParser")
+{
+	SECTION("encoding") {
+		CHECK(frame(0x04030201, FrameType::COMMAND, "ab") ==
+		      string("\x07\0\0\0\x01\x02\x03\x04\x01" "ab", 11));
+		string out;
+		BinaryCliCommParser::appendFrame(out, 7, FrameType::REPLY_OK,
+			std::array{"foo"sv, ""sv, "bar"sv});
+		CHECK(out == frame(7, FrameType::REPLY_OK, "foobar"));
+	}
+	SECTION("single frame") {
+		CHECK(parse(frame(1, FrameType::COMMAND, "foo")) ==
+		      vector<Frame>{{1, FrameType::COMMAND, "foo"}});
+		CHECK(parse(frame(2, FrameType::COMMAND, "")) ==
+		      vector<Frame>{{2, FrameType::COMMAND, ""}});
+	}
+	SECTION("raw payload") {
+		string payload("<&>\0\xff\n", 6);
+		CHECK(parse(frame(3, FrameType::COMMAND, payload)) ==
+		      vector<Frame>{{3, FrameType::COMMAND, payload}});
+	}
+	SECTION("multiple frames, split over multiple buffers") {
+		auto stream = frame(1, FrameType::COMMAND, "foo") +
+		              frame(2, FrameType::COMMAND, "") +
+		              frame(0xffffffff, FrameType::COMMAND, string(1000, 'x'));
+		vector<Frame> expected = {
+			{1, FrameType::COMMAND, "foo"},
+			{2, FrameType::COMMAND, ""},
+			{0xffffffff, FrameType::COMMAND, string(1000, 'x')},
+		};
+		for (size_t step : {1, 2, 3, 5, 9, 100, 4096}) {
+			CHECK(parse(stream, step) == expected);
+		}
+	}
+	SECTION("invalid frames are reported") {
+		// too short for the header
+		auto stream = string("\x02\0\0\0xy", 6) + frame(1, FrameType::COMMAND, "foo");
+		CHECK(parse(stream) == vector<Frame>{
+			{0, FrameType::REPLY_ERROR, "frame too short"},
+			{1, FrameType::COMMAND, "foo"}});
+		stream = string("\0\0\0\0", 4) + frame(1, FrameType::COMMAND, "foo");
+		CHECK(parse(stream, 1) == vector<Frame>{
+			{0, FrameType::REPLY_ERROR, "frame too short"},
+			{1, FrameType::COMMAND, "foo"}});
+		// contains the id, but not the type
+		CHECK(parse(string("\x04\0\0\0\x05\0\0\0", 8)) == vector<Frame>{
+			{5, FrameType::REPLY_ERROR, "frame too short"}});
+
+		// too long
+		auto size = BinaryCliCommParser::MAX_FRAME_SIZE + 1;
+		stream = string("\x01\0\0\x04", 4) + string("\x09\0\0\0", 4) + string(size - 4, 'x') +
+		         frame(1, FrameType::COMMAND, "foo");
+		CHECK(parse(stream, 1000) == vector<Frame>{
+			{9, FrameType::REPLY_ERROR, "frame too large"},
+			{1, FrameType::COMMAND, "foo"}});
+	}
+}
@@ -0,0 +1,350 @@
+#include "catch.hpp"
+#include "CompiledCondition.hh"
+
+#include "CPURegs.hh"
+
+#include "xrange.hh"
+
+#include <array>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+using namespace openmsx;
+
+// Memory and slot selection, instead of a complete MSX machine.
+struct FakeMachine final : CompiledCondition::Machine {
+	FakeMachine() {
+		for (auto i : xrange(mem.size())) mem[i] = uint8_t(i ^ (i >> 8));
+	}
+	[[nodiscard]] uint8_t peekMem(uint16_t address, EmuTime /*time*/) const override {
+		return mem[address];
+	}
+	[[nodiscard]] int getPrimarySlot(int page) const override { return primary[page]; }
+	[[nodiscard]] int getSecondarySlot(int page) const override { return secondary[page]; }
+	[[nodiscard]] bool isExpanded(int ps) const override { return expanded[ps]; }
+
+	std::array<uint8_t, 0x10000> mem;
+	std::array<int, 4> primary = {0, 0, 0, 0};
+	std::array<int, 4> secondary = {0, 0, 0, 0};
+	std::array<bool, 4> expanded = {false, false, false, false};
+};
+
+static CompiledCondition::Context makeContext(const CPURegs& regs, const FakeMachine& machine)
+{
+	return {
+		.regs = regs,
+		.machine = machine,
+		.time = EmuTime::zero(),
+	};
+}
+
+static std::optional<int64_t> eval(std::string_view expr, const CPURegs& regs = CPURegs(false),
+                                   const FakeMachine& machine = FakeMachine())
+{
+	auto cond = CompiledCondition::compile(expr);
+	REQUIRE(cond);
+	auto context = makeContext(regs, machine);
+	auto result = cond->evaluateValue(context);
+	auto b = cond->evaluate(context);
+	CHECK(b.has_value() == result.has_value());
+	if (result) CHECK(*b == (*result != 0));
+	return result;
+}
+
+static bool compiles(std::string_view expr)
+{
+	return CompiledCondition::compile(expr) != nullptr;
+}
+
+TEST_CASE("CompiledCondition: precedence and associativity")
+{
+	CHECK(eval("1 + 2 * 3") == 7);
+	CHECK(eval("(1 + 2) * 3") == 9);
+	CHECK(eval("10 - 4 - 3") == 3); // left associative
+	CHECK(eval("100 / 10 / 5") == 2);
+	CHECK(eval("2 - -3") == 5);
+	CHECK(eval("-2 * -3") == 6);
+	CHECK(eval("!0 + 1") == 2);
+	CHECK(eval("~5 & 0xff") == 250);
+	CHECK(eval("1 << 2 + 1") == 8);
+	CHECK(eval("16 >> 1 >> 1") == 4);
+	CHECK(eval("1 + 2 < 4") == 1);
+	CHECK(eval("3 > 2 > 1") == 0); // (3 > 2) > 1
+	CHECK(eval("1 < 2 == 1") == 1);
+	CHECK(eval("2 == 2 & 6") == 0); // (2 == 2) & 6
+	CHECK(eval("1 | 2 ^ 3 & 6") == 1); // 1 | (2 ^ (3 & 6))
+	CHECK(eval("6 & 3 | 8") == 10);
+	CHECK(eval("1 || 0 && 0") == 1); // 1 || (0 && 0)
+	CHECK(eval("0 || 1 && 0") == 0);
+	CHECK(eval("5 && 7") == 1);
+	CHECK(eval("0 ? 2 : 3") == 3);
+	CHECK(eval("1 ? 2 : 0 ? 3 : 4") == 2); // right associative
+	CHECK(eval("0 ? 2 : 0 ? 3 : 4") == 4);
+	CHECK(eval("0 ? 2 : 1 ? 3 : 4") == 3);
+	CHECK(eval("1 ? 0 ? 5 : 6 : 7") == 6);
+	CHECK(eval("  ( 1+2 )*3  ") == 9);
+}
+
+TEST_CASE("CompiledCondition: division")
+{
+	// like Tcl: the quotient is rounded towards negative infinity ...
+	CHECK(eval(" 7 /  2") ==  3);
+	CHECK(eval("-7 /  2") == -4);
+	CHECK(eval(" 7 / -2") == -4);
+	CHECK(eval("-7 / -2") ==  3);
+	CHECK(eval("-8 /  2") == -4);
+	// ... and so the remainder has the sign of the divisor
+	CHECK(eval(" 7 %  2") ==  1);
+	CHECK(eval("-7 %  2") ==  1);
+	CHECK(eval(" 7 % -2") == -1);
+	CHECK(eval("-7 % -2") == -1);
+	CHECK(eval("-8 %  2") ==  0);
+	CHECK(eval("-8 % -3") == -2);
+}
+
+TEST_CASE("CompiledCondition: literals")
+{
+	CHECK(eval("0") == 0);
+	CHECK(eval("123") == 123);
+	CHECK(eval("0x1F") == 31);
+	CHECK(eval("0XfF") == 255);
+	CHECK(eval("0b101") == 5);
+	CHECK(eval("0B11") == 3);
+	CHECK(eval("0o17") == 15);
+	CHECK(eval("0O7") == 7);
+	CHECK(eval("0x7fffffff") == 0x7fffffff);
+
+	CHECK(!compiles("017")); // octal in Tcl 8, decimal in Tcl 9
+	CHECK(!compiles("0x"));
+	CHECK(!compiles("0b102"));
+	CHECK(!compiles("0o8"));
+	CHECK(!compiles("12ab"));
+	CHECK(!compiles("1.5"));
+	CHECK(!compiles("1e3"));
+	CHECK(!compiles("0x80000000")); // too big, left to Tcl
+	CHECK(!compiles("$foo"));
+	CHECK(!compiles("[unknown_command]"));
+	CHECK(!compiles("1 +"));
+	CHECK(!compiles("(1"));
+}
+
+TEST_CASE("CompiledCondition: fallback to Tcl")
+{
+	// out of range (intermediate) results
+	CHECK(eval("0x7fffffff + 1") == std::nullopt);
+	CHECK(eval("-0x7fffffff - 1") == std::nullopt);
+	CHECK(eval("0x10000 * 0x10000") == std::nullopt);
+	CHECK(eval("~0x7fffffff") == std::nullopt);
+	CHECK(eval("1 << 31") == std::nullopt);
+	CHECK(eval("1 << -1") == std::nullopt);
+	CHECK(eval("1 >> -1") == std::nullopt);
+	CHECK(eval("1 << 30") == (1 << 30));
+	CHECK(eval("-1 >> 100") == -1);
+	CHECK(eval("(0x7fffffff + 1) - 1") == std::nullopt);
+
+	// division by zero (must give the Tcl error)
+	CHECK(eval("1 / 0") == std::nullopt);
+	CHECK(eval("1 % 0") == std::nullopt);
+	CHECK(eval("1 / (2 - 2)") == std::nullopt);
+	CHECK(eval("1 + (1 / 0 ? 2 : 3)") == std::nullopt);
+	// ... unless it's not evaluated
+	CHECK(eval("0 && (1 / 0)") == 0);
+	CHECK(eval("1 || (1 / 0)") == 1);
+	CHECK(eval("1 ? 2 : 1 / 0") == 2);
+
+	// address out of range, also an error in Tcl
+	CHECK(eval("[peek 0x10000]") == std::nullopt);
+	CHECK(eval("[peek16 0x10000]") == std::nullopt);
+	CHECK(eval("[peek_s8 [peek 0x10000]]") == std::nullopt);
+}
+
+TEST_CASE("CompiledCondition: pc_in_slot")
+{
+	// 'pc_in_slot' returns "true", that only works as a boolean
+	CHECK(compiles("[pc_in_slot 1]"));
+	CHECK(compiles("[pc_in_slot 1 2]"));
+	CHECK(compiles("[pc_in_slot X 2 X]"));
+	CHECK(compiles("[pc_in_slot 1] && [reg A] == 3"));
+	CHECK(compiles("![pc_in_slot 1]"));
+	CHECK(compiles("[reg A] ? [pc_in_slot 1] : [pc_in_slot 2]"));
+
+	CHECK(!compiles("[pc_in_slot 1] + 1"));
+	CHECK(!compiles("[pc_in_slot 1] == 1"));
+	CHECK(!compiles("-[pc_in_slot 1]"));
+	CHECK(!compiles("~[pc_in_slot 1]"));
+	CHECK(!compiles("([reg A] ? [pc_in_slot 1] : 0) + 1"));
+	CHECK(!compiles("[peek [pc_in_slot 1]]"));
+	CHECK(!compiles("[pc_in_slot 4]"));
+	CHECK(!compiles("[pc_in_slot 1 2 3]")); // mapper argument
+
+	// its value is not a number
+	CPURegs regs(false);
+	FakeMachine machine;
+	auto value = [&](std::string_view expr) {
+		auto cond = CompiledCondition::compile(expr);
+		REQUIRE(cond);
+		return cond->evaluateValue(makeContext(regs, machine));
+	};
+	CHECK(value("[pc_in_slot 1]") == std::nullopt);
+	CHECK(value("[reg A] ? 1 : [pc_in_slot 1]") == std::nullopt);
+	CHECK(value("[reg A] ? [pc_in_slot 1] : 1") == std::nullopt);
+
+	// but it can be evaluated as a boolean
+	auto inSlot = [&](std::string_view expr) {
+		auto cond = CompiledCondition::compile(expr);
+		REQUIRE(cond);
+		return cond->evaluate(makeContext(regs, machine));
+	};
+	regs.setPC(0x8123); // page 2
+	machine.primary = {0, 3, 1, 2};
+	CHECK(inSlot("[pc_in_slot 1]") == true);
+	CHECK(inSlot("[pc_in_slot 3]") == false);
+	CHECK(inSlot("[pc_in_slot X 2]") == true); // slot 1 is not expanded
+	CHECK(inSlot("[pc_in_slot 1 2]") == true);
+	machine.expanded[1] = true;
+	machine.secondary = {0, 0, 2, 0};
+	CHECK(inSlot("[pc_in_slot 1 2]") == true);
+	CHECK(inSlot("[pc_in_slot 1 3]") == false);
+	CHECK(inSlot("[pc_in_slot X 3]") == false);
+	CHECK(inSlot("![pc_in_slot 1 3]") == true);
+	regs.setPC(0x4000); // page 1
+	CHECK(inSlot("[pc_in_slot 3]") == true);
+	CHECK(inSlot("[pc_in_slot 1]") == false);
+}
+
+TEST_CASE("CompiledCondition: peek")
+{
+	FakeMachine machine;
+	machine.mem[0x4000] = 0x12;
+	machine.mem[0x4001] = 0x84;
+	machine.mem[0xffff] = 0x99;
+	CPURegs regs(false);
+	regs.setHL(0x4000);
+	auto ev = [&](std::string_view expr) { return eval(expr, regs, machine); };
+
+	CHECK(ev("[peek 0x4000]") == 0x12);
+	CHECK(ev("[peek8 0x4001]") == 0x84);
+	CHECK(ev("[peek_u8 0x4001]") == 0x84);
+	CHECK(ev("[peek_s8 0x4000]") == 0x12);
+	CHECK(ev("[peek_s8 0x4001]") == 0x84 - 256);
+	CHECK(ev("[peek16 0x4000]") == 0x8412);
+	CHECK(ev("[peek16_LE 0x4000]") == 0x8412);
+	CHECK(ev("[peek16_BE 0x4000]") == 0x1284);
+	CHECK(ev("[peek_u16BE 0x4000]") == 0x1284);
+	CHECK(ev("[peek_s16 0x4000]") == 0x8412 - 65536);
+	CHECK(ev("[peek_s16BE 0x4000]") == 0x1284);
+	CHECK(ev("[debug read memory 0x4000]") == 0x12);
+	CHECK(ev("[peek [reg HL]]") == 0x12);
+	CHECK(ev("[peek [reg HL]] + [peek 0x4001] == 0x96") == 1);
+	CHECK(ev("[peek 0xffff]") == 0x99);
+	CHECK(ev("[peek16 0xffff]") == std::nullopt); // 2nd byte out of range
+	CHECK(ev("[peek [peek_s8 0x4001]]") == std::nullopt); // negative address
+}
+
+TEST_CASE("CompiledCondition: registers")
+{
+	CPURegs regs(false);
+	regs.setA(0x12);
+	regs.setHL(0xABCD);
+	regs.setPC(0x4000);
+	CHECK(eval("[reg A]", regs) == 0x12);
+	CHECK(eval("[reg a]", regs) == 0x12);
+	CHECK(eval("[reg HL]", regs) == 0xABCD);
+	CHECK(eval("[reg H]", regs) == 0xAB);
+	CHECK(eval("[reg L]", regs) == 0xCD);
+	CHECK(eval("[reg pc] == 0x4000", regs) == 1);
+	CHECK(eval("[reg A] * 2 + 1", regs) == 0x25);
+
+	CHECK(!compiles("[reg A 5]")); // writes the register
+	CHECK(!compiles("[reg XY]"));
+	CHECK(!compiles("[reg]"));
+}
+
+TEST_CASE("CompiledCondition: inputs")
+{
+	auto inputs = [](std::string_view expr) {
+		auto cond = CompiledCondition::compile(expr);
+		REQUIRE(cond);
+		return cond->getInputs();
+	};
+	using Addrs = std::vector<uint16_t>;
+
+	SECTION("constants") {
+		auto in = inputs("1 + 2");
+		CHECK(in.addresses.empty());
+		CHECK(in.regs == 0);
+		CHECK(!in.dynamic);
+	}
+	SECTION("constant peek addresses") {
+		auto in = inputs("[peek 0x1234] + [peek16 0x2000] + [peek_s8 0x1234]");
+		CHECK(in.addresses == Addrs{0x1234, 0x2000, 0x2001}); // sorted, unique
+		CHECK(in.regs == 0);
+		CHECK(!in.dynamic);
+
+		in = inputs("[peek_u16BE 0x3000] || [debug read memory 0x10]");
+		CHECK(in.addresses == Addrs{0x0010, 0x3000, 0x3001});
+		CHECK(!in.dynamic);
+
+		in = inputs("[peek16 0xffff]"); // 2nd byte is out of range
+		CHECK(in.addresses == Addrs{0xffff});
+		CHECK(!in.dynamic);
+	}
+	SECTION("registers") {
+		// bit numbers as in the "CPU regs" debuggable, REG16 sets 2 bits
+		CHECK(inputs("[reg A]").regs == (1u << 0));
+		CHECK(inputs("[reg F]").regs == (1u << 1));
+		CHECK(inputs("[reg HL]").regs == (3u << 6));
+		CHECK(inputs("[reg H]").regs == (1u << 6));
+		CHECK(inputs("[reg IX] + [reg IY]").regs == ((3u << 16) | (3u << 18)));
+		CHECK(inputs("[reg PC]").regs == (3u << 20));
+		CHECK(inputs("[reg SP] + [reg R]").regs == ((3u << 22) | (1u << 25)));
+		CHECK(inputs("[reg IFF]").regs == (1u << 27));
+		CHECK(!inputs("[reg HL] == [reg DE]").dynamic);
+	}
+	SECTION("dynamic") {
+		auto in = inputs("[peek [reg HL]]");
+		CHECK(in.addresses.empty());
+		CHECK(in.regs == (3u << 6));
+		CHECK(in.dynamic);
+
+		CHECK(inputs("[peek [peek 0x1000]]").dynamic);
+		CHECK(inputs("[peek 0x10000]").dynamic);
+		CHECK(inputs("$wp_last_address == 0x4000").dynamic);
+		CHECK(inputs("$wp_last_value").dynamic);
+		CHECK(inputs("[watch_in_slot 1]").dynamic);
+
+		in = inputs("[pc_in_slot 1] && [peek 0x8000]");
+		CHECK(in.addresses == Addrs{0x8000});
+		CHECK(in.regs == (3u << 20));
+		CHECK(in.dynamic);
+	}
+	SECTION("readInputs") {
+		auto cond = CompiledCondition::compile("[reg L] + [reg A] + [reg BC]");
+		REQUIRE(cond);
+		CPURegs regs(false);
+		regs.setA(0x11);
+		regs.setBC(0x2233);
+		regs.setHL(0x4455);
+		FakeMachine machine;
+		std::vector<uint8_t> values;
+		cond->readInputs(makeContext(regs, machine), values);
+		// in order of the register bit number
+		CHECK(values == std::vector<uint8_t>{0x11, 0x22, 0x33, 0x55});
+
+		// first the memory (in address order), then the registers
+		cond = CompiledCondition::compile("[peek16 0x8000] + [reg A] + [peek 0x1234]");
+		REQUIRE(cond);
+		machine.mem[0x1234] = 0xAA;
+		machine.mem[0x8000] = 0xBB;
+		machine.mem[0x8001] = 0xCC;
+		values.clear();
+		cond->readInputs(makeContext(regs, machine), values);
+		CHECK(values == std::vector<uint8_t>{0xAA, 0xBB, 0xCC, 0x11});
+		// a changed input gives different values
+		machine.mem[0x8001] = 0xCD;
+		std::vector<uint8_t> values2;
+		cond->readInputs(makeContext(regs, machine), values2);
+		CHECK(values2 != values);
+	}
+}
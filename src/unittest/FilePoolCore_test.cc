@@ -133,5 +133,17 @@ TEST_CASE("FilePoolCore")
 	CHECK(lines[3].starts_with("f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2"));
 	CHECK(lines[3].ends_with(tmp + "/c"));
 
+	// binary 'filecache' is written as well, and is used when present
+	CHECK(FileOperations::isRegularFile(tmp + "/cache.bin"));
+	FileOperations::unlink(tmp + "/cache");
+	{
+		FilePoolCore pool(tmp + "/cache",
+		                  [] { return FilePoolCore::Directories{}; }, // only lookup in cache
+		                  [](std::string_view, float) { /* report progress: nothing */});
+		auto [file, fname] = pool.getFile(FileType::ROM, Sha1Sum("f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2"));
+		CHECK(file.is_open());
+		CHECK(fname == tmp + "/c");
+	}
+
 	FileOperations::deleteRecursive(tmp);
 }
@@ -0,0 +1,135 @@
+#include "catch.hpp"
+#include "InstructionTracer.hh"
+
+#include "FileOperations.hh"
+
+#include "xrange.hh"
+
+#include <array>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+using namespace openmsx;
+
+using Tracer = InstructionTracer;
+using Regs = std::array<uint16_t, Tracer::NUM_REGS>;
+
+struct Instr {
+	uint64_t time;
+	uint16_t pc;
+	uint8_t slot;
+	std::array<uint8_t, 4> bytes;
+	Regs regs;
+	std::vector<Tracer::MemAccess> accesses;
+};
+
+static void writeTrace(const std::string& filename, uint64_t startTime,
+                       bool memory, const std::vector<Instr>& instrs)
+{
+	// compressed, just like the real recordings
+	auto* f = gzopen(filename.c_str(), "wb1");
+	REQUIRE(f);
+	auto write = [&](std::span<const uint8_t> data) {
+		REQUIRE(gzwrite(f, data.data(), unsigned(data.size())) == int(data.size()));
+	};
+	Tracer::Encoder encoder;
+	write(encoder.start(EmuTime::fromUint64(startTime), memory));
+	for (const auto& instr : instrs) {
+		encoder.beginInstruction(EmuTime::fromUint64(instr.time),
+		                         instr.pc, instr.slot, instr.bytes);
+		for (const auto& a : instr.accesses) {
+			encoder.memoryAccess(a.address, a.value, a.write);
+		}
+		write(encoder.endInstruction(instr.regs));
+	}
+	REQUIRE(gzclose(f) == Z_OK);
+}
+
+TEST_CASE("InstructionTracer: write and load")
+{
+	auto tmp = FileOperations::getTempDir() + "/instructiontracer_unittest";
+	FileOperations::deleteRecursive(tmp);
+	FileOperations::mkdirp(tmp);
+	auto filename = tmp + "/trace.gz";
+
+	static constexpr uint64_t START = 1000;
+	Regs regs0 = {0x0044, 0x1234, 0x5678, 0x9abc, 0, 0, 0, 0, 0xffff, 0xffff, 0xf000, 0x0042, 0x0d};
+	Regs regs1 = regs0;
+	regs1[Tracer::HL] = 0x9abd; // 'INC HL'
+	regs1[Tracer::IR] = 0x0043;
+	Regs regs2 = regs1; // 'NOP', only R changes
+	regs2[Tracer::IR] = 0x0044;
+	std::vector<Instr> instrs = {
+		// first record: delta 0 (single byte varint)
+		{START, 0x4000, 0x01, {0x23, 0x00, 0x01, 0x02}, regs0,
+		 {{0x4000, 0x23, false}}},
+		// delta 0x7f: largest single byte varint
+		{START + 0x7f, 0x4001, 0x01, {0x23, 0x00, 0x01, 0x02}, regs1,
+		 {{0x4001, 0x23, false}, {0xc000, 0x55, true}}},
+		// 3 byte varint, slot 3-2 (expanded), no memory accesses
+		{START + 0x7f + 0x12345, 0xfffe, 0x1b, {0x00, 0xff, 0x00, 0x00}, regs2,
+		 {}},
+	};
+
+	auto check = [&](bool memory) {
+		writeTrace(filename, START, memory, instrs);
+
+		size_t n = 0;
+		Tracer::load(filename, [&](const Tracer::Record& rec) {
+			REQUIRE(n < instrs.size());
+			const auto& instr = instrs[n];
+			CHECK(rec.time == EmuTime::fromUint64(instr.time));
+			CHECK(rec.pc == instr.pc);
+			CHECK(rec.slot == instr.slot);
+			CHECK(rec.bytes == instr.bytes);
+			for (auto i : xrange(Tracer::NUM_REGS)) {
+				if (rec.changed & (1 << i)) CHECK(rec.regs[i] == instr.regs[i]);
+			}
+			if (memory) {
+				REQUIRE(rec.accesses.size() == instr.accesses.size());
+				for (auto i : xrange(rec.accesses.size())) {
+					CHECK(rec.accesses[i].address == instr.accesses[i].address);
+					CHECK(rec.accesses[i].value   == instr.accesses[i].value);
+					CHECK(rec.accesses[i].write   == instr.accesses[i].write);
+				}
+			} else {
+				CHECK(rec.accesses.empty());
+			}
+			++n;
+		});
+		CHECK(n == instrs.size());
+	};
+
+	SECTION("register mask") {
+		std::vector<uint16_t> masks;
+		writeTrace(filename, START, false, instrs);
+		Tracer::load(filename, [&](const Tracer::Record& rec) {
+			masks.push_back(rec.changed);
+		});
+		REQUIRE(masks.size() == 3);
+		CHECK(masks[0] == (1 << Tracer::NUM_REGS) - 1); // all registers
+		CHECK(masks[1] == ((1 << Tracer::HL) | (1 << Tracer::IR)));
+		CHECK(masks[2] == (1 << Tracer::IR));
+	}
+	SECTION("without memory") {
+		check(false);
+	}
+	SECTION("with memory") {
+		check(true);
+	}
+	SECTION("truncated") {
+		auto* f = gzopen(filename.c_str(), "wb1");
+		REQUIRE(f);
+		Tracer::Encoder encoder;
+		auto header = encoder.start(EmuTime::fromUint64(START), true);
+		gzwrite(f, header.data(), unsigned(header.size()));
+		encoder.beginInstruction(EmuTime::fromUint64(START), 0, 0, instrs[0].bytes);
+		auto rec = encoder.endInstruction(regs0);
+		gzwrite(f, rec.data(), unsigned(rec.size() - 1)); // drop last byte
+		REQUIRE(gzclose(f) == Z_OK);
+		CHECK_THROWS(Tracer::load(filename, [](const Tracer::Record&) {}));
+	}
+
+	FileOperations::deleteRecursive(tmp);
+}
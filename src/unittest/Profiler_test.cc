@@ -0,0 +1,111 @@
+#include "catch.hpp"
+#include "Profiler.hh"
+
+#include <sstream>
+#include <vector>
+
+using namespace openmsx;
+
+using Location = Profiler::Location;
+
+static void checkRoundTrip(const Location& loc)
+{
+	auto key = loc.toKey();
+	CHECK(uint16_t(key) == loc.addr); // the address is in the lowest bits
+	CHECK(Location::fromKey(key) == loc);
+}
+
+TEST_CASE("Profiler: Location")
+{
+	SECTION("round trip") {
+		checkRoundTrip({.addr = 0x0000, .ps = 0});
+		checkRoundTrip({.addr = 0xffff, .ps = 3});
+		checkRoundTrip({.addr = 0x4000, .ps = 1, .ss = 0});
+		checkRoundTrip({.addr = 0x8000, .ps = 3, .ss = 3});
+		checkRoundTrip({.addr = 0x4000, .ps = 2, .segment = 0});
+		checkRoundTrip({.addr = 0xbfff, .ps = 3, .ss = 2, .segment = 0xffff});
+		checkRoundTrip({.addr = 0x1234, .ps = 0, .ss = 1, .segment = 0x1234});
+	}
+	SECTION("distinct keys") {
+		// no expanded slot vs sub-slot 0, no segment vs segment 0
+		auto k1 = Location{.addr = 0x4000, .ps = 1}.toKey();
+		auto k2 = Location{.addr = 0x4000, .ps = 1, .ss = 0}.toKey();
+		auto k3 = Location{.addr = 0x4000, .ps = 1, .segment = 0}.toKey();
+		auto k4 = Location{.addr = 0x4000, .ps = 1, .ss = 0, .segment = 0}.toKey();
+		CHECK(k1 != k2);
+		CHECK(k1 != k3);
+		CHECK(k1 != k4);
+		CHECK(k2 != k3);
+		CHECK(k2 != k4);
+		CHECK(k3 != k4);
+		CHECK(Location{.addr = 0x4000, .ps = 1}.toKey() != Location{.addr = 0x4000, .ps = 2}.toKey());
+		CHECK(Location{.addr = 0x4000, .ps = 1, .segment = 1}.toKey() !=
+		      Location{.addr = 0x4000, .ps = 1, .segment = 2}.toKey());
+	}
+	SECTION("format") {
+		CHECK(Location{.addr = 0, .ps = 1}.formatSlot() == "1");
+		CHECK(Location{.addr = 0, .ps = 3, .ss = 2}.formatSlot() == "3-2");
+		CHECK(Location{.addr = 0, .ps = 3}.formatSegment().empty());
+		CHECK(Location{.addr = 0, .ps = 3, .segment = 17}.formatSegment() == "17");
+	}
+}
+
+static std::vector<Profiler::Entry> exampleEntries()
+{
+	auto key = [](uint16_t addr, uint8_t ps, std::optional<uint8_t> ss = {},
+	              std::optional<uint16_t> segment = {}) {
+		return Location{.addr = addr, .ps = ps, .ss = ss, .segment = segment}.toKey();
+	};
+	// sorted on cycles (as returned by getEntries()), not on address
+	return {
+		{key(0x4003, 1),       {.count = 10, .duration = 0}, 100, "main"},
+		{key(0x4000, 1),       {.count =  5, .duration = 0},  50, "main"},
+		{key(0x8001, 3, 2, 5), {.count =  2, .duration = 0},  20, ""},
+		{key(0x0038, 0),       {.count =  1, .duration = 0},   7, "irq"},
+		{key(0x8000, 3, 2, 5), {.count =  1, .duration = 0},   3, ""},
+		{key(0x8000, 3, 2, 6), {.count =  1, .duration = 0},   2, ""},
+	};
+}
+
+TEST_CASE("Profiler: callgrind")
+{
+	std::ostringstream os;
+	Profiler::writeCallgrind(os, exampleEntries());
+	CHECK(os.str() ==
+		"# callgrind format\n"
+		"version: 1\n"
+		"creator: openMSX\n"
+		"positions: instr\n"
+		"events: Cycles Instructions\n"
+		"summary: 182 20\n"
+		"\n"
+		"fl=slot 0\n"
+		"fn=irq\n"
+		"0x0038 7 1\n"
+		"\n"
+		"fl=slot 1\n"
+		"fn=main\n"
+		"0x4000 50 5\n"
+		"0x4003 100 10\n"
+		"\n"
+		"fl=slot 3-2 segment 5\n"
+		"fn=?_slot 3-2 segment 5\n"
+		"0x8000 3 1\n"
+		"0x8001 20 2\n"
+		"\n"
+		"fl=slot 3-2 segment 6\n"
+		"fn=?_slot 3-2 segment 6\n"
+		"0x8000 2 1\n"
+		"\n");
+}
+
+TEST_CASE("Profiler: flamegraph")
+{
+	std::ostringstream os;
+	Profiler::writeFlameGraph(os, exampleEntries());
+	CHECK(os.str() ==
+		"slot 0;irq 7\n"
+		"slot 1;main 150\n"
+		"slot 3-2;segment 5;? 23\n"
+		"slot 3-2;segment 6;? 2\n");
+}
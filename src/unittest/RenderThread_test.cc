@@ -0,0 +1,38 @@
+#include "catch.hpp"
+#include "RenderThread.hh"
+
+#include "xrange.hh"
+
+#include <vector>
+
+using namespace openmsx;
+
+TEST_CASE("RenderThread")
+{
+	std::vector<int> executed;
+
+	SECTION("order and sync") {
+		RenderThread thread;
+		// more than fit in the queue at once
+		for (auto i : xrange(5000)) {
+			thread.enqueue([&executed, i] { executed.push_back(i); });
+		}
+		thread.sync();
+		REQUIRE(executed.size() == 5000);
+		for (auto i : xrange(5000)) CHECK(executed[i] == i);
+
+		// can be reused after sync()
+		thread.enqueue([&] { executed.push_back(-1); });
+		thread.sync();
+		CHECK(executed.back() == -1);
+	}
+	SECTION("pending commands are executed on destruction") {
+		{
+			RenderThread thread;
+			for (auto i : xrange(100)) {
+				thread.enqueue([&executed, i] { executed.push_back(i); });
+			}
+		}
+		CHECK(executed.size() == 100);
+	}
+}
@@ -0,0 +1,109 @@
+#include "catch.hpp"
+#include "RomDatabase.hh"
+
+#include "File.hh"
+#include "FileOperations.hh"
+
+#include "ranges.hh"
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+using namespace openmsx;
+
+static String32 str32(const char* buf, size_t offset)
+{
+	String32 result;
+	toString32(buf, buf + offset, result);
+	return result;
+}
+
+static RomDatabase createDB()
+{
+	// offset 0 is the empty string
+	static constexpr std::string_view strings("\0Title\0" "1985\0" "Konami\0" "JP\0" "Other\0", 28);
+	MemBuffer<char> buffer(strings.size());
+	copy_to_range(strings, buffer);
+	const char* buf = buffer.data();
+	RomDatabase::RomDB db;
+	db.push_back({Sha1Sum("1111111111111111111111111111111111111111"),
+	              RomInfo(str32(buf, 1), str32(buf, 7), str32(buf, 12), str32(buf, 19),
+	                      true, str32(buf, 0), str32(buf, 0), RomType::KONAMI, 42)});
+	db.push_back({Sha1Sum("2222222222222222222222222222222222222222"),
+	              RomInfo(str32(buf, 22), str32(buf, 0), str32(buf, 0), str32(buf, 0),
+	                      false, str32(buf, 0), str32(buf, 22), RomType::ASCII8, 0)});
+	return {std::move(db), std::move(buffer)};
+}
+
+TEST_CASE("RomDatabase: image")
+{
+	if (!std::is_same_v<String32, uint32_t>) return; // image not supported
+
+	auto tmp = FileOperations::getTempDir() + "/romdatabase_unittest";
+	FileOperations::deleteRecursive(tmp);
+	auto imageName = tmp + "/image";
+
+	auto original = createDB();
+	original.saveImage(imageName, "signature");
+	auto size = File(imageName).getSize();
+
+	SECTION("round trip") {
+		RomDatabase loaded({}, {});
+		REQUIRE(loaded.loadImage(imageName, "signature"));
+		const auto& db = loaded.getFullDB();
+		const auto* buf = loaded.getBufferStart();
+		REQUIRE(db.size() == 2);
+
+		CHECK(db[0].sha1 == Sha1Sum("1111111111111111111111111111111111111111"));
+		const auto& info0 = db[0].romInfo;
+		CHECK(info0.getTitle(buf) == "Title");
+		CHECK(info0.getYear(buf) == "1985");
+		CHECK(info0.getCompany(buf) == "Konami");
+		CHECK(info0.getCountry(buf) == "JP");
+		CHECK(info0.getOrigType(buf).empty());
+		CHECK(info0.getRemark(buf).empty());
+		CHECK(info0.getOriginal());
+		CHECK(info0.getRomType() == RomType::KONAMI);
+		CHECK(info0.getGenMSXid() == 42);
+
+		CHECK(db[1].sha1 == Sha1Sum("2222222222222222222222222222222222222222"));
+		const auto& info1 = db[1].romInfo;
+		CHECK(info1.getTitle(buf) == "Other");
+		CHECK(info1.getYear(buf).empty());
+		CHECK(info1.getRemark(buf) == "Other");
+		CHECK(!info1.getOriginal());
+		CHECK(info1.getRomType() == RomType::ASCII8);
+		CHECK(info1.getGenMSXid() == 0);
+	}
+	SECTION("deterministic") {
+		// no uninitialized (padding) bytes end up in the image
+		auto imageName2 = tmp + "/image2";
+		createDB().saveImage(imageName2, "signature");
+		File f1(imageName);
+		File f2(imageName2);
+		auto m1 = f1.mmap<const uint8_t>();
+		auto m2 = f2.mmap<const uint8_t>();
+		CHECK(std::ranges::equal(m1, m2));
+	}
+	SECTION("stale signature") {
+		RomDatabase loaded({}, {});
+		CHECK(!loaded.loadImage(imageName, "other signature"));
+		CHECK(!loaded.loadImage(imageName, "signatur"));
+		CHECK(loaded.getFullDB().empty());
+	}
+	SECTION("corrupt") {
+		auto name2 = tmp + "/truncated";
+		{
+			File in(imageName);
+			auto mem = in.mmap<const uint8_t>();
+			FileOperations::writeFileAtomically(name2, std::span{mem.data(), size - 1});
+		}
+		RomDatabase loaded({}, {});
+		CHECK(!loaded.loadImage(name2, "signature"));
+		CHECK(!loaded.loadImage(tmp + "/does-not-exist", "signature"));
+	}
+
+	FileOperations::deleteRecursive(tmp);
+}
@@ -0,0 +1,54 @@
+#include "catch.hpp"
+#include "Rom.hh"
+
+#include "FileOperations.hh"
+#include "Filename.hh"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace openmsx;
+
+static void createFile(const std::string& filename, std::string_view content)
+{
+	std::ofstream of(filename, std::ios::binary);
+	of.write(content.data(), std::streamsize(content.size()));
+}
+
+TEST_CASE("Rom: applyPatches")
+{
+	auto tmp = FileOperations::getTempDir() + "/rom_unittest";
+	FileOperations::deleteRecursive(tmp);
+	FileOperations::mkdirp(tmp);
+	auto ips = tmp + "/patch.ips";
+	// offset 1: 0xAA, offset 5-6: 0xBB 0xCC (beyond the end of the ROM)
+	createFile(ips, std::string_view(
+		"PATCH"
+		"\x00\x00\x01" "\x00\x01" "\xAA"
+		"\x00\x00\x05" "\x00\x02" "\xBB\xCC"
+		"EOF", 5 + 6 + 7 + 3));
+
+	// A firstblock/lastblock ROM is a range inside the (shared) content of
+	// a PanasonicRom, patching it must leave that content untouched.
+	const std::vector<uint8_t> panasonicRom = {0, 1, 2, 3, 4, 5, 6, 7};
+	const auto original = panasonicRom;
+	auto range = std::span{panasonicRom}.subspan(2, 4);
+
+	SECTION("patch inside") {
+		std::vector<Filename> patches;
+		patches.emplace_back(ips);
+		auto patched = Rom::applyPatches(range, std::move(patches));
+		CHECK(panasonicRom == original);
+		CHECK(std::vector<uint8_t>(patched.begin(), patched.end()) ==
+		      std::vector<uint8_t>{2, 0xAA, 4, 5, 0, 0xBB, 0xCC});
+	}
+	SECTION("no patches") {
+		auto patched = Rom::applyPatches(range, {});
+		CHECK(panasonicRom == original);
+		CHECK(std::vector<uint8_t>(patched.begin(), patched.end()) ==
+		      std::vector<uint8_t>{2, 3, 4, 5});
+	}
+
+	FileOperations::deleteRecursive(tmp);
+}
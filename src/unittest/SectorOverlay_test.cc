@@ -0,0 +1,147 @@
+#include "catch.hpp"
+#include "SectorOverlay.hh"
+
+#include "serialize.hh"
+
+#include "DeltaBlock.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace openmsx;
+
+static SectorBuffer filled(uint8_t value)
+{
+	SectorBuffer buf;
+	buf.raw.fill(value);
+	return buf;
+}
+
+// Simulates reading from the (read-only) base image: sector 'n' is filled
+// with 'n', then the overlay replaces the modified sectors.
+static std::vector<SectorBuffer> readSectors(SectorOverlay& overlay, size_t start, size_t num)
+{
+	std::vector<SectorBuffer> result;
+	for (auto i : xrange(num)) result.push_back(filled(uint8_t(start + i)));
+	overlay.read(result, start);
+	return result;
+}
+
+static std::vector<uint8_t> firstBytes(const std::vector<SectorBuffer>& buffers)
+{
+	std::vector<uint8_t> result;
+	for (const auto& buf : buffers) {
+		// all bytes in a sector are the same in this test
+		CHECK(std::ranges::all_of(buf.raw, [&](uint8_t b) { return b == buf.raw[0]; }));
+		result.push_back(buf.raw[0]);
+	}
+	return result;
+}
+
+TEST_CASE("SectorOverlay")
+{
+	SectorOverlay overlay;
+	using V = std::vector<uint8_t>;
+
+	SECTION("read-through") {
+		// nothing modified: the data from the base image is untouched
+		CHECK(overlay.getNbModifiedSectors() == 0);
+		CHECK(firstBytes(readSectors(overlay, 0, 4)) == V{0, 1, 2, 3});
+		CHECK(firstBytes(readSectors(overlay, 10, 1)) == V{10});
+	}
+	SECTION("write-redirect") {
+		overlay.write(2, filled(0xA2));
+		overlay.write(5, filled(0xA5));
+		CHECK(overlay.getNbModifiedSectors() == 2);
+
+		// modified sectors come from the overlay, others from the image
+		CHECK(firstBytes(readSectors(overlay, 0, 8)) == V{0, 1, 0xA2, 3, 4, 0xA5, 6, 7});
+		// ranges that start/end at, or lie in between, modified sectors
+		CHECK(firstBytes(readSectors(overlay, 2, 1)) == V{0xA2});
+		CHECK(firstBytes(readSectors(overlay, 3, 2)) == V{3, 4});
+		CHECK(firstBytes(readSectors(overlay, 5, 3)) == V{0xA5, 6, 7});
+		CHECK(firstBytes(readSectors(overlay, 6, 10)) == V{6, 7, 8, 9, 10, 11, 12, 13, 14, 15});
+
+		// writing again: the latest data wins
+		overlay.write(2, filled(0xB2));
+		overlay.write(2, filled(0xC2));
+		CHECK(overlay.getNbModifiedSectors() == 2);
+		CHECK(firstBytes(readSectors(overlay, 1, 3)) == V{1, 0xC2, 3});
+		CHECK(firstBytes(readSectors(overlay, 5, 1)) == V{0xA5});
+
+		// also writing the original content keeps it redirected
+		overlay.write(3, filled(3));
+		CHECK(overlay.getNbModifiedSectors() == 3);
+		CHECK(firstBytes(readSectors(overlay, 0, 4)) == V{0, 1, 0xC2, 3});
+	}
+	SECTION("independent overlays") {
+		SectorOverlay other;
+		overlay.write(1, filled(0x11));
+		other.write(1, filled(0x22));
+		other.write(2, filled(0x33));
+		CHECK(firstBytes(readSectors(overlay, 0, 3)) == V{0, 0x11, 2});
+		CHECK(firstBytes(readSectors(other,   0, 3)) == V{0, 0x22, 0x33});
+	}
+	SECTION("copy") {
+		// a copy shares the delta file, but not later modifications
+		overlay.write(1, filled(0x11));
+		SectorOverlay copy = overlay;
+		copy.write(1, filled(0x22));
+		overlay.write(2, filled(0x33));
+		CHECK(firstBytes(readSectors(overlay, 0, 3)) == V{0, 0x11, 0x33});
+		CHECK(firstBytes(readSectors(copy,    0, 3)) == V{0, 0x22, 2});
+	}
+	SECTION("records are reused") {
+		// rewriting a sector overwrites its record
+		for (auto i : xrange(10)) overlay.write(7, filled(uint8_t(i)));
+		CHECK(overlay.getNbRecords() == 1);
+		overlay.write(8, filled(0x88));
+		CHECK(overlay.getNbRecords() == 2);
+		CHECK(firstBytes(readSectors(overlay, 7, 2)) == V{9, 0x88});
+
+		// ... unless a copy still refers to it
+		{
+			SectorOverlay copy = overlay;
+			overlay.write(7, filled(0x77));
+			CHECK(overlay.getNbRecords() == 3);
+			CHECK(firstBytes(readSectors(copy,    7, 1)) == V{9});
+			CHECK(firstBytes(readSectors(overlay, 7, 1)) == V{0x77});
+		}
+		// once that copy is gone, its record can be reused
+		overlay.write(9, filled(0x99));
+		overlay.write(7, filled(0x17));
+		overlay.write(8, filled(0x18));
+		CHECK(overlay.getNbRecords() == 3);
+		CHECK(firstBytes(readSectors(overlay, 7, 3)) == V{0x17, 0x18, 0x99});
+	}
+	SECTION("reverse snapshot") {
+		overlay.write(1, filled(0x11));
+		overlay.write(2, filled(0x22));
+
+		LastDeltaBlocks lastDeltaBlocks;
+		std::vector<std::shared_ptr<DeltaBlock>> deltaBlocks;
+		MemOutputArchive out(lastDeltaBlocks, deltaBlocks, true);
+		out.serialize("overlay", overlay);
+		auto buf = std::move(out).releaseBuffer();
+
+		// the snapshot keeps the old content of sector 1
+		overlay.write(1, filled(0x33));
+		CHECK(overlay.getNbRecords() == 3);
+
+		SectorOverlay restored;
+		MemInputArchive in(buf, deltaBlocks);
+		in.serialize("overlay", restored);
+		CHECK(firstBytes(readSectors(restored, 0, 3)) == V{0, 0x11, 0x22});
+		CHECK(firstBytes(readSectors(overlay,  0, 3)) == V{0, 0x33, 0x22});
+
+		// when the snapshot (and the overlay restored from it) are gone,
+		// only the records of 'overlay' remain in use
+		deltaBlocks.clear();
+		restored = SectorOverlay();
+		overlay.write(3, filled(0x44));
+		CHECK(overlay.getNbRecords() == 3);
+		CHECK(firstBytes(readSectors(overlay, 0, 4)) == V{0, 0x33, 0x22, 0x44});
+	}
+}
@@ -1,6 +1,8 @@
 #include "catch.hpp"
 #include "SymbolManager.hh"
 
+#include "strCat.hh"
+
 using namespace openmsx;
 
 TEST_CASE("SymbolManager: isHexDigit")
@@ -192,6 +194,24 @@ TEST_CASE("SymbolManager: loadGeneric")
 	CHECK(file.symbols[2].value == 3);
 }
 
+TEST_CASE("SymbolManager: loadGeneric big file")
+{
+	// big enough to be parsed in multiple chunks (in parallel)
+	static constexpr unsigned NUM = 100'000;
+	std::string buffer;
+	for (unsigned i = 0; i < NUM; ++i) {
+		strAppend(buffer, "label", i, ": equ ", i % 0x10000, "\n");
+	}
+	auto file = SymbolManager::loadGeneric("big.sym", buffer);
+	REQUIRE(file.symbols.size() == NUM);
+	bool ok = true;
+	for (unsigned i = 0; i < NUM; ++i) {
+		ok &= (file.symbols[i].name == strCat("label", i)) &&
+		      (file.symbols[i].value == i % 0x10000);
+	}
+	CHECK(ok);
+}
+
 TEST_CASE("SymbolManager: loadNoICE without segments")
 {
 	std::string_view buffer =
@@ -331,3 +351,32 @@ TEST_CASE("SymbolManager: loadLinkMap")
 	CHECK(file.symbols[5].name == "last");
 	CHECK(file.symbols[5].value == 0x8765);
 }
+
+TEST_CASE("SymbolManager: findNearest")
+{
+	std::vector<Symbol> symbols = {
+		{"start",   0x4000, {},  {}},
+		{"func",    0x4100, {},  {}},
+		{"inSlot",  0x4080, 1,   {}},
+		{"inSeg",   0x40c0, 1,   3},
+		{"other",   0x40f0, 2,   {}},
+		{"alias",   0x4100, 1,   {}},
+	};
+	std::vector<const Symbol*> index;
+	for (const auto& sym : symbols) index.push_back(&sym);
+	SymbolManager::sortForNearest(index);
+
+	auto find = [&](uint16_t addr, uint8_t slot, std::optional<uint16_t> segment) {
+		auto r = SymbolManager::findNearest(index, addr, slot, segment);
+		return r ? strCat(r->symbol->name, '+', r->offset) : std::string("-");
+	};
+	CHECK(find(0x3fff, 0, {}) == "-");
+	CHECK(find(0x4000, 0, {}) == "start+0");
+	CHECK(find(0x40ff, 0, {}) == "start+255");
+	CHECK(find(0x40ff, 1, {}) == "inSlot+127");
+	CHECK(find(0x40ff, 1, 3) == "inSeg+63");
+	CHECK(find(0x40ff, 1, 4) == "inSlot+127");
+	CHECK(find(0x40ff, 2, 3) == "other+15");
+	CHECK(find(0x4105, 0, {}) == "func+5");
+	CHECK(find(0x4105, 1, 3) == "alias+5"); // most specific one on equal values
+}
@@ -3,9 +3,11 @@
 #include "TigerTree.hh"
 #include "ranges.hh"
 #include "tiger.hh"
+#include "xrange.hh"
 
 #include <algorithm>
 #include <span>
+#include <vector>
 
 using namespace openmsx;
 
@@ -18,12 +20,32 @@ struct TTTestData final : public TTData
 
 	bool isCacheStillValid(time_t&) override
 	{
-		return false;
+		return cacheValid;
 	}
 
 	uint8_t* buffer;
+	bool cacheValid = false;
 };
 
+// Straightforward (non-incremental) tiger-tree calculation on whole blocks.
+static TigerHash referenceHash(std::span<uint8_t> buffer)
+{
+	static constexpr auto BLOCK_SIZE = TigerTree::BLOCK_SIZE;
+	std::vector<TigerHash> level;
+	for (size_t i = 0; i < buffer.size(); i += BLOCK_SIZE) {
+		tiger_leaf(buffer.subspan(i, BLOCK_SIZE), level.emplace_back());
+	}
+	while (level.size() > 1) {
+		std::vector<TigerHash> next;
+		for (size_t i = 0; i + 1 < level.size(); i += 2) {
+			tiger_int(level[i], level[i + 1], next.emplace_back());
+		}
+		if (level.size() & 1) next.push_back(level.back());
+		level = std::move(next);
+	}
+	return level[0];
+}
+
 
 // TODO check that hash (re)calculation is indeed incremental
 
@@ -91,3 +113,52 @@ TEST_CASE("TigerTree")
 		      "PLHCYOTPV4TTXTUPHYGGVPMARGMFE4U5JYRV4VA");
 	}
 }
+
+TEST_CASE("TigerTree: many blocks and persistent cache")
+{
+	static constexpr auto BLOCK_SIZE = TigerTree::BLOCK_SIZE;
+	static constexpr size_t NUM_BLOCKS = 5000; // more than one parallel batch
+	std::vector<uint8_t> buffer_(NUM_BLOCKS * BLOCK_SIZE + 1);
+	auto buffer = std::span{buffer_}.subspan(1);
+	for (auto i : xrange(buffer.size())) buffer[i] = uint8_t(i * 7 + i / 1000);
+	TTTestData data;
+	data.buffer = buffer.data();
+	std::string name = "many blocks";
+	auto dummyCallback = [](size_t, size_t) {};
+
+	TigerTree tt1(data, buffer.size(), name);
+	CHECK(tt1.calcHash(dummyCallback).toString() == referenceHash(buffer).toString());
+	CHECK(tt1.needSavePersistent());
+	auto saved = tt1.savePersistent();
+	CHECK(!saved.empty());
+	CHECK(!tt1.needSavePersistent());
+
+	SECTION("load valid cache") {
+		TigerTree tt2(data, buffer.size(), name); // cache is invalidated
+		data.cacheValid = true;
+		CHECK(tt2.loadPersistent(saved));
+		CHECK(!tt2.needSavePersistent());
+
+		// modify the data, only the blocks below the modified node are rehashed
+		std::ranges::fill(buffer.subspan(1234 * BLOCK_SIZE + 10, 10), 0xAA);
+		tt2.notifyChange(1234 * BLOCK_SIZE + 10, 10, 0);
+		CHECK(tt2.needSavePersistent());
+		CHECK(tt2.calcHash(dummyCallback).toString() == referenceHash(buffer).toString());
+	}
+	SECTION("data modified since cache was stored") {
+		TigerTree tt2(data, buffer.size(), name);
+		data.cacheValid = false;
+		CHECK(!tt2.loadPersistent(saved));
+	}
+	SECTION("different name") {
+		TigerTree tt2(data, buffer.size(), "other name");
+		data.cacheValid = true;
+		CHECK(!tt2.loadPersistent(saved));
+	}
+	SECTION("corrupt data") {
+		TigerTree tt2(data, buffer.size(), name);
+		data.cacheValid = true;
+		saved.pop_back();
+		CHECK(!tt2.loadPersistent(saved));
+	}
+}
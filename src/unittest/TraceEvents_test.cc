@@ -0,0 +1,136 @@
+#include "catch.hpp"
+#include "TraceEvents.hh"
+
+#include "xrange.hh"
+
+#include <algorithm>
+#include <string>
+
+using namespace openmsx;
+
+static EmuTime t(uint64_t u) { return EmuTime::fromUint64(u); }
+
+TEST_CASE("TraceEvents: append and lookup", "[TraceEvents]")
+{
+	TraceEvents events;
+	CHECK(events.empty());
+	CHECK(events.lowerBound(t(0)) == events.end());
+
+	// more than one chunk, with duplicate times
+	auto n = 3 * TraceEvents::CHUNK_SIZE + 10;
+	for (auto i : xrange(n)) {
+		events.push_back(t(10 * (i / 2)), uint64_t(i));
+	}
+	REQUIRE(events.size() == n);
+	CHECK(events.front().value == TraceValue(uint64_t(0)));
+	CHECK(events.back().time == t(10 * ((n - 1) / 2)));
+	for (auto i : xrange(n)) {
+		CHECK(events[i].value == TraceValue(uint64_t(i)));
+	}
+
+	// same result as the generic algorithms
+	for (auto time : {0, 5, 10, 20475, 20480, 20485, 40960, 61490, 1'000'000}) {
+		auto lo = std::ranges::lower_bound(events, t(time), {}, &TraceEvent::time);
+		auto hi = std::ranges::upper_bound(events, t(time), {}, &TraceEvent::time);
+		CHECK(events.lowerBound(t(time)) == lo);
+		CHECK(events.upperBound(t(time)) == hi);
+		CHECK(timelineUpperBound(events.begin(), events.end(), t(time)) == hi);
+	}
+	// restricted range
+	auto first = events.begin() + 100;
+	auto last = events.begin() + 200;
+	CHECK(events.lowerBound(first, last, t(0)) == first);
+	CHECK(events.upperBound(first, last, t(100'000)) == last);
+	CHECK(events.upperBound(first, last, t(600)) == events.begin() + 122);
+
+	CHECK(TraceEvents::findClosest(events.begin(), events.end(), t(13)).getTime() == t(10));
+	CHECK(TraceEvents::findClosest(events.begin(), events.end(), t(15)).getTime() == t(10));
+	CHECK(TraceEvents::findClosest(events.begin(), events.end(), t(16)).getTime() == t(20));
+	CHECK(TraceEvents::findClosest(first, first, t(16)) == first);
+
+	auto between = events.between(t(20), t(40));
+	CHECK(between.size() == 4);
+	CHECK(between.front().value == TraceValue(uint64_t(4)));
+}
+
+TEST_CASE("TraceEvents: large time gaps", "[TraceEvents]")
+{
+	TraceEvents events;
+	events.push_back(t(5), 1);
+	events.push_back(t(6), 2);
+	events.push_back(t(uint64_t(1) << 40), 3); // doesn't fit in a 32-bit offset
+	events.push_back(t((uint64_t(1) << 40) + 1), 4);
+	CHECK(events.getTime(0) == t(5));
+	CHECK(events.getTime(1) == t(6));
+	CHECK(events.getTime(2) == t(uint64_t(1) << 40));
+	CHECK(events.getTime(3) == t((uint64_t(1) << 40) + 1));
+	CHECK(events.lowerBound(t(7)).getIndex() == 2);
+}
+
+TEST_CASE("TraceEvents: truncate", "[TraceEvents]")
+{
+	TraceEvents events;
+	auto n = 2 * TraceEvents::CHUNK_SIZE + 5;
+	for (auto i : xrange(n)) events.push_back(t(i), uint64_t(i));
+
+	events.eraseFrom(t(n)); // nothing
+	CHECK(events.size() == n);
+	events.eraseFrom(t(TraceEvents::CHUNK_SIZE + 3));
+	CHECK(events.size() == TraceEvents::CHUNK_SIZE + 3);
+	CHECK(events.back().value == TraceValue(uint64_t(TraceEvents::CHUNK_SIZE + 2)));
+
+	// can append again after truncating
+	events.push_back(t(1'000'000), std::string_view("foo"));
+	CHECK(events.size() == TraceEvents::CHUNK_SIZE + 4);
+	CHECK(events.back().value == TraceValue(std::string_view("foo")));
+
+	events.eraseFrom(t(TraceEvents::CHUNK_SIZE));
+	CHECK(events.size() == TraceEvents::CHUNK_SIZE);
+	events.clear();
+	CHECK(events.empty());
+}
+
+TEST_CASE("TraceEvents: move values to disk", "[TraceEvents]")
+{
+	auto& storage = TraceStorage::instance();
+	storage.setMemoryLimit(0); // keep as few chunks in memory as possible
+
+	auto value = [](size_t i) -> TraceValue {
+		switch (i % 4) {
+			case 0: return std::monostate{};
+			case 1: return uint64_t(i);
+			case 2: return double(i) / 2.0;
+			default: return std::string_view(std::string(i % 37, 'x') + std::to_string(i));
+		}
+	};
+
+	TraceEvents events1;
+	TraceEvents events2;
+	auto n = 5 * TraceEvents::CHUNK_SIZE + 7;
+	for (auto i : xrange(n)) {
+		events1.push_back(t(i), value(i));
+		events2.push_back(t(2 * i), value(n - i));
+	}
+	CHECK(storage.getDiskUsage() > 0);
+
+	// access in a non-sequential order, chunks get reloaded (and moved
+	// to disk again)
+	for (auto i : xrange(1000)) {
+		auto j = (i * 7919) % n;
+		CHECK(events1[j].value == value(j));
+		CHECK(events2[j].value == value(n - j));
+	}
+
+	// truncate a chunk that was moved to disk
+	events1.eraseFrom(t(TraceEvents::CHUNK_SIZE + 1));
+	CHECK(events1.size() == TraceEvents::CHUNK_SIZE + 1);
+	CHECK(events1.back().value == value(TraceEvents::CHUNK_SIZE));
+	events1.push_back(t(n), value(n));
+	CHECK(events1.back().value == value(n));
+	CHECK(events1[0].value == value(0));
+
+	events1.clear();
+	events2.clear();
+	CHECK(storage.getMemoryUsage() == 0);
+	storage.setMemoryLimit(size_t(-1));
+}
@@ -0,0 +1,119 @@
+#include "catch.hpp"
+#include "V9990LogOp.hh"
+
+#include "xrange.hh"
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace openmsx;
+using namespace openmsx::V9990LogOp;
+
+// The row based blendBytes() and blendWords() must give the same results as
+// the per pixel routines in V9990CmdEngine, which use the getLUT() tables.
+
+// Long enough to cover both the SIMD loop and the scalar tail.
+static constexpr size_t NUM = 16 * 3 + 5;
+
+static std::vector<uint8_t> randomBytes(std::mt19937& rng, size_t num)
+{
+	std::uniform_int_distribution<int> dist(0, 255);
+	std::vector<uint8_t> result(num);
+	for (auto& b : result) b = uint8_t(dist(rng));
+	return result;
+}
+
+// Like V9990Bpp8::pset()
+static uint8_t referenceBpp8(uint8_t op, uint8_t src, uint8_t dst, uint8_t mask)
+{
+	auto lut = getLUT((op & 0x10) ? Log::BPP8 : Log::NO_T, op);
+	uint8_t newColor = lut[256 * dst + src];
+	return uint8_t((dst & ~mask) | (newColor & mask));
+}
+
+// Like V9990Bpp16::pset()
+static uint16_t referenceBpp16(uint8_t op, uint16_t src, uint16_t dst, uint16_t mask)
+{
+	auto lut = getLUT(Log::NO_T, op);
+	uint16_t newColor = ((op & 0x10) && (src == 0))
+		? dst
+		: uint16_t((lut[((dst & 0x00FF) << 8) + ((src & 0x00FF) >> 0)] << 0) +
+		           (lut[((dst & 0xFF00) << 0) + ((src & 0xFF00) >> 8)] << 8));
+	return uint16_t((dst & ~mask) | (newColor & mask));
+}
+
+TEST_CASE("V9990LogOp: blendBytes")
+{
+	std::mt19937 rng(1234); // fixed seed
+	for (auto op : xrange(uint8_t(32))) {
+		for (uint8_t mask : {0xFF, 0x00, 0x5A}) {
+			auto src = randomBytes(rng, NUM);
+			auto dst = randomBytes(rng, NUM);
+			// make sure there are transparent source pixels
+			for (size_t i = 0; i < NUM; i += 3) src[i] = 0;
+
+			auto expected = dst;
+			for (auto i : xrange(NUM)) {
+				expected[i] = referenceBpp8(op, src[i], dst[i], mask);
+			}
+			auto actual = dst;
+			blendBytes(actual.data(), VRAMSource{src.data()}, NUM,
+			           LogOpMasks(op), mask, (op & 0x10) != 0);
+			CHECK(actual == expected);
+
+			for (uint8_t color : {uint8_t(0), src[1]}) {
+				for (auto i : xrange(NUM)) {
+					expected[i] = referenceBpp8(op, color, dst[i], mask);
+				}
+				actual = dst;
+				blendBytes(actual.data(), ColorSource{color}, NUM,
+				           LogOpMasks(op), mask, (op & 0x10) != 0);
+				CHECK(actual == expected);
+			}
+		}
+	}
+}
+
+TEST_CASE("V9990LogOp: blendWords")
+{
+	std::mt19937 rng(5678); // fixed seed
+	for (auto op : xrange(uint8_t(32))) {
+		for (uint16_t mask : {0xFFFF, 0x0000, 0x00FF, 0xA55A}) {
+			auto srcLo = randomBytes(rng, NUM);
+			auto srcHi = randomBytes(rng, NUM);
+			auto dstLo = randomBytes(rng, NUM);
+			auto dstHi = randomBytes(rng, NUM);
+			// only the full zero pixels are transparent, not the ones
+			// with just a zero low or high byte
+			for (size_t i = 0; i < NUM; i += 3) { srcLo[i] = 0; srcHi[i] = 0; }
+			for (size_t i = 1; i < NUM; i += 5) srcLo[i] = 0;
+			for (size_t i = 2; i < NUM; i += 7) srcHi[i] = 0;
+
+			auto check = [&](auto sourceLo, auto sourceHi, auto getSrc) {
+				auto expectedLo = dstLo;
+				auto expectedHi = dstHi;
+				for (auto i : xrange(NUM)) {
+					auto dst = uint16_t(dstLo[i] | (dstHi[i] << 8));
+					auto r = referenceBpp16(op, getSrc(i), dst, mask);
+					expectedLo[i] = uint8_t(r & 0xFF);
+					expectedHi[i] = uint8_t(r >> 8);
+				}
+				auto actualLo = dstLo;
+				auto actualHi = dstHi;
+				blendWords(actualLo.data(), actualHi.data(), sourceLo, sourceHi,
+				           NUM, LogOpMasks(op), mask, (op & 0x10) != 0);
+				CHECK(actualLo == expectedLo);
+				CHECK(actualHi == expectedHi);
+			};
+
+			check(VRAMSource{srcLo.data()}, VRAMSource{srcHi.data()},
+			      [&](size_t i) { return uint16_t(srcLo[i] | (srcHi[i] << 8)); });
+			for (uint16_t color : {0x0000, 0x0012, 0x3400, 0x5678}) {
+				check(ColorSource{uint8_t(color & 0xFF)}, ColorSource{uint8_t(color >> 8)},
+				      [&](size_t /*i*/) { return color; });
+			}
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#include "catch.hpp"
+#include "XSAExtractor.hh"
+
+#include "xrange.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+using namespace openmsx;
+
+// 1500 bytes, compressed with literals, short and long (> 512 bytes) matches
+static constexpr std::array<uint8_t, 158> xsaData = {
+	0x50, 0x43, 0x4b, 0x08, 0xdc, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x78, 0x00, 0x02, 0x6f, 0x70, 0x00, 0x65, 0x6e, 0x53, 0x20, 0x53, 0x20,
+	0x65, 0x53, 0x00, 0x58, 0x6f, 0x4d, 0x58, 0x6f, 0x53, 0x41, 0x6e, 0x86,
+	0x53, 0x00, 0x41, 0x53, 0x6f, 0x58, 0x4d, 0x6f, 0x58, 0x53, 0xe6, 0x65,
+	0x0e, 0x53, 0x6e, 0x65, 0x70, 0x0b, 0xfa, 0xff, 0x1b, 0xfc, 0xff, 0x37,
+	0xf8, 0x5f, 0x08, 0x1e, 0x2c, 0xf0, 0x33, 0xcc, 0x99, 0xe1, 0x20, 0x6e,
+	0x70, 0x65, 0xe1, 0x0b, 0x6f, 0x65, 0x53, 0x6e, 0xe0, 0x20, 0x20, 0x53,
+	0x65, 0x58, 0x11, 0x1b, 0x41, 0x53, 0x6e, 0xfe, 0x6e, 0x7f, 0x83, 0xff,
+	0xcb, 0x83, 0x03, 0x00, 0x25, 0x4a, 0x6f, 0x94, 0xb9, 0x00, 0xde, 0x03,
+	0x28, 0x4d, 0x72, 0x97, 0xbc, 0xe1, 0x00, 0x06, 0x2b, 0x50, 0x75, 0x9a,
+	0xbf, 0xe4, 0x09, 0x00, 0x2e, 0x53, 0x78, 0x9d, 0xc2, 0xe7, 0x0c, 0x31,
+	0x00, 0x56, 0x7b, 0xa0, 0xc5, 0xea, 0x0f, 0x34, 0x59, 0xfc, 0x7e, 0xa3,
+	0x47, 0x56, 0x7e, 0xe3, 0x40, 0xff, 0x77, 0xfe, 0x5d, 0x03, 0x82, 0xff,
+	0xff, 0x01,
+};
+
+static std::vector<uint8_t> expectedData()
+{
+	std::vector<uint8_t> result(1500);
+	for (auto i : xrange(result.size())) {
+		result[i] = uint8_t((i < 600) ? "openMSX XSA "[(i * i / 7) % 12]
+		                              : result[i - 580 + (i % 3)]);
+	}
+	for (auto i : xrange(40)) result[1000 + i] = uint8_t(i * 37);
+	return result;
+}
+
+TEST_CASE("XSAExtractor")
+{
+	SECTION("valid image") {
+		CHECK(XSAExtractor::getNbSectors(xsaData) == 3);
+
+		XSAExtractor extractor(xsaData);
+		auto data = std::move(extractor).extractData();
+		REQUIRE(data.size() == 3);
+		std::span<const uint8_t> bytes{data.data()->raw.data(), 3 * 512};
+		auto expected = expectedData();
+		CHECK(std::ranges::equal(bytes.first(1500), expected));
+		// remainder of the last sector is zero-filled
+		CHECK(std::ranges::all_of(bytes.subspan(1500), [](uint8_t b) { return b == 0; }));
+	}
+	SECTION("not an XSA image") {
+		auto copy = xsaData;
+		copy[2] = 'X';
+		CHECK_THROWS((void)XSAExtractor::getNbSectors(copy));
+		CHECK_THROWS(XSAExtractor{copy});
+		CHECK_THROWS((void)XSAExtractor::getNbSectors(std::span{xsaData}.first(6)));
+	}
+	SECTION("truncated image") {
+		CHECK_THROWS(XSAExtractor{std::span{xsaData}.first(100)});
+	}
+}
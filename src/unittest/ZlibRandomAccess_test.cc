@@ -0,0 +1,79 @@
+#include "catch.hpp"
+#include "ZlibRandomAccess.hh"
+
+#include "xrange.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#define ZLIB_CONST
+#include <zlib.h>
+
+using namespace openmsx;
+
+static std::vector<uint8_t> rawDeflate(const std::vector<uint8_t>& input)
+{
+	z_stream s = {};
+	REQUIRE(deflateInit2(&s, 6, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+	std::vector<uint8_t> result(deflateBound(&s, uLong(input.size())));
+	s.next_in = input.data();
+	s.avail_in = uInt(input.size());
+	s.next_out = result.data();
+	s.avail_out = uInt(result.size());
+	REQUIRE(deflate(&s, Z_FINISH) == Z_STREAM_END);
+	result.resize(s.total_out);
+	deflateEnd(&s);
+	return result;
+}
+
+TEST_CASE("ZlibRandomAccess")
+{
+	// compressible, but not too much, data spanning several chunks
+	std::vector<uint8_t> data(3 * ZlibRandomAccess::SPAN + 12345);
+	uint32_t r = 1;
+	for (auto i : xrange(data.size())) {
+		r = r * 1103515245 + 12345;
+		data[i] = ((i > 1000) && ((r >> 16) & 3)) ? data[i - 1 - (r >> 8) % 900]
+		                                           : uint8_t(r >> 24);
+	}
+	auto compressed = rawDeflate(data);
+
+	auto check = [&](const ZlibRandomAccess& index) {
+		REQUIRE(index.getSize() == data.size());
+		CHECK(index.getChunkStart(0) == 0);
+		CHECK(index.getChunkStart(index.getNumChunks()) == data.size());
+		for (auto chunk : xrange(index.getNumChunks())) {
+			auto start = index.getChunkStart(chunk);
+			auto end   = index.getChunkStart(chunk + 1);
+			CHECK(index.findChunk(start) == chunk);
+			CHECK(index.findChunk(end - 1) == chunk);
+			std::vector<uint8_t> out(end - start);
+			index.inflateChunk(compressed, chunk, out);
+			CHECK(std::equal(out.begin(), out.end(), data.begin() + start));
+		}
+	};
+
+	ZlibRandomAccess index(compressed);
+	CHECK(index.getNumChunks() > 1);
+	check(index);
+
+	SECTION("save/load") {
+		auto saved = index.save("name", 1234);
+		auto loaded = ZlibRandomAccess::load(saved, "name", compressed.size(), 1234);
+		REQUIRE(loaded);
+		check(*loaded);
+
+		// mismatch in name, size or time
+		CHECK(!ZlibRandomAccess::load(saved, "other", compressed.size(), 1234));
+		CHECK(!ZlibRandomAccess::load(saved, "name", compressed.size() + 1, 1234));
+		CHECK(!ZlibRandomAccess::load(saved, "name", compressed.size(), 1235));
+		// truncated
+		saved.pop_back();
+		CHECK(!ZlibRandomAccess::load(saved, "name", compressed.size(), 1234));
+	}
+	SECTION("truncated stream") {
+		compressed.resize(compressed.size() / 2);
+		CHECK_THROWS(ZlibRandomAccess{compressed});
+	}
+}
@@ -8,6 +8,7 @@
 #include <bit>
 #include <cstring>
 #include <sstream>
+#include <vector>
 
 using namespace openmsx;
 
@@ -142,6 +143,14 @@ TEST_CASE("sha1: update,digest")
 		Sha1Sum sum = sha1.digest();
 		CHECK(sum.toString(buf) == "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
 	}
+	SECTION("many blocks in one update") {
+		// unaligned start, many complete blocks, partial last block
+		std::vector<uint8_t> in(1'000'000, 'a');
+		sha1.update(std::span{in}.first(7));
+		sha1.update(std::span{in}.subspan(7));
+		Sha1Sum sum = sha1.digest();
+		CHECK(sum.toString(buf) == "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+	}
 }
 
 TEST_CASE("sha1: finalize")
@@ -3,11 +3,20 @@
 #include "Math.hh"
 #include "MemBuffer.hh"
 #include "ScopedAssign.hh"
+#include "enumerate.hh"
+#include "narrow.hh"
 #include "tiger.hh"
+#include "xrange.hh"
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <cstring>
 #include <map>
 #include <span>
+#include <string_view>
+#include <thread>
 
 namespace openmsx {
 
@@ -20,6 +29,7 @@ struct TTCacheEntry
 	MemBuffer<Info> nodes;
 	time_t time = -1;
 	size_t numNodesValid;
+	bool dirty = false; // persistent part changed since last save/load
 };
 // Typically contains 0 or 1 element, and only rarely 2 or more. But we need
 // the address of existing elements to remain stable when new elements are
@@ -41,20 +51,65 @@ static std::map<std::pair<size_t, std::string>, TTCacheEntry> ttCache;
 		result.nodes.resize(numNodes);
 		for (auto& i : result.nodes) i.valid = false; // all invalid
 		result.numNodesValid = 0;
+		result.dirty = false;
 	}
 	return result;
 }
 
-TigerTree::TigerTree(TTData& data_, size_t dataSize_, const std::string& name)
+// Format of the data produced by savePersistent(). This is only a cache on the
+// local machine, so there's no need to care about endianness.
+struct PersistHeader {
+	std::array<char, 8> magic;
+	uint32_t version;
+	uint32_t nameSize;
+	uint64_t dataSize;
+	int64_t time;
+	uint64_t numNodes;
+	// followed by 'nameSize' bytes and 'numNodes' PersistNode structs
+};
+struct PersistNode {
+	uint64_t n;
+	TigerHash hash;
+};
+static constexpr std::array<char, 8> PERSIST_MAGIC = {'o', 'M', 'S', 'X', 't', 't', 'h', '\0'};
+static constexpr uint32_t PERSIST_VERSION = 1;
+
+static_assert(std::has_single_bit(TigerTree::PERSIST_BLOCKS));
+[[nodiscard]] static constexpr bool isPersistentNode(size_t n)
+{
+	// The level of a node is 2^(number of trailing 1-bits of its number),
+	// see the description of the tree layout below.
+	constexpr auto mask = TigerTree::PERSIST_BLOCKS - 1;
+	return (n & mask) == mask;
+}
+
+// Hashing the leaves is by far the most expensive part of the calculation.
+// When many leaves need to be (re)calculated (e.g. the first time for a large
+// hard disk image), their data is fetched in batches, and each batch is hashed
+// in parallel.
+static constexpr size_t PARALLEL_MIN_BLOCKS = 256;
+static constexpr size_t PARALLEL_BATCH_BLOCKS = 4096;
+
+TigerTree::TigerTree(TTData& data_, size_t dataSize_, const std::string& name_)
 	: data(data_)
 	, dataSize(dataSize_)
+	, name(name_)
 	, entry(getCacheEntry(data, dataSize, name))
 {
 }
 
 const TigerHash& TigerTree::calcHash(const std::function<void(size_t, size_t)>& progressCallback)
 {
-	return calcHash(getTop(), progressCallback);
+	auto top = getTop();
+	if (!entry.nodes[top.n].valid) {
+		std::vector<size_t> blocks;
+		collectInvalidLeaves(top, blocks, progressCallback);
+		if (blocks.size() >= PARALLEL_MIN_BLOCKS) {
+			hashLeavesParallel(blocks, progressCallback);
+		}
+		// the remaining (few) leaves are handled below
+	}
+	return calcHash(top, progressCallback);
 }
 
 void TigerTree::notifyChange(size_t offset, size_t len, time_t time)
@@ -63,24 +118,159 @@ void TigerTree::notifyChange(size_t offset, size_t len, time_t time)
 
 	assert((offset + len) <= dataSize);
 	if (len == 0) return;
+	entry.dirty = true;
 
-	if (entry.nodes[getTop().n].valid) {
-		entry.nodes[getTop().n].valid = false; // set sentinel
-		entry.numNodesValid--;
-	}
+	// Always walk up to the top: after loadPersistent() a valid node can
+	// have invalid descendants, so we can't stop at the first invalid node.
+	auto top = getTop().n;
 	auto first = offset / BLOCK_SIZE;
 	auto last = (offset + len - 1) / BLOCK_SIZE;
 	assert(first <= last); // requires len != 0
 	do {
 		auto node = getLeaf(first);
-		while (entry.nodes[node.n].valid) {
-			entry.nodes[node.n].valid = false;
-			entry.numNodesValid--;
+		while (true) {
+			if (auto& nod = entry.nodes[node.n]; nod.valid) {
+				nod.valid = false;
+				entry.numNodesValid--;
+			}
+			if (node.n == top) break;
 			node = getParent(node);
 		}
 	} while (++first <= last);
 }
 
+bool TigerTree::needSavePersistent() const
+{
+	return entry.dirty;
+}
+
+std::vector<uint8_t> TigerTree::savePersistent()
+{
+	entry.dirty = false;
+
+	std::vector<PersistNode> nodes;
+	for (auto n = PERSIST_BLOCKS - 1; n < entry.nodes.size(); n += PERSIST_BLOCKS) {
+		assert(isPersistentNode(n));
+		if (const auto& nod = entry.nodes[n]; nod.valid) {
+			nodes.push_back({n, nod.hash});
+		}
+	}
+	if (nodes.empty()) return {};
+
+	PersistHeader header = {
+		.magic = PERSIST_MAGIC,
+		.version = PERSIST_VERSION,
+		.nameSize = narrow<uint32_t>(name.size()),
+		.dataSize = dataSize,
+		.time = entry.time,
+		.numNodes = nodes.size(),
+	};
+	auto nodesStart = sizeof(header) + name.size();
+	std::vector<uint8_t> result(nodesStart + nodes.size() * sizeof(PersistNode));
+	memcpy(&result[0], &header, sizeof(header));
+	memcpy(&result[sizeof(header)], name.data(), name.size());
+	memcpy(&result[nodesStart], nodes.data(), nodes.size() * sizeof(PersistNode));
+	return result;
+}
+
+bool TigerTree::loadPersistent(std::span<const uint8_t> buf)
+{
+	if (entry.numNodesValid != 0) return false; // don't overwrite newer results
+	if (buf.size() < sizeof(PersistHeader)) return false;
+
+	PersistHeader header;
+	memcpy(&header, buf.data(), sizeof(header));
+	if ((header.magic != PERSIST_MAGIC) ||
+	    (header.version != PERSIST_VERSION) ||
+	    (header.dataSize != dataSize) ||
+	    (header.nameSize != name.size()) ||
+	    (header.numNodes > entry.nodes.size())) {
+		return false;
+	}
+	auto nodesStart = sizeof(header) + name.size();
+	if (buf.size() != (nodesStart + header.numNodes * sizeof(PersistNode))) return false;
+	if (std::string_view(std::bit_cast<const char*>(&buf[sizeof(header)]), name.size()) != name) {
+		return false;
+	}
+	auto time = time_t(header.time);
+	if (!data.isCacheStillValid(time)) return false; // the data was modified
+
+	for (auto i : xrange(header.numNodes)) {
+		PersistNode node;
+		memcpy(&node, &buf[nodesStart + i * sizeof(PersistNode)], sizeof(node));
+		if ((node.n >= entry.nodes.size()) || !isPersistentNode(node.n)) {
+			// corrupt, undo
+			for (auto& nod : entry.nodes) nod.valid = false;
+			entry.numNodesValid = 0;
+			return false;
+		}
+		auto& nod = entry.nodes[node.n];
+		if (!nod.valid) entry.numNodesValid++;
+		nod.hash = node.hash;
+		nod.valid = true;
+	}
+	entry.time = time;
+	entry.dirty = false;
+	return true;
+}
+
+void TigerTree::collectInvalidLeaves(
+	Node node, std::vector<size_t>& blocks, const std::function<void(size_t, size_t)>& progressCallback)
+{
+	if (entry.nodes[node.n].valid) return; // no need to look at descendants
+	if (node.n & 1) {
+		collectInvalidLeaves(getLeftChild (node), blocks, progressCallback);
+		collectInvalidLeaves(getRightChild(node), blocks, progressCallback);
+	} else {
+		auto block = node.n / 2;
+		if (((block + 1) * BLOCK_SIZE) > dataSize) return; // partial last block
+		blocks.push_back(block);
+		if (blocks.size() == PARALLEL_BATCH_BLOCKS) {
+			hashLeavesParallel(blocks, progressCallback);
+			blocks.clear();
+		}
+	}
+}
+
+void TigerTree::hashLeavesParallel(
+	std::span<const size_t> blocks, const std::function<void(size_t, size_t)>& progressCallback)
+{
+	// Leave room for the byte in front of each block, see tiger_leaf().
+	static constexpr size_t STRIDE = BLOCK_SIZE + 64;
+	MemBuffer<uint8_t> buf(blocks.size() * STRIDE);
+	auto getBlock = [&](size_t i) { return std::span{&buf[i * STRIDE + 64], BLOCK_SIZE}; };
+
+	// TTData is not thread-safe, so fetch all data first.
+	for (auto [i, block] : enumerate(blocks)) {
+		memcpy(getBlock(i).data(), data.getData(block * BLOCK_SIZE, BLOCK_SIZE), BLOCK_SIZE);
+	}
+
+	auto hashRange = [&](size_t begin, size_t end) {
+		for (auto i : xrange(begin, end)) {
+			tiger_leaf(getBlock(i), entry.nodes[2 * blocks[i]].hash);
+		}
+	};
+	auto numThreads = std::max(1u, std::thread::hardware_concurrency());
+	auto chunk = (blocks.size() + numThreads - 1) / numThreads;
+	std::vector<std::thread> threads;
+	for (auto begin = chunk; begin < blocks.size(); begin += chunk) {
+		threads.emplace_back(hashRange, begin, std::min(begin + chunk, blocks.size()));
+	}
+	hashRange(0, std::min(chunk, blocks.size()));
+	for (auto& t : threads) t.join();
+
+	for (auto block : blocks) {
+		auto& nod = entry.nodes[2 * block];
+		assert(!nod.valid);
+		nod.valid = true;
+	}
+	entry.numNodesValid += blocks.size();
+	entry.dirty = true;
+	if (progressCallback) {
+		progressCallback(entry.numNodesValid, entry.nodes.size());
+	}
+}
+
 const TigerHash& TigerTree::calcHash(Node node, const std::function<void(size_t, size_t)>& progressCallback)
 {
 	auto n = node.n;
@@ -110,6 +300,7 @@ const TigerHash& TigerTree::calcHash(Node node, const std::function<void(size_t,
 		}
 		nod.valid = true;
 		entry.numNodesValid++;
+		entry.dirty = true;
 		if (progressCallback) {
 			progressCallback(entry.numNodesValid, entry.nodes.size());
 		}
@@ -31,7 +31,9 @@
 #include <cstdint>
 #include <ctime>
 #include <functional>
+#include <span>
 #include <string>
+#include <vector>
 
 namespace openmsx {
 
@@ -90,6 +92,33 @@ public:
 	 */
 	void notifyChange(size_t offset, size_t len, time_t time);
 
+	/** Support for a persistent cache (e.g. in a file), so that the hash
+	 * of a large, unmodified file doesn't need to be recalculated from
+	 * scratch after a restart.
+	 *
+	 * Only the upper part of the tree is stored: the nodes that (normally)
+	 * cover PERSIST_BLOCKS or more blocks. Storing all nodes would take
+	 * more than 2% of the file size. The price is that after a change, the blocks
+	 * below such a stored node need to be rehashed (once).
+	 */
+	static constexpr size_t PERSIST_BLOCKS = 64;
+
+	/** Has the (persistent part of the) tree changed since the last
+	 * savePersistent() or loadPersistent() call? */
+	[[nodiscard]] bool needSavePersistent() const;
+
+	/** Serialize the persistent part of the tree. Returns an empty buffer
+	 * when there's nothing worth storing. */
+	[[nodiscard]] std::vector<uint8_t> savePersistent();
+
+	/** Restore the state stored by savePersistent(). The data is ignored
+	 * if it doesn't match (e.g. the file was modified in the mean time,
+	 * see TTData::isCacheStillValid()) or when this tree already has
+	 * valid nodes.
+	 * @result Whether the data was used.
+	 */
+	bool loadPersistent(std::span<const uint8_t> buf);
+
 private:
 	// functions to navigate in binary tree
 	struct Node {
@@ -104,10 +133,14 @@ private:
 	[[nodiscard]] Node getRightChild(Node node) const;
 
 	[[nodiscard]] const TigerHash& calcHash(Node node, const std::function<void(size_t, size_t)>& progressCallback);
+	void collectInvalidLeaves(Node node, std::vector<size_t>& blocks,
+	                          const std::function<void(size_t, size_t)>& progressCallback);
+	void hashLeavesParallel(std::span<const size_t> blocks, const std::function<void(size_t, size_t)>& progressCallback);
 
 private:
 	TTData& data;
 	const size_t dataSize;
+	const std::string name;
 	TTCacheEntry& entry;
 };
 
@@ -34,6 +34,13 @@ A million repetitions of "a"
 #ifdef __SSE2__
 #include <emmintrin.h> // SSE2
 #endif
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SHA1_USE_SHA_NI 1
+#include <cpuid.h>
+#include <immintrin.h> // SHA extensions, selected at runtime
+#else
+#define SHA1_USE_SHA_NI 0
+#endif
 
 namespace openmsx {
 
@@ -270,16 +277,16 @@ SHA1::SHA1()
 	m_state.a[4] = 0xC3D2E1F0;
 }
 
-void SHA1::transform(std::span<const uint8_t, 64> buffer)
+static void transformGeneric(std::array<uint32_t, 5>& state, std::span<const uint8_t, 64> buffer)
 {
 	WorkspaceBlock block(buffer);
 
-	// Copy m_state[] to working vars
-	uint32_t a = m_state.a[0];
-	uint32_t b = m_state.a[1];
-	uint32_t c = m_state.a[2];
-	uint32_t d = m_state.a[3];
-	uint32_t e = m_state.a[4];
+	// Copy state[] to working vars
+	uint32_t a = state[0];
+	uint32_t b = state[1];
+	uint32_t c = state[2];
+	uint32_t d = state[3];
+	uint32_t e = state[4];
 
 	// 4 rounds of 20 operations each. Loop unrolled
 	block.r0(a,b,c,d,e, 0); block.r0(e,a,b,c,d, 1); block.r0(d,e,a,b,c, 2);
@@ -310,12 +317,113 @@ void SHA1::transform(std::span<const uint8_t, 64> buffer)
 	block.r4(a,b,c,d,e,75); block.r4(e,a,b,c,d,76); block.r4(d,e,a,b,c,77);
 	block.r4(c,d,e,a,b,78); block.r4(b,c,d,e,a,79);
 
-	// Add the working vars back into m_state[]
-	m_state.a[0] += a;
-	m_state.a[1] += b;
-	m_state.a[2] += c;
-	m_state.a[3] += d;
-	m_state.a[4] += e;
+	// Add the working vars back into state[]
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
+#if SHA1_USE_SHA_NI
+// Implementation using the x86 SHA extensions. Each step performs 4 of the 80
+// rounds and (interleaved) calculates the message schedule for later steps.
+// The message words rotate through 4 registers, 'm0' holds the words for the
+// current step, 'm1'-'m3' those for the next steps. The 'e' value alternates
+// between two registers.
+#define SHA_NI_TARGET __attribute__((target("sha,sse4.1")))
+
+template<int K>
+SHA_NI_TARGET __attribute__((always_inline)) static inline void shaNiStep(
+	__m128i& abcd, __m128i& e, __m128i& eNext,
+	const __m128i& m0, __m128i& m1, __m128i& m2, __m128i& m3)
+{
+	if constexpr (K == 0) {
+		e = _mm_add_epi32(e, m0);
+	} else {
+		e = _mm_sha1nexte_epu32(e, m0);
+	}
+	eNext = abcd;
+	if constexpr (K >= 3 && K <= 18) m1 = _mm_sha1msg2_epu32(m1, m0);
+	abcd = _mm_sha1rnds4_epu32(abcd, e, K / 5);
+	if constexpr (K >= 1 && K <= 16) m3 = _mm_sha1msg1_epu32(m3, m0);
+	if constexpr (K >= 2 && K <= 17) m2 = _mm_xor_si128(m2, m0);
+}
+
+SHA_NI_TARGET static void transformShaNi(std::array<uint32_t, 5>& state, std::span<const uint8_t> blocks)
+{
+	assert((blocks.size() % 64) == 0);
+	const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607, 0x08090a0b0c0d0e0f);
+
+	__m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(std::bit_cast<const __m128i*>(state.data())), 0x1b);
+	__m128i e0 = _mm_set_epi32(narrow_cast<int>(state[4]), 0, 0, 0);
+
+	for (size_t i = 0; i < blocks.size(); i += 64) {
+		const auto* p = std::bit_cast<const __m128i*>(&blocks[i]);
+		__m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128(p + 0), byteSwap);
+		__m128i m1 = _mm_shuffle_epi8(_mm_loadu_si128(p + 1), byteSwap);
+		__m128i m2 = _mm_shuffle_epi8(_mm_loadu_si128(p + 2), byteSwap);
+		__m128i m3 = _mm_shuffle_epi8(_mm_loadu_si128(p + 3), byteSwap);
+		__m128i abcdSave = abcd;
+		__m128i eSave = e0;
+		__m128i e1;
+
+		shaNiStep< 0>(abcd, e0, e1, m0, m1, m2, m3);
+		shaNiStep< 1>(abcd, e1, e0, m1, m2, m3, m0);
+		shaNiStep< 2>(abcd, e0, e1, m2, m3, m0, m1);
+		shaNiStep< 3>(abcd, e1, e0, m3, m0, m1, m2);
+		shaNiStep< 4>(abcd, e0, e1, m0, m1, m2, m3);
+		shaNiStep< 5>(abcd, e1, e0, m1, m2, m3, m0);
+		shaNiStep< 6>(abcd, e0, e1, m2, m3, m0, m1);
+		shaNiStep< 7>(abcd, e1, e0, m3, m0, m1, m2);
+		shaNiStep< 8>(abcd, e0, e1, m0, m1, m2, m3);
+		shaNiStep< 9>(abcd, e1, e0, m1, m2, m3, m0);
+		shaNiStep<10>(abcd, e0, e1, m2, m3, m0, m1);
+		shaNiStep<11>(abcd, e1, e0, m3, m0, m1, m2);
+		shaNiStep<12>(abcd, e0, e1, m0, m1, m2, m3);
+		shaNiStep<13>(abcd, e1, e0, m1, m2, m3, m0);
+		shaNiStep<14>(abcd, e0, e1, m2, m3, m0, m1);
+		shaNiStep<15>(abcd, e1, e0, m3, m0, m1, m2);
+		shaNiStep<16>(abcd, e0, e1, m0, m1, m2, m3);
+		shaNiStep<17>(abcd, e1, e0, m1, m2, m3, m0);
+		shaNiStep<18>(abcd, e0, e1, m2, m3, m0, m1);
+		shaNiStep<19>(abcd, e1, e0, m3, m0, m1, m2);
+
+		e0 = _mm_sha1nexte_epu32(e0, eSave);
+		abcd = _mm_add_epi32(abcd, abcdSave);
+	}
+
+	_mm_storeu_si128(std::bit_cast<__m128i*>(state.data()), _mm_shuffle_epi32(abcd, 0x1b));
+	state[4] = narrow_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+#undef SHA_NI_TARGET
+
+[[nodiscard]] static bool detectShaNi()
+{
+	unsigned eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+	bool ssse3  = ecx & (1 << 9);
+	bool sse4_1 = ecx & (1 << 19);
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+	bool sha = ebx & (1 << 29);
+	return ssse3 && sse4_1 && sha;
+}
+#endif
+
+// 'blocks' contains a whole number of 64-byte blocks
+static void transform(std::array<uint32_t, 5>& state, std::span<const uint8_t> blocks)
+{
+	assert((blocks.size() % 64) == 0);
+#if SHA1_USE_SHA_NI
+	static const bool hasShaNi = detectShaNi();
+	if (hasShaNi) {
+		transformShaNi(state, blocks);
+		return;
+	}
+#endif
+	for (size_t i = 0; i < blocks.size(); i += 64) {
+		transformGeneric(state, subspan<64>(blocks, i));
+	}
 }
 
 // Use this function to hash in binary data and strings
@@ -331,10 +439,11 @@ void SHA1::update(std::span<const uint8_t> data)
 	if ((j + len) > 63) {
 		i = 64 - j;
 		copy_to_range(data.subspan(0, i), subspan(m_buffer, j));
-		transform(m_buffer);
-		for (/**/; i + 63 < len; i += 64) {
-			transform(subspan<64>(data, i));
-		}
+		transform(m_state.a, m_buffer);
+		// all remaining complete blocks in one go
+		size_t n = (len - i) & ~size_t(63);
+		transform(m_state.a, data.subspan(i, n));
+		i += n;
 		j = 0;
 	} else {
 		i = 0;
@@ -350,13 +459,13 @@ void SHA1::finalize()
 	m_buffer[j++] = 0x80;
 	if (j > 56) {
 		std::ranges::fill(subspan(m_buffer, j, 64 - j), 0);
-		transform(m_buffer);
+		transform(m_state.a, m_buffer);
 		j = 0;
 	}
 	std::ranges::fill(subspan(m_buffer, j, 56 - j), 0);
 	Endian::B64 finalCount(8 * m_count); // convert number of bytes to bits
 	memcpy(&m_buffer[56], &finalCount, 8);
-	transform(m_buffer);
+	transform(m_state.a, m_buffer);
 
 	m_finalized = true;
 }
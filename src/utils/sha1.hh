@@ -115,7 +115,6 @@ public:
 	[[nodiscard]] static Sha1Sum calc(std::span<const uint8_t> data);
 
 private:
-	void transform(std::span<const uint8_t, 64> buffer);
 	void finalize();
 
 private:
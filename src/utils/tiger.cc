@@ -732,7 +732,7 @@ void tiger_int(const TigerHash& h0, const TigerHash& h1, TigerHash& result)
 
 void tiger_leaf(std::span<uint8_t> data, TigerHash& result)
 {
-	static std::array<uint8_t, 64> last = {
+	static constexpr std::array<uint8_t, 64> lastTemplate = {
 		0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -755,6 +755,7 @@ void tiger_leaf(std::span<uint8_t> data, TigerHash& result)
 		chunks = chunks.subspan<64>();
 	}
 
+	auto last = lastTemplate; // local copy keeps this function reentrant
 	last[0] = data.back();
 	tiger_compress(last, result.h64);
 
@@ -10,7 +10,6 @@ TODO:
 #include "CharacterConverter.hh"
 
 #include "VDP.hh"
-#include "VDPVRAM.hh"
 
 #include "ranges.hh"
 #include "xrange.hh"
@@ -28,8 +27,8 @@ namespace openmsx {
 using Pixel = CharacterConverter::Pixel;
 
 CharacterConverter::CharacterConverter(
-	VDP& vdp_, std::span<const Pixel, 16> palFg_, std::span<const Pixel, 16> palBg_)
-	: vdp(vdp_), vram(vdp.getVRAM()), palFg(palFg_), palBg(palBg_)
+	const VDP& vdp, std::span<const Pixel, 16> palFg_, std::span<const Pixel, 16> palBg_)
+	: palFg(palFg_), palBg(palBg_), msx1VDP(vdp.isMSX1VDP())
 {
 }
 
@@ -39,45 +38,46 @@ void CharacterConverter::setDisplayMode(DisplayMode mode)
 	assert(modeBase < 0x0C);
 }
 
-void CharacterConverter::convertLine(std::span<Pixel> buf, int line) const
+void CharacterConverter::convertLine(
+	std::span<Pixel> buf, int line, const State& state, bool blink) const
 {
 	// TODO: Support YJK on modes other than Graphic 6/7.
 	switch (modeBase) {
 	case DisplayMode::GRAPHIC1:   // screen 1
-		renderGraphic1(subspan<256>(buf), line);
+		renderGraphic1(subspan<256>(buf), line, state);
 		break;
 	case DisplayMode::TEXT1:      // screen 0, width 40
-		renderText1(subspan<256>(buf), line);
+		renderText1(subspan<256>(buf), line, state);
 		break;
 	case DisplayMode::MULTICOLOR: // screen 3
-		renderMulti(subspan<256>(buf), line);
+		renderMulti(subspan<256>(buf), line, state);
 		break;
 	case DisplayMode::GRAPHIC2:   // screen 2
-		renderGraphic2(subspan<256>(buf), line);
+		renderGraphic2(subspan<256>(buf), line, state);
 		break;
 	case DisplayMode::GRAPHIC3:   // screen 4
-		renderGraphic2(subspan<256>(buf), line); // graphic3, actually
+		renderGraphic2(subspan<256>(buf), line, state); // graphic3, actually
 		break;
 	case  DisplayMode::TEXT2:     // screen 0, width 80
-		renderText2(subspan<512>(buf), line);
+		renderText2(subspan<512>(buf), line, state, blink);
 		break;
 	case DisplayMode::TEXT1Q:     // TMSxxxx only
-		if (vdp.isMSX1VDP()) {
-			renderText1Q(subspan<256>(buf), line);
+		if (msx1VDP) {
+			renderText1Q(subspan<256>(buf), line, state);
 		} else {
 			renderBlank (subspan<256>(buf));
 		}
 		break;
 	case DisplayMode::MULTIQ:     // TMSxxxx only
-		if (vdp.isMSX1VDP()) {
-			renderMultiQ(subspan<256>(buf), line);
+		if (msx1VDP) {
+			renderMultiQ(subspan<256>(buf), line, state);
 		} else {
 			renderBlank (subspan<256>(buf));
 		}
 		break;
 	default: // remaining (non-bitmap) modes
-		if (vdp.isMSX1VDP()) {
-			renderBogus(subspan<256>(buf));
+		if (msx1VDP) {
+			renderBogus(subspan<256>(buf), state);
 		} else {
 			renderBlank(subspan<256>(buf));
 		}
@@ -139,14 +139,14 @@ static inline void draw8(
 	pixelPtr += 8;
 }
 
-void CharacterConverter::renderText1(std::span<Pixel, 256> buf, int line) const
+void CharacterConverter::renderText1(std::span<Pixel, 256> buf, int line, const State& state) const
 {
-	Pixel fg = palFg[vdp.getForegroundColor()];
-	Pixel bg = palFg[vdp.getBackgroundColor()];
+	Pixel fg = palFg[state.foregroundColor];
+	Pixel bg = palFg[state.backgroundColor];
 
 	// 8 * 256 is small enough to always be contiguous
-	auto patternArea = vram.patternTable.getReadArea<256 * 8>(0);
-	auto l = (line + vdp.getVerticalScroll()) & 7;
+	auto patternArea = state.patternTable.getReadArea<256 * 8>(0);
+	auto l = (line + state.verticalScroll) & 7;
 
 	// Note: Because line width is not a power of two, reading an entire line
 	//       from a VRAM pointer returned by readArea will not wrap the index
@@ -155,18 +155,18 @@ void CharacterConverter::renderText1(std::span<Pixel, 256> buf, int line) const
 	unsigned nameEnd = nameStart + 40;
 	Pixel* __restrict pixelPtr = buf.data();
 	for (auto name : xrange(nameStart, nameEnd)) {
-		unsigned charCode = vram.nameTable.readNP((name + 0xC00) | (~0u << 12));
+		unsigned charCode = state.nameTable.readNP((name + 0xC00) | (~0u << 12));
 		auto pattern = patternArea[l + charCode * 8];
 		draw6(pixelPtr, fg, bg, pattern);
 	}
 }
 
-void CharacterConverter::renderText1Q(std::span<Pixel, 256> buf, int line) const
+void CharacterConverter::renderText1Q(std::span<Pixel, 256> buf, int line, const State& state) const
 {
-	Pixel fg = palFg[vdp.getForegroundColor()];
-	Pixel bg = palFg[vdp.getBackgroundColor()];
+	Pixel fg = palFg[state.foregroundColor];
+	Pixel bg = palFg[state.backgroundColor];
 
-	unsigned patternBaseLine = (~0u << 13) | ((line + vdp.getVerticalScroll()) & 7);
+	unsigned patternBaseLine = (~0u << 13) | ((line + state.verticalScroll) & 7);
 
 	// Note: Because line width is not a power of two, reading an entire line
 	//       from a VRAM pointer returned by readArea will not wrap the index
@@ -176,39 +176,39 @@ void CharacterConverter::renderText1Q(std::span<Pixel, 256> buf, int line) const
 	unsigned patternQuarter = (line & 0xC0) << 2;
 	Pixel* __restrict pixelPtr = buf.data();
 	for (auto name : xrange(nameStart, nameEnd)) {
-		unsigned charCode = vram.nameTable.readNP((name + 0xC00) | (~0u << 12));
+		unsigned charCode = state.nameTable.readNP((name + 0xC00) | (~0u << 12));
 		unsigned patternNr = patternQuarter | charCode;
-		auto pattern = vram.patternTable.readNP(
+		auto pattern = state.patternTable.readNP(
 			patternBaseLine | (patternNr * 8));
 		draw6(pixelPtr, fg, bg, pattern);
 	}
 }
 
-void CharacterConverter::renderText2(std::span<Pixel, 512> buf, int line) const
+void CharacterConverter::renderText2(std::span<Pixel, 512> buf, int line, const State& state, bool blink) const
 {
-	Pixel plainFg = palFg[vdp.getForegroundColor()];
-	Pixel plainBg = palFg[vdp.getBackgroundColor()];
+	Pixel plainFg = palFg[state.foregroundColor];
+	Pixel plainBg = palFg[state.backgroundColor];
 	Pixel blinkFg, blinkBg;
-	if (vdp.getBlinkState(line)) {
-		int fg = vdp.getBlinkForegroundColor();
-		blinkFg = palBg[fg ? fg : vdp.getBlinkBackgroundColor()];
-		blinkBg = palBg[vdp.getBlinkBackgroundColor()];
+	if (blink) {
+		int fg = state.blinkForegroundColor;
+		blinkFg = palBg[fg ? fg : state.blinkBackgroundColor];
+		blinkBg = palBg[state.blinkBackgroundColor];
 	} else {
 		blinkFg = plainFg;
 		blinkBg = plainBg;
 	}
 
 	// 8 * 256 is small enough to always be contiguous
-	auto patternArea = vram.patternTable.getReadArea<256 * 8>(0);
-	auto l = (line + vdp.getVerticalScroll()) & 7;
+	auto patternArea = state.patternTable.getReadArea<256 * 8>(0);
+	auto l = (line + state.verticalScroll) & 7;
 
 	unsigned colorStart = (line / 8) * (80 / 8);
 	unsigned nameStart  = (line / 8) * 80;
 	Pixel* __restrict pixelPtr = buf.data();
 	for (auto i : xrange(80 / 8)) {
-		unsigned colorPattern = vram.colorTable.readNP(
+		unsigned colorPattern = state.colorTable.readNP(
 			(colorStart + i) | (~0u << 9));
-		auto nameArea = vram.nameTable.getReadArea<8>(
+		auto nameArea = state.nameTable.getReadArea<8>(
 			(nameStart + 8 * i) | (~0u << 12));
 		draw6(pixelPtr,
 		      (colorPattern & 0x80) ? blinkFg : plainFg,
@@ -245,21 +245,21 @@ void CharacterConverter::renderText2(std::span<Pixel, 512> buf, int line) const
 	}
 }
 
-std::span<const uint8_t, 32> CharacterConverter::getNamePtr(int line, int scroll) const
+std::span<const uint8_t, 32> CharacterConverter::getNamePtr(const State& state, int line, int scroll)
 {
 	// no need to test whether multi-page scrolling is enabled,
 	// indexMask in the nameTable already takes care of it
-	return vram.nameTable.getReadArea<32>(
+	return state.nameTable.getReadArea<32>(
 		((line / 8) * 32) | ((scroll & 0x20) ? 0x8000 : 0));
 }
-void CharacterConverter::renderGraphic1(std::span<Pixel, 256> buf, int line) const
+void CharacterConverter::renderGraphic1(std::span<Pixel, 256> buf, int line, const State& state) const
 {
-	auto patternArea = vram.patternTable.getReadArea<256 * 8>(0);
+	auto patternArea = state.patternTable.getReadArea<256 * 8>(0);
 	auto l = line & 7;
-	auto colorArea = vram.colorTable.getReadArea<256 / 8>(0);
+	auto colorArea = state.colorTable.getReadArea<256 / 8>(0);
 
-	int scroll = vdp.getHorizontalScrollHigh();
-	auto namePtr = getNamePtr(line, scroll);
+	int scroll = state.horizontalScrollHigh;
+	auto namePtr = getNamePtr(state, line, scroll);
 	Pixel* __restrict pixelPtr = buf.data();
 	repeat(32, [&] {
 		auto charCode = namePtr[scroll & 0x1F];
@@ -268,26 +268,26 @@ void CharacterConverter::renderGraphic1(std::span<Pixel, 256> buf, int line) con
 		Pixel fg = palFg[color >> 4];
 		Pixel bg = palFg[color & 0x0F];
 		draw8(pixelPtr, fg, bg, pattern);
-		if (!(++scroll & 0x1F)) namePtr = getNamePtr(line, scroll);
+		if (!(++scroll & 0x1F)) namePtr = getNamePtr(state, line, scroll);
 	});
 }
 
-void CharacterConverter::renderGraphic2(std::span<Pixel, 256> buf, int line) const
+void CharacterConverter::renderGraphic2(std::span<Pixel, 256> buf, int line, const State& state) const
 {
 	int quarter8 = (((line / 8) * 32) & ~0xFF) * 8;
 	int line7 = line & 7;
-	int scroll = vdp.getHorizontalScrollHigh();
-	auto namePtr = getNamePtr(line, scroll);
+	int scroll = state.horizontalScrollHigh;
+	auto namePtr = getNamePtr(state, line, scroll);
 
 	Pixel* __restrict pixelPtr = buf.data();
-	if (vram.colorTable  .isContinuous((8 * 256) - 1) &&
-	    vram.patternTable.isContinuous((8 * 256) - 1) &&
+	if (state.colorTable  .isContinuous((8 * 256) - 1) &&
+	    state.patternTable.isContinuous((8 * 256) - 1) &&
 	    ((scroll & 0x1f) == 0)) {
 		// Both color and pattern table can be accessed contiguously
 		// (no mirroring) and there's no v9958 horizontal scrolling.
 		// This is very common, so make an optimized version for this.
-		auto patternArea = vram.patternTable.getReadArea<256 * 8>(quarter8);
-		auto colorArea   = vram.colorTable  .getReadArea<256 * 8>(quarter8);
+		auto patternArea = state.patternTable.getReadArea<256 * 8>(quarter8);
+		auto colorArea   = state.colorTable  .getReadArea<256 * 8>(quarter8);
 		for (auto n : xrange(32)) {
 			auto charCode8 = namePtr[n] * 8;
 			auto pattern = patternArea[line7 + charCode8];
@@ -305,26 +305,26 @@ void CharacterConverter::renderGraphic2(std::span<Pixel, 256> buf, int line) con
 		repeat(32, [&] {
 			unsigned charCode8 = namePtr[scroll & 0x1F] * 8;
 			unsigned index = charCode8 | baseLine;
-			auto pattern = vram.patternTable.readNP(index);
-			auto color   = vram.colorTable  .readNP(index);
+			auto pattern = state.patternTable.readNP(index);
+			auto color   = state.colorTable  .readNP(index);
 			Pixel fg = palFg[color >> 4];
 			Pixel bg = palFg[color & 0x0F];
 			draw8(pixelPtr, fg, bg, pattern);
-			if (!(++scroll & 0x1F)) namePtr = getNamePtr(line, scroll);
+			if (!(++scroll & 0x1F)) namePtr = getNamePtr(state, line, scroll);
 		});
 	}
 }
 
 void CharacterConverter::renderMultiHelper(
-	Pixel* __restrict pixelPtr, int line,
+	Pixel* __restrict pixelPtr, int line, const State& state,
 	unsigned mask, unsigned patternQuarter) const
 {
 	unsigned baseLine = mask | ((line / 4) & 7);
-	unsigned scroll = vdp.getHorizontalScrollHigh();
-	auto namePtr = getNamePtr(line, scroll);
+	unsigned scroll = state.horizontalScrollHigh;
+	auto namePtr = getNamePtr(state, line, scroll);
 	repeat(32, [&] {
 		unsigned patternNr = patternQuarter | namePtr[scroll & 0x1F];
-		unsigned color = vram.patternTable.readNP((patternNr * 8) | baseLine);
+		unsigned color = state.patternTable.readNP((patternNr * 8) | baseLine);
 		Pixel cl = palFg[color >> 4];
 		Pixel cr = palFg[color & 0x0F];
 		pixelPtr[0] = cl; pixelPtr[1] = cl;
@@ -332,28 +332,28 @@ void CharacterConverter::renderMultiHelper(
 		pixelPtr[4] = cr; pixelPtr[5] = cr;
 		pixelPtr[6] = cr; pixelPtr[7] = cr;
 		pixelPtr += 8;
-		if (!(++scroll & 0x1F)) namePtr = getNamePtr(line, scroll);
+		if (!(++scroll & 0x1F)) namePtr = getNamePtr(state, line, scroll);
 	});
 }
-void CharacterConverter::renderMulti(std::span<Pixel, 256> buf, int line) const
+void CharacterConverter::renderMulti(std::span<Pixel, 256> buf, int line, const State& state) const
 {
 	unsigned mask = (~0u << 11);
-	renderMultiHelper(buf.data(), line, mask, 0);
+	renderMultiHelper(buf.data(), line, state, mask, 0);
 }
 
 void CharacterConverter::renderMultiQ(
-	std::span<Pixel, 256> buf, int line) const
+	std::span<Pixel, 256> buf, int line, const State& state) const
 {
 	unsigned mask = (~0u << 13);
 	unsigned patternQuarter = (line * 4) & ~0xFF;  // (line / 8) * 32
-	renderMultiHelper(buf.data(), line, mask, patternQuarter);
+	renderMultiHelper(buf.data(), line, state, mask, patternQuarter);
 }
 
-void CharacterConverter::renderBogus(std::span<Pixel, 256> buf) const
+void CharacterConverter::renderBogus(std::span<Pixel, 256> buf, const State& state) const
 {
 	Pixel* __restrict pixelPtr = buf.data();
-	Pixel fg = palFg[vdp.getForegroundColor()];
-	Pixel bg = palFg[vdp.getBackgroundColor()];
+	Pixel fg = palFg[state.foregroundColor];
+	Pixel bg = palFg[state.backgroundColor];
 	auto draw = [&](int n, Pixel col) {
 		pixelPtr = std::fill_n(pixelPtr, n, col);
 	};
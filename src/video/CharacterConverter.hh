@@ -1,13 +1,14 @@
 #ifndef CHARACTERCONVERTER_HH
 #define CHARACTERCONVERTER_HH
 
+#include "VDPVRAM.hh"
+
 #include <cstdint>
 #include <span>
 
 namespace openmsx {
 
 class VDP;
-class VDPVRAM;
 class DisplayMode;
 
 
@@ -18,6 +19,22 @@ class CharacterConverter
 public:
 	using Pixel = uint32_t;
 
+	/** The VDP state that is needed to convert a line. Instead of reading
+	  * the live VDP and VRAM, convertLine() reads this copy, which is taken
+	  * when the draw command is recorded. See RenderThread.
+	  */
+	struct State {
+		VRAMTableView nameTable;
+		VRAMTableView patternTable;
+		VRAMTableView colorTable;
+		int foregroundColor;
+		int backgroundColor;
+		int blinkForegroundColor;
+		int blinkBackgroundColor;
+		uint8_t verticalScroll;
+		uint8_t horizontalScrollHigh;
+	};
+
 	/** Create a new bitmap scanline converter.
 	  * @param vdp The VDP of which the VRAM will be converted.
 	  * @param palFg Pointer to 16-entries array that specifies
@@ -29,7 +46,7 @@ public:
 	  *   This is kept as a pointer, so any changes to the palette
 	  *   are immediately picked up by convertLine.
 	  */
-	CharacterConverter(VDP& vdp, std::span<const Pixel, 16> palFg, std::span<const Pixel, 16> palBg);
+	CharacterConverter(const VDP& vdp, std::span<const Pixel, 16> palFg, std::span<const Pixel, 16> palBg);
 
 	/** Convert a line of V9938 VRAM to 256 or 512 host pixels.
 	  * Call this method in non-planar display modes (Graphic4 and Graphic5).
@@ -38,8 +55,10 @@ public:
 	  *            least 256 or 512 pixels, but more is allowed (the extra
 	  *            pixels aren't touched).
 	  * @param line Display line number [0..255].
+	  * @param state The VDP state to convert.
+	  * @param blink The blink state for this line, see VDP::getBlinkState().
 	  */
-	void convertLine(std::span<Pixel> buf, int line) const;
+	void convertLine(std::span<Pixel> buf, int line, const State& state, bool blink) const;
 
 	/** Select the display mode to use for scanline conversion.
 	  * @param mode The new display mode.
@@ -47,27 +66,27 @@ public:
 	void setDisplayMode(DisplayMode mode);
 
 private:
-	inline void renderText1   (std::span<Pixel, 256> buf, int line) const;
-	inline void renderText1Q  (std::span<Pixel, 256> buf, int line) const;
-	inline void renderText2   (std::span<Pixel, 512> buf, int line) const;
-	inline void renderGraphic1(std::span<Pixel, 256> buf, int line) const;
-	inline void renderGraphic2(std::span<Pixel, 256> buf, int line) const;
-	inline void renderMulti   (std::span<Pixel, 256> buf, int line) const;
-	inline void renderMultiQ  (std::span<Pixel, 256> buf, int line) const;
-	inline void renderBogus   (std::span<Pixel, 256> buf) const;
+	inline void renderText1   (std::span<Pixel, 256> buf, int line, const State& state) const;
+	inline void renderText1Q  (std::span<Pixel, 256> buf, int line, const State& state) const;
+	inline void renderText2   (std::span<Pixel, 512> buf, int line, const State& state, bool blink) const;
+	inline void renderGraphic1(std::span<Pixel, 256> buf, int line, const State& state) const;
+	inline void renderGraphic2(std::span<Pixel, 256> buf, int line, const State& state) const;
+	inline void renderMulti   (std::span<Pixel, 256> buf, int line, const State& state) const;
+	inline void renderMultiQ  (std::span<Pixel, 256> buf, int line, const State& state) const;
+	inline void renderBogus   (std::span<Pixel, 256> buf, const State& state) const;
 	inline void renderBlank   (std::span<Pixel, 256> buf) const;
-	inline void renderMultiHelper(Pixel* pixelPtr, int line,
+	inline void renderMultiHelper(Pixel* pixelPtr, int line, const State& state,
 	                       unsigned mask, unsigned patternQuarter) const;
 
-	[[nodiscard]] std::span<const uint8_t, 32> getNamePtr(int line, int scroll) const;
+	[[nodiscard]] static std::span<const uint8_t, 32> getNamePtr(
+		const State& state, int line, int scroll);
 
 private:
-	VDP& vdp;
-	VDPVRAM& vram;
-
 	std::span<const Pixel, 16> palFg;
 	std::span<const Pixel, 16> palBg;
 
+	bool msx1VDP;
+
 	unsigned modeBase = 0; // not strictly needed, but avoids Coverity warning
 };
 
@@ -19,7 +19,7 @@ public:
 	[[nodiscard]] virtual PostProcessor* getPostProcessor() const = 0;
 
 	/** See VDP::getWorkingFrame() and VDP::getLastFrame() */
-	[[nodiscard]] virtual const RawFrame* getWorkingFrame() const = 0;
+	[[nodiscard]] virtual const RawFrame* getWorkingFrame() = 0;
 	[[nodiscard]] virtual const RawFrame* getLastFrame() const = 0;
 
 	/** Will the output of this Rasterizer be displayed?
@@ -0,0 +1,68 @@
+#include "RenderThread.hh"
+
+namespace openmsx {
+
+// Typically a frame takes a few dozen commands. This limit only kicks in
+// when the emulation produces commands faster than they can be executed.
+static constexpr size_t MAX_QUEUED_COMMANDS = 1024;
+
+RenderThread::RenderThread()
+{
+	if (std::thread::hardware_concurrency() > 1) {
+		thread.emplace([this]() { run(); });
+	}
+}
+
+RenderThread::~RenderThread()
+{
+	if (!thread) return;
+	{
+		std::unique_lock lock(mutex);
+		commandDone.wait(lock, [&] { return queue.empty(); });
+		stop = true;
+	}
+	commandAdded.notify_all();
+	thread->join();
+}
+
+void RenderThread::enqueue(Command command)
+{
+	if (!thread) {
+		command();
+		return;
+	}
+	{
+		std::unique_lock lock(mutex);
+		commandDone.wait(lock, [&] { return queue.size() < MAX_QUEUED_COMMANDS; });
+		queue.push_back(std::move(command));
+	}
+	commandAdded.notify_all();
+}
+
+void RenderThread::sync()
+{
+	if (!thread) return;
+	std::unique_lock lock(mutex);
+	commandDone.wait(lock, [&] { return queue.empty(); });
+}
+
+void RenderThread::run()
+{
+	std::unique_lock lock(mutex);
+	while (true) {
+		commandAdded.wait(lock, [&] { return stop || !queue.empty(); });
+		if (stop) return;
+
+		// Keep the command in the queue while it executes, so that
+		// sync() also waits for it.
+		auto& command = queue.front();
+		lock.unlock();
+		command();
+		lock.lock();
+		queue.pop_front();
+
+		commandDone.notify_all();
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,68 @@
+#ifndef RENDERTHREAD_HH
+#define RENDERTHREAD_HH
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace openmsx {
+
+/** Thread that executes the draw commands of a rasterizer, so that
+  * rendering overlaps with the emulation of the next scanlines.
+  *
+  * Commands are executed in the order in which they were queued. A command
+  * may not refer to state that the emulation keeps on changing (VRAM, VDP
+  * registers, sprite buffers, ...), instead it carries a snapshot of the
+  * state it needs. State that is only used by the commands themselves
+  * (e.g. the palette of the rasterizer) is changed via queued commands as
+  * well. Any other access to that state must first call sync().
+  *
+  * On hosts with a single core the thread is never started and commands
+  * are executed directly when they are queued.
+  */
+class RenderThread
+{
+public:
+	using Command = std::function<void()>;
+
+	RenderThread();
+	RenderThread(const RenderThread&) = delete;
+	RenderThread(RenderThread&&) = delete;
+	RenderThread& operator=(const RenderThread&) = delete;
+	RenderThread& operator=(RenderThread&&) = delete;
+	~RenderThread();
+
+	/** Is there a separate thread? If not, commands are executed directly
+	  * and it's not useful to take snapshots for them.
+	  */
+	[[nodiscard]] bool isThreaded() const { return thread.has_value(); }
+
+	/** Queue a command for execution on the render thread.
+	  * When the queue is full, this blocks until there is room again.
+	  */
+	void enqueue(Command command);
+
+	/** Wait until all queued commands have been executed.
+	  */
+	void sync();
+
+private:
+	void run();
+
+private:
+	std::optional<std::thread> thread;
+	std::mutex mutex;
+	std::condition_variable commandAdded;
+	std::condition_variable commandDone;
+
+	// protected by 'mutex'
+	std::deque<Command> queue; // the front is (possibly) being executed
+	bool stop = false;
+};
+
+} // namespace openmsx
+
+#endif
@@ -6,12 +6,15 @@
 #include "RawFrame.hh"
 #include "RenderSettings.hh"
 #include "Renderer.hh"
+#include "SpriteChecker.hh"
 #include "VDP.hh"
 #include "VDPVRAM.hh"
 
 #include "MemoryOps.hh"
 #include "enumerate.hh"
 #include "one_of.hh"
+#include "ranges.hh"
+#include "stl.hh"
 #include "xrange.hh"
 
 #include <algorithm>
@@ -19,6 +22,8 @@
 #include <cassert>
 #include <cstdint>
 #include <memory>
+#include <utility>
+#include <vector>
 
 using namespace gl;
 
@@ -78,30 +83,71 @@ static constexpr int translateX(int absoluteX, bool narrow)
 		+ maxX / 2;
 }
 
-inline void SDLRasterizer::renderBitmapLine(std::span<Pixel> buf, unsigned vramLine)
+inline void SDLRasterizer::renderBitmapLine(
+	std::span<Pixel> buf, const VRAMTableView& window, bool planar, unsigned vramLine)
 {
-	if (vdp.getDisplayMode().isPlanar()) {
+	if (planar) {
 		auto [vramPtr0, vramPtr1] =
-			vram.bitmapCacheWindow.getReadAreaPlanar<256>(vramLine * 256);
+			window.getReadAreaPlanar<256>(vramLine * 256);
 		bitmapConverter.convertLinePlanar(buf, vramPtr0, vramPtr1);
 	} else {
 		auto vramPtr =
-			vram.bitmapCacheWindow.getReadArea<128>(vramLine * 128);
+			window.getReadArea<128>(vramLine * 128);
 		bitmapConverter.convertLine(buf, vramPtr);
 	}
 }
 
+const uint8_t* SDLRasterizer::snapshotVRAM()
+{
+	if (!renderThread.isThreaded()) return nullptr;
+
+	auto changeCount = vram.getChangeCount();
+	if ((numVRAMSnapshots != 0) && (changeCount == snapshotChangeCount)) {
+		// VRAM didn't change since the last snapshot
+		return vramSnapshots[numVRAMSnapshots - 1].data();
+	}
+	if (numVRAMSnapshots == vramSnapshots.size()) {
+		// VRAM keeps on changing during this frame (e.g. a VDP command
+		// that writes to the displayed page). Copying the VRAM for each
+		// draw command would cost more than it gains.
+		return nullptr;
+	}
+
+	auto data = vram.getData();
+	auto& snapshot = vramSnapshots[numVRAMSnapshots++];
+	if (snapshot.size() != data.size()) {
+		snapshot = MemBuffer<uint8_t>(data.size());
+	}
+	copy_to_range(data, snapshot);
+	snapshotChangeCount = changeCount;
+	return snapshot.data();
+}
+
+template<typename Draw>
+void SDLRasterizer::drawFromVRAM(Draw&& draw)
+{
+	if (const auto* snapshot = snapshotVRAM()) {
+		renderThread.enqueue([snapshot, draw = std::forward<Draw>(draw)] {
+			draw(snapshot);
+		});
+	} else {
+		renderThread.sync();
+		draw(vram.getData().data());
+	}
+}
+
 SDLRasterizer::SDLRasterizer(
 		VDP& vdp_, Display& display, OutputSurface& screen_,
 		std::unique_ptr<PostProcessor> postProcessor_)
 	: vdp(vdp_), vram(vdp.getVRAM())
+	, spriteChecker(vdp.getSpriteChecker())
 	, screen(screen_)
 	, postProcessor(std::move(postProcessor_))
 	, workFrame(std::make_unique<RawFrame>(640, 240))
 	, renderSettings(display.getRenderSettings())
 	, characterConverter(vdp, subspan<16>(palFg), palBg)
 	, bitmapConverter(palFg, PALETTE256, V9958_COLORS)
-	, spriteConverter(vdp.getSpriteChecker(), palBg)
+	, spriteConverter(palBg)
 {
 	// Init the palette.
 	precalcPalette();
@@ -122,6 +168,7 @@ SDLRasterizer::SDLRasterizer(
 
 SDLRasterizer::~SDLRasterizer()
 {
+	renderThread.sync();
 	renderSettings.getColorMatrixSetting().detach(*this);
 	renderSettings.getGammaSetting()      .detach(*this);
 	renderSettings.getBrightnessSetting() .detach(*this);
@@ -133,8 +180,9 @@ PostProcessor* SDLRasterizer::getPostProcessor() const
 	return postProcessor.get();
 }
 
-const RawFrame* SDLRasterizer::getWorkingFrame() const
+const RawFrame* SDLRasterizer::getWorkingFrame()
 {
+	renderThread.sync();
 	return workFrame.get();
 }
 
@@ -154,7 +202,9 @@ void SDLRasterizer::reset()
 {
 	// Init renderer state.
 	setDisplayMode(vdp.getDisplayMode());
-	spriteConverter.setTransparency(vdp.getTransparency());
+	renderThread.enqueue([this, transparency = vdp.getTransparency()] {
+		spriteConverter.setTransparency(transparency);
+	});
 
 	resetPalette();
 }
@@ -172,12 +222,21 @@ void SDLRasterizer::resetPalette()
 void SDLRasterizer::setSuperimposeVideoFrame(const RawFrame* videoSource)
 {
 	postProcessor->setSuperimposeVideoFrame(videoSource);
-	precalcColorIndex0(vdp.getDisplayMode(), vdp.getTransparency(),
-	                   videoSource, vdp.getBackgroundColor());
+	renderThread.enqueue([this, mode = vdp.getDisplayMode(),
+	                      transparency = vdp.getTransparency(),
+	                      superimposing = videoSource != nullptr,
+	                      bgColor = vdp.getBackgroundColor()] {
+		precalcColorIndex0(mode, transparency, superimposing, bgColor);
+	});
 }
 
 void SDLRasterizer::frameStart(EmuTime time)
 {
+	// Normally already done in frameEnd(), but that's not called when
+	// the previous frame was skipped.
+	renderThread.sync();
+	numVRAMSnapshots = 0;
+
 	workFrame = postProcessor->rotateFrames(std::move(workFrame), time);
 	workFrame->init(
 	    vdp.isInterlaced() ? (vdp.getEvenOdd() ? FrameSource::FieldType::ODD
@@ -194,41 +253,53 @@ void SDLRasterizer::frameStart(EmuTime time)
 
 void SDLRasterizer::frameEnd()
 {
+	// The frame must be complete before frameStart() hands it over to
+	// the post processor.
+	renderThread.sync();
 }
 
 void SDLRasterizer::setDisplayMode(DisplayMode mode)
 {
-	if (mode.isBitmapMode()) {
-		bitmapConverter.setDisplayMode(mode);
-	} else {
-		characterConverter.setDisplayMode(mode);
-	}
-	precalcColorIndex0(mode, vdp.getTransparency(),
-	                   vdp.isSuperimposing(), vdp.getRawBackgroundColor());
-	spriteConverter.setDisplayMode(mode);
-	spriteConverter.setPalette(mode.getByte() == DisplayMode::GRAPHIC7
-	                           ? palGraphic7Sprites : palBg);
-
+	renderThread.enqueue([this, mode, transparency = vdp.getTransparency(),
+	                      superimposing = vdp.isSuperimposing() != nullptr,
+	                      bgColor = vdp.getRawBackgroundColor()] {
+		if (mode.isBitmapMode()) {
+			bitmapConverter.setDisplayMode(mode);
+		} else {
+			characterConverter.setDisplayMode(mode);
+		}
+		precalcColorIndex0(mode, transparency, superimposing, bgColor);
+		spriteConverter.setDisplayMode(mode);
+		spriteConverter.setPalette(mode.getByte() == DisplayMode::GRAPHIC7
+		                           ? palGraphic7Sprites : palBg);
+	});
 }
 
 void SDLRasterizer::setPalette(unsigned index, int grb)
 {
-	// Update SDL colors in palette.
-	Pixel newColor = V9938_COLORS[(grb >> 4) & 7][grb >> 8][grb & 7];
-	palFg[index     ] = newColor;
-	palFg[index + 16] = newColor;
-	palBg[index     ] = newColor;
-	bitmapConverter.palette16Changed();
-
-	precalcColorIndex0(vdp.getDisplayMode(), vdp.getTransparency(),
-	                   vdp.isSuperimposing(), vdp.getBackgroundColor());
+	renderThread.enqueue([this, index, grb, mode = vdp.getDisplayMode(),
+	                      transparency = vdp.getTransparency(),
+	                      superimposing = vdp.isSuperimposing() != nullptr,
+	                      bgColor = vdp.getBackgroundColor()] {
+		// Update SDL colors in palette.
+		Pixel newColor = V9938_COLORS[(grb >> 4) & 7][grb >> 8][grb & 7];
+		palFg[index     ] = newColor;
+		palFg[index + 16] = newColor;
+		palBg[index     ] = newColor;
+		bitmapConverter.palette16Changed();
+
+		precalcColorIndex0(mode, transparency, superimposing, bgColor);
+	});
 }
 
 void SDLRasterizer::setBackgroundColor(uint8_t index)
 {
 	if (vdp.getDisplayMode().getByte() != DisplayMode::GRAPHIC7) {
-		precalcColorIndex0(vdp.getDisplayMode(), vdp.getTransparency(),
-				   vdp.isSuperimposing(), index);
+		renderThread.enqueue([this, index, mode = vdp.getDisplayMode(),
+		                      transparency = vdp.getTransparency(),
+		                      superimposing = vdp.isSuperimposing() != nullptr] {
+			precalcColorIndex0(mode, transparency, superimposing, index);
+		});
 	}
 }
 
@@ -246,9 +317,12 @@ void SDLRasterizer::setBorderMask(bool /*masked*/)
 
 void SDLRasterizer::setTransparency(bool enabled)
 {
-	spriteConverter.setTransparency(enabled);
-	precalcColorIndex0(vdp.getDisplayMode(), enabled,
-	                   vdp.isSuperimposing(), vdp.getBackgroundColor());
+	renderThread.enqueue([this, enabled, mode = vdp.getDisplayMode(),
+	                      superimposing = vdp.isSuperimposing() != nullptr,
+	                      bgColor = vdp.getBackgroundColor()] {
+		spriteConverter.setTransparency(enabled);
+		precalcColorIndex0(mode, enabled, superimposing, bgColor);
+	});
 }
 
 void SDLRasterizer::precalcPalette()
@@ -357,7 +431,7 @@ void SDLRasterizer::precalcPalette()
 }
 
 void SDLRasterizer::precalcColorIndex0(DisplayMode mode,
-		bool transparency, const RawFrame* superimposing, uint8_t bgColorIndex)
+		bool transparency, bool superimposing, uint8_t bgColorIndex)
 {
 	// Graphic7 mode doesn't use transparency.
 	if (mode.getByte() == DisplayMode::GRAPHIC7) {
@@ -387,10 +461,9 @@ void SDLRasterizer::precalcColorIndex0(DisplayMode mode,
 	}
 }
 
-std::pair<Pixel, Pixel> SDLRasterizer::getBorderColors()
+std::pair<Pixel, Pixel> SDLRasterizer::getBorderColors(
+	DisplayMode mode, uint8_t bgColor, bool superimposing)
 {
-	DisplayMode mode = vdp.getDisplayMode();
-	int bgColor = vdp.getBackgroundColor();
 	if (mode.getBase() == DisplayMode::GRAPHIC5) {
 		// border in SCREEN6 has separate color for even and odd pixels.
 		// TODO odd/even swapped?
@@ -401,7 +474,7 @@ std::pair<Pixel, Pixel> SDLRasterizer::getBorderColors()
 		if (mode.getByte() == DisplayMode::GRAPHIC7) {
 			return PALETTE256[bgColor];
 		} else {
-			if (!bgColor && vdp.isSuperimposing()) {
+			if (!bgColor && superimposing) {
 				return screen.getKeyColor();
 			} else {
 				return palBg[bgColor];
@@ -414,37 +487,42 @@ std::pair<Pixel, Pixel> SDLRasterizer::getBorderColors()
 void SDLRasterizer::drawBorder(
 	int fromX, int fromY, int limitX, int limitY)
 {
-	auto [border0, border1] = getBorderColors();
-
 	int startY = std::max(fromY - lineRenderTop, 0);
 	int endY = std::min(limitY - lineRenderTop, 240);
-	if ((fromX == 0) && (limitX == VDP::TICKS_PER_LINE) &&
-	    (border0 == border1)) {
-		// complete lines, non striped
-		for (auto y : xrange(startY, endY)) {
-			workFrame->setBlank(y, border0);
-			// setBlank() implies this line is not suitable
-			// for left/right border optimization in a later
-			// frame.
-		}
-	} else {
-		unsigned lineWidth = vdp.getDisplayMode().getLineWidth();
-		unsigned x = translateX(fromX, (lineWidth == 512));
-		unsigned num = translateX(limitX, (lineWidth == 512)) - x;
-		unsigned width = (lineWidth == 512) ? 640 : 320;
-		for (auto y : xrange(startY, endY)) {
-			MemoryOps::fill_2(workFrame->getLineDirect(y).subspan(x, num),
-			                  border0, border1);
-			if (limitX == VDP::TICKS_PER_LINE) {
-				// Only set line width at the end (right
-				// border) of the line. This ensures we can
-				// keep testing the width of the previous
-				// version of this line for all (partial)
-				// updates of this line.
-				workFrame->setLineWidth(y, width);
+	renderThread.enqueue([this, fromX, limitX, startY, endY,
+	                      mode = vdp.getDisplayMode(),
+	                      bgColor = vdp.getBackgroundColor(),
+	                      superimposing = vdp.isSuperimposing() != nullptr] {
+		auto [border0, border1] = getBorderColors(mode, bgColor, superimposing);
+
+		if ((fromX == 0) && (limitX == VDP::TICKS_PER_LINE) &&
+		    (border0 == border1)) {
+			// complete lines, non striped
+			for (auto y : xrange(startY, endY)) {
+				workFrame->setBlank(y, border0);
+				// setBlank() implies this line is not suitable
+				// for left/right border optimization in a later
+				// frame.
+			}
+		} else {
+			unsigned lineWidth = mode.getLineWidth();
+			unsigned x = translateX(fromX, (lineWidth == 512));
+			unsigned num = translateX(limitX, (lineWidth == 512)) - x;
+			unsigned width = (lineWidth == 512) ? 640 : 320;
+			for (auto y : xrange(startY, endY)) {
+				MemoryOps::fill_2(workFrame->getLineDirect(y).subspan(x, num),
+				                  border0, border1);
+				if (limitX == VDP::TICKS_PER_LINE) {
+					// Only set line width at the end (right
+					// border) of the line. This ensures we can
+					// keep testing the width of the previous
+					// version of this line for all (partial)
+					// updates of this line.
+					workFrame->setLineWidth(y, width);
+				}
 			}
 		}
-	}
+	});
 }
 
 void SDLRasterizer::drawDisplay(
@@ -506,6 +584,10 @@ void SDLRasterizer::drawDisplay(
 	pageBorder = std::min(pageBorder, pageSplit);
 
 	if (mode.isBitmapMode()) {
+		// Which VRAM lines to show for the even and odd pages.
+		std::vector<std::array<unsigned, 2>> vramLines;
+		vramLines.reserve(displayHeight);
+		int lineY = displayY;
 		for (auto y : xrange(screenY, screenLimitY)) {
 			// Which bits in the name mask determine the page?
 			// TODO optimize this?
@@ -519,58 +601,94 @@ void SDLRasterizer::drawDisplay(
 			unsigned pageMaskEven = vdp.isMultiPageScrolling()
 				? (pageMaskOdd & ~0x100)
 				: pageMaskOdd;
-			const std::array<unsigned, 2> vramLine = {
-				(vram.nameTable.getMask() >> 7) & (pageMaskEven | displayY),
-				(vram.nameTable.getMask() >> 7) & (pageMaskOdd  | displayY)
-			};
-
-			std::array<Pixel, 512> buf;
-			auto lineInBuf = unsigned(-1); // buffer data not valid
-			auto dst = workFrame->getLineDirect(y).subspan(leftBackground + displayX);
-			int firstPageWidth = pageBorder - displayX;
-			if (firstPageWidth > 0) {
-				if (((displayX + hScroll) == 0) &&
-				    (firstPageWidth == narrow<int>(lineWidth))) {
-					// fast-path, directly render to destination
-					renderBitmapLine(dst, vramLine[scrollPage1]);
+			vramLines.push_back({
+				(vram.nameTable.getMask() >> 7) & (pageMaskEven | lineY),
+				(vram.nameTable.getMask() >> 7) & (pageMaskOdd  | lineY)
+			});
+			lineY = (lineY + 1) & 255;
+		}
+
+		drawFromVRAM([this, screenY, displayX, displayWidth, lineWidth,
+		              leftBackground, hScroll, pageBorder, scrollPage1, scrollPage2,
+		              planar = mode.isPlanar(), vramLines = std::move(vramLines),
+		              window = VRAMTableView(vram.bitmapCacheWindow)](const uint8_t* vramData) {
+			auto snapshot = window.withData(vramData);
+			for (auto [i, vramLine] : enumerate(vramLines)) {
+				std::array<Pixel, 512> buf;
+				auto lineInBuf = unsigned(-1); // buffer data not valid
+				auto dst = workFrame->getLineDirect(screenY + narrow<int>(i))
+				                    .subspan(leftBackground + displayX);
+				int firstPageWidth = pageBorder - displayX;
+				if (firstPageWidth > 0) {
+					if (((displayX + hScroll) == 0) &&
+					    (firstPageWidth == narrow<int>(lineWidth))) {
+						// fast-path, directly render to destination
+						renderBitmapLine(dst, snapshot, planar, vramLine[scrollPage1]);
+					} else {
+						lineInBuf = vramLine[scrollPage1];
+						renderBitmapLine(buf, snapshot, planar, vramLine[scrollPage1]);
+						auto src = subspan(buf, displayX + hScroll, firstPageWidth);
+						copy_to_range(src, dst);
+					}
 				} else {
-					lineInBuf = vramLine[scrollPage1];
-					renderBitmapLine(buf, vramLine[scrollPage1]);
-					auto src = subspan(buf, displayX + hScroll, firstPageWidth);
-					copy_to_range(src, dst);
+					firstPageWidth = 0;
 				}
-			} else {
-				firstPageWidth = 0;
-			}
-			if (firstPageWidth < displayWidth) {
-				if (lineInBuf != vramLine[scrollPage2]) {
-					renderBitmapLine(buf, vramLine[scrollPage2]);
+				if (firstPageWidth < displayWidth) {
+					if (lineInBuf != vramLine[scrollPage2]) {
+						renderBitmapLine(buf, snapshot, planar, vramLine[scrollPage2]);
+					}
+					unsigned x = displayX < pageBorder
+						   ? 0 : displayX + hScroll - lineWidth;
+					copy_to_range(subspan(buf, x, displayWidth - firstPageWidth),
+					              subspan(dst, firstPageWidth));
 				}
-				unsigned x = displayX < pageBorder
-					   ? 0 : displayX + hScroll - lineWidth;
-				copy_to_range(subspan(buf, x, displayWidth - firstPageWidth),
-				              subspan(dst, firstPageWidth));
 			}
-
-			displayY = (displayY + 1) & 255;
-		}
+		});
 	} else {
 		// horizontal scroll (high) is implemented in CharacterConverter
-		for (auto y : xrange(screenY, screenLimitY)) {
-			assert(!vdp.isMSX1VDP() || displayY < 192);
+		CharacterConverter::State state{
+			.nameTable            = vram.nameTable,
+			.patternTable         = vram.patternTable,
+			.colorTable           = vram.colorTable,
+			.foregroundColor      = vdp.getForegroundColor(),
+			.backgroundColor      = vdp.getBackgroundColor(),
+			.blinkForegroundColor = vdp.getBlinkForegroundColor(),
+			.blinkBackgroundColor = vdp.getBlinkBackgroundColor(),
+			.verticalScroll       = vdp.getVerticalScroll(),
+			.horizontalScrollHigh = vdp.getHorizontalScrollHigh(),
+		};
+		std::vector<bool> blink;
+		blink.reserve(displayHeight);
+		int lineY = displayY;
+		repeat(displayHeight, [&] {
+			assert(!vdp.isMSX1VDP() || lineY < 192);
+			blink.push_back(vdp.getBlinkState(lineY));
+			lineY = (lineY + 1) & 255;
+		});
+
+		drawFromVRAM([this, screenY, displayX, displayY, displayWidth, lineWidth,
+		              leftBackground, state, blink = std::move(blink)](const uint8_t* vramData) {
+			auto snapshot = state;
+			snapshot.nameTable    = state.nameTable   .withData(vramData);
+			snapshot.patternTable = state.patternTable.withData(vramData);
+			snapshot.colorTable   = state.colorTable  .withData(vramData);
+
+			int line = displayY;
+			for (auto i : xrange(blink.size())) {
+				auto dst = workFrame->getLineDirect(screenY + narrow<int>(i))
+				                    .subspan(leftBackground + displayX);
+				if ((displayX == 0) && (displayWidth == narrow<int>(lineWidth))){
+					characterConverter.convertLine(dst, line, snapshot, blink[i]);
+				} else {
+					std::array<Pixel, 512> buf;
+					characterConverter.convertLine(buf, line, snapshot, blink[i]);
+					auto src = subspan(buf, displayX, displayWidth);
+					copy_to_range(src, dst);
+				}
 
-			auto dst = workFrame->getLineDirect(y).subspan(leftBackground + displayX);
-			if ((displayX == 0) && (displayWidth == narrow<int>(lineWidth))){
-				characterConverter.convertLine(dst, displayY);
-			} else {
-				std::array<Pixel, 512> buf;
-				characterConverter.convertLine(buf, displayY);
-				auto src = subspan(buf, displayX, displayWidth);
-				copy_to_range(src, dst);
+				line = (line + 1) & 255;
 			}
-
-			displayY = (displayY + 1) & 255;
-		}
+		});
 	}
 }
 
@@ -592,42 +710,61 @@ void SDLRasterizer::drawSprites(
 	displayHeight = screenLimitY - screenY;
 	if (displayHeight <= 0) return;
 
+	// Copy the sprites of these lines (including the sentinel element),
+	// the SpriteChecker reuses its buffers.
+	using SpriteInfo = SpriteChecker::SpriteInfo;
+	std::vector<SpriteInfo> sprites;
+	std::vector<std::pair<size_t, size_t>> lines; // offset and size in 'sprites'
+	lines.reserve(displayHeight);
+	for (auto y : xrange(fromY, fromY + displayHeight)) {
+		auto visibleSprites = spriteChecker.getSprites(y);
+		lines.emplace_back(sprites.size(), visibleSprites.size());
+		if (!visibleSprites.empty()) {
+			append(sprites, std::span{visibleSprites.data(), visibleSprites.size() + 1});
+		}
+	}
+
 	// Render sprites.
 	// TODO: Call different SpriteConverter methods depending on narrow/wide
 	//       pixels in this display mode?
 	int spriteMode = vdp.getDisplayMode().getSpriteMode(vdp.isMSX1VDP());
 	int displayLimitX = displayX + displayWidth;
-	int limitY = fromY + displayHeight;
 	int screenX = translateX(
 		vdp.getLeftSprites(),
 		vdp.getDisplayMode().getLineWidth() == 512);
-	if (spriteMode == 1) {
-		for (int y = fromY; y < limitY; y++, screenY++) {
-			auto dst = workFrame->getLineDirect(screenY).subspan(screenX);
-			spriteConverter.drawMode1(y, displayX, displayLimitX, dst);
-		}
-	} else {
-		uint8_t mode = vdp.getDisplayMode().getByte();
-		if (mode == DisplayMode::GRAPHIC5) {
-			for (int y = fromY; y < limitY; y++, screenY++) {
-				auto dst = workFrame->getLineDirect(screenY).subspan(screenX);
-				spriteConverter.template drawMode2<DisplayMode::GRAPHIC5>(
-					y, displayX, displayLimitX, dst);
-			}
-		} else if (mode == DisplayMode::GRAPHIC6) {
-			for (int y = fromY; y < limitY; y++, screenY++) {
-				auto dst = workFrame->getLineDirect(screenY).subspan(screenX);
-				spriteConverter.template drawMode2<DisplayMode::GRAPHIC6>(
-					y, displayX, displayLimitX, dst);
+	renderThread.enqueue([this, screenY, screenX, displayX, displayLimitX, spriteMode,
+	                      mode = vdp.getDisplayMode().getByte(),
+	                      sprites = std::move(sprites), lines = std::move(lines)] {
+		auto drawLines = [&](auto drawLine) {
+			for (auto [i, line] : enumerate(lines)) {
+				auto [offset, size] = line;
+				auto dst = workFrame->getLineDirect(screenY + narrow<int>(i)).subspan(screenX);
+				drawLine(std::span{sprites.data() + offset, size}, dst);
 			}
+		};
+		if (spriteMode == 1) {
+			drawLines([&](std::span<const SpriteInfo> visibleSprites, std::span<Pixel> dst) {
+				spriteConverter.drawMode1(visibleSprites, displayX, displayLimitX, dst);
+			});
 		} else {
-			for (int y = fromY; y < limitY; y++, screenY++) {
-				auto dst = workFrame->getLineDirect(screenY).subspan(screenX);
-				spriteConverter.template drawMode2<DisplayMode::GRAPHIC4>(
-					y, displayX, displayLimitX, dst);
+			if (mode == DisplayMode::GRAPHIC5) {
+				drawLines([&](std::span<const SpriteInfo> visibleSprites, std::span<Pixel> dst) {
+					spriteConverter.template drawMode2<DisplayMode::GRAPHIC5>(
+						visibleSprites, displayX, displayLimitX, dst);
+				});
+			} else if (mode == DisplayMode::GRAPHIC6) {
+				drawLines([&](std::span<const SpriteInfo> visibleSprites, std::span<Pixel> dst) {
+					spriteConverter.template drawMode2<DisplayMode::GRAPHIC6>(
+						visibleSprites, displayX, displayLimitX, dst);
+				});
+			} else {
+				drawLines([&](std::span<const SpriteInfo> visibleSprites, std::span<Pixel> dst) {
+					spriteConverter.template drawMode2<DisplayMode::GRAPHIC4>(
+						visibleSprites, displayX, displayLimitX, dst);
+				});
 			}
 		}
-	}
+	});
 }
 
 bool SDLRasterizer::isRecording() const
@@ -641,6 +778,7 @@ void SDLRasterizer::update(const Setting& setting) noexcept
 	                       &renderSettings.getBrightnessSetting(),
 	                       &renderSettings.getContrastSetting(),
 	                       &renderSettings.getColorMatrixSetting())) {
+		renderThread.sync();
 		precalcPalette();
 		resetPalette();
 	}
@@ -4,8 +4,10 @@
 #include "BitmapConverter.hh"
 #include "CharacterConverter.hh"
 #include "Rasterizer.hh"
+#include "RenderThread.hh"
 #include "SpriteConverter.hh"
 
+#include "MemBuffer.hh"
 #include "Observer.hh"
 
 #include <array>
@@ -15,6 +17,7 @@
 namespace openmsx {
 
 class Display;
+class SpriteChecker;
 class VDP;
 class VDPVRAM;
 class OutputSurface;
@@ -25,6 +28,9 @@ class PostProcessor;
 
 /** Rasterizer using a frame buffer approach: it writes pixels to a single
   * rectangular pixel buffer.
+  * The pixels are written by a RenderThread: the draw methods only record
+  * a command, together with a snapshot of the VDP, VRAM and sprite state
+  * it needs.
   */
 class SDLRasterizer final : public Rasterizer
                           , private Observer<Setting>
@@ -43,7 +49,7 @@ public:
 
 	// Rasterizer interface:
 	[[nodiscard]] PostProcessor* getPostProcessor() const override;
-	[[nodiscard]] const RawFrame* getWorkingFrame() const override;
+	[[nodiscard]] const RawFrame* getWorkingFrame() override;
 	[[nodiscard]] const RawFrame* getLastFrame() const override;
 	[[nodiscard]] bool isActive() override;
 	void reset() override;
@@ -69,7 +75,20 @@ public:
 	[[nodiscard]] bool isRecording() const override;
 
 private:
-	inline void renderBitmapLine(std::span<Pixel> buf, unsigned vramLine);
+	inline void renderBitmapLine(std::span<Pixel> buf, const VRAMTableView& window,
+	                             bool planar, unsigned vramLine);
+
+	/** Get a snapshot of the current VRAM contents for a queued draw
+	  * command. The snapshot remains valid until the next frameStart().
+	  * @return nullptr when no snapshot should be taken, then the command
+	  *     has to be executed directly on the live VRAM.
+	  */
+	[[nodiscard]] const uint8_t* snapshotVRAM();
+
+	/** Execute a draw command that reads VRAM. The command is called with
+	  * a pointer to the VRAM data it should read, see snapshotVRAM().
+	  */
+	template<typename Draw> void drawFromVRAM(Draw&& draw);
 
 	/** Reload entire palette from VDP.
 	  */
@@ -86,10 +105,11 @@ private:
 	  * @param transparency True iff transparency is enabled.
 	  */
 	void precalcColorIndex0(DisplayMode mode, bool transparency,
-	                        const RawFrame* superimposing, uint8_t bgcolorIndex);
+	                        bool superimposing, uint8_t bgcolorIndex);
 
 	// Get the border color(s). These are 16bpp or 32bpp host pixels.
-	std::pair<Pixel, Pixel> getBorderColors();
+	std::pair<Pixel, Pixel> getBorderColors(
+		DisplayMode mode, uint8_t bgColor, bool superimposing);
 
 	// Observer<Setting>
 	void update(const Setting& setting) noexcept override;
@@ -103,6 +123,10 @@ private:
 	  */
 	VDPVRAM& vram;
 
+	/** Delivers the sprite data to be rendered.
+	  */
+	SpriteChecker& spriteChecker;
+
 	/** The surface which is visible to the user.
 	  */
 	OutputSurface& screen;
@@ -164,6 +188,21 @@ private:
 	/** Host colors corresponding to each possible V9958 color.
 	  */
 	std::array<Pixel, 32768> V9958_COLORS;
+
+	/** Copies of the VRAM contents, referenced by queued draw commands.
+	  * Only the first 'numVRAMSnapshots' are in use in the current frame.
+	  */
+	std::array<MemBuffer<uint8_t>, 4> vramSnapshots;
+	unsigned numVRAMSnapshots = 0;
+
+	/** VDPVRAM::getChangeCount() at the time of the last snapshot.
+	  */
+	unsigned snapshotChangeCount = 0;
+
+	/** Executes the draw commands. Must be the last member: its destructor
+	  * still executes the pending commands, which use the members above.
+	  */
+	RenderThread renderThread;
 };
 
 } // namespace openmsx
@@ -14,6 +14,7 @@ TODO:
 
 #include "BooleanSetting.hh"
 #include "serialize.hh"
+#include "xrange.hh"
 
 #include <algorithm>
 #include <bit>
@@ -38,6 +39,7 @@ void SpriteChecker::reset(EmuTime time)
 	collisionY = 0;
 
 	frameStart(time);
+	invalidateCache();
 
 	updateSpritesMethod = &SpriteChecker::updateSprites1;
 }
@@ -67,6 +69,84 @@ inline SpriteChecker::SpritePattern SpriteChecker::calculatePatternPlanar(
 	return !vdp.isSpriteMag() ? pattern : doublePattern(pattern);
 }
 
+template<typename Calc>
+inline void SpriteChecker::fillCache(int minLine, int maxLine, Calc calc)
+{
+	int line = minLine;
+	while (line < maxLine) {
+		if (lineGeneration[line] == generation) {
+			spriteCount[line] = cachedCount[line];
+			++line;
+			continue;
+		}
+		// Find a range of lines that all need to be (re)calculated.
+		int end = line + 1;
+		while ((end < maxLine) && (lineGeneration[end] != generation)) ++end;
+
+		for (auto l : xrange(line, end)) overflowSprite[l] = NO_OVERFLOW;
+		calc(line, end);
+		for (auto l : xrange(line, end)) {
+			cachedCount[l] = spriteCount[l];
+			collisionCache[l] = COLLISION_UNKNOWN;
+			lineGeneration[l] = generation;
+		}
+		line = end;
+	}
+}
+
+template<typename CalcCollision>
+inline void SpriteChecker::updateStatus(int minLine, int maxLine, CalcCollision calcCollision)
+{
+	// Find the earliest line with a 5th (or 9th) sprite condition.
+	int overflowNum = NO_OVERFLOW;
+	for (auto line : xrange(minLine, maxLine)) {
+		if (overflowSprite[line] != NO_OVERFLOW) {
+			overflowNum = overflowSprite[line];
+			break;
+		}
+	}
+
+	// Update status register.
+	uint8_t status = vdp.getStatusReg0();
+	if (overflowNum != NO_OVERFLOW) {
+		// Five (or nine) sprites on a line.
+		// According to TMS9918.pdf 5th sprite detection is only
+		// active when F flag is zero. Stuck to this for V9938.
+		// Dragon Quest 2 needs this.
+		if ((status & 0xC0) == 0) {
+			status = uint8_t(0x40 | (status & 0x20) | overflowNum);
+		}
+	}
+	if (~status & 0x40) {
+		// No 5th sprite detected, store number of latest sprite processed.
+		status = (status & 0x20) | uint8_t(std::min(spriteEnd, 31));
+	}
+	vdp.setSpriteStatus(status);
+
+	// Optimisation:
+	// If collision already occurred,
+	// that state is stable until it is reset by a status reg read,
+	// so no need to execute the checks.
+	if (vdp.getStatusReg0() & 0x20) return;
+
+	for (auto line : xrange(minLine, maxLine)) {
+		auto& minXCollision = collisionCache[line];
+		if (minXCollision == COLLISION_UNKNOWN) {
+			minXCollision = calcCollision(line);
+		}
+		if (minXCollision < 256) {
+			vdp.setSpriteStatus(vdp.getStatusReg0() | 0x20);
+			// verified: collision coords are also filled
+			//           in for sprite mode 1
+			// x-coord should be increased by 12
+			// y-coord                         8
+			collisionX = minXCollision + 12;
+			collisionY = line - vdp.getLineZero() + 8;
+			return; // don't check lines with higher Y-coord
+		}
+	}
+}
+
 void SpriteChecker::updateSprites1(int limit)
 {
 	if (vdp.spritesEnabledFast()) {
@@ -85,6 +165,29 @@ void SpriteChecker::updateSprites1(int limit)
 }
 
 inline void SpriteChecker::checkSprites1(int minLine, int maxLine)
+{
+	// The sprite lists and collision results of each line are cached (see
+	// 'lineGeneration'), only lines that are not in the cache are
+	// calculated again. The status register is always updated, based on
+	// the (cached) per line results.
+	int magSize = (vdp.isSpriteMag() + 1) * vdp.getSpriteSize();
+	validateCache({
+		.displayDelta = vdp.getVerticalScroll() - vdp.getLineZero(),
+		.spriteSize = vdp.getSpriteSize(),
+		.spriteMode = 1,
+		.mag = vdp.isSpriteMag(),
+		.limitSprites = limitSpritesSetting.getBoolean(),
+		.planar = false,
+		.can0collide = vdp.canSpriteColor0Collide()});
+	fillCache(minLine, maxLine, [&](int first, int last) {
+		calcSprites1(first, last);
+	});
+	updateStatus(minLine, maxLine, [&](int line) {
+		return calcCollision1(line, magSize);
+	});
+}
+
+inline void SpriteChecker::calcSprites1(int minLine, int maxLine)
 {
 	// This implementation contains a double for-loop. The outer loop goes
 	// over the sprites, the inner loop over the to-be-checked lines. This
@@ -98,9 +201,9 @@ inline void SpriteChecker::checkSprites1(int minLine, int maxLine)
 	// routine 4x-5x faster!
 	//
 	// This routine also needs to detect the sprite number of the 'first'
-	// 5th-sprite-condition. With 'first' meaning the first line where this
-	// condition occurs. Because our loops are swapped compared to the real
-	// VDP, we need some extra fixup logic to correctly detect this.
+	// 5th-sprite-condition. Because our loops are swapped compared to the
+	// real VDP, we record, per line, the first sprite that triggers this
+	// condition. updateStatus() then picks the earliest line.
 
 	// Calculate display line.
 	// This is the line sprites are checked at; the line they are displayed
@@ -114,8 +217,6 @@ inline void SpriteChecker::checkSprites1(int minLine, int maxLine)
 	int magSize = (mag + 1) * size;
 	auto attributePtr = vram.spriteAttribTable.getReadArea<32 * 4>(0);
 	uint8_t patternIndexMask = size == 16 ? 0xFC : 0xFF;
-	int fifthSpriteNum  = -1;  // no 5th sprite detected yet
-	int fifthSpriteLine = 999; // larger than any possible valid line
 
 	int sprite = 0;
 	for (/**/; sprite < 32; ++sprite) {
@@ -134,10 +235,8 @@ inline void SpriteChecker::checkSprites1(int minLine, int maxLine)
 
 			auto visibleIndex = spriteCount[line];
 			if (visibleIndex == 4) {
-				// Find earliest line where this condition occurs.
-				if (line < fifthSpriteLine) {
-					fifthSpriteLine = line;
-					fifthSpriteNum = sprite;
+				if (overflowSprite[line] == NO_OVERFLOW) {
+					overflowSprite[line] = narrow<int8_t>(sprite);
 				}
 				if (limitSprites) continue;
 			}
@@ -154,30 +253,11 @@ inline void SpriteChecker::checkSprites1(int minLine, int maxLine)
 			spriteCount[line] = visibleIndex + 1;
 		}
 	}
+	spriteEnd = sprite;
+}
 
-	// Update status register.
-	uint8_t status = vdp.getStatusReg0();
-	if (fifthSpriteNum != -1) {
-		// Five sprites on a line.
-		// According to TMS9918.pdf 5th sprite detection is only
-		// active when F flag is zero.
-		if ((status & 0xC0) == 0) {
-			status = uint8_t(0x40 | (status & 0x20) | fifthSpriteNum);
-		}
-	}
-	if (~status & 0x40) {
-		// No 5th sprite detected, store number of latest sprite processed.
-		status = (status & 0x20) | uint8_t(std::min(sprite, 31));
-	}
-	vdp.setSpriteStatus(status);
-
-	// Optimisation:
-	// If collision already occurred,
-	// that state is stable until it is reset by a status reg read,
-	// so no need to execute the checks.
-	// The spriteBuffer array is filled now, so we can bail out.
-	if (vdp.getStatusReg0() & 0x20) return;
-
+inline int16_t SpriteChecker::calcCollision1(int line, int magSize) const
+{
 	/*
 	Model for sprite collision: (or "coincidence" in TMS9918 data sheet)
 	- Reset when status reg is read.
@@ -193,53 +273,41 @@ inline void SpriteChecker::checkSprites1(int minLine, int maxLine)
 	Implemented by checking every pair for collisions.
 	For large numbers of sprites that would be slow,
 	but there are max 4 sprites and therefore max 6 pairs.
-	If any collision is found, method returns at once.
 	*/
 	bool can0collide = vdp.canSpriteColor0Collide();
-	for (auto line : xrange(minLine, maxLine)) {
-		int minXCollision = 999;
-		for (int i = std::min<int>(4, spriteCount[line]); --i >= 1; /**/) {
-			auto color1 = spriteBuffer[line][i].colorAttrib & 0xf;
-			if (!can0collide && (color1 == 0)) continue;
-			int x_i = spriteBuffer[line][i].x;
-			SpritePattern pattern_i = spriteBuffer[line][i].pattern;
-			for (int j = i; --j >= 0; /**/) {
-				auto color2 = spriteBuffer[line][j].colorAttrib & 0xf;
-				if (!can0collide && (color2 == 0)) continue;
-				// Do sprite i and sprite j collide?
-				int x_j = spriteBuffer[line][j].x;
-				int dist = x_j - x_i;
-				if ((-magSize < dist) && (dist < magSize)) {
-					SpritePattern pattern_j = spriteBuffer[line][j].pattern;
-					if (dist < 0) {
-						pattern_j <<= -dist;
-					} else {
-						pattern_j >>= dist;
-					}
-					SpritePattern colPat = pattern_i & pattern_j;
-					if (x_i < 0) {
-						assert(x_i >= -32);
-						colPat &= (1 << (32 + x_i)) - 1;
-					}
-					if (colPat) {
-						int xCollision = x_i + std::countl_zero(colPat);
-						assert(xCollision >= 0);
-						minXCollision = std::min(minXCollision, xCollision);
-					}
+	int minXCollision = NO_COLLISION;
+	for (int i = std::min<int>(4, spriteCount[line]); --i >= 1; /**/) {
+		auto color1 = spriteBuffer[line][i].colorAttrib & 0xf;
+		if (!can0collide && (color1 == 0)) continue;
+		int x_i = spriteBuffer[line][i].x;
+		SpritePattern pattern_i = spriteBuffer[line][i].pattern;
+		for (int j = i; --j >= 0; /**/) {
+			auto color2 = spriteBuffer[line][j].colorAttrib & 0xf;
+			if (!can0collide && (color2 == 0)) continue;
+			// Do sprite i and sprite j collide?
+			int x_j = spriteBuffer[line][j].x;
+			int dist = x_j - x_i;
+			if ((-magSize < dist) && (dist < magSize)) {
+				SpritePattern pattern_j = spriteBuffer[line][j].pattern;
+				if (dist < 0) {
+					pattern_j <<= -dist;
+				} else {
+					pattern_j >>= dist;
+				}
+				SpritePattern colPat = pattern_i & pattern_j;
+				if (x_i < 0) {
+					assert(x_i >= -32);
+					colPat &= (1 << (32 + x_i)) - 1;
+				}
+				if (colPat) {
+					int xCollision = x_i + std::countl_zero(colPat);
+					assert(xCollision >= 0);
+					minXCollision = std::min(minXCollision, xCollision);
 				}
 			}
 		}
-		if (minXCollision < 256) {
-			vdp.setSpriteStatus(vdp.getStatusReg0() | 0x20);
-			// verified: collision coords are also filled
-			//           in for sprite mode 1
-			// x-coord should be increased by 12
-			// y-coord                         8
-			collisionX = minXCollision + 12;
-			collisionY = line - vdp.getLineZero() + 8;
-			return; // don't check lines with higher Y-coord
-		}
 	}
+	return narrow<int16_t>(minXCollision);
 }
 
 void SpriteChecker::updateSprites2(int limit)
@@ -262,21 +330,39 @@ void SpriteChecker::updateSprites2(int limit)
 
 inline void SpriteChecker::checkSprites2(int minLine, int maxLine)
 {
-	// See comment in checkSprites1() about order of inner and outer loops.
+	// See comment in checkSprites1() about the cache.
+	int magSize = (vdp.isSpriteMag() + 1) * vdp.getSpriteSize();
+	validateCache({
+		.displayDelta = vdp.getVerticalScroll() - vdp.getLineZero(),
+		.spriteSize = vdp.getSpriteSize(),
+		.spriteMode = 2,
+		.mag = vdp.isSpriteMag(),
+		.limitSprites = limitSpritesSetting.getBoolean(),
+		.planar = planar,
+		.can0collide = vdp.canSpriteColor0Collide()});
+	fillCache(minLine, maxLine, [&](int first, int last) {
+		calcSprites2(first, last);
+	});
+	updateStatus(minLine, maxLine, [&](int line) {
+		return calcCollision2(line, magSize);
+	});
+}
+
+inline void SpriteChecker::calcSprites2(int minLine, int maxLine)
+{
+	// See comment in calcSprites1() about order of inner and outer loops.
 
 	// Calculate display line.
 	// This is the line sprites are checked at; the line they are displayed
 	// at is one lower.
 	int displayDelta = vdp.getVerticalScroll() - vdp.getLineZero();
 
-	// Get sprites for this line and detect 5th sprite if any.
+	// Get sprites for this line and detect 9th sprite if any.
 	bool limitSprites = limitSpritesSetting.getBoolean();
 	int size = vdp.getSpriteSize();
 	bool mag = vdp.isSpriteMag();
 	int magSize = (mag + 1) * size;
 	int patternIndexMask = (size == 16) ? 0xFC : 0xFF;
-	int ninthSpriteNum  = -1;  // no 9th sprite detected yet
-	int ninthSpriteLine = 999; // larger than any possible valid line
 
 	// Because it gave a measurable performance boost, we duplicated the
 	// code for planar and non-planar modes.
@@ -301,10 +387,8 @@ inline void SpriteChecker::checkSprites2(int minLine, int maxLine)
 
 				auto visibleIndex = spriteCount[line];
 				if (visibleIndex == 8) {
-					// Find earliest line where this condition occurs.
-					if (line < ninthSpriteLine) {
-						ninthSpriteLine = line;
-						ninthSpriteNum = sprite;
+					if (overflowSprite[line] == NO_OVERFLOW) {
+						overflowSprite[line] = narrow<int8_t>(sprite);
 					}
 					if (limitSprites) continue;
 				}
@@ -346,10 +430,8 @@ inline void SpriteChecker::checkSprites2(int minLine, int maxLine)
 
 				auto visibleIndex = spriteCount[line];
 				if (visibleIndex == 8) {
-					// Find earliest line where this condition occurs.
-					if (line < ninthSpriteLine) {
-						ninthSpriteLine = line;
-						ninthSpriteNum = sprite;
+					if (overflowSprite[line] == NO_OVERFLOW) {
+						overflowSprite[line] = narrow<int8_t>(sprite);
 					}
 					if (limitSprites) continue;
 				}
@@ -384,31 +466,11 @@ inline void SpriteChecker::checkSprites2(int minLine, int maxLine)
 			}
 		}
 	}
+	spriteEnd = sprite;
+}
 
-	// Update status register.
-	uint8_t status = vdp.getStatusReg0();
-	if (ninthSpriteNum != -1) {
-		// Nine sprites on a line.
-		// According to TMS9918.pdf 5th sprite detection is only
-		// active when F flag is zero. Stuck to this for V9938.
-		// Dragon Quest 2 needs this.
-		if ((status & 0xC0) == 0) {
-			status = uint8_t(0x40 | (status & 0x20) | ninthSpriteNum);
-		}
-	}
-	if (~status & 0x40) {
-		// No 9th sprite detected, store number of latest sprite processed.
-		status = (status & 0x20) | uint8_t(std::min(sprite, 31));
-	}
-	vdp.setSpriteStatus(status);
-
-	// Optimisation:
-	// If collision already occurred,
-	// that state is stable until it is reset by a status reg read,
-	// so no need to execute the checks.
-	// The visibleSprites array is filled now, so we can bail out.
-	if (vdp.getStatusReg0() & 0x20) return;
-
+inline int16_t SpriteChecker::calcCollision2(int line, int magSize) const
+{
 	/*
 	Model for sprite collision: (or "coincidence" in TMS9918 data sheet)
 	- Reset when status reg is read.
@@ -429,55 +491,46 @@ inline void SpriteChecker::checkSprites2(int minLine, int maxLine)
 	        Probably new approach is needed anyway for OR-ing.
 	*/
 	bool can0collide = vdp.canSpriteColor0Collide();
-	for (auto line : xrange(minLine, maxLine)) {
-		int minXCollision = 999; // no collision
-		std::span<SpriteInfo, 32 + 1> visibleSprites = spriteBuffer[line];
-		for (int i = std::min<int>(8, spriteCount[line]); --i >= 1; /**/) {
-			auto colorAttrib1 = visibleSprites[i].colorAttrib;
-			if (!can0collide && ((colorAttrib1 & 0xf) == 0)) continue;
+	int minXCollision = NO_COLLISION;
+	std::span<const SpriteInfo, 32 + 1> visibleSprites = spriteBuffer[line];
+	for (int i = std::min<int>(8, spriteCount[line]); --i >= 1; /**/) {
+		auto colorAttrib1 = visibleSprites[i].colorAttrib;
+		if (!can0collide && ((colorAttrib1 & 0xf) == 0)) continue;
+		// If CC or IC is set, this sprite cannot collide.
+		if (colorAttrib1 & 0x60) continue;
+
+		int x_i = visibleSprites[i].x;
+		SpritePattern pattern_i = visibleSprites[i].pattern;
+		for (int j = i; --j >= 0; /**/) {
+			auto colorAttrib2 = visibleSprites[j].colorAttrib;
+			if (!can0collide && ((colorAttrib2 & 0xf) == 0)) continue;
 			// If CC or IC is set, this sprite cannot collide.
-			if (colorAttrib1 & 0x60) continue;
-
-			int x_i = visibleSprites[i].x;
-			SpritePattern pattern_i = visibleSprites[i].pattern;
-			for (int j = i; --j >= 0; /**/) {
-				auto colorAttrib2 = visibleSprites[j].colorAttrib;
-				if (!can0collide && ((colorAttrib2 & 0xf) == 0)) continue;
-				// If CC or IC is set, this sprite cannot collide.
-				if (colorAttrib2 & 0x60) continue;
-
-				// Do sprite i and sprite j collide?
-				int x_j = visibleSprites[j].x;
-				int dist = x_j - x_i;
-				if ((-magSize < dist) && (dist < magSize)) {
-					SpritePattern pattern_j = visibleSprites[j].pattern;
-					if (dist < 0) {
-						pattern_j <<= -dist;
-					} else {
-						pattern_j >>= dist;
-					}
-					SpritePattern colPat = pattern_i & pattern_j;
-					if (x_i < 0) {
-						assert(x_i >= -32);
-						colPat &= (1 << (32 + x_i)) - 1;
-					}
-					if (colPat) {
-						int xCollision = x_i + std::countl_zero(colPat);
-						assert(xCollision >= 0);
-						minXCollision = std::min(minXCollision, xCollision);
-					}
+			if (colorAttrib2 & 0x60) continue;
+
+			// Do sprite i and sprite j collide?
+			int x_j = visibleSprites[j].x;
+			int dist = x_j - x_i;
+			if ((-magSize < dist) && (dist < magSize)) {
+				SpritePattern pattern_j = visibleSprites[j].pattern;
+				if (dist < 0) {
+					pattern_j <<= -dist;
+				} else {
+					pattern_j >>= dist;
+				}
+				SpritePattern colPat = pattern_i & pattern_j;
+				if (x_i < 0) {
+					assert(x_i >= -32);
+					colPat &= (1 << (32 + x_i)) - 1;
+				}
+				if (colPat) {
+					int xCollision = x_i + std::countl_zero(colPat);
+					assert(xCollision >= 0);
+					minXCollision = std::min(minXCollision, xCollision);
 				}
 			}
 		}
-		if (minXCollision < 256) {
-			vdp.setSpriteStatus(vdp.getStatusReg0() | 0x20);
-			// x-coord should be increased by 12
-			// y-coord                         8
-			collisionX = minXCollision + 12;
-			collisionY = line - vdp.getLineZero() + 8;
-			return; // don't check lines with higher Y-coord
-		}
 	}
+	return narrow<int16_t>(minXCollision);
 }
 
 // version 1: initial version
@@ -499,6 +552,7 @@ void SpriteChecker::serialize(Archive& ar, unsigned version)
 		// first (partial) frame after loadstate.
 		std::ranges::fill(spriteCount, 0);
 		// content of spriteBuffer[] doesn't matter if spriteCount[] is 0
+		invalidateCache();
 	}
 	ar.serialize("collisionX", collisionX,
 	             "collisionY", collisionY);
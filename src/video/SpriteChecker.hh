@@ -267,10 +267,12 @@ public:
 
 	void updateVRAM(unsigned /*offset*/, EmuTime time) override {
 		checkUntil(time);
+		invalidateCache();
 	}
 
 	void updateWindow(bool /*enabled*/, EmuTime time) override {
 		sync(time);
+		invalidateCache();
 	}
 
 	template<typename Archive>
@@ -298,6 +300,41 @@ private:
 		}
 	}
 
+	/** Parameters, other than the content of the sprite attribute and
+	  * pattern tables, that influence the result of checking a line.
+	  */
+	struct CacheKey {
+		int displayDelta = 0;
+		int spriteSize = 0;
+		int spriteMode = 0;
+		bool mag = false;
+		bool limitSprites = false;
+		bool planar = false;
+		bool can0collide = false;
+
+		[[nodiscard]] bool operator==(const CacheKey&) const = default;
+	};
+
+	/** Mark all cached line results as outdated.
+	  */
+	void invalidateCache() {
+		if (++generation == 0) [[unlikely]] {
+			// wrapped, make sure no stale entry matches by accident
+			std::ranges::fill(lineGeneration, 0);
+			generation = 1;
+		}
+	}
+
+	/** Invalidate the cache if 'key' differs from the key the current
+	  * cached results were calculated with.
+	  */
+	void validateCache(const CacheKey& key) {
+		if (key != cacheKey) {
+			cacheKey = key;
+			invalidateCache();
+		}
+	}
+
 	/** Calculate sprite patterns for sprite mode 1.
 	  */
 	void updateSprites1(int limit);
@@ -328,6 +365,8 @@ private:
 	  * @effect Fills in the spriteBuffer and spriteCount arrays.
 	  */
 	void checkSprites1(int minLine, int maxLine);
+	void calcSprites1(int minLine, int maxLine);
+	[[nodiscard]] int16_t calcCollision1(int line, int magSize) const;
 
 	/** Check sprite collision and number of sprites per line.
 	  * This routine implements sprite mode 2 (MSX2).
@@ -340,6 +379,21 @@ private:
 	  * @effect Fills in the spriteBuffer and spriteCount arrays.
 	  */
 	void checkSprites2(int minLine, int maxLine);
+	void calcSprites2(int minLine, int maxLine);
+	[[nodiscard]] int16_t calcCollision2(int line, int magSize) const;
+
+	/** Make sure the lines in [minLine, maxLine) are present in the cache,
+	  * (re)calculating them if needed. Also fills in spriteCount for
+	  * those lines.
+	  */
+	template<typename Calc>
+	void fillCache(int minLine, int maxLine, Calc calc);
+
+	/** Update the status register and collision coordinates for the
+	  * (cached) lines in [minLine, maxLine).
+	  */
+	template<typename CalcCollision>
+	void updateStatus(int minLine, int maxLine, CalcCollision calcCollision);
 
 private:
 	using UpdateSpritesMethod = void (SpriteChecker::*)(int limit);
@@ -397,6 +451,32 @@ private:
 	  * TODO: Introduce separate update methods for planar/non-planar modes.
 	  */
 	bool planar;
+
+	/** Cache of the per line results of the sprite checks.
+	  * Most frames leave the sprite tables unchanged, then checking a line
+	  * gives the same result as in the previous frame. The content of
+	  * spriteBuffer[line] is kept across frames, the other results are
+	  * stored in the arrays below. A line is valid in the cache when its
+	  * 'lineGeneration' equals 'generation'. Writes to the sprite tables
+	  * (see updateVRAM() and updateWindow()) or a change in 'cacheKey'
+	  * increase 'generation' and thus invalidate all lines.
+	  * None of this is serialized, it's recalculated after loadstate.
+	  */
+	static constexpr int8_t NO_OVERFLOW = -1;
+	static constexpr int16_t COLLISION_UNKNOWN = -1;
+	static constexpr int16_t NO_COLLISION = 999;
+	/** Number of visible sprites (like 'spriteCount'). */
+	std::array<uint8_t, VDP::NUM_LINES_MAX> cachedCount;
+	/** Sprite number that caused the 5th/9th sprite condition, or NO_OVERFLOW. */
+	std::array<int8_t, VDP::NUM_LINES_MAX> overflowSprite;
+	/** Leftmost x-coordinate of a collision, NO_COLLISION or
+	  * COLLISION_UNKNOWN when not yet calculated. */
+	std::array<int16_t, VDP::NUM_LINES_MAX> collisionCache;
+	std::array<uint32_t, VDP::NUM_LINES_MAX> lineGeneration = {};
+	uint32_t generation = 1;
+	CacheKey cacheKey;
+	/** Number of the sprite that terminated the attribute table scan. */
+	int spriteEnd = 0;
 };
 SERIALIZE_CLASS_VERSION(SpriteChecker, 2);
 
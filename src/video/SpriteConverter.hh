@@ -30,13 +30,10 @@ public:
 	/** Constructor.
 	  * After construction, also call the various set methods to complete
 	  * initialisation.
-	  * @param spriteChecker_ Delivers the sprite data to be rendered.
 	  * @param pal The initial palette. Can later be changed via setPallette().
 	  */
-	explicit SpriteConverter(SpriteChecker& spriteChecker_,
-	                         std::span<const Pixel, 16> pal)
-		: spriteChecker(spriteChecker_)
-		, palette(pal)
+	explicit SpriteConverter(std::span<const Pixel, 16> pal)
+		: palette(pal)
 	{
 	}
 
@@ -90,16 +87,16 @@ public:
 	}
 
 	/** Draw sprites in sprite mode 1.
-	  * @param absLine Absolute line number.
-	  *     Range is [0..262) for NTSC and [0..313) for PAL.
+	  * @param visibleSprites The sprites on this line, as returned by
+	  *     SpriteChecker::getSprites() (or a copy of it, including the
+	  *     sentinel element).
 	  * @param minX Minimum X coordinate to draw (inclusive).
 	  * @param maxX Maximum X coordinate to draw (exclusive).
 	  * @param pixelPtr Pointer to memory to draw to.
 	  */
-	void drawMode1(int absLine, int minX, int maxX, std::span<Pixel> pixelPtr) const
+	void drawMode1(std::span<const SpriteChecker::SpriteInfo> visibleSprites,
+	               int minX, int maxX, std::span<Pixel> pixelPtr) const
 	{
-		// Determine sprites visible on this line.
-		auto visibleSprites = spriteChecker.getSprites(absLine);
 		// Optimisation: return at once if no sprites on this line.
 		// Lines without any sprites are very common in most programs.
 		if (visibleSprites.empty()) return;
@@ -135,17 +132,15 @@ public:
 	  * Make sure the pixel pointers point to a large enough memory area:
 	  * 256 pixels for ZOOM_256 and ZOOM_REAL in 256-pixel wide modes;
 	  * 512 pixels for ZOOM_REAL in 512-pixel wide modes.
-	  * @param absLine Absolute line number.
-	  *     Range is [0..262) for NTSC and [0..313) for PAL.
+	  * @param visibleSprites The sprites on this line, see drawMode1().
 	  * @param minX Minimum X coordinate to draw (inclusive).
 	  * @param maxX Maximum X coordinate to draw (exclusive).
 	  * @param pixelPtr Pointer to memory to draw to.
 	  */
 	template<unsigned MODE>
-	void drawMode2(int absLine, int minX, int maxX, std::span<Pixel> pixelPtr) const
+	void drawMode2(std::span<const SpriteChecker::SpriteInfo> visibleSprites,
+	               int minX, int maxX, std::span<Pixel> pixelPtr) const
 	{
-		// Determine sprites visible on this line.
-		auto visibleSprites = spriteChecker.getSprites(absLine);
 		// Optimisation: return at once if no sprites on this line.
 		// Lines without any sprites are very common in most programs.
 		if (visibleSprites.empty()) return;
@@ -205,8 +200,6 @@ public:
 	}
 
 private:
-	SpriteChecker& spriteChecker;
-
 	/** The current sprite palette.
 	  */
 	std::span<const Pixel, 16> palette;
@@ -1199,7 +1199,7 @@ void VDP::changeRegister(uint8_t reg, uint8_t val, EmuTime time)
 		if ((change & 0x80) && isVDPwithVRAMremapping()) {
 			// confirmed: VRAM remapping only happens on TMS99xx
 			// see VDPVRAM for details on the remapping itself
-			vram->change4k8kMapping((val & 0x80) != 0);
+			vram->change4k8kMapping((val & 0x80) != 0, time);
 		}
 		break;
 	case 2:
@@ -164,6 +164,7 @@ struct Graphic4Mode
 	static constexpr uint8_t PIXELS_PER_BYTE = 2;
 	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 1;
 	static constexpr unsigned PIXELS_PER_LINE = 256;
+	static constexpr bool PLANAR = false;
 	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
 	static uint8_t point(const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
 	template<typename LogOp>
@@ -216,6 +217,7 @@ struct Graphic5Mode
 	static constexpr uint8_t PIXELS_PER_BYTE = 4;
 	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 2;
 	static constexpr unsigned PIXELS_PER_LINE = 512;
+	static constexpr bool PLANAR = false;
 	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
 	static uint8_t point(const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
 	template<typename LogOp>
@@ -270,6 +272,7 @@ struct Graphic6Mode
 	static constexpr uint8_t PIXELS_PER_BYTE = 2;
 	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 1;
 	static constexpr unsigned PIXELS_PER_LINE = 512;
+	static constexpr bool PLANAR = true;
 	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
 	static uint8_t point(const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
 	template<typename LogOp>
@@ -322,6 +325,7 @@ struct Graphic7Mode
 	static constexpr uint8_t PIXELS_PER_BYTE = 1;
 	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 0;
 	static constexpr unsigned PIXELS_PER_LINE = 256;
+	static constexpr bool PLANAR = true;
 	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
 	static uint8_t point(const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
 	template<typename LogOp>
@@ -372,6 +376,7 @@ struct NonBitmapMode
 	static constexpr uint8_t PIXELS_PER_BYTE = 1;
 	static constexpr uint8_t PIXELS_PER_BYTE_SHIFT = 0;
 	static constexpr unsigned PIXELS_PER_LINE = 256;
+	static constexpr bool PLANAR = false;
 	static unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
 	static uint8_t point(const VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
 	template<typename LogOp>
@@ -720,6 +725,45 @@ using TXorOp = TransparentOp<XorOp>;
 using TNotOp = TransparentOp<NotOp>;
 
 
+// Bulk execution helpers.
+//
+// The byte based block commands (HMMV, HMMM, YMMM) normally write VRAM one
+// byte at a time via VDPVRAM::cmdWrite(), so that the renderer and sprite
+// checker can sync right before a byte they're interested in changes. When
+// none of the bytes in the remainder of a row is observed, the exact moment
+// of each write doesn't matter. Then we only step through the access slots
+// to find out how far the command gets, and do the actual VRAM accesses
+// with bulk memory operations.
+
+/** In non-planar modes the bytes of one row of a block command are stored
+  * contiguously in VRAM. Returns the lowest address of such a row of 'num'
+  * bytes, starting at pixel 'x' and moving in the direction of 'tx'.
+  */
+template<typename Mode>
+static unsigned lowestRowAddress(unsigned x, unsigned y, int tx, unsigned num)
+{
+	static_assert(!Mode::PLANAR);
+	unsigned first = Mode::addressOf(x, y, false);
+	return (tx > 0) ? first : (first - (num - 1));
+}
+
+/** Copy 'num' bytes from 'src' to 'dst' (both pointing to the lowest address
+  * of their range) in the same order as the VDP does: one byte at a time,
+  * moving downwards in memory when 'backwards' is set. When both ranges
+  * overlap this gives a different result than memmove().
+  */
+static void copyBytes(const uint8_t* src, uint8_t* dst, unsigned num, bool backwards)
+{
+	if ((src + num <= dst) || (dst + num <= src)) {
+		std::copy_n(src, num, dst);
+	} else if (!backwards) {
+		for (unsigned i = 0; i < num; ++i) dst[i] = src[i];
+	} else {
+		for (unsigned i = num; i-- > 0; ) dst[i] = src[i];
+	}
+}
+
+
 // Commands
 
 void VDPCmdEngine::setStatusChangeTime(EmuTime t)
@@ -1381,6 +1425,34 @@ void VDPCmdEngine::executeHmmv(EmuTime limit)
 	auto calculator = getSlotCalculator(limit);
 
 	while (!calculator.limitReached()) {
+		if constexpr (!Mode::PLANAR) {
+			unsigned first = lowestRowAddress<Mode>(ADX, DY, TX, ANX);
+			if (uint8_t* dst = dstExt ? nullptr : vram.getCmdBulkArea(first, ANX)) {
+				// Fast path: fill (the remainder of) this row in one go.
+				unsigned num = 1;
+				while (num < ANX) {
+					calculator.next(Delta::D48);
+					if (calculator.limitReached()) break;
+					++num;
+				}
+				if (TX < 0) dst += ANX - num;
+				std::fill_n(dst, num, COL);
+				ANX -= num;
+				if (ANX != 0) {
+					// limit reached in the middle of the row
+					ADX += num * TX;
+					break;
+				}
+				DY += TY; --NY;
+				ADX = DX; ANX = tmpNX;
+				if (--tmpNY == 0) {
+					commandDone(calculator.getTime());
+					break;
+				}
+				calculator.next(Delta::D104); // 48 + 56
+				continue;
+			}
+		}
 		if (doPset) [[likely]] {
 			vram.cmdWrite(Mode::addressOf(ADX, DY, dstExt),
 			              COL, calculator.getTime());
@@ -1491,6 +1563,58 @@ void VDPCmdEngine::executeHmmm(EmuTime limit)
 	switch (phase) {
 	case 0:
 loop:		if (calculator.limitReached()) [[unlikely]] { phase = 0; break; }
+		if constexpr (!Mode::PLANAR) {
+			const uint8_t* src = nullptr;
+			uint8_t* dst = nullptr;
+			if (!srcExt && !dstExt) {
+				src = vram.getCmdBulkReadArea(
+					lowestRowAddress<Mode>(ASX, SY, TX, ANX), ANX);
+				dst = vram.getCmdBulkArea(
+					lowestRowAddress<Mode>(ADX, DY, TX, ANX), ANX);
+			}
+			if (src && dst) {
+				// Fast path: copy (the remainder of) this row in one go.
+				unsigned num = 0;
+				bool pendingWrite = false;
+				while (true) {
+					calculator.next(Delta::D24);
+					if (calculator.limitReached()) {
+						pendingWrite = true;
+						break;
+					}
+					if (++num == ANX) break;
+					calculator.next(Delta::D64);
+					if (calculator.limitReached()) break;
+				}
+				if (TX < 0) {
+					src += ANX - num;
+					dst += ANX - num;
+				}
+				copyBytes(src, dst, num, TX < 0);
+				ANX -= num;
+				if (ANX != 0) {
+					// limit reached in the middle of the row
+					ASX += num * TX; ADX += num * TX;
+					if (pendingWrite) {
+						// byte was already read, but not yet written
+						tmpSrc = vram.cmdReadWindow.readNP(
+							Mode::addressOf(ASX, SY, false));
+						phase = 1;
+					} else {
+						phase = 0;
+					}
+					break;
+				}
+				SY += TY; DY += TY; --NY;
+				ASX = SX; ADX = DX; ANX = tmpNX;
+				if (--tmpNY == 0) {
+					commandDone(calculator.getTime());
+					break;
+				}
+				calculator.next(Delta::D128); // 64 + 64
+				goto loop;
+			}
+		}
 		if (doPoint) [[likely]] {
 			tmpSrc = vram.cmdReadWindow.readNP(Mode::addressOf(ASX, SY, srcExt));
 		} else {
@@ -1629,6 +1753,59 @@ void VDPCmdEngine::executeYmmm(EmuTime limit)
 	switch (phase) {
 	case 0:
 loop:		if (calculator.limitReached()) [[unlikely]] { phase = 0; break; }
+		if constexpr (!Mode::PLANAR) {
+			const uint8_t* src = nullptr;
+			uint8_t* dst = nullptr;
+			if (!dstExt) {
+				src = vram.getCmdBulkReadArea(
+					lowestRowAddress<Mode>(ADX, SY, TX, ANX), ANX);
+				dst = vram.getCmdBulkArea(
+					lowestRowAddress<Mode>(ADX, DY, TX, ANX), ANX);
+			}
+			if (src && dst) {
+				// Fast path: copy (the remainder of) this row in one go.
+				unsigned num = 0;
+				bool pendingWrite = false;
+				while (true) {
+					calculator.next(Delta::D24);
+					if (calculator.limitReached()) {
+						pendingWrite = true;
+						break;
+					}
+					if (++num == ANX) break;
+					calculator.next(Delta::D40);
+					if (calculator.limitReached()) break;
+				}
+				if (TX < 0) {
+					src += ANX - num;
+					dst += ANX - num;
+				}
+				copyBytes(src, dst, num, TX < 0);
+				ANX -= num;
+				if (ANX != 0) {
+					// limit reached in the middle of the row
+					ADX += num * TX;
+					if (pendingWrite) {
+						// byte was already read, but not yet written
+						tmpSrc = vram.cmdReadWindow.readNP(
+							Mode::addressOf(ADX, SY, false));
+						phase = 1;
+					} else {
+						phase = 0;
+					}
+					break;
+				}
+				// note: going to the next line does not take extra time
+				SY += TY; DY += TY; --NY;
+				ADX = DX; ANX = tmpNX;
+				if (--tmpNY == 0) {
+					commandDone(calculator.getTime());
+					break;
+				}
+				calculator.next(Delta::D40);
+				goto loop;
+			}
+		}
 		if (doPset) [[likely]] {
 			tmpSrc = vram.cmdReadWindow.readNP(
 			       Mode::addressOf(ADX, SY, dstExt));
@@ -3,9 +3,11 @@
 #include "Renderer.hh"
 #include "SpriteChecker.hh"
 
+#include "narrow.hh"
 #include "outer.hh"
 #include "ranges.hh"
 #include "serialize.hh"
+#include "xrange.hh"
 
 #include <algorithm>
 #include <array>
@@ -16,7 +18,7 @@ namespace openmsx {
 // class VRAMWindow
 
 VRAMWindow::VRAMWindow(Ram& vram)
-	: data(vram.data())
+	: VRAMTableView(vram.data())
 	// sizeMask will be initialized shortly by the VDPVRAM class
 {
 }
@@ -58,6 +60,20 @@ uint8_t VDPVRAM::LogicalVRAMDebuggable::read(unsigned address, EmuTime time)
 	return vram.cpuRead(transform(address), time);
 }
 
+void VDPVRAM::LogicalVRAMDebuggable::readBlock(unsigned start, std::span<uint8_t> output)
+{
+	auto& vram = OUTER(VDPVRAM, logicalVRAMDebug);
+	auto time = getMotherBoard().getCurrentTime();
+	if (vram.vdp.getDisplayMode().isPlanar()) {
+		// interleaved, not a contiguous block in the vram
+		for (auto i : xrange(output.size())) {
+			output[i] = read(narrow<unsigned>(start + i), time);
+		}
+	} else {
+		vram.cpuReadBlock(start, output, time);
+	}
+}
+
 void VDPVRAM::LogicalVRAMDebuggable::write(
 	unsigned address, uint8_t value, EmuTime time)
 {
@@ -83,6 +99,12 @@ uint8_t VDPVRAM::PhysicalVRAMDebuggable::read(unsigned address, EmuTime time)
 	return vram.cpuRead(address, time);
 }
 
+void VDPVRAM::PhysicalVRAMDebuggable::readBlock(unsigned start, std::span<uint8_t> output)
+{
+	auto& vram = OUTER(VDPVRAM, physicalVRAMDebug);
+	vram.cpuReadBlock(start, output, getMotherBoard().getCurrentTime());
+}
+
 void VDPVRAM::PhysicalVRAMDebuggable::write(
 	unsigned address, uint8_t value, EmuTime time)
 {
@@ -139,6 +161,7 @@ void VDPVRAM::clear()
 		// give the same value.
 		std::ranges::fill(subspan(data, actualSize), 0xFF);
 	}
+	++changeCount;
 }
 
 void VDPVRAM::updateDisplayMode(DisplayMode mode, bool cmdBit, EmuTime time)
@@ -204,6 +227,8 @@ void VDPVRAM::updateVRMode(bool newVRmode, EmuTime time)
 	}
 	vrMode = newVRmode;
 	setSizeMask(time);
+	spriteAttribTable.notifyAll(time);
+	spritePatternTable.notifyAll(time);
 
 	if (vrMode) {
 		// switch from VR=0 to VR=1
@@ -216,6 +241,7 @@ void VDPVRAM::updateVRMode(bool newVRmode, EmuTime time)
 			std::swap(data[i], data[swapAddr(i)]);
 		}
 	}
+	++changeCount;
 }
 
 void VDPVRAM::setRenderer(Renderer* newRenderer, EmuTime time)
@@ -231,7 +257,7 @@ void VDPVRAM::setRenderer(Renderer* newRenderer, EmuTime time)
 	bitmapVisibleWindow.setObserver(renderer);
 }
 
-void VDPVRAM::change4k8kMapping(bool mapping8k)
+void VDPVRAM::change4k8kMapping(bool mapping8k, EmuTime time)
 {
 	/* Sources:
 	 *  - http://www.msx.org/forumtopicl8624.html
@@ -275,6 +301,9 @@ void VDPVRAM::change4k8kMapping(bool mapping8k)
 	 * even in 4K mode, all 16K of VRAM can be accessed. The only
 	 * difference is in what addresses are used to store data.
 	 */
+	spriteAttribTable.notifyAll(time);
+	spritePatternTable.notifyAll(time);
+
 	std::array<uint8_t, 0x4000> tmp;
 	if (mapping8k) {
 		// from 8k/16k to 4k mapping
@@ -296,6 +325,7 @@ void VDPVRAM::change4k8kMapping(bool mapping8k)
 		}
 	}
 	copy_to_range(tmp, std::span{data});
+	++changeCount;
 }
 
 
@@ -321,6 +351,9 @@ void VDPVRAM::serialize(Archive& ar, unsigned /*version*/)
 	}
 
 	ar.serialize_blob("data", std::span{data.data(), actualSize});
+	if constexpr (Archive::IS_LOADER) {
+		++changeCount;
+	}
 	ar.serialize("cmdReadWindow",       cmdReadWindow,
 	             "cmdWriteWindow",      cmdWriteWindow,
 	             "nameTable",           nameTable,
@@ -124,24 +124,15 @@ public:
 	void updateWindow(bool /*enabled*/, EmuTime /*time*/) override {}
 };
 
-/** Specifies an address range in the VRAM.
-  * A VDP subsystem can use this to put a claim on a certain area.
-  * For example, the owner of a read window will be notified before
-  * writes to the corresponding area are commited.
-  * The address range is specified by a mask and is not necessarily
-  * continuous. See "doc/vram-addressing.txt" for details.
-  * TODO: Rename to "Table"? That's the term the VDP data book uses.
-  *       Maybe have two classes: "Table" for tables, using a mask,
-  *       and "Window" for the command engine, using an interval.
+/** The reading part of a VRAMWindow: a VRAM table described by a base and
+  * an index mask, together with the VRAM data it is read from.
+  * Unlike a VRAMWindow this can be copied, and the copy can be pointed to
+  * a snapshot of the VRAM contents (see withData()). That way the table can
+  * still be read as it was at the moment the snapshot was taken.
   */
-class VRAMWindow
+class VRAMTableView
 {
 public:
-	VRAMWindow(const VRAMWindow&) = delete;
-	VRAMWindow(VRAMWindow&&) = delete;
-	VRAMWindow& operator=(const VRAMWindow&) = delete;
-	VRAMWindow& operator=(VRAMWindow&&) = delete;
-
 	/** Gets the mask for this window.
 	  * Should only be called if the window is enabled.
 	  * TODO: Only used by dirty checking. Maybe a new dirty checking
@@ -152,51 +143,6 @@ public:
 		return effectiveBaseMask;
 	}
 
-	/** Sets the mask and enables this window.
-	  * @param newBaseMask The table base register,
-	  *     with the unused bits all ones.
-	  * @param newIndexMask The table index mask,
-	  *     with the unused bits all ones.
-	  * @param newSizeMask
-	  * @param time The moment in emulated time this change occurs.
-	  * TODO: In planar mode, the index bits are rotated one to the right.
-	  *       Solution: have the caller pass index mask instead of the
-	  *       number of bits.
-	  *       For many tables the number of index bits depends on the
-	  *       display mode anyway.
-	  */
-	void setMask(unsigned newBaseMask, unsigned newIndexMask,
-	                    unsigned newSizeMask, EmuTime time) {
-		origBaseMask = newBaseMask;
-		newBaseMask &= newSizeMask;
-		if (isEnabled() &&
-		    (newBaseMask  == effectiveBaseMask) &&
-		    (newIndexMask == indexMask)) {
-			return;
-		}
-		observer->updateWindow(true, time);
-		effectiveBaseMask = newBaseMask;
-		indexMask         = newIndexMask;
-		baseAddr  =  effectiveBaseMask & indexMask; // this enables window
-		combiMask = ~effectiveBaseMask | indexMask;
-	}
-
-	/** Same as above, but 'sizeMask' doesn't change.
-	 * This is a useful shortcut, because 'sizeMask' rarely changes.
-	 */
-	void setMask(unsigned newBaseMask, unsigned newIndexMask,
-	                    EmuTime time) {
-		setMask(newBaseMask, newIndexMask, sizeMask, time);
-	}
-
-	/** Disable this window: no address will be considered inside.
-	  * @param time The moment in emulated time this change occurs.
-	  */
-	void disable(EmuTime time) {
-		observer->updateWindow(false, time);
-		baseAddr = unsigned(-1);
-	}
-
 	/** Is the given index range continuous in VRAM (iow there's no mirroring)
 	  * Only if the range is continuous it's allowed to call getReadArea().
 	  */
@@ -280,6 +226,116 @@ public:
 		return data[addr];
 	}
 
+	/** Get a copy of this view that reads from other VRAM data, typically
+	  * a snapshot of the VRAM contents.
+	  * @param newData Must have the same size as the VRAM data block,
+	  *     see VDPVRAM::getData().
+	  */
+	[[nodiscard]] VRAMTableView withData(const uint8_t* newData) const {
+		VRAMTableView result = *this;
+		result.data = newData;
+		return result;
+	}
+
+protected:
+	explicit VRAMTableView(const uint8_t* data_)
+		: data(data_)
+	{
+	}
+
+	[[nodiscard]] bool isEnabled() const {
+		return baseAddr != unsigned(-1);
+	}
+
+protected:
+	/** Pointer to the entire VRAM data.
+	  */
+	const uint8_t* data;
+
+	/** Effective mask of this window.
+	  * This is always equal to 'origBaseMask & sizeMask'.
+	  */
+	unsigned effectiveBaseMask = 0;
+
+	/** Index mask of this window.
+	  */
+	unsigned indexMask = 0;
+
+	/** Lowest address in this window.
+	  * Or -1 when this window is disabled.
+	  */
+	unsigned baseAddr = unsigned(-1); // disable window
+
+	/** Mask to handle vram mirroring
+	  * Note: this only handles mirroring for power-of-2 sizes
+	  *       mirroring of extended VRAM is handled in a different way
+	  */
+	unsigned sizeMask;
+};
+
+/** Specifies an address range in the VRAM.
+  * A VDP subsystem can use this to put a claim on a certain area.
+  * For example, the owner of a read window will be notified before
+  * writes to the corresponding area are commited.
+  * The address range is specified by a mask and is not necessarily
+  * continuous. See "doc/vram-addressing.txt" for details.
+  * TODO: Rename to "Table"? That's the term the VDP data book uses.
+  *       Maybe have two classes: "Table" for tables, using a mask,
+  *       and "Window" for the command engine, using an interval.
+  */
+class VRAMWindow : public VRAMTableView
+{
+public:
+	VRAMWindow(const VRAMWindow&) = delete;
+	VRAMWindow(VRAMWindow&&) = delete;
+	VRAMWindow& operator=(const VRAMWindow&) = delete;
+	VRAMWindow& operator=(VRAMWindow&&) = delete;
+
+	/** Sets the mask and enables this window.
+	  * @param newBaseMask The table base register,
+	  *     with the unused bits all ones.
+	  * @param newIndexMask The table index mask,
+	  *     with the unused bits all ones.
+	  * @param newSizeMask
+	  * @param time The moment in emulated time this change occurs.
+	  * TODO: In planar mode, the index bits are rotated one to the right.
+	  *       Solution: have the caller pass index mask instead of the
+	  *       number of bits.
+	  *       For many tables the number of index bits depends on the
+	  *       display mode anyway.
+	  */
+	void setMask(unsigned newBaseMask, unsigned newIndexMask,
+	                    unsigned newSizeMask, EmuTime time) {
+		origBaseMask = newBaseMask;
+		newBaseMask &= newSizeMask;
+		if (isEnabled() &&
+		    (newBaseMask  == effectiveBaseMask) &&
+		    (newIndexMask == indexMask)) {
+			return;
+		}
+		observer->updateWindow(true, time);
+		effectiveBaseMask = newBaseMask;
+		indexMask         = newIndexMask;
+		baseAddr  =  effectiveBaseMask & indexMask; // this enables window
+		combiMask = ~effectiveBaseMask | indexMask;
+	}
+
+	/** Same as above, but 'sizeMask' doesn't change.
+	 * This is a useful shortcut, because 'sizeMask' rarely changes.
+	 */
+	void setMask(unsigned newBaseMask, unsigned newIndexMask,
+	                    EmuTime time) {
+		setMask(newBaseMask, newIndexMask, sizeMask, time);
+	}
+
+	/** Disable this window: no address will be considered inside.
+	  * @param time The moment in emulated time this change occurs.
+	  */
+	void disable(EmuTime time) {
+		observer->updateWindow(false, time);
+		baseAddr = unsigned(-1);
+	}
+
 	/** Is there an observer registered for this window?
 	  */
 	[[nodiscard]] bool hasObserver() const {
@@ -312,6 +368,19 @@ public:
 		return (address & combiMask) == baseAddr;
 	}
 
+	/** Conservative variant of isInside() for a range of addresses.
+	  * @param first The lowest address in the range.
+	  * @param last The highest address in the range (inclusive).
+	  * @return false if none of the addresses in the range is inside
+	  *     this window, true if some of them (might) be inside.
+	  */
+	[[nodiscard]] bool mightOverlap(unsigned first, unsigned last) const {
+		assert(first <= last);
+		// Bits that are the same for all addresses in the range.
+		unsigned fixed = ~Math::floodRight(first ^ last);
+		return (first & combiMask & fixed) == (baseAddr & fixed);
+	}
+
 	/** Notifies the observer of this window of a VRAM change,
 	  * if the changes address is inside this window.
 	  * @param address The address to test.
@@ -323,6 +392,15 @@ public:
 		}
 	}
 
+	/** Notifies the observer of this window that (possibly) all of its
+	  * content changed in a way that bypassed notify(), for example
+	  * because VRAM was remapped.
+	  * @param time The moment in emulated time the change occurs.
+	  */
+	void notifyAll(EmuTime time) {
+		observer->updateWindow(isEnabled(), time);
+	}
+
 	/** Inform VRAMWindow of changed sizeMask.
 	  * For the moment this only happens when switching the VR bit in VDP
 	  * register 8 (in VR=0 mode only 32kB VRAM is addressable).
@@ -338,11 +416,6 @@ public:
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
-private:
-	[[nodiscard]] bool isEnabled() const {
-		return baseAddr != unsigned(-1);
-	}
-
 private:
 	/** Only VDPVRAM may construct VRAMWindow objects.
 	  */
@@ -353,10 +426,6 @@ private:
 	  */
 	explicit VRAMWindow(Ram& vram);
 
-	/** Pointer to the entire VRAM data.
-	  */
-	uint8_t* data;
-
 	/** Observer associated with this VRAM window.
 	  * It will be called when changes occur within the window.
 	  * If there is no observer, this variable is &dummyObserver.
@@ -367,30 +436,10 @@ private:
 	 */
 	unsigned origBaseMask = 0;
 
-	/** Effective mask of this window.
-	  * This is always equal to 'origBaseMask & sizeMask'.
-	  */
-	unsigned effectiveBaseMask = 0;
-
-	/** Index mask of this window.
-	  */
-	unsigned indexMask = 0;
-
-	/** Lowest address in this window.
-	  * Or -1 when this window is disabled.
-	  */
-	unsigned baseAddr = unsigned(-1); // disable window
-
 	/** Combination of effectiveBaseMask and index mask used for "inside" checks.
 	  */
 	unsigned combiMask = 0;
 
-	/** Mask to handle vram mirroring
-	  * Note: this only handles mirroring for power-of-2 sizes
-	  *       mirroring of extended VRAM is handled in a different way
-	  */
-	unsigned sizeMask;
-
 	static inline DummyVRAMObserver dummyObserver;
 };
 
@@ -447,6 +496,49 @@ public:
 		writeCommon(address, value, time);
 	}
 
+	/** Get direct access to a range of VRAM for a bulk command engine
+	  * operation. Writing to this area bypasses the VRAM observers, so
+	  * this is only allowed when no observer (renderer, sprite checker)
+	  * is interested in any of these addresses. Also the range may not
+	  * be affected by mirroring or non-present ram chips.
+	  * Like cmdWrite(), the caller must have synced the observers up to
+	  * the time of the first access (this is implied for the command
+	  * engine).
+	  * @param address The lowest address in the range.
+	  * @param num The number of bytes in the range.
+	  * @return Pointer to the VRAM data at 'address', or nullptr when the
+	  *     range cannot be accessed directly.
+	  */
+	[[nodiscard]] uint8_t* getCmdBulkArea(unsigned address, unsigned num) {
+		assert(num > 0);
+		unsigned last = address + num - 1;
+		if (((last & sizeMask) != last) || (last >= actualSize)) {
+			return nullptr;
+		}
+		if ((bitmapVisibleWindow.hasObserver() &&
+		     bitmapVisibleWindow.mightOverlap(address, last)) ||
+		    (spriteAttribTable.hasObserver() &&
+		     spriteAttribTable.mightOverlap(address, last)) ||
+		    (spritePatternTable.hasObserver() &&
+		     spritePatternTable.mightOverlap(address, last))) {
+			return nullptr;
+		}
+		++changeCount; // the caller writes to this area
+		return &data[address];
+	}
+
+	/** Similar to getCmdBulkArea(), but for reading. Reads don't need
+	  * to be observed, so this only checks for mirroring.
+	  */
+	[[nodiscard]] const uint8_t* getCmdBulkReadArea(unsigned address, unsigned num) const {
+		assert(num > 0);
+		unsigned last = address + num - 1;
+		if (((last & sizeMask) != last) || (last >= actualSize)) {
+			return nullptr;
+		}
+		return &data[address];
+	}
+
 	/** Write a byte to VRAM through the CPU interface.
 	  * @param address The address to write.
 	  * @param value The value to write.
@@ -507,6 +599,29 @@ public:
 		return data[address];
 	}
 
+	/** Like cpuRead() for a block of consecutive addresses, but only
+	  * synchronizes with the command engine once. Used by the debuggables.
+	  */
+	void cpuReadBlock(unsigned address, std::span<uint8_t> output, EmuTime time) {
+		#ifdef DEBUG
+		assert(time >= vramTime);
+		#endif
+		assert(vdp.isInsideFrame(time));
+		if (output.empty()) return;
+
+		if (cmdWriteWindow.mightOverlap(address & sizeMask, (address & sizeMask) + unsigned(output.size()) - 1)) {
+			cmdEngine->sync(time);
+		}
+		cmdEngine->stealAccessSlot(time);
+
+		#ifdef DEBUG
+		vramTime = time;
+		#endif
+		for (auto& o : output) {
+			o = data[address++ & sizeMask];
+		}
+	}
+
 	/** Used by the VDP to signal display mode changes.
 	  * VDPVRAM will inform the Renderer, command engine and the sprite
 	  * checker of this change.
@@ -559,15 +674,25 @@ public:
 
 	/** TMS99x8 VRAM can be mapped in two ways.
 	  * See implementation for more details.
+	  * @param mapping8k The new mapping.
+	  * @param time The moment in emulated time this change occurs.
 	  */
-	void change4k8kMapping(bool mapping8k);
+	void change4k8kMapping(bool mapping8k, EmuTime time);
 
-	/** Only used by debugger
+	/** Used by the debugger and to take snapshots of the VRAM contents.
 	 */
 	[[nodiscard]] std::span<const uint8_t> getData() const {
 		return {data.data(), data.size()};
 	}
 
+	/** Counts the changes of the VRAM contents. Comparing two values tells
+	  * whether the VRAM contents (might) have changed in between, for
+	  * example to know whether a snapshot of the VRAM is still up-to-date.
+	  */
+	[[nodiscard]] unsigned getChangeCount() const {
+		return changeCount;
+	}
+
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
@@ -593,6 +718,7 @@ private:
 		spritePatternTable.notify(address, time);
 
 		data[address] = value;
+		++changeCount;
 
 		// Cache dirty marking should happen after the commit,
 		// otherwise the cache could be re-validated based on old state.
@@ -631,6 +757,10 @@ private:
 	  */
 	Ram data;
 
+	/** See getChangeCount().
+	  */
+	unsigned changeCount = 0;
+
 	/** Debuggable with mode dependent view on the vram
 	  *   Screen7/8 are not interleaved in this mode.
 	  *   This debuggable is also at least 128kB in size (it possibly
@@ -640,6 +770,7 @@ private:
 	public:
 		explicit LogicalVRAMDebuggable(const VDP& vdp);
 		[[nodiscard]] uint8_t read(unsigned address, EmuTime time) override;
+		void readBlock(unsigned start, std::span<uint8_t> output) override;
 		void write(unsigned address, uint8_t value, EmuTime time) override;
 	private:
 		unsigned transform(unsigned address);
@@ -652,6 +783,7 @@ private:
 	struct PhysicalVRAMDebuggable final : SimpleDebuggable {
 		PhysicalVRAMDebuggable(const VDP& vdp, unsigned actualSize);
 		[[nodiscard]] uint8_t read(unsigned address, EmuTime time) override;
+		void readBlock(unsigned start, std::span<uint8_t> output) override;
 		void write(unsigned address, uint8_t value, EmuTime time) override;
 	} physicalVRAMDebug;
 
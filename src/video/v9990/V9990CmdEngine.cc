@@ -2,29 +2,32 @@
 
 #include "V9990.hh"
 #include "V9990DisplayTiming.hh"
+#include "V9990LogOp.hh"
 #include "V9990VRAM.hh"
 
 #include "BooleanSetting.hh"
 #include "Clock.hh"
 #include "EnumSetting.hh"
 #include "MSXMotherBoard.hh"
-#include "MemBuffer.hh"
 #include "RenderSettings.hh"
 #include "serialize.hh"
 
 #include "checked_cast.hh"
 #include "narrow.hh"
-#include "stl.hh"
 #include "unreachable.hh"
 #include "xrange.hh"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <iostream>
+#include <limits>
 #include <string_view>
 
 namespace openmsx {
 
+using namespace V9990LogOp;
+
 static constexpr unsigned maxLength = 171; // The maximum value from the xxx_TIMING tables below
 static constexpr EmuDuration d_(unsigned x)
 {
@@ -106,184 +109,11 @@ static constexpr std::array SRCH_TIMING = {
 }
 
 
-
-// Lazily initialized LUT to speed up logical operations:
-//  - 1st index is the mode: 2,4,8 bpp or 'not-transparent'
-//  - 2nd index is the logical operation: one of the 16 possible binary functions
-// * Each entry contains a 256x256 byte array, that array is indexed using
-//   destination and source byte (in that order).
-// * A fully populated logOpLUT would take 4MB, however the vast majority of
-//   this table is (almost) never used. So we save quite some memory (and
-//   startup time) by lazily initializing this table.
-enum class Log : uint8_t {
-	NO_T, BPP2, BPP4, BPP8,
-	NUM
-};
-static array_with_enum_index<Log, std::array<MemBuffer<uint8_t>, 16>> logOpLUT;
-
-// to speedup calculating logOpLUT
-static constexpr auto bitLUT = [] {
-	std::array<std::array<std::array<std::array<uint8_t, 2>, 2>, 16>, 8> result = {};
-	for (auto op : xrange(16)) {
-		unsigned tmp = op;
-		for (auto src : xrange(2)) {
-			for (auto dst : xrange(2)) {
-				unsigned b = tmp & 1;
-				for (auto bit : xrange(8)) {
-					result[bit][op][src][dst] = narrow<uint8_t>(b << bit);
-				}
-				tmp >>= 1;
-			}
-		}
-	}
-	return result;
-}();
-
-[[nodiscard]] static constexpr uint8_t func01(unsigned op, unsigned src, unsigned dst)
-{
-	if ((src & 0x03) == 0) return dst & 0x03;
-	uint8_t res = 0;
-	res |= bitLUT[0][op][(src & 0x01) >> 0][(dst & 0x01) >> 0];
-	res |= bitLUT[1][op][(src & 0x02) >> 1][(dst & 0x02) >> 1];
-	return res;
-}
-[[nodiscard]] static constexpr uint8_t func23(unsigned op, unsigned src, unsigned dst)
-{
-	if ((src & 0x0C) == 0) return dst & 0x0C;
-	uint8_t res = 0;
-	res |= bitLUT[2][op][(src & 0x04) >> 2][(dst & 0x04) >> 2];
-	res |= bitLUT[3][op][(src & 0x08) >> 3][(dst & 0x08) >> 3];
-	return res;
-}
-[[nodiscard]] static constexpr uint8_t func45(unsigned op, unsigned src, unsigned dst)
-{
-	if ((src & 0x30) == 0) return dst & 0x30;
-	uint8_t res = 0;
-	res |= bitLUT[4][op][(src & 0x10) >> 4][(dst & 0x10) >> 4];
-	res |= bitLUT[5][op][(src & 0x20) >> 5][(dst & 0x20) >> 5];
-	return res;
-}
-[[nodiscard]] static constexpr uint8_t func67(unsigned op, unsigned src, unsigned dst)
-{
-	if ((src & 0xC0) == 0) return dst & 0xC0;
-	uint8_t res = 0;
-	res |= bitLUT[6][op][(src & 0x40) >> 6][(dst & 0x40) >> 6];
-	res |= bitLUT[7][op][(src & 0x80) >> 7][(dst & 0x80) >> 7];
-	return res;
-}
-
-[[nodiscard]] static constexpr uint8_t func03(unsigned op, unsigned src, unsigned dst)
-{
-	if ((src & 0x0F) == 0) return dst & 0x0F;
-	uint8_t res = 0;
-	res |= bitLUT[0][op][(src & 0x01) >> 0][(dst & 0x01) >> 0];
-	res |= bitLUT[1][op][(src & 0x02) >> 1][(dst & 0x02) >> 1];
-	res |= bitLUT[2][op][(src & 0x04) >> 2][(dst & 0x04) >> 2];
-	res |= bitLUT[3][op][(src & 0x08) >> 3][(dst & 0x08) >> 3];
-	return res;
-}
-[[nodiscard]] static constexpr uint8_t func47(unsigned op, unsigned src, unsigned dst)
-{
-	if ((src & 0xF0) == 0) return dst & 0xF0;
-	uint8_t res = 0;
-	res |= bitLUT[4][op][(src & 0x10) >> 4][(dst & 0x10) >> 4];
-	res |= bitLUT[5][op][(src & 0x20) >> 5][(dst & 0x20) >> 5];
-	res |= bitLUT[6][op][(src & 0x40) >> 6][(dst & 0x40) >> 6];
-	res |= bitLUT[7][op][(src & 0x80) >> 7][(dst & 0x80) >> 7];
-	return res;
-}
-
-[[nodiscard]] static constexpr uint8_t func07(unsigned op, unsigned src, unsigned dst)
-{
-	// if (src == 0) return dst;  // handled in fillTable8
-	uint8_t res = 0;
-	res |= bitLUT[0][op][(src & 0x01) >> 0][(dst & 0x01) >> 0];
-	res |= bitLUT[1][op][(src & 0x02) >> 1][(dst & 0x02) >> 1];
-	res |= bitLUT[2][op][(src & 0x04) >> 2][(dst & 0x04) >> 2];
-	res |= bitLUT[3][op][(src & 0x08) >> 3][(dst & 0x08) >> 3];
-	res |= bitLUT[4][op][(src & 0x10) >> 4][(dst & 0x10) >> 4];
-	res |= bitLUT[5][op][(src & 0x20) >> 5][(dst & 0x20) >> 5];
-	res |= bitLUT[6][op][(src & 0x40) >> 6][(dst & 0x40) >> 6];
-	res |= bitLUT[7][op][(src & 0x80) >> 7][(dst & 0x80) >> 7];
-	return res;
-}
-
-static constexpr void fillTableNoT(unsigned op, std::span<uint8_t, 256 * 256> table)
-{
-	for (auto dst : xrange(256)) {
-		for (auto src : xrange(256)) {
-			table[dst * 256 + src] = func07(op, src, dst);
-		}
-	}
-}
-
-static constexpr void fillTable2(unsigned op, std::span<uint8_t, 256 * 256> table)
-{
-	for (auto dst : xrange(256)) {
-		for (auto src : xrange(256)) {
-			uint8_t res = 0;
-			res |= func01(op, src, dst);
-			res |= func23(op, src, dst);
-			res |= func45(op, src, dst);
-			res |= func67(op, src, dst);
-			table[dst * 256 + src] = res;
-		}
-	}
-}
-
-static constexpr void fillTable4(unsigned op, std::span<uint8_t, 256 * 256> table)
-{
-	for (auto dst : xrange(256)) {
-		for (auto src : xrange(256)) {
-			uint8_t res = 0;
-			res |= func03(op, src, dst);
-			res |= func47(op, src, dst);
-			table[dst * 256 + src] = res;
-		}
-	}
-}
-
-static constexpr void fillTable8(unsigned op, std::span<uint8_t, 256 * 256> table)
-{
-	for (auto dst : xrange(256)) {
-		{ // src == 0
-			table[dst * 256 + 0  ] = narrow_cast<uint8_t>(dst);
-		}
-		for (auto src : xrange(1, 256)) { // src != 0
-			table[dst * 256 + src] = func07(op, src, dst);
-		}
-	}
-}
-
-[[nodiscard]] static std::span<const uint8_t, 256 * 256> getLogOpImpl(Log mode, unsigned op)
+[[nodiscard]] static constexpr bool overlap(unsigned a, unsigned b, unsigned num)
 {
-	op &= 0x0f;
-	auto& lut = logOpLUT[mode][op];
-	if (!lut.data()) {
-		lut.resize(256 * 256);
-		std::span<uint8_t, 256 * 256> s{lut};
-		switch (mode) {
-		using enum Log;
-		case NO_T:
-			fillTableNoT(op, s);
-			break;
-		case BPP2:
-			fillTable2(op, s);
-			break;
-		case BPP4:
-			fillTable4(op, s);
-			break;
-		case BPP8:
-			fillTable8(op, s);
-			break;
-		default:
-			UNREACHABLE;
-		}
-	}
-	return std::span<uint8_t, 256 * 256>{lut};
+	return (a < (b + num)) && (b < (a + num));
 }
 
-
 static constexpr uint8_t DIY = 0x08;
 static constexpr uint8_t DIX = 0x04;
 static constexpr uint8_t NEQ = 0x02;
@@ -324,7 +154,7 @@ inline uint8_t V9990CmdEngine::V9990P1::shiftMask(unsigned x)
 
 inline std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990P1::getLogOpLUT(uint8_t op)
 {
-	return getLogOpImpl((op & 0x10) ? Log::BPP4 : Log::NO_T, op);
+	return getLUT((op & 0x10) ? Log::BPP4 : Log::NO_T, op);
 }
 
 inline uint8_t V9990CmdEngine::V9990P1::logOp(
@@ -392,7 +222,7 @@ inline uint8_t V9990CmdEngine::V9990P2::shiftMask(unsigned x)
 
 inline std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990P2::getLogOpLUT(uint8_t op)
 {
-	return getLogOpImpl((op & 0x10) ? Log::BPP4 : Log::NO_T, op);
+	return getLUT((op & 0x10) ? Log::BPP4 : Log::NO_T, op);
 }
 
 inline uint8_t V9990CmdEngine::V9990P2::logOp(
@@ -460,7 +290,7 @@ inline uint8_t V9990CmdEngine::V9990Bpp2::shiftMask(unsigned x)
 
 inline std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990Bpp2::getLogOpLUT(uint8_t op)
 {
-	return getLogOpImpl((op & 0x10) ? Log::BPP2 : Log::NO_T, op);
+	return getLUT((op & 0x10) ? Log::BPP2 : Log::NO_T, op);
 }
 
 inline uint8_t V9990CmdEngine::V9990Bpp2::logOp(
@@ -528,7 +358,7 @@ inline uint8_t V9990CmdEngine::V9990Bpp4::shiftMask(unsigned x)
 
 inline std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990Bpp4::getLogOpLUT(uint8_t op)
 {
-	return getLogOpImpl((op & 0x10) ? Log::BPP4 : Log::NO_T, op);
+	return getLUT((op & 0x10) ? Log::BPP4 : Log::NO_T, op);
 }
 
 inline uint8_t V9990CmdEngine::V9990Bpp4::logOp(
@@ -595,7 +425,7 @@ inline uint8_t V9990CmdEngine::V9990Bpp8::shiftMask(unsigned /*x*/)
 
 inline std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990Bpp8::getLogOpLUT(uint8_t op)
 {
-	return getLogOpImpl((op & 0x10) ? Log::BPP8 : Log::NO_T, op);
+	return getLUT((op & 0x10) ? Log::BPP8 : Log::NO_T, op);
 }
 
 inline uint8_t V9990CmdEngine::V9990Bpp8::logOp(
@@ -629,6 +459,47 @@ inline void V9990CmdEngine::V9990Bpp8::psetColor(
 	vram.writeVRAMDirect(addr, result);
 }
 
+// Pixels [x, x + num) of row 'y', 'x + num' must not exceed 'pitch'.
+// Consecutive pixels alternate between the two VRAM banks (see
+// V9990VRAM::transformBx()), but within each bank they are contiguous.
+inline void V9990CmdEngine::V9990Bpp8::fillRow(
+	V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch, unsigned num,
+	uint16_t color, uint16_t mask, uint8_t op)
+{
+	auto data = vram.getWriteBackdoor();
+	unsigned lin = (x + y * pitch) & 0x7FFFF;
+	for (auto i : xrange(std::min(num, 2u))) {
+		unsigned addr = V9990VRAM::transformBx(lin + i);
+		bool hi = (addr & 0x40000) != 0;
+		auto c = narrow_cast<uint8_t>(hi ? (color >> 8) : (color & 0xFF));
+		auto m = narrow_cast<uint8_t>(hi ? (mask  >> 8) : (mask  & 0xFF));
+		blendBytes(&data[addr], ColorSource{c}, (num - i + 1) / 2,
+		           LogOpMasks(op), m, (op & 0x10) != 0);
+	}
+}
+
+// Returns false (and does nothing) when source and destination overlap. In
+// that case the order in which the pixels are processed matters, so the
+// caller should fall back to the per pixel routines.
+inline bool V9990CmdEngine::V9990Bpp8::copyRow(
+	V9990VRAM& vram, unsigned sx, unsigned sy, unsigned dx, unsigned dy,
+	unsigned pitch, unsigned num, uint16_t mask, uint8_t op)
+{
+	unsigned srcLin = (sx + sy * pitch) & 0x7FFFF;
+	unsigned dstLin = (dx + dy * pitch) & 0x7FFFF;
+	if (overlap(srcLin, dstLin, num)) return false;
+
+	auto data = vram.getWriteBackdoor();
+	for (auto i : xrange(std::min(num, 2u))) {
+		unsigned srcAddr = V9990VRAM::transformBx(srcLin + i);
+		unsigned dstAddr = V9990VRAM::transformBx(dstLin + i);
+		auto m = narrow_cast<uint8_t>((dstAddr & 0x40000) ? (mask >> 8) : (mask & 0xFF));
+		blendBytes(&data[dstAddr], VRAMSource{&data[srcAddr]}, (num - i + 1) / 2,
+		           LogOpMasks(op), m, (op & 0x10) != 0);
+	}
+	return true;
+}
+
 // 16 bpp -------------------------------------------------------------
 inline unsigned V9990CmdEngine::V9990Bpp16::getPitch(unsigned width)
 {
@@ -664,7 +535,7 @@ inline uint16_t V9990CmdEngine::V9990Bpp16::shiftMask(unsigned /*x*/)
 
 inline std::span<const uint8_t, 256 * 256> V9990CmdEngine::V9990Bpp16::getLogOpLUT(uint8_t op)
 {
-	return getLogOpImpl(Log::NO_T, op);
+	return getLUT(Log::NO_T, op);
 }
 
 inline uint16_t V9990CmdEngine::V9990Bpp16::logOp(
@@ -701,6 +572,36 @@ inline void V9990CmdEngine::V9990Bpp16::psetColor(
 	vram.writeVRAMDirect(addr + 0x40000, narrow_cast<uint8_t>(result >> 8));
 }
 
+// Pixels [x, x + num) of row 'y', 'x + num' must not exceed 'pitch'.
+inline void V9990CmdEngine::V9990Bpp16::fillRow(
+	V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch, unsigned num,
+	uint16_t color, uint16_t mask, uint8_t op)
+{
+	auto data = vram.getWriteBackdoor();
+	unsigned addr = addressOf(x, y, pitch);
+	blendWords(&data[addr + 0x00000], &data[addr + 0x40000],
+	           ColorSource{narrow_cast<uint8_t>(color & 0xFF)},
+	           ColorSource{narrow_cast<uint8_t>(color >> 8)},
+	           num, LogOpMasks(op), mask, (op & 0x10) != 0);
+}
+
+// See V9990Bpp8::copyRow().
+inline bool V9990CmdEngine::V9990Bpp16::copyRow(
+	V9990VRAM& vram, unsigned sx, unsigned sy, unsigned dx, unsigned dy,
+	unsigned pitch, unsigned num, uint16_t mask, uint8_t op)
+{
+	unsigned srcAddr = addressOf(sx, sy, pitch);
+	unsigned dstAddr = addressOf(dx, dy, pitch);
+	if (overlap(srcAddr, dstAddr, num)) return false;
+
+	auto data = vram.getWriteBackdoor();
+	blendWords(&data[dstAddr + 0x00000], &data[dstAddr + 0x40000],
+	           VRAMSource{&data[srcAddr + 0x00000]},
+	           VRAMSource{&data[srcAddr + 0x40000]},
+	           num, LogOpMasks(op), mask, (op & 0x10) != 0);
+	return true;
+}
+
 // ====================================================================
 /** Constructor
   */
@@ -1035,6 +936,26 @@ void V9990CmdEngine::executeLMMC(EmuTime limit)
 	}
 }
 
+// Number of steps of length 'delta' that the engine can take before reaching
+// 'limit' (the last step may end past 'limit', like in the per pixel loops).
+[[nodiscard]] static unsigned stepsUntil(EmuTime time, EmuTime limit, EmuDuration delta)
+{
+	assert(time < limit);
+	if (delta == EmuDuration::zero()) [[unlikely]] {
+		// broken timing: commands execute instantaneously
+		return std::numeric_limits<unsigned>::max();
+	}
+	uint64_t steps = ((limit - time).toUint64() - 1) / delta.toUint64() + 1;
+	return narrow_cast<unsigned>(std::min<uint64_t>(steps, std::numeric_limits<unsigned>::max()));
+}
+
+// Number of pixels, starting at 'x' and moving in direction 'dx', before the
+// x-coordinate wraps around within 'pitch'.
+[[nodiscard]] static unsigned rowRemaining(unsigned x, uint16_t dx, unsigned pitch)
+{
+	return (dx == 1) ? (pitch - x) : (x + 1);
+}
+
 // LMMV
 void V9990CmdEngine::startLMMV(EmuTime time)
 {
@@ -1046,19 +967,28 @@ void V9990CmdEngine::startLMMV(EmuTime time)
 template<typename Mode>
 void V9990CmdEngine::executeLMMV(EmuTime limit)
 {
-	// TODO can be optimized a lot
-
 	auto delta = getTiming(*this, LMMV_TIMING);
 	unsigned pitch = Mode::getPitch(vdp.getImageWidth());
 	uint16_t dx = (ARG & DIX) ? uint16_t(-1) : 1;
 	uint16_t dy = (ARG & DIY) ? uint16_t(-1) : 1;
 	auto lut = Mode::getLogOpLUT(LOG);
 	while (engineTime < limit) {
-		engineTime += delta;
-		Mode::psetColor(vram, DX, DY, pitch, fgCol, WM, lut, LOG);
+		unsigned num = 1;
+		if constexpr (Mode::BITS_PER_PIXEL >= 8) {
+			// Handle as many pixels of the current row as possible.
+			unsigned x = DX & (pitch - 1);
+			num = std::min({unsigned(ANX), stepsUntil(engineTime, limit, delta),
+			                rowRemaining(x, dx, pitch)});
+			Mode::fillRow(vram, (dx == 1) ? x : (x + 1 - num), DY, pitch,
+			              num, fgCol, WM, LOG);
+		} else {
+			Mode::psetColor(vram, DX, DY, pitch, fgCol, WM, lut, LOG);
+		}
+		engineTime += delta * num;
 
-		DX += dx;
-		if (!--ANX) {
+		DX += uint16_t(num * dx);
+		ANX = uint16_t(ANX - num);
+		if (!ANX) {
 			DX -= uint16_t(NX * dx);
 			DY += dy;
 			if (!--ANY) {
@@ -1139,22 +1069,37 @@ void V9990CmdEngine::startLMMM(EmuTime time)
 template<typename Mode>
 void V9990CmdEngine::executeLMMM(EmuTime limit)
 {
-	// TODO can be optimized a lot
-
 	auto delta = getTiming(*this, LMMM_TIMING);
 	unsigned pitch = Mode::getPitch(vdp.getImageWidth());
 	uint16_t dx = (ARG & DIX) ? uint16_t(-1) : 1;
 	uint16_t dy = (ARG & DIY) ? uint16_t(-1) : 1;
 	auto lut = Mode::getLogOpLUT(LOG);
 	while (engineTime < limit) {
-		engineTime += delta;
-		auto src = Mode::point(vram, SX, SY, pitch);
-		src = Mode::shift(src, SX, DX);
-		Mode::pset(vram, DX, DY, pitch, src, WM, lut, LOG);
+		unsigned num = 1;
+		bool done = false;
+		if constexpr (Mode::BITS_PER_PIXEL >= 8) {
+			// Handle as many pixels of the current row as possible.
+			unsigned sx = SX & (pitch - 1);
+			unsigned x  = DX & (pitch - 1);
+			num = std::min({unsigned(ANX), stepsUntil(engineTime, limit, delta),
+			                rowRemaining(sx, dx, pitch), rowRemaining(x, dx, pitch)});
+			done = Mode::copyRow(vram,
+				(dx == 1) ? sx : (sx + 1 - num), SY,
+				(dx == 1) ? x  : (x  + 1 - num), DY,
+				pitch, num, WM, LOG);
+			if (!done) num = 1;
+		}
+		if (!done) {
+			auto src = Mode::point(vram, SX, SY, pitch);
+			src = Mode::shift(src, SX, DX);
+			Mode::pset(vram, DX, DY, pitch, src, WM, lut, LOG);
+		}
+		engineTime += delta * num;
 
-		DX += dx;
-		SX += dx;
-		if (!--ANX) {
+		DX += uint16_t(num * dx);
+		SX += uint16_t(num * dx);
+		ANX = uint16_t(ANX - num);
+		if (!ANX) {
 			DX -= uint16_t(NX * dx);
 			SX -= uint16_t(NX * dx);
 			DY += dy;
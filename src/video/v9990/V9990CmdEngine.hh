@@ -199,6 +199,12 @@ private:
 		static void psetColor(
 			V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch,
 			uint16_t color, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t op);
+		static void fillRow(
+			V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch, unsigned num,
+			uint16_t color, uint16_t mask, uint8_t op);
+		[[nodiscard]] static bool copyRow(
+			V9990VRAM& vram, unsigned sx, unsigned sy, unsigned dx, unsigned dy,
+			unsigned pitch, unsigned num, uint16_t mask, uint8_t op);
 	};
 
 	class V9990Bpp16 {
@@ -220,6 +226,12 @@ private:
 		static void psetColor(
 			V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch,
 			uint16_t color, uint16_t mask, std::span<const uint8_t, 256 * 256> lut, uint8_t op);
+		static void fillRow(
+			V9990VRAM& vram, unsigned x, unsigned y, unsigned pitch, unsigned num,
+			uint16_t color, uint16_t mask, uint8_t op);
+		[[nodiscard]] static bool copyRow(
+			V9990VRAM& vram, unsigned sx, unsigned sy, unsigned dx, unsigned dy,
+			unsigned pitch, unsigned num, uint16_t mask, uint8_t op);
 	};
 
 	void startSTOP  (EmuTime time);
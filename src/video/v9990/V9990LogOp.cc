@@ -0,0 +1,186 @@
+#include "V9990LogOp.hh"
+
+#include "MemBuffer.hh"
+
+#include "narrow.hh"
+#include "stl.hh"
+#include "unreachable.hh"
+#include "xrange.hh"
+
+#include <array>
+
+namespace openmsx::V9990LogOp {
+
+// Lazily initialized LUT to speed up logical operations:
+//  - 1st index is the mode: 2,4,8 bpp or 'not-transparent'
+//  - 2nd index is the logical operation: one of the 16 possible binary functions
+// * Each entry contains a 256x256 byte array, that array is indexed using
+//   destination and source byte (in that order).
+// * A fully populated logOpLUT would take 4MB, however the vast majority of
+//   this table is (almost) never used. So we save quite some memory (and
+//   startup time) by lazily initializing this table.
+static array_with_enum_index<Log, std::array<MemBuffer<uint8_t>, 16>> logOpLUT;
+
+// to speedup calculating logOpLUT
+static constexpr auto bitLUT = [] {
+	std::array<std::array<std::array<std::array<uint8_t, 2>, 2>, 16>, 8> result = {};
+	for (auto op : xrange(16)) {
+		unsigned tmp = op;
+		for (auto src : xrange(2)) {
+			for (auto dst : xrange(2)) {
+				unsigned b = tmp & 1;
+				for (auto bit : xrange(8)) {
+					result[bit][op][src][dst] = narrow<uint8_t>(b << bit);
+				}
+				tmp >>= 1;
+			}
+		}
+	}
+	return result;
+}();
+
+[[nodiscard]] static constexpr uint8_t func01(unsigned op, unsigned src, unsigned dst)
+{
+	if ((src & 0x03) == 0) return dst & 0x03;
+	uint8_t res = 0;
+	res |= bitLUT[0][op][(src & 0x01) >> 0][(dst & 0x01) >> 0];
+	res |= bitLUT[1][op][(src & 0x02) >> 1][(dst & 0x02) >> 1];
+	return res;
+}
+[[nodiscard]] static constexpr uint8_t func23(unsigned op, unsigned src, unsigned dst)
+{
+	if ((src & 0x0C) == 0) return dst & 0x0C;
+	uint8_t res = 0;
+	res |= bitLUT[2][op][(src & 0x04) >> 2][(dst & 0x04) >> 2];
+	res |= bitLUT[3][op][(src & 0x08) >> 3][(dst & 0x08) >> 3];
+	return res;
+}
+[[nodiscard]] static constexpr uint8_t func45(unsigned op, unsigned src, unsigned dst)
+{
+	if ((src & 0x30) == 0) return dst & 0x30;
+	uint8_t res = 0;
+	res |= bitLUT[4][op][(src & 0x10) >> 4][(dst & 0x10) >> 4];
+	res |= bitLUT[5][op][(src & 0x20) >> 5][(dst & 0x20) >> 5];
+	return res;
+}
+[[nodiscard]] static constexpr uint8_t func67(unsigned op, unsigned src, unsigned dst)
+{
+	if ((src & 0xC0) == 0) return dst & 0xC0;
+	uint8_t res = 0;
+	res |= bitLUT[6][op][(src & 0x40) >> 6][(dst & 0x40) >> 6];
+	res |= bitLUT[7][op][(src & 0x80) >> 7][(dst & 0x80) >> 7];
+	return res;
+}
+
+[[nodiscard]] static constexpr uint8_t func03(unsigned op, unsigned src, unsigned dst)
+{
+	if ((src & 0x0F) == 0) return dst & 0x0F;
+	uint8_t res = 0;
+	res |= bitLUT[0][op][(src & 0x01) >> 0][(dst & 0x01) >> 0];
+	res |= bitLUT[1][op][(src & 0x02) >> 1][(dst & 0x02) >> 1];
+	res |= bitLUT[2][op][(src & 0x04) >> 2][(dst & 0x04) >> 2];
+	res |= bitLUT[3][op][(src & 0x08) >> 3][(dst & 0x08) >> 3];
+	return res;
+}
+[[nodiscard]] static constexpr uint8_t func47(unsigned op, unsigned src, unsigned dst)
+{
+	if ((src & 0xF0) == 0) return dst & 0xF0;
+	uint8_t res = 0;
+	res |= bitLUT[4][op][(src & 0x10) >> 4][(dst & 0x10) >> 4];
+	res |= bitLUT[5][op][(src & 0x20) >> 5][(dst & 0x20) >> 5];
+	res |= bitLUT[6][op][(src & 0x40) >> 6][(dst & 0x40) >> 6];
+	res |= bitLUT[7][op][(src & 0x80) >> 7][(dst & 0x80) >> 7];
+	return res;
+}
+
+[[nodiscard]] static constexpr uint8_t func07(unsigned op, unsigned src, unsigned dst)
+{
+	// if (src == 0) return dst;  // handled in fillTable8
+	uint8_t res = 0;
+	res |= bitLUT[0][op][(src & 0x01) >> 0][(dst & 0x01) >> 0];
+	res |= bitLUT[1][op][(src & 0x02) >> 1][(dst & 0x02) >> 1];
+	res |= bitLUT[2][op][(src & 0x04) >> 2][(dst & 0x04) >> 2];
+	res |= bitLUT[3][op][(src & 0x08) >> 3][(dst & 0x08) >> 3];
+	res |= bitLUT[4][op][(src & 0x10) >> 4][(dst & 0x10) >> 4];
+	res |= bitLUT[5][op][(src & 0x20) >> 5][(dst & 0x20) >> 5];
+	res |= bitLUT[6][op][(src & 0x40) >> 6][(dst & 0x40) >> 6];
+	res |= bitLUT[7][op][(src & 0x80) >> 7][(dst & 0x80) >> 7];
+	return res;
+}
+
+static constexpr void fillTableNoT(unsigned op, std::span<uint8_t, 256 * 256> table)
+{
+	for (auto dst : xrange(256)) {
+		for (auto src : xrange(256)) {
+			table[dst * 256 + src] = func07(op, src, dst);
+		}
+	}
+}
+
+static constexpr void fillTable2(unsigned op, std::span<uint8_t, 256 * 256> table)
+{
+	for (auto dst : xrange(256)) {
+		for (auto src : xrange(256)) {
+			uint8_t res = 0;
+			res |= func01(op, src, dst);
+			res |= func23(op, src, dst);
+			res |= func45(op, src, dst);
+			res |= func67(op, src, dst);
+			table[dst * 256 + src] = res;
+		}
+	}
+}
+
+static constexpr void fillTable4(unsigned op, std::span<uint8_t, 256 * 256> table)
+{
+	for (auto dst : xrange(256)) {
+		for (auto src : xrange(256)) {
+			uint8_t res = 0;
+			res |= func03(op, src, dst);
+			res |= func47(op, src, dst);
+			table[dst * 256 + src] = res;
+		}
+	}
+}
+
+static constexpr void fillTable8(unsigned op, std::span<uint8_t, 256 * 256> table)
+{
+	for (auto dst : xrange(256)) {
+		{ // src == 0
+			table[dst * 256 + 0  ] = narrow_cast<uint8_t>(dst);
+		}
+		for (auto src : xrange(1, 256)) { // src != 0
+			table[dst * 256 + src] = func07(op, src, dst);
+		}
+	}
+}
+
+std::span<const uint8_t, 256 * 256> getLUT(Log mode, unsigned op)
+{
+	op &= 0x0f;
+	auto& lut = logOpLUT[mode][op];
+	if (!lut.data()) {
+		lut.resize(256 * 256);
+		std::span<uint8_t, 256 * 256> s{lut};
+		switch (mode) {
+		using enum Log;
+		case NO_T:
+			fillTableNoT(op, s);
+			break;
+		case BPP2:
+			fillTable2(op, s);
+			break;
+		case BPP4:
+			fillTable4(op, s);
+			break;
+		case BPP8:
+			fillTable8(op, s);
+			break;
+		default:
+			UNREACHABLE;
+		}
+	}
+	return std::span<uint8_t, 256 * 256>{lut};
+}
+
+} // namespace openmsx::V9990LogOp
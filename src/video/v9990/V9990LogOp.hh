@@ -0,0 +1,175 @@
+#ifndef V9990LOGOP_HH
+#define V9990LOGOP_HH
+
+#include "narrow.hh"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/** The logical operations (LOG register) of the V9990 command engine.
+  */
+namespace openmsx::V9990LogOp {
+
+// Bits 0-3 of the LOG register select one of the 16 possible binary
+// functions. When bit 4 is set, source pixels with value 0 are transparent.
+// The transparency check depends on the number of bits per pixel, that's
+// selected by 'Log' ('NO_T' ignores bit 4).
+enum class Log : uint8_t {
+	NO_T, BPP2, BPP4, BPP8,
+	NUM
+};
+
+/** Returns a 256x256 table, indexed using destination and source byte (in
+  * that order), with the result of the logical operation on those bytes.
+  */
+[[nodiscard]] std::span<const uint8_t, 256 * 256> getLUT(Log mode, unsigned op);
+
+
+// Row based operations
+//
+// In 8bpp and 16bpp modes each pixel occupies whole bytes and the pixels of
+// (a part of) a row occupy contiguous VRAM ranges. For such ranges the
+// logical operation, the transparency check and the write-mask can be
+// applied to many pixels at once. The results are identical to those of the
+// tables returned by getLUT(): here the logical operation is expressed as a
+// combination of bitwise operations.
+
+// Bit 'n' in 'op' is the result for the (src-bit, dst-bit) combination:
+//   n=0 -> (0, 0),  n=1 -> (0, 1),  n=2 -> (1, 0),  n=3 -> (1, 1)
+// (this matches the construction of the tables in getLUT()).
+struct LogOpMasks {
+	explicit LogOpMasks(uint8_t op)
+		: m00((op & 1) ? 0xFF : 0x00)
+		, m01((op & 2) ? 0xFF : 0x00)
+		, m10((op & 4) ? 0xFF : 0x00)
+		, m11((op & 8) ? 0xFF : 0x00) {}
+
+	[[nodiscard]] uint8_t operator()(uint8_t src, uint8_t dst) const {
+		return uint8_t((~(src | dst) & m00) | (~src &  dst & m01) |
+		               ( src & ~dst & m10) | ( src &  dst & m11));
+	}
+
+	uint8_t m00, m01, m10, m11;
+};
+
+#ifdef __SSE2__
+[[nodiscard]] inline __m128i load128(const uint8_t* p)
+{
+	return _mm_loadu_si128(std::bit_cast<const __m128i*>(p));
+}
+[[nodiscard]] inline __m128i logOp128(
+	__m128i m00, __m128i m01, __m128i m10, __m128i m11, __m128i src, __m128i dst)
+{
+	auto r00 = _mm_andnot_si128(_mm_or_si128(src, dst), m00);
+	auto r01 = _mm_and_si128(_mm_andnot_si128(src, dst), m01);
+	auto r10 = _mm_and_si128(_mm_andnot_si128(dst, src), m10);
+	auto r11 = _mm_and_si128(_mm_and_si128(src, dst), m11);
+	return _mm_or_si128(_mm_or_si128(r00, r01), _mm_or_si128(r10, r11));
+}
+#endif
+
+// Source of a row operation: a single color (LMMV) or a VRAM range (LMMM).
+struct ColorSource {
+	uint8_t color;
+	[[nodiscard]] uint8_t operator[](size_t /*i*/) const { return color; }
+#ifdef __SSE2__
+	[[nodiscard]] __m128i load(size_t /*i*/) const { return _mm_set1_epi8(char(color)); }
+#endif
+};
+struct VRAMSource {
+	const uint8_t* src;
+	[[nodiscard]] uint8_t operator[](size_t i) const { return src[i]; }
+#ifdef __SSE2__
+	[[nodiscard]] __m128i load(size_t i) const { return load128(src + i); }
+#endif
+};
+
+// dst[i] = logOp(src[i], dst[i]) under 'mask'. When 'transp' is set, zero
+// source bytes leave the destination unchanged (8bpp transparency).
+template<typename Source>
+inline void blendBytes(uint8_t* dst, Source src, size_t num,
+                       LogOpMasks op, uint8_t mask, bool transp)
+{
+	size_t i = 0;
+#ifdef __SSE2__
+	auto m00 = _mm_set1_epi8(char(op.m00));
+	auto m01 = _mm_set1_epi8(char(op.m01));
+	auto m10 = _mm_set1_epi8(char(op.m10));
+	auto m11 = _mm_set1_epi8(char(op.m11));
+	auto wm = _mm_set1_epi8(char(mask));
+	auto zero = _mm_setzero_si128();
+	for (/**/; (i + 16) <= num; i += 16) {
+		auto s = src.load(i);
+		auto d = load128(dst + i);
+		auto r = logOp128(m00, m01, m10, m11, s, d);
+		auto m = transp ? _mm_andnot_si128(_mm_cmpeq_epi8(s, zero), wm) : wm;
+		auto result = _mm_xor_si128(d, _mm_and_si128(_mm_xor_si128(d, r), m));
+		_mm_storeu_si128(std::bit_cast<__m128i*>(dst + i), result);
+	}
+#endif
+	for (/**/; i < num; ++i) {
+		uint8_t s = src[i];
+		uint8_t d = dst[i];
+		uint8_t m = (transp && (s == 0)) ? 0 : mask;
+		dst[i] = uint8_t(d ^ ((d ^ op(s, d)) & m));
+	}
+}
+
+// Same as above, but for 16bpp pixels stored as separate low and high byte
+// ranges. Transparency applies to the full 16-bit pixel value.
+template<typename Source>
+inline void blendWords(uint8_t* dstLo, uint8_t* dstHi, Source srcLo, Source srcHi,
+                       size_t num, LogOpMasks op, uint16_t mask, bool transp)
+{
+	auto maskLo = narrow_cast<uint8_t>(mask & 0xFF);
+	auto maskHi = narrow_cast<uint8_t>(mask >> 8);
+	size_t i = 0;
+#ifdef __SSE2__
+	auto m00 = _mm_set1_epi8(char(op.m00));
+	auto m01 = _mm_set1_epi8(char(op.m01));
+	auto m10 = _mm_set1_epi8(char(op.m10));
+	auto m11 = _mm_set1_epi8(char(op.m11));
+	auto wmLo = _mm_set1_epi8(char(maskLo));
+	auto wmHi = _mm_set1_epi8(char(maskHi));
+	auto zero = _mm_setzero_si128();
+	for (/**/; (i + 16) <= num; i += 16) {
+		auto sLo = srcLo.load(i);
+		auto sHi = srcHi.load(i);
+		auto dLo = load128(dstLo + i);
+		auto dHi = load128(dstHi + i);
+		auto rLo = logOp128(m00, m01, m10, m11, sLo, dLo);
+		auto rHi = logOp128(m00, m01, m10, m11, sHi, dHi);
+		auto mLo = wmLo;
+		auto mHi = wmHi;
+		if (transp) {
+			auto t = _mm_and_si128(_mm_cmpeq_epi8(sLo, zero), _mm_cmpeq_epi8(sHi, zero));
+			mLo = _mm_andnot_si128(t, mLo);
+			mHi = _mm_andnot_si128(t, mHi);
+		}
+		_mm_storeu_si128(std::bit_cast<__m128i*>(dstLo + i),
+		                 _mm_xor_si128(dLo, _mm_and_si128(_mm_xor_si128(dLo, rLo), mLo)));
+		_mm_storeu_si128(std::bit_cast<__m128i*>(dstHi + i),
+		                 _mm_xor_si128(dHi, _mm_and_si128(_mm_xor_si128(dHi, rHi), mHi)));
+	}
+#endif
+	for (/**/; i < num; ++i) {
+		uint8_t sLo = srcLo[i];
+		uint8_t sHi = srcHi[i];
+		uint8_t dLo = dstLo[i];
+		uint8_t dHi = dstHi[i];
+		bool skip = transp && (sLo == 0) && (sHi == 0);
+		uint8_t mLo = skip ? 0 : maskLo;
+		uint8_t mHi = skip ? 0 : maskHi;
+		dstLo[i] = uint8_t(dLo ^ ((dLo ^ op(sLo, dLo)) & mLo));
+		dstHi[i] = uint8_t(dHi ^ ((dHi ^ op(sHi, dHi)) & mHi));
+	}
+}
+
+} // namespace openmsx::V9990LogOp
+
+#endif
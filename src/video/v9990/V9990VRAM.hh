@@ -7,6 +7,7 @@
 #include "TrackedRam.hh"
 
 #include <cstdint>
+#include <span>
 
 namespace openmsx {
 
@@ -80,6 +81,13 @@ public:
 		data.write(address, value);
 	}
 
+	/** Bulk access for the command engine.
+	  * See TrackedRam::getWriteBackdoor() for restrictions.
+	  */
+	[[nodiscard]] std::span<uint8_t> getWriteBackdoor() {
+		return data.getWriteBackdoor();
+	}
+
 	[[nodiscard]] uint8_t readVRAMCPU(unsigned address, EmuTime time);
 	void writeVRAMCPU(unsigned address, uint8_t val, EmuTime time);
 